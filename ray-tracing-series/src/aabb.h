@@ -0,0 +1,73 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // An axis-aligned bounding box, an empty box has its min greater than its max
+    class Aabb final
+    {
+    public:
+        Aabb()
+            : m_min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max())
+            , m_max(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max())
+        {
+        }
+        Aabb(const vec3& min, const vec3& max) : m_min(min), m_max(max) {}
+
+        const vec3& min() const { return m_min; }
+        const vec3& max() const { return m_max; }
+
+        bool isEmpty() const { return m_min.x() > m_max.x(); }
+        vec3 centroid() const { return 0.5f * (m_min + m_max); }
+
+        // Grow the box so that it contains the given point or box
+        inline void expand(const vec3& p);
+        inline void expand(const Aabb& box);
+
+        // Half of the surface area, the SAH only relies on area ratios so the factor 2 is dropped
+        inline float halfArea() const;
+
+    private:
+        vec3 m_min;
+        vec3 m_max;
+    };
+
+    inline void Aabb::expand(const vec3& p)
+    {
+        m_min = vec3(std::min(m_min.x(), p.x()), std::min(m_min.y(), p.y()), std::min(m_min.z(), p.z()));
+        m_max = vec3(std::max(m_max.x(), p.x()), std::max(m_max.y(), p.y()), std::max(m_max.z(), p.z()));
+    }
+
+    inline void Aabb::expand(const Aabb& box)
+    {
+        if (box.isEmpty())
+        {
+            return;
+        }
+        expand(box.m_min);
+        expand(box.m_max);
+    }
+
+    inline float Aabb::halfArea() const
+    {
+        if (isEmpty())
+        {
+            return 0.f;
+        }
+        vec3 d = m_max - m_min;
+        return d.x() * d.y() + d.y() * d.z() + d.z() * d.x();
+    }
+}
@@ -0,0 +1,1708 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bvh.h"
+#include "camera.h"
+#include "compressedsphereset.h"
+#include "config.h"
+#include "defines.h"
+#include "denoiser.h"
+#include "fastmath.h"
+#include "hdrimage.h"
+#include "imagetexture.h"
+#include "meshloader.h"
+#include "movingsphere.h"
+#include "numa.h"
+#include "outofcoresphereset.h"
+#include "plane.h"
+#include "preview.h"
+#include "random.h"
+#include "ray.h"
+#include "raytracer.h"
+#include "scene.h"
+#include "sphere.h"
+#include "sphereset.h"
+#include "texturecache.h"
+#include "threadpool.h"
+#include "timer.h"
+#include "tonemap.h"
+#include "transform.h"
+#include "utils.h"
+#include "vec3.h"
+#include "vec3a.h"
+#include "vec3x8.h"
+#include "worlds.h"
+
+namespace rts
+{
+    namespace
+    {
+        const std::size_t BENCHMARK_BINARY_SPHERE_COUNT = 10000000;
+        const std::size_t BENCHMARK_BVH_SPHERE_COUNT = 1000000;
+        const int BENCHMARK_RAY_COUNT = 100000;
+        const std::size_t BENCHMARK_TEXT_SPHERE_COUNT = 100000;
+        const std::size_t BENCHMARK_CLUSTER_SPHERE_COUNT = 1000;
+        const std::size_t BENCHMARK_CLUSTER_INSTANCE_COUNT = 1000;
+        const std::size_t BENCHMARK_MOTION_SPHERE_COUNT = 200000;
+        const float BENCHMARK_MOTION_DISTANCE = 1.f; // the distance travelled by the moving spheres during the shutter interval
+        const std::size_t BENCHMARK_OUT_OF_CORE_BRICK_SPHERE_COUNT = 1 << 14;
+        const std::size_t BENCHMARK_OUT_OF_CORE_CACHE_SIZE = 4 << 20;  // about an eighth of the bricks of the 1M spheres
+        const std::string BENCHMARK_OUT_OF_CORE_BRICK_FILE_PATH("output/benchmark_bricks.rtsk");
+        const std::size_t BENCHMARK_REFIT_SPHERE_COUNT = 200000;
+        const std::size_t BENCHMARK_REFIT_MOVING_SPHERE_COUNT = 2000;   // the spheres moving in a straight line from frame to frame
+        const std::size_t BENCHMARK_REFIT_EDIT_COUNT = 20;              // the spheres added and removed at each frame
+        const float BENCHMARK_REFIT_SPEED = 1.f;                        // the distance travelled by the moving spheres per frame
+        const int BENCHMARK_REFIT_FRAME_COUNT = 30;
+        const std::uint32_t BENCHMARK_MESH_RESOLUTION = 1000; // the torus has 2 * resolution^2 triangles
+        const std::size_t BENCHMARK_VECTOR_COUNT = 1 << 20; // a multiple of 8 for the wide kernels
+        const int BENCHMARK_VECTOR_PASS_COUNT = 20;
+        const int BENCHMARK_DENOISER_WIDTH = 200;   // the aspect ratio of the camera is the one of the image
+        const int BENCHMARK_DENOISER_HEIGHT = 150;
+        const int BENCHMARK_DENOISER_REFERENCE_RAY_COUNT = 1024;
+        const int BENCHMARK_SCALING_WIDTH = 200;    // the aspect ratio of the camera is the one of the image
+        const int BENCHMARK_SCALING_HEIGHT = 150;
+        const int BENCHMARK_SCALING_RAY_COUNT = 16;
+        const int BENCHMARK_MEDIUM_WIDTH = 200;     // the aspect ratio of the camera is the one of the image
+        const int BENCHMARK_MEDIUM_HEIGHT = 150;
+        const int BENCHMARK_MEDIUM_RAY_COUNT = 16;
+        const float BENCHMARK_FOG_RADIUS = 30.f;    // around the camera and the whole world
+        const float BENCHMARK_FOG_DENSITY = 0.03f;  // a mean free path of about 33, twice the distance from the camera to the world
+        const int BENCHMARK_SPECTRAL_WIDTH = 200;   // the aspect ratio of the camera is the one of the image
+        const int BENCHMARK_SPECTRAL_HEIGHT = 150;
+        const int BENCHMARK_SPECTRAL_RAY_COUNT = 16;
+        const float BENCHMARK_GLASS_CAUCHY_B = 0.0042f; // about the dispersion of a crown glass
+        const int BENCHMARK_ENVIRONMENT_WIDTH = 160;    // the aspect ratio of the camera is the one of the image
+        const int BENCHMARK_ENVIRONMENT_HEIGHT = 120;
+        const int BENCHMARK_ENVIRONMENT_RAY_COUNT = 16;
+        const int BENCHMARK_ENVIRONMENT_REFERENCE_RAY_COUNT = 256;
+        const float BENCHMARK_SUN_RADIANCE = 2000.f;    // about twice the light of the sky on the ground
+        const float BENCHMARK_SUN_ANGULAR_RADIUS = 0.035f;
+        const std::string BENCHMARK_ENVIRONMENT_FILE_PATH("output/benchmark_environment.pfm");
+        const int BENCHMARK_ROUGH_WIDTH = 160;          // the aspect ratio of the camera is the one of the image
+        const int BENCHMARK_ROUGH_HEIGHT = 120;
+        const int BENCHMARK_ROUGH_RAY_COUNT = 16;
+        const int BENCHMARK_ROUGH_SPHERE_COUNT = 5;     // from a roughness of 0 to 1
+        const std::size_t BENCHMARK_SPHERE_RAY_COUNT = 1 << 20;
+        const int BENCHMARK_GROUND_WIDTH = 200;         // the aspect ratio of the camera is the one of the image
+        const int BENCHMARK_GROUND_HEIGHT = 150;
+        const int BENCHMARK_GROUND_RAY_COUNT = 16;
+        const std::string BENCHMARK_PREVIEW_FRAMEBUFFER_NAME("rts_preview_benchmark");
+        const int BENCHMARK_PREVIEW_SAMPLE_COUNT = 8;   // the rays per pixel accumulated before the camera is moved
+        const int BENCHMARK_TEXTURE_SIZE = 2048;
+        const int BENCHMARK_TEXTURE_LOOKUP_SIZE = 2048; // the lookups are made for a square of pixels in scanline order
+        const std::size_t BENCHMARK_TEXTURE_CACHE_SIZE = 4 << 20;   // about a fifth of the tiled texture file
+        const std::string BENCHMARK_TEXTURE_FILE_PATH("output/benchmark_texture.rtst");
+        const std::string BENCHMARK_BINARY_SCENE_FILE_PATH("output/benchmark_scene.rtsb");
+        const std::string BENCHMARK_TEXT_SCENE_FILE_PATH("output/benchmark_scene.txt");
+
+        // A latitude-longitude sky which gets bluer towards the zenith, with a small and bright sun
+        HdrImage generateSkyImage(int width, int height)
+        {
+            const float pi = static_cast<float>(M_PI);
+            vec3 sunDirection = unitVector(vec3(-0.5f, 0.6f, 0.6f));
+            HdrImage image;
+            image.resize(width, height);
+            for (int j = 0; j < height; ++j)
+            {
+                float theta = (1.f - (j + 0.5f) / height) * pi;
+                for (int i = 0; i < width; ++i)
+                {
+                    float phi = 2.f * pi * (i + 0.5f) / width;
+                    vec3 direction(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+                    float t = std::max(direction.y(), 0.f);
+                    vec3 color = (direction.y() < 0.f) ? vec3(0.3f, 0.3f, 0.3f) : (1.f - t) * vec3(1.f, 1.f, 1.f) + t * vec3(0.4f, 0.6f, 1.f);
+                    if (dot(direction, sunDirection) > std::cos(BENCHMARK_SUN_ANGULAR_RADIUS))
+                    {
+                        color = BENCHMARK_SUN_RADIANCE * vec3(1.f, 0.9f, 0.8f);
+                    }
+                    image.at(i, j) = color;
+                }
+            }
+            return image;
+        }
+
+        // Generate spheres of random materials scattered in a cube, the cube grows with the sphere count
+        void generateBenchmarkWorld(Scene& scene, std::size_t sphereCount)
+        {
+            Random random;
+            const std::uint32_t materialCount = 64;
+            for (std::uint32_t i = 0; i < materialCount; ++i)
+            {
+                vec3 albedo(random.get(), random.get(), random.get());
+                scene.addMaterial((i % 2 == 0) ? makeLambertianRecord(albedo) : makeMetalRecord(albedo, random.get()));
+            }
+
+            float extent = 2.f * std::cbrt(static_cast<float>(sphereCount));
+            for (std::size_t i = 0; i < sphereCount; ++i)
+            {
+                vec3 center = extent * vec3(random.get() - 0.5f, random.get() - 0.5f, random.get() - 0.5f);
+                scene.addSphere(center, 0.1f + 0.2f * random.get(), static_cast<std::uint32_t>(i % materialCount));
+            }
+        }
+
+        // Fill a scene with copies of a cluster of spheres, either as instances of a single group or flattened
+        void generateClusterWorld(Scene& scene, bool useInstances)
+        {
+            Scene cluster;
+            generateBenchmarkWorld(cluster, BENCHMARK_CLUSTER_SPHERE_COUNT);
+            for (std::size_t i = 0; i < cluster.getMaterialCount(); ++i)
+            {
+                scene.addMaterial(makeLambertianRecord(vec3(0.5f, 0.5f, 0.5f)));
+            }
+            std::uint32_t group = useInstances ? scene.addGroup() : 0;
+            if (useInstances)
+            {
+                for (std::size_t i = 0; i < cluster.getSphereCount(); ++i)
+                {
+                    const auto& sphere = cluster.getSpheres()[i];
+                    scene.addGroupSphere(group, vec3(sphere.center[0], sphere.center[1], sphere.center[2]), sphere.radius, sphere.materialIndex);
+                }
+            }
+
+            // The clusters are placed with a random rotation and scale in a cube which grows with their count
+            Random random;
+            float extent = 40.f * std::cbrt(static_cast<float>(BENCHMARK_CLUSTER_INSTANCE_COUNT));
+            for (std::size_t i = 0; i < BENCHMARK_CLUSTER_INSTANCE_COUNT; ++i)
+            {
+                vec3 translation = extent * vec3(random.get() - 0.5f, random.get() - 0.5f, random.get() - 0.5f);
+                float scale = 0.5f + random.get();
+                Transform transform = Transform::translation(translation) * Transform::rotationY(360.f * random.get()) * Transform::scale(scale);
+                if (useInstances)
+                {
+                    scene.addInstance(group, transform);
+                    continue;
+                }
+
+                for (std::size_t j = 0; j < cluster.getSphereCount(); ++j)
+                {
+                    const auto& sphere = cluster.getSpheres()[j];
+                    vec3 center = transform.transformPoint(vec3(sphere.center[0], sphere.center[1], sphere.center[2]));
+                    scene.addSphere(center, scale * sphere.radius, sphere.materialIndex);
+                }
+            }
+        }
+
+        // A few large spheres of each material over a ground sphere, surrounded by a ring of small diffuse ones
+        void generateDenoiserWorld(Scene& scene)
+        {
+            scene.addSphere(vec3(0.f, -1000.f, 0.f), 1000.f, scene.addMaterial(makeLambertianRecord(vec3(0.5f, 0.5f, 0.5f))));
+            scene.addSphere(vec3(-2.2f, 1.f, 0.f), 1.f, scene.addMaterial(makeLambertianRecord(vec3(0.4f, 0.2f, 0.1f))));
+            scene.addSphere(vec3(0.f, 1.f, 0.f), 1.f, scene.addMaterial(makeDielectricRecord(vec3(1.f, 1.f, 1.f), 1.5f)));
+            scene.addSphere(vec3(2.2f, 1.f, 0.f), 1.f, scene.addMaterial(makeMetalRecord(vec3(0.7f, 0.6f, 0.5f), 0.2f)));
+
+            Random random;
+            for (int i = 0; i < 24; ++i)
+            {
+                float angle = 2.f * 3.14159265f * i / 24.f;
+                vec3 albedo(random.get() * random.get(), random.get() * random.get(), random.get() * random.get());
+                scene.addSphere(vec3(4.f * std::cos(angle), 0.25f, 4.f * std::sin(angle)), 0.25f, scene.addMaterial(makeLambertianRecord(albedo)));
+            }
+
+            scene.setCamera({ { 0.f, 2.5f, 7.f }, { 0.f, 0.7f, 0.f }, { 0.f, 1.f, 0.f }, 50.f, 0.f, 0.f, 0.f, 0.f });
+        }
+
+        // A row of metal spheres from a polished one to a matte one, made of fuzzy metals as in the book or of rough conductors
+        void generateRoughWorld(Scene& scene, bool microfacets)
+        {
+            scene.addSphere(vec3(0.f, -1000.f, 0.f), 1000.f, scene.addMaterial(makeLambertianRecord(vec3(0.5f, 0.5f, 0.5f))));
+            for (int i = 0; i < BENCHMARK_ROUGH_SPHERE_COUNT; ++i)
+            {
+                float roughness = static_cast<float>(i) / (BENCHMARK_ROUGH_SPHERE_COUNT - 1);
+                vec3 albedo(0.9f, 0.6f, 0.3f);
+                MaterialRecord material = microfacets ? makeRoughConductorRecord(albedo, roughness) : makeMetalRecord(albedo, roughness);
+                scene.addSphere(vec3(2.2f * (i - 0.5f * (BENCHMARK_ROUGH_SPHERE_COUNT - 1)), 1.f, 0.f), 1.f, scene.addMaterial(material));
+            }
+            scene.setCamera({ { 0.f, 1.6f, 8.f }, { 0.f, 1.f, 0.f }, { 0.f, 1.f, 0.f }, 48.f, 0.f, 0.f, 0.f, 0.f });
+        }
+
+        // Render the random world with the workers of the pool only, the calling thread waits without taking part
+        double measureScalingRender(ThreadPool& pool, const std::vector<const Scene*>& nodeScenes, const Camera& camera, HdrImage& image)
+        {
+            image.resize(BENCHMARK_SCALING_WIDTH, BENCHMARK_SCALING_HEIGHT);
+
+            Timer timer;
+            timer.setStartTime();
+            std::promise<void> done;
+            std::future<void> doneFuture = done.get_future();
+            pool.submit([&]()
+            {
+                rayTracingMainTask(camera, nodeScenes, BENCHMARK_SCALING_RAY_COUNT, &image, nullptr, &pool);
+                done.set_value();
+            });
+            doneFuture.wait();
+            return timer.getElapsedTime();
+        }
+
+        // Tessellate a torus with smooth normals, its major radius is 1 and its minor radius 0.3
+        TriangleMeshData generateTorusMesh(std::uint32_t resolution)
+        {
+            const float majorRadius = 1.f;
+            const float minorRadius = 0.3f;
+            const float twoPi = 2.f * static_cast<float>(M_PI);
+
+            TriangleMeshData mesh;
+            mesh.hasNormals = true;
+            mesh.vertices.reserve(static_cast<std::size_t>(resolution) * resolution);
+            for (std::uint32_t i = 0; i < resolution; ++i)
+            {
+                float theta = twoPi * i / resolution;
+                for (std::uint32_t j = 0; j < resolution; ++j)
+                {
+                    float phi = twoPi * j / resolution;
+                    vec3 normal(cos(theta) * cos(phi), sin(phi), sin(theta) * cos(phi));
+                    vec3 position = majorRadius * vec3(cos(theta), 0.f, sin(theta)) + minorRadius * normal;
+                    mesh.vertices.push_back({ { position.x(), position.y(), position.z() }, { normal.x(), normal.y(), normal.z() } });
+                }
+            }
+
+            // Two triangles per quad of the grid, which wraps around in both directions
+            mesh.indices.reserve(6 * static_cast<std::size_t>(resolution) * resolution);
+            for (std::uint32_t i = 0; i < resolution; ++i)
+            {
+                for (std::uint32_t j = 0; j < resolution; ++j)
+                {
+                    std::uint32_t i1 = (i + 1) % resolution;
+                    std::uint32_t j1 = (j + 1) % resolution;
+                    std::uint32_t quad[4] = { i * resolution + j, i1 * resolution + j, i1 * resolution + j1, i * resolution + j1 };
+                    mesh.indices.insert(mesh.indices.end(), { quad[0], quad[2], quad[1], quad[0], quad[3], quad[2] });
+                }
+            }
+            return mesh;
+        }
+
+        void benchmarkFormat(std::size_t sphereCount, const std::string& filePath, bool binary)
+        {
+            Timer timer;
+            {
+                Scene scene;
+                generateBenchmarkWorld(scene, sphereCount);
+
+                timer.setStartTime();
+                bool saved = binary ? scene.saveBinaryFile(filePath) : scene.saveTextFile(filePath);
+                if (!saved)
+                {
+                    return;
+                }
+                std::cout << "    save: " << timer.getElapsedTime() << "s\n";
+            }
+
+            Scene scene;
+            timer.setStartTime();
+            bool loaded = binary ? scene.loadBinaryFile(filePath) : scene.loadTextFile(filePath);
+            double loadTime = timer.getElapsedTime();
+            if (loaded)
+            {
+                std::cout << "    load: " << loadTime << "s ("
+                    << 1e9 * loadTime / static_cast<double>(scene.getSphereCount()) << "ns per sphere)\n";
+
+                // Access every sphere once, for the binary format this accounts for the cost of paging the file in
+                // note that the BVH isn't built here, it's measured separately (see benchmarkBvhConstruction)
+                timer.setStartTime();
+                float radiusSum = 0.f;
+                for (std::size_t i = 0; i < scene.getSphereCount(); ++i)
+                {
+                    radiusSum += scene.getSpheres()[i].radius;
+                }
+                std::cout << "    first pass over the spheres: " << timer.getElapsedTime() << "s (checksum " << radiusSum << ")\n";
+            }
+
+            std::remove(filePath.c_str());
+        }
+
+        // The same vectors stored both as an array of vec3 and as a structure of arrays for vec3x8
+        struct BenchmarkVectors
+        {
+            std::vector<vec3> vectors;
+            std::vector<float> x, y, z;
+
+            void add(const vec3& v)
+            {
+                vectors.push_back(v);
+                x.push_back(v.x());
+                y.push_back(v.y());
+                z.push_back(v.z());
+            }
+
+            vec3x8 load(std::size_t i) const { return vec3x8::load(&x[i], &y[i], &z[i]); }
+        };
+
+        // The sphere intersection and the metal scatter are written once for vec3 and vec3a, both types share the same operators
+        template <typename Vector>
+        bool intersectSphereKernel(const Vector& origin, const Vector& direction, const Vector& center, float radius, float& t)
+        {
+            Vector oc = origin - center;
+            float a = dot(direction, direction);
+            float b = dot(oc, direction);
+            float c = dot(oc, oc) - radius * radius;
+            float discriminant = b * b - a * c;
+            t = (-b - std::sqrt(std::max(discriminant, 0.f))) / a;
+            return discriminant > 0.f && t > 0.f;
+        }
+
+        floatx8 intersectSphereKernel(const vec3x8& origin, const vec3x8& direction, const vec3x8& center, const floatx8& radius, floatx8& t)
+        {
+            vec3x8 oc = origin - center;
+            floatx8 a = dot(direction, direction);
+            floatx8 b = dot(oc, direction);
+            floatx8 c = dot(oc, oc) - radius * radius;
+            floatx8 discriminant = b * b - a * c;
+            t = (-b - sqrtx8(maxx8(discriminant, 0.f))) / a;
+            return (discriminant > 0.f) & (t > 0.f);
+        }
+
+        template <typename Vector>
+        Vector scatterMetalKernel(const Vector& direction, const Vector& normal, const Vector& randomPoint, float fuzz)
+        {
+            Vector v = unitVector(direction);
+            Vector reflected = v - 2.f * dot(v, normal) * normal;
+            return unitVector(reflected + fuzz * randomPoint);
+        }
+
+        vec3x8 scatterMetalKernel(const vec3x8& direction, const vec3x8& normal, const vec3x8& randomPoint, const floatx8& fuzz)
+        {
+            vec3x8 v = unitVector(direction);
+            vec3x8 reflected = v - floatx8(2.f) * dot(v, normal) * normal;
+            return unitVector(reflected + fuzz * randomPoint);
+        }
+
+        // Run the intersection kernel of the given vector type over all the ray and sphere pairs, return the time of a pass
+        template <typename Vector>
+        double measureIntersectionKernel(const BenchmarkVectors& origins, const BenchmarkVectors& directions, const BenchmarkVectors& centers,
+            const std::vector<float>& radii, std::size_t& hitCount)
+        {
+            Timer timer;
+            timer.setStartTime();
+            for (int pass = 0; pass < BENCHMARK_VECTOR_PASS_COUNT; ++pass)
+            {
+                hitCount = 0;
+                for (std::size_t i = 0; i < BENCHMARK_VECTOR_COUNT; ++i)
+                {
+                    float t;
+                    hitCount += intersectSphereKernel(Vector(origins.vectors[i]), Vector(directions.vectors[i]), Vector(centers.vectors[i]), radii[i], t) ? 1 : 0;
+                }
+            }
+            return timer.getElapsedTime() / BENCHMARK_VECTOR_PASS_COUNT;
+        }
+
+        template <typename Vector>
+        double measureScatterKernel(const BenchmarkVectors& directions, const BenchmarkVectors& normals, const BenchmarkVectors& randomPoints,
+            std::vector<vec3>& scattered)
+        {
+            Timer timer;
+            timer.setStartTime();
+            for (int pass = 0; pass < BENCHMARK_VECTOR_PASS_COUNT; ++pass)
+            {
+                for (std::size_t i = 0; i < BENCHMARK_VECTOR_COUNT; ++i)
+                {
+                    Vector v = scatterMetalKernel(Vector(directions.vectors[i]), Vector(normals.vectors[i]), Vector(randomPoints.vectors[i]), 0.3f);
+                    scattered[i] = vec3(v.x(), v.y(), v.z());
+                }
+            }
+            return timer.getElapsedTime() / BENCHMARK_VECTOR_PASS_COUNT;
+        }
+
+        // Run the kernel over all the inputs with the given fast-math features, return the time per input in ns
+        template <typename Kernel>
+        double measureFastMathKernel(unsigned features, Kernel&& kernel)
+        {
+            FastMath::setFeatures(features);
+            Timer timer;
+            timer.setStartTime();
+            for (int pass = 0; pass < BENCHMARK_VECTOR_PASS_COUNT; ++pass)
+            {
+                for (std::size_t i = 0; i < BENCHMARK_VECTOR_COUNT; ++i)
+                {
+                    kernel(i);
+                }
+            }
+            return timer.getElapsedTime() * 1e9 / (static_cast<double>(BENCHMARK_VECTOR_PASS_COUNT) * BENCHMARK_VECTOR_COUNT);
+        }
+
+        // The sphere intersection of the book, b * b - c and -b - sqrt, it's the baseline of Sphere::intersect
+        bool intersectBookSphere(const vec3& center, float radius, const Ray& r, float tMin, float tMax, float& t)
+        {
+            vec3 oc = r.origin() - center;
+            float b = dot(oc, r.direction());
+            float c = dot(oc, oc) - radius * radius;
+            float discriminant = b * b - c;
+            if (discriminant > 0.f)
+            {
+                float discriminantSqrt = std::sqrt(discriminant);
+                t = -b - discriminantSqrt;
+                if (tMin < t && t < tMax)
+                {
+                    return true;
+                }
+                t = -b + discriminantSqrt;
+                if (tMin < t && t < tMax)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // The same arguments for Sphere::intersect, which takes the squared radius
+        bool intersectRobustSphere(const vec3& center, float radius, const Ray& r, float tMin, float tMax, float& t)
+        {
+            return Sphere::intersect(center, radius * radius, r, tMin, tMax, t);
+        }
+
+        // The distance to the first intersection in front of the ray in double precision, a negative value when there's none
+        double intersectSphereExactly(const vec3& center, float radius, const Ray& r)
+        {
+            double oc[3], d[3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                oc[axis] = static_cast<double>(r.origin()[axis]) - center[axis];
+                d[axis] = r.direction()[axis];
+            }
+            double a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            double b = oc[0] * d[0] + oc[1] * d[1] + oc[2] * d[2];
+            double c = oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2] - static_cast<double>(radius) * radius;
+            double discriminant = b * b - a * c;
+            if (discriminant < 0.0)
+            {
+                return -1.0;
+            }
+            double q = -b - std::copysign(std::sqrt(discriminant), b);
+            double t0 = std::min(c / q, q / a);
+            double t1 = std::max(c / q, q / a);
+            return (t0 > 0.0) ? t0 : t1;
+        }
+
+        // Rays aimed at the points of a sphere which they see, hence they must all hit it, they start at the given distance
+        // from its center, or from the height of the camera of the random world above its top when distance is 0
+        std::vector<Ray> generateSphereRays(const vec3& center, float radius, float distance, Random& random)
+        {
+            std::vector<Ray> rays;
+            rays.reserve(BENCHMARK_SPHERE_RAY_COUNT);
+            while (rays.size() < BENCHMARK_SPHERE_RAY_COUNT)
+            {
+                vec3 origin, normal;
+                if (distance > 0.f)
+                {
+                    origin = center + distance * getUnitVector(getRandomPointInUnitSphere(random));
+                    normal = getUnitVector(getRandomPointInUnitSphere(random));
+                }
+                else
+                {
+                    origin = center + vec3(100.f * random.get() - 50.f, radius + 0.5f + 1.5f * random.get(), 100.f * random.get() - 50.f);
+                    normal = getUnitVector(vec3(200.f * random.get() - 100.f, radius, 200.f * random.get() - 100.f));
+                }
+                vec3 target = center + radius * normal;
+                if (dot(normal, origin - target) > 0.f)
+                {
+                    rays.push_back(Ray(origin, target - origin));
+                }
+            }
+            return rays;
+        }
+
+        // Generate random rays starting inside the given bounds, they're spread over the [0, 1) time interval when randomTime is set
+        std::vector<Ray> generateBenchmarkRays(const Aabb& bounds, bool randomTime)
+        {
+            Random random;
+            vec3 extent = bounds.max() - bounds.min();
+            std::vector<Ray> rays;
+            rays.reserve(BENCHMARK_RAY_COUNT);
+            for (int i = 0; i < BENCHMARK_RAY_COUNT; ++i)
+            {
+                vec3 origin = bounds.min() + vec3(random.get(), random.get(), random.get()) * extent;
+                vec3 direction = getRandomPointInUnitSphere(random);
+                rays.push_back(Ray(origin, direction, randomTime ? random.get() : 0.f));
+            }
+            return rays;
+        }
+
+        // Trace random rays starting inside the world's bounds and return the number of rays traced per second
+        double measureTracePerformance(const Hitable& world, const Aabb& bounds, bool randomTime = false)
+        {
+            std::vector<Ray> rays = generateBenchmarkRays(bounds, randomTime);
+
+            Timer timer;
+            timer.setStartTime();
+            int hitCount = 0;
+            for (const auto& r : rays)
+            {
+                HitRecord rec;
+                hitCount += world.hit(r, RAY_LENGTH_MIN, RAY_LENGTH_MAX, rec) ? 1 : 0;
+            }
+            double elapsedTime = timer.getElapsedTime();
+            RTS_UNUSED(hitCount);
+            return BENCHMARK_RAY_COUNT / elapsedTime;
+        }
+
+        // Make a lookup for each pixel of a square in scanline order, the square is rotated over the texture and a pixel covers
+        // texelsPerPixel texels, return the number of lookups per second, lookup takes the coordinates and the level of detail
+        template<typename Lookup>
+        double measureTextureLookups(float texelsPerPixel, Lookup&& lookup)
+        {
+            const float step = texelsPerPixel / BENCHMARK_TEXTURE_SIZE;
+            const float cosAngle = std::cos(0.5f), sinAngle = std::sin(0.5f);
+            const float lod = std::log2(texelsPerPixel);
+
+            Timer timer;
+            timer.setStartTime();
+            vec3 sum(0.f, 0.f, 0.f);
+            for (int y = 0; y < BENCHMARK_TEXTURE_LOOKUP_SIZE; ++y)
+            {
+                for (int x = 0; x < BENCHMARK_TEXTURE_LOOKUP_SIZE; ++x)
+                {
+                    float u = step * (cosAngle * x - sinAngle * y);
+                    float v = step * (sinAngle * x + cosAngle * y);
+                    sum += lookup(u, v, lod);
+                }
+            }
+            double elapsedTime = timer.getElapsedTime();
+
+            // Use the colors so that the lookups aren't optimized away
+            if (!(sum.r() >= 0.f))
+            {
+                return 0.;
+            }
+            return static_cast<double>(BENCHMARK_TEXTURE_LOOKUP_SIZE) * BENCHMARK_TEXTURE_LOOKUP_SIZE / elapsedTime;
+        }
+    }
+
+    void benchmarkFastMath()
+    {
+        unsigned previousFeatures = FastMath::getFeatures();
+        const std::size_t count = BENCHMARK_VECTOR_COUNT;
+
+        // The colors are skewed towards the dark values where the gamma curve is the steepest
+        Random random;
+        std::vector<float> cosines(count);
+        std::vector<vec3> colors(count), vectors(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            cosines[i] = random.get();
+            colors[i] = vec3(powInt(random.get(), 3), powInt(random.get(), 3), powInt(random.get(), 3));
+            vectors[i] = (0.1f + 10.f * random.get()) * getRandomPointInUnitSphere(random);
+        }
+
+        std::cout << "Fast-math approximations over " << count << " values" << std::endl;
+
+        // Schlick's approximation, pow against the integer powers
+        std::vector<float> precise(count), approximated(count);
+        double preciseTime = measureFastMathKernel(FAST_MATH_NONE, [&](std::size_t i) { precise[i] = getSchlickApproximation(cosines[i], 1.5f); });
+        double fastTime = measureFastMathKernel(FAST_MATH_INTEGER_POW, [&](std::size_t i) { approximated[i] = getSchlickApproximation(cosines[i], 1.5f); });
+        float maxError = 0.f;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            maxError = std::max(maxError, std::fabs(approximated[i] - precise[i]) / precise[i]);
+        }
+        std::cout << "    Schlick, pow: " << preciseTime << " ns, integer powers: " << fastTime << " ns, x" << preciseTime / fastTime
+            << " (max relative error " << maxError << ")" << std::endl;
+
+        // Gamma correction and 8-bit conversion, pow against sqrt and the lookup table
+        std::vector<int> preciseLevels(3 * count), sqrtLevels(3 * count), lutLevels(3 * count);
+        preciseTime = measureFastMathKernel(FAST_MATH_NONE, [&](std::size_t i) { convertToRgb8(colors[i], IMAGE_GAMMA_CORRECTION, &preciseLevels[3 * i]); });
+        double sqrtTime = measureFastMathKernel(FAST_MATH_GAMMA_SQRT, [&](std::size_t i) { convertToRgb8(colors[i], IMAGE_GAMMA_CORRECTION, &sqrtLevels[3 * i]); });
+        double lutTime = measureFastMathKernel(FAST_MATH_GAMMA_LUT, [&](std::size_t i) { convertToRgb8(colors[i], IMAGE_GAMMA_CORRECTION, &lutLevels[3 * i]); });
+        std::size_t sqrtMismatchCount = 0, lutMismatchCount = 0;
+        int sqrtMaxError = 0, lutMaxError = 0;
+        for (std::size_t i = 0; i < 3 * count; ++i)
+        {
+            sqrtMismatchCount += (sqrtLevels[i] != preciseLevels[i]) ? 1 : 0;
+            lutMismatchCount += (lutLevels[i] != preciseLevels[i]) ? 1 : 0;
+            sqrtMaxError = std::max(sqrtMaxError, std::abs(sqrtLevels[i] - preciseLevels[i]));
+            lutMaxError = std::max(lutMaxError, std::abs(lutLevels[i] - preciseLevels[i]));
+        }
+        std::cout << "    gamma, pow: " << preciseTime << " ns, sqrt: " << sqrtTime << " ns, x" << preciseTime / sqrtTime
+            << " (" << sqrtMismatchCount << " levels off by at most " << sqrtMaxError << "), lookup table: " << lutTime << " ns, x" << preciseTime / lutTime
+            << " (" << lutMismatchCount << " levels off by at most " << lutMaxError << ")" << std::endl;
+
+        // Normalization, sqrt and division against rsqrt
+        std::vector<vec3> preciseVectors(count), approximatedVectors(count);
+        preciseTime = measureFastMathKernel(FAST_MATH_NONE, [&](std::size_t i) { preciseVectors[i] = getUnitVector(vectors[i]); });
+        fastTime = measureFastMathKernel(FAST_MATH_RSQRT_NORMALIZE, [&](std::size_t i) { approximatedVectors[i] = getUnitVector(vectors[i]); });
+        maxError = 0.f;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            maxError = std::max(maxError, std::fabs(approximatedVectors[i].length() - 1.f));
+        }
+        std::cout << "    normalize, sqrt: " << preciseTime << " ns, rsqrt: " << fastTime << " ns, x" << preciseTime / fastTime
+            << " (max length error " << maxError << ")" << std::endl;
+
+        FastMath::setFeatures(previousFeatures);
+        std::cout << std::endl;
+    }
+
+    void benchmarkSphereIntersection()
+    {
+        unsigned previousFeatures = FastMath::getFeatures();
+        std::cout << "Sphere intersection of the book against Sphere::intersect over " << BENCHMARK_SPHERE_RAY_COUNT << " rays per setup" << std::endl;
+
+        // The rays are normalized precisely, the error left is the one of the intersection
+        FastMath::setFeatures(FAST_MATH_NONE);
+        struct Setup
+        {
+            const char* name;
+            vec3 center;
+            float radius;
+            float distance;
+        };
+        const Setup setups[] = {
+            { "radius 0.2 at a distance of 10", vec3(4.f, 1.f, 0.f), 0.2f, 10.f },
+            { "radius 0.2 at a distance of 1000", vec3(4.f, 1.f, 0.f), 0.2f, 1000.f },
+            { "ground of radius 1000 from a height of 0.5 to 2", vec3(0.f, -1000.f, 0.f), 1000.f, 0.f }
+        };
+        Random random;
+        std::vector<Ray> groundRays;
+        for (const Setup& setup : setups)
+        {
+            std::vector<Ray> rays = generateSphereRays(setup.center, setup.radius, setup.distance, random);
+            std::vector<double> references(rays.size());
+            for (std::size_t i = 0; i < rays.size(); ++i)
+            {
+                references[i] = intersectSphereExactly(setup.center, setup.radius, rays[i]);
+            }
+
+            // The relative error of the distance to the hit and the rays which miss, the rays which graze the sphere so closely
+            // that they miss it in double precision as well are left out, the time is the one of a ray/sphere test
+            auto measure = [&](auto&& intersect, double& time, double& meanError, double& maxError, std::size_t& missCount)
+            {
+                meanError = maxError = 0.0;
+                missCount = 0;
+                std::size_t hitCount = 0;
+                float sum = 0.f;
+                Timer timer;
+                timer.setStartTime();
+                for (std::size_t i = 0; i < rays.size(); ++i)
+                {
+                    float t;
+                    if (intersect(setup.center, setup.radius, rays[i], 0.f, RAY_LENGTH_MAX, t))
+                    {
+                        sum += t;
+                    }
+                }
+                time = timer.getElapsedTime() * 1e9 / rays.size();
+                for (std::size_t i = 0; i < rays.size(); ++i)
+                {
+                    float t;
+                    if (references[i] <= 0.0)
+                    {
+                        continue;
+                    }
+                    if (intersect(setup.center, setup.radius, rays[i], 0.f, RAY_LENGTH_MAX, t))
+                    {
+                        double error = std::fabs(t - references[i]) / references[i];
+                        meanError += error;
+                        maxError = std::max(maxError, error);
+                        ++hitCount;
+                    }
+                    else
+                    {
+                        ++missCount;
+                    }
+                }
+                meanError /= std::max<std::size_t>(hitCount, 1);
+                RTS_UNUSED(sum);
+            };
+            double bookTime, bookMeanError, bookMaxError, robustTime, robustMeanError, robustMaxError;
+            std::size_t bookMissCount, robustMissCount;
+            measure(intersectBookSphere, bookTime, bookMeanError, bookMaxError, bookMissCount);
+            measure(intersectRobustSphere, robustTime, robustMeanError, robustMaxError, robustMissCount);
+            std::cout << "    " << setup.name << ", book: " << bookTime << " ns, relative error " << bookMeanError << " (max " << bookMaxError << "), "
+                << bookMissCount << " misses" << std::endl;
+            std::cout << "    " << setup.name << ", robust: " << robustTime << " ns, relative error " << robustMeanError << " (max " << robustMaxError
+                << "), " << robustMissCount << " misses" << std::endl;
+
+            if (setup.distance == 0.f)
+            {
+                groundRays = std::move(rays);
+            }
+        }
+
+        // The rays scattered by the ground which hit it again, they start at the hits of the rays aimed at it from the camera height
+        // without the margin of RAY_LENGTH_MIN and with it, the plane is the same ground without the curvature
+        const Setup& ground = setups[2];
+        Plane plane(ground.center + vec3(0.f, ground.radius, 0.f), vec3(0.f, 1.f, 0.f), nullptr);
+        auto countSelfIntersections = [&](auto&& hitGround, std::size_t& count, std::size_t& marginCount)
+        {
+            count = marginCount = 0;
+            for (const Ray& r : groundRays)
+            {
+                HitRecord rec;
+                if (hitGround(r, 0.f, rec))
+                {
+                    Ray scattered(rec.p, getCosineWeightedDirection(rec.normal, random));
+                    HitRecord scatteredRec;
+                    count += hitGround(scattered, 0.f, scatteredRec) ? 1 : 0;
+                    marginCount += hitGround(scattered, RAY_LENGTH_MIN, scatteredRec) ? 1 : 0;
+                }
+            }
+        };
+        auto hitSphere = [&](auto&& intersect)
+        {
+            return [&, intersect](const Ray& r, float tMin, HitRecord& rec)
+            {
+                if (!intersect(ground.center, ground.radius, r, tMin, RAY_LENGTH_MAX, rec.t))
+                {
+                    return false;
+                }
+                rec.p = r.pointAtParameter(rec.t);
+                rec.normal = (rec.p - ground.center) / ground.radius;
+                return true;
+            };
+        };
+        std::size_t bookCount, bookMarginCount, robustCount, robustMarginCount, planeCount, planeMarginCount;
+        countSelfIntersections(hitSphere(intersectBookSphere), bookCount, bookMarginCount);
+        countSelfIntersections(hitSphere(intersectRobustSphere), robustCount, robustMarginCount);
+        countSelfIntersections([&](const Ray& r, float tMin, HitRecord& rec) { return plane.hit(r, tMin, RAY_LENGTH_MAX, rec); }, planeCount, planeMarginCount);
+        std::cout << "    rays scattered by the ground which hit it again, book: " << bookCount << " (" << bookMarginCount << " with RAY_LENGTH_MIN), robust: "
+            << robustCount << " (" << robustMarginCount << "), plane: " << planeCount << " (" << planeMarginCount << ")" << std::endl;
+        FastMath::setFeatures(previousFeatures);
+
+        // The random world on its ground sphere against the plane
+        double sphereTime = 0.;
+        for (int setup = 0; setup < 2; ++setup)
+        {
+            Scene scene;
+            generateRandomWorld(scene, makeNoDispersionRecord(), setup == 0);
+            scene.commit();
+            std::unique_ptr<Camera> camera = scene.createCamera(static_cast<float>(BENCHMARK_GROUND_WIDTH) / BENCHMARK_GROUND_HEIGHT);
+
+            HdrImage image;
+            image.resize(BENCHMARK_GROUND_WIDTH, BENCHMARK_GROUND_HEIGHT);
+            Timer timer;
+            timer.setStartTime();
+            rayTracingMainTask(*camera, scene, BENCHMARK_GROUND_RAY_COUNT, &image);
+            double renderTime = timer.getElapsedTime();
+            if (setup == 0)
+            {
+                sphereTime = renderTime;
+            }
+            double sampleRate = static_cast<double>(BENCHMARK_GROUND_WIDTH) * BENCHMARK_GROUND_HEIGHT * BENCHMARK_GROUND_RAY_COUNT / renderTime;
+            std::cout << "    random world at " << BENCHMARK_GROUND_WIDTH << "x" << BENCHMARK_GROUND_HEIGHT << ", " << BENCHMARK_GROUND_RAY_COUNT
+                << " rays per pixel on a ground " << ((setup == 0) ? "sphere" : "plane") << ": " << renderTime << "s, " << sampleRate / 1e6
+                << " Msamples/s (" << renderTime / sphereTime << "x)" << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkSceneLoading()
+    {
+        std::cout << "Scene loading, binary format with " << BENCHMARK_BINARY_SPHERE_COUNT << " spheres" << std::endl;
+        benchmarkFormat(BENCHMARK_BINARY_SPHERE_COUNT, BENCHMARK_BINARY_SCENE_FILE_PATH, true);
+
+        std::cout << "Scene loading, text format with " << BENCHMARK_TEXT_SPHERE_COUNT << " spheres" << std::endl;
+        benchmarkFormat(BENCHMARK_TEXT_SPHERE_COUNT, BENCHMARK_TEXT_SCENE_FILE_PATH, false);
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkBvhConstruction()
+    {
+        Scene scene;
+        generateBenchmarkWorld(scene, BENCHMARK_BVH_SPHERE_COUNT);
+        scene.commit();
+
+        struct BuildSetup
+        {
+            const char* name;
+            BvhBuildMethod method;
+            bool useThreadPool;
+        };
+        const BuildSetup setups[] = {
+            { "binned SAH, single thread", BvhBuildMethod::BinnedSah, false },
+            { "binned SAH, thread pool", BvhBuildMethod::BinnedSah, true },
+            { "LBVH, single thread", BvhBuildMethod::Lbvh, false },
+            { "LBVH, thread pool", BvhBuildMethod::Lbvh, true } };
+
+        std::cout << "BVH construction with " << BENCHMARK_BVH_SPHERE_COUNT << " spheres ("
+            << (getThreadPool() != nullptr ? getThreadPool()->getThreadCount() : 1) << " threads)" << std::endl;
+        for (const auto& setup : setups)
+        {
+            ThreadPool* pool = setup.useThreadPool ? getThreadPool() : nullptr;
+            if (setup.useThreadPool && pool == nullptr)
+            {
+                continue; // the multithreading support isn't activated
+            }
+
+            Timer timer;
+            timer.setStartTime();
+            SphereSet spheres(scene.getSpheres(), scene.getSphereCount(), scene.getMaterials(), setup.method, pool);
+            double buildTime = timer.getElapsedTime();
+
+            const Bvh& bvh = spheres.getBvh();
+            std::cout << "    " << setup.name << ": build " << buildTime << "s, "
+                << bvh.getNodeCount() << " nodes, SAH cost " << bvh.computeSahCost() << ", "
+                << measureTracePerformance(spheres, bvh.getBounds()) / 1e6 << " Mrays/s" << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkCompressedBvh()
+    {
+        Scene scene;
+        generateBenchmarkWorld(scene, BENCHMARK_BVH_SPHERE_COUNT);
+        scene.commit();
+
+        BvhBuildMethod buildMethod = BVH_FAST_BUILD ? BvhBuildMethod::Lbvh : BvhBuildMethod::BinnedSah;
+        double sphereCount = static_cast<double>(scene.getSphereCount());
+        std::cout << "Compressed BVH with " << BENCHMARK_BVH_SPHERE_COUNT << " spheres" << std::endl;
+
+        // The uncompressed spheres are the records along with the nodes and the index array of their hierarchy
+        Timer timer;
+        timer.setStartTime();
+        SphereSet spheres(scene.getSpheres(), scene.getSphereCount(), scene.getMaterials(), buildMethod, getThreadPool());
+        double buildTime = timer.getElapsedTime();
+        double uncompressedRate = measureTracePerformance(spheres, spheres.getBvh().getBounds());
+        std::cout << "    uncompressed: build " << buildTime << "s, "
+            << (sphereCount * sizeof(SphereRecord) + spheres.getBvh().getMemoryUsage()) / sphereCount << " bytes per sphere, "
+            << spheres.getBvh().getNodeCount() << " nodes, " << uncompressedRate / 1e6 << " Mrays/s" << std::endl;
+
+        timer.setStartTime();
+        CompressedSphereSet compressedSpheres(scene.getSpheres(), scene.getSphereCount(), scene.getMaterials(), buildMethod, getThreadPool());
+        buildTime = timer.getElapsedTime();
+        double compressedRate = measureTracePerformance(compressedSpheres, compressedSpheres.getBvh().getBounds());
+        std::cout << "    compressed: build " << buildTime << "s, " << compressedSpheres.getMemoryUsage() / sphereCount << " bytes per sphere, "
+            << compressedSpheres.getBvh().getNodeCount() << " nodes, " << compressedRate / 1e6 << " Mrays/s ("
+            << 100.0 * compressedRate / uncompressedRate << "% of the uncompressed speed)" << std::endl;
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkOutOfCore()
+    {
+        Scene scene;
+        generateBenchmarkWorld(scene, BENCHMARK_BVH_SPHERE_COUNT);
+        scene.commit();
+
+        std::cout << "Out-of-core geometry with " << BENCHMARK_BVH_SPHERE_COUNT << " spheres in bricks of " << BENCHMARK_OUT_OF_CORE_BRICK_SPHERE_COUNT
+            << " spheres, " << BENCHMARK_OUT_OF_CORE_CACHE_SIZE / (1024 * 1024) << "MB of cache" << std::endl;
+        Timer timer;
+        timer.setStartTime();
+        if (!saveSphereBricks(BENCHMARK_OUT_OF_CORE_BRICK_FILE_PATH, scene.getSpheres(), scene.getSphereCount(), BENCHMARK_OUT_OF_CORE_BRICK_SPHERE_COUNT,
+            getThreadPool()))
+        {
+            return;
+        }
+        std::cout << "    write the bricks " << timer.getElapsedTime() << "s" << std::endl;
+
+        // The same rays are traced in memory, one at a time through the cache and in a single batch
+        CompressedSphereSet inCoreSpheres(scene.getSpheres(), scene.getSphereCount(), scene.getMaterials(), BvhBuildMethod::BinnedSah, getThreadPool());
+        Aabb bounds = inCoreSpheres.getBvh().getBounds();
+        std::cout << "    in memory: " << measureTracePerformance(inCoreSpheres, bounds) / 1e6 << " Mrays/s" << std::endl;
+
+        OutOfCoreSphereSet perRaySpheres(scene.getMaterials(), BENCHMARK_OUT_OF_CORE_CACHE_SIZE);
+        if (!perRaySpheres.open(BENCHMARK_OUT_OF_CORE_BRICK_FILE_PATH))
+        {
+            return;
+        }
+        double rate = measureTracePerformance(perRaySpheres, bounds);
+        BrickCacheStats stats = perRaySpheres.getCacheStats();
+        std::cout << "    one ray at a time: " << rate / 1e6 << " Mrays/s, " << stats.loadCount << " brick loads for " << perRaySpheres.getBrickCount()
+            << " bricks, " << stats.residentSize / (1024.0 * 1024.0) << "MB resident" << std::endl;
+
+        OutOfCoreSphereSet batchSpheres(scene.getMaterials(), BENCHMARK_OUT_OF_CORE_CACHE_SIZE);
+        if (!batchSpheres.open(BENCHMARK_OUT_OF_CORE_BRICK_FILE_PATH))
+        {
+            return;
+        }
+        std::vector<Ray> rays = generateBenchmarkRays(bounds, false);
+        std::vector<HitRecord> records;
+        timer.setStartTime();
+        batchSpheres.hitBatch(rays, RAY_LENGTH_MIN, RAY_LENGTH_MAX, records);
+        rate = rays.size() / timer.getElapsedTime();
+        stats = batchSpheres.getCacheStats();
+        std::cout << "    queued per brick: " << rate / 1e6 << " Mrays/s, " << stats.loadCount << " brick loads, "
+            << stats.residentSize / (1024.0 * 1024.0) << "MB resident" << std::endl;
+
+        std::remove(BENCHMARK_OUT_OF_CORE_BRICK_FILE_PATH.c_str());
+        std::cout << std::endl;
+    }
+
+    void benchmarkBvhRefit()
+    {
+        // The moving spheres are either scattered in the whole world or clustered in a corner of it, where they bounce off the sides
+        struct RefitSetup
+        {
+            const char* name;
+            float regionSize;   // relative to the size of the world
+        };
+        const RefitSetup setups[] = { { "scattered", 1.f }, { "clustered", 0.25f } };
+
+        std::cout << "BVH refit with " << BENCHMARK_REFIT_SPHERE_COUNT << " spheres, " << BENCHMARK_REFIT_MOVING_SPHERE_COUNT << " moving and "
+            << BENCHMARK_REFIT_EDIT_COUNT << " added and removed per frame over " << BENCHMARK_REFIT_FRAME_COUNT << " frames" << std::endl;
+        for (const auto& setup : setups)
+        {
+            Scene scene;
+            generateBenchmarkWorld(scene, BENCHMARK_REFIT_SPHERE_COUNT);
+
+            Random random;
+            float extent = 2.f * std::cbrt(static_cast<float>(BENCHMARK_REFIT_SPHERE_COUNT));
+            float regionExtent = setup.regionSize * extent;
+            vec3 regionMin = vec3(-0.5f, -0.5f, -0.5f) * extent;
+            std::vector<vec3> velocities(BENCHMARK_REFIT_MOVING_SPHERE_COUNT);
+            for (std::size_t i = 0; i < BENCHMARK_REFIT_MOVING_SPHERE_COUNT; ++i)
+            {
+                velocities[i] = BENCHMARK_REFIT_SPEED * unitVector(getRandomPointInUnitSphere(random));
+                scene.moveSphere(i, regionMin + regionExtent * vec3(random.get(), random.get(), random.get()), scene.getSpheres()[i].radius);
+            }
+            scene.commit();
+
+            // The moving spheres are the first ones, the spheres removed and added are taken among the others
+            double updateTime = 0.0;
+            double sahCostSum = 0.0;
+            float maxDrift = 1.f;
+            int partialRebuildCount = 0;
+            std::uint32_t rebuiltPrimitiveCount = 0;
+            int fullRebuildCount = 0;
+            for (int frame = 0; frame < BENCHMARK_REFIT_FRAME_COUNT; ++frame)
+            {
+                for (std::size_t i = 0; i < BENCHMARK_REFIT_MOVING_SPHERE_COUNT; ++i)
+                {
+                    const SphereRecord& sphere = scene.getSpheres()[i];
+                    vec3 center = vec3(sphere.center[0], sphere.center[1], sphere.center[2]) + velocities[i];
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        if (center[axis] < regionMin[axis] || center[axis] > regionMin[axis] + regionExtent)
+                        {
+                            velocities[i][axis] = -velocities[i][axis];
+                            center[axis] += 2.f * velocities[i][axis];
+                        }
+                    }
+                    scene.moveSphere(i, center, sphere.radius);
+                }
+                for (std::size_t i = 0; i < BENCHMARK_REFIT_EDIT_COUNT; ++i)
+                {
+                    std::size_t otherCount = scene.getSphereCount() - BENCHMARK_REFIT_MOVING_SPHERE_COUNT;
+                    scene.removeSphere(BENCHMARK_REFIT_MOVING_SPHERE_COUNT + std::min(static_cast<std::size_t>(random.get() * otherCount), otherCount - 1));
+                    vec3 center = extent * vec3(random.get() - 0.5f, random.get() - 0.5f, random.get() - 0.5f);
+                    scene.addSphere(center, 0.1f + 0.2f * random.get(), static_cast<std::uint32_t>(i % scene.getMaterialCount()));
+                }
+
+                Timer timer;
+                timer.setStartTime();
+                BvhRefitStats stats = scene.update();
+                updateTime += timer.getElapsedTime();
+
+                sahCostSum += stats.sahCost;
+                maxDrift = std::max(maxDrift, stats.refittedSahCost / stats.builtSahCost);
+                partialRebuildCount += (!stats.fullRebuild && stats.rebuiltPrimitiveCount > 0) ? 1 : 0;
+                fullRebuildCount += stats.fullRebuild ? 1 : 0;
+                rebuiltPrimitiveCount += stats.rebuiltPrimitiveCount;
+            }
+
+            // The reference, the same spheres built from scratch
+            Timer timer;
+            timer.setStartTime();
+            SphereSet rebuiltSpheres(scene.getSpheres(), scene.getSphereCount(), scene.getMaterials(),
+                BVH_FAST_BUILD ? BvhBuildMethod::Lbvh : BvhBuildMethod::BinnedSah, getThreadPool());
+            double buildTime = timer.getElapsedTime();
+
+            // Both hierarchies must find the same hits
+            Aabb bounds = rebuiltSpheres.getBvh().getBounds();
+            int mismatchCount = 0;
+            for (int i = 0; i < BENCHMARK_RAY_COUNT; ++i)
+            {
+                vec3 origin = bounds.min() + vec3(random.get(), random.get(), random.get()) * (bounds.max() - bounds.min());
+                Ray r(origin, getRandomPointInUnitSphere(random), 0.f);
+                HitRecord updatedRec, rebuiltRec;
+                bool updatedHit = scene.getWorld().hit(r, RAY_LENGTH_MIN, RAY_LENGTH_MAX, updatedRec);
+                bool rebuiltHit = rebuiltSpheres.hit(r, RAY_LENGTH_MIN, RAY_LENGTH_MAX, rebuiltRec);
+                mismatchCount += (updatedHit != rebuiltHit || (updatedHit && updatedRec.t != rebuiltRec.t)) ? 1 : 0;
+            }
+
+            std::cout << "    " << setup.name << ": update " << updateTime * 1000.0 / BENCHMARK_REFIT_FRAME_COUNT << "ms per frame (full build "
+                << buildTime * 1000.0 << "ms), SAH cost up to " << maxDrift << "x the built one, " << partialRebuildCount << " partial and "
+                << fullRebuildCount << " full rebuilds (" << rebuiltPrimitiveCount << " spheres)" << std::endl;
+            std::cout << "        average SAH cost " << sahCostSum / BENCHMARK_REFIT_FRAME_COUNT << " (full build " << rebuiltSpheres.getBvh().computeSahCost() << "), "
+                << measureTracePerformance(scene.getWorld(), bounds) / 1e6 << " Mrays/s (full build "
+                << measureTracePerformance(rebuiltSpheres, bounds) / 1e6 << " Mrays/s), " << mismatchCount << " mismatching hits" << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkTextures()
+    {
+        // A texture of random colors, the worst case for the caches since the neighboring texels are as unrelated as the distant ones
+        Random random;
+        std::vector<std::uint8_t> rgb(3 * BENCHMARK_TEXTURE_SIZE * BENCHMARK_TEXTURE_SIZE);
+        for (auto& value : rgb)
+        {
+            value = static_cast<std::uint8_t>(256.f * random.get());
+        }
+
+        Timer timer;
+        timer.setStartTime();
+        ImageTexture texture;
+        texture.create(BENCHMARK_TEXTURE_SIZE, BENCHMARK_TEXTURE_SIZE, rgb);
+        std::cout << "Textures of " << BENCHMARK_TEXTURE_SIZE << "x" << BENCHMARK_TEXTURE_SIZE << " texels, " << BENCHMARK_TEXTURE_LOOKUP_SIZE << "x"
+            << BENCHMARK_TEXTURE_LOOKUP_SIZE << " lookups" << std::endl;
+        std::cout << "    build the tiles and the " << texture.getLevelCount() << " levels " << timer.getElapsedTime() << "s, "
+            << texture.getMemoryUsage() / (1024.0 * 1024.0) << "MB" << std::endl;
+
+        // The baseline is a bilinear lookup in a row-major image without any level, hence aliased and spread over the memory when minified
+        std::vector<float> srgbToLinear(256);
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.f;
+            srgbToLinear[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        auto rowMajorLookup = [&](float u, float v, float)
+        {
+            float x = u * BENCHMARK_TEXTURE_SIZE - 0.5f;
+            float y = v * BENCHMARK_TEXTURE_SIZE - 0.5f;
+            float x0 = std::floor(x), y0 = std::floor(y);
+            float fx = x - x0, fy = y - y0;
+            vec3 color(0.f, 0.f, 0.f);
+            for (int j = 0; j < 2; ++j)
+            {
+                for (int i = 0; i < 2; ++i)
+                {
+                    int tx = (static_cast<int>(x0) + i) & (BENCHMARK_TEXTURE_SIZE - 1);
+                    int ty = (static_cast<int>(y0) + j) & (BENCHMARK_TEXTURE_SIZE - 1);
+                    const std::uint8_t* texel = &rgb[3 * (static_cast<std::size_t>(ty) * BENCHMARK_TEXTURE_SIZE + tx)];
+                    float weight = (i ? fx : 1.f - fx) * (j ? fy : 1.f - fy);
+                    color += weight * vec3(srgbToLinear[texel[0]], srgbToLinear[texel[1]], srgbToLinear[texel[2]]);
+                }
+            }
+            return color;
+        };
+        auto tiledBilinearLookup = [&](float u, float v, float) { return texture.sample(u, v, 0.f); };
+        auto tiledLookup = [&](float u, float v, float lod) { return texture.sample(u, v, lod); };
+
+        if (!texture.save(BENCHMARK_TEXTURE_FILE_PATH))
+        {
+            return;
+        }
+        TextureCache cache(BENCHMARK_TEXTURE_CACHE_SIZE);
+        ImageTexture streamedTexture;
+        if (!streamedTexture.load(BENCHMARK_TEXTURE_FILE_PATH, &cache))
+        {
+            return;
+        }
+        auto streamedLookup = [&](float u, float v, float lod) { return streamedTexture.sample(u, v, lod); };
+
+        for (float texelsPerPixel : { 1.f, 4.f, 16.f })
+        {
+            TextureCacheStats before = cache.getStats();
+            double rowMajorRate = measureTextureLookups(texelsPerPixel, rowMajorLookup);
+            double tiledBilinearRate = measureTextureLookups(texelsPerPixel, tiledBilinearLookup);
+            double tiledRate = measureTextureLookups(texelsPerPixel, tiledLookup);
+            double streamedRate = measureTextureLookups(texelsPerPixel, streamedLookup);
+            TextureCacheStats after = cache.getStats();
+            std::uint64_t readCount = (after.hitCount - before.hitCount) + (after.missCount - before.missCount);
+            std::cout << "    " << texelsPerPixel << " texels per pixel: row-major bilinear " << rowMajorRate / 1e6 << " Mlookups/s, tiled bilinear "
+                << tiledBilinearRate / 1e6 << " Mlookups/s, tiled trilinear "
+                << tiledRate / 1e6 << " Mlookups/s, streamed through " << BENCHMARK_TEXTURE_CACHE_SIZE / (1024 * 1024) << "MB of cache "
+                << streamedRate / 1e6 << " Mlookups/s (" << 100. * (after.hitCount - before.hitCount) / std::max<std::uint64_t>(readCount, 1)
+                << "% page hits)" << std::endl;
+        }
+        TextureCacheStats stats = cache.getStats();
+        std::cout << "    " << stats.missCount << " page loads, " << stats.evictionCount << " evictions, "
+            << stats.residentSize / (1024.0 * 1024.0) << "MB resident" << std::endl;
+
+        std::remove(BENCHMARK_TEXTURE_FILE_PATH.c_str());
+        std::cout << std::endl;
+    }
+
+    void benchmarkInstancing()
+    {
+        std::cout << "Instancing, " << BENCHMARK_CLUSTER_INSTANCE_COUNT << " clusters of " << BENCHMARK_CLUSTER_SPHERE_COUNT << " spheres" << std::endl;
+
+        for (bool useInstances : { false, true })
+        {
+            Scene scene;
+            generateClusterWorld(scene, useInstances);
+
+            Timer timer;
+            timer.setStartTime();
+            scene.commit();
+            double buildTime = timer.getElapsedTime();
+
+            Aabb bounds;
+            scene.getWorld().boundingBox(bounds);
+            std::cout << "    " << (useInstances ? "instances" : "flattened") << ": build " << buildTime << "s, "
+                << scene.getGeometryMemoryUsage() / (1024.0 * 1024.0) << "MB of geometry, "
+                << measureTracePerformance(scene.getWorld(), bounds) / 1e6 << " Mrays/s" << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkTriangleMesh()
+    {
+        Scene scene;
+        scene.addMesh(generateTorusMesh(BENCHMARK_MESH_RESOLUTION), scene.addMaterial(makeLambertianRecord(vec3(0.5f, 0.5f, 0.5f))));
+        std::cout << "Triangle mesh with " << 2 * BENCHMARK_MESH_RESOLUTION * BENCHMARK_MESH_RESOLUTION << " triangles" << std::endl;
+
+        Timer timer;
+        timer.setStartTime();
+        scene.commit();
+        double buildTime = timer.getElapsedTime();
+
+        Aabb bounds;
+        scene.getWorld().boundingBox(bounds);
+        std::cout << "    build " << buildTime << "s, " << scene.getGeometryMemoryUsage() / (1024.0 * 1024.0) << "MB of geometry, "
+            << measureTracePerformance(scene.getWorld(), bounds) / 1e6 << " Mrays/s" << std::endl;
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkMotionBlur()
+    {
+        // The same spheres, either static or moving in random directions during the [0, 1] shutter interval
+        Scene staticScene;
+        generateBenchmarkWorld(staticScene, BENCHMARK_MOTION_SPHERE_COUNT);
+        staticScene.commit();
+
+        Random random;
+        Scene movingScene;
+        CameraRecord camera = { { 0.f, 0.f, 0.f }, { 0.f, 0.f, -1.f }, { 0.f, 1.f, 0.f }, CAMERA_FOV, 0.f, 0.f, 0.f, 1.f };
+        movingScene.setCamera(camera);
+        for (std::size_t i = 0; i < staticScene.getMaterialCount(); ++i)
+        {
+            movingScene.addMaterial(makeLambertianRecord(vec3(0.5f, 0.5f, 0.5f)));
+        }
+        for (std::size_t i = 0; i < staticScene.getSphereCount(); ++i)
+        {
+            const auto& sphere = staticScene.getSpheres()[i];
+            vec3 center(sphere.center[0], sphere.center[1], sphere.center[2]);
+            vec3 motion = BENCHMARK_MOTION_DISTANCE * unitVector(getRandomPointInUnitSphere(random));
+            movingScene.addMovingSphere(center, center + motion, 0.f, 1.f, sphere.radius, sphere.materialIndex);
+        }
+        movingScene.commit();
+
+        // The reference for the interpolated bounds, a hierarchy built over the bounds of the whole motion
+        std::vector<Aabb> motionBounds(movingScene.getMovingSphereCount());
+        const MovingSphereRecord* movingSpheres = movingScene.getMovingSpheres();
+        for (std::size_t i = 0; i < motionBounds.size(); ++i)
+        {
+            vec3 extent(movingSpheres[i].radius, movingSpheres[i].radius, movingSpheres[i].radius);
+            vec3 center0(movingSpheres[i].center0[0], movingSpheres[i].center0[1], movingSpheres[i].center0[2]);
+            vec3 center1(movingSpheres[i].center1[0], movingSpheres[i].center1[1], movingSpheres[i].center1[2]);
+            motionBounds[i] = Aabb(center0 - extent, center0 + extent);
+            motionBounds[i].expand(Aabb(center1 - extent, center1 + extent));
+        }
+        Bvh motionBvh;
+        motionBvh.build(motionBounds, BvhBuildMethod::BinnedSah, getThreadPool());
+
+        class MotionBoundsSpheres final : public Hitable
+        {
+        public:
+            MotionBoundsSpheres(const Bvh& bvh, const MovingSphereRecord* spheres) : m_bvh(bvh), m_spheres(spheres) {}
+
+            virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override
+            {
+                return m_bvh.intersect(r, tMin, tMax, [&](std::uint32_t index, float tMinPrimitive, float tMaxPrimitive, float& t)
+                {
+                    const MovingSphereRecord& sphere = m_spheres[index];
+                    vec3 center = MovingSphere::getCenter(vec3(sphere.center0[0], sphere.center0[1], sphere.center0[2]),
+                        vec3(sphere.center1[0], sphere.center1[1], sphere.center1[2]), sphere.time0, sphere.time1, r.time());
+                    bool hit = Sphere::intersect(center, sphere.radius * sphere.radius, r, tMinPrimitive, tMaxPrimitive, t);
+                    rec.t = t;
+                    return hit;
+                });
+            }
+            virtual bool boundingBox(Aabb& box) const override { box = m_bvh.getBounds(); return true; }
+
+        private:
+            const Bvh& m_bvh;
+            const MovingSphereRecord* m_spheres;
+        } motionBoundsSpheres(motionBvh, movingSpheres);
+
+        Aabb bounds;
+        staticScene.getWorld().boundingBox(bounds);
+        std::cout << "Motion blur with " << BENCHMARK_MOTION_SPHERE_COUNT << " spheres moving by " << BENCHMARK_MOTION_DISTANCE << std::endl;
+        std::cout << "    static spheres: " << measureTracePerformance(staticScene.getWorld(), bounds, true) / 1e6 << " Mrays/s" << std::endl;
+        std::cout << "    moving spheres, interpolated bounds: " << measureTracePerformance(movingScene.getWorld(), bounds, true) / 1e6 << " Mrays/s" << std::endl;
+        std::cout << "    moving spheres, bounds of the whole motion: " << measureTracePerformance(motionBoundsSpheres, bounds, true) / 1e6 << " Mrays/s" << std::endl;
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkMedia()
+    {
+        std::cout << "Participating media over the random world at " << BENCHMARK_MEDIUM_WIDTH << "x" << BENCHMARK_MEDIUM_HEIGHT << ", "
+            << BENCHMARK_MEDIUM_RAY_COUNT << " rays per pixel" << std::endl;
+
+        // The same world without any medium, with fog around the camera and the world, and with balls of smoke in the fog as well
+        double referenceTime = 0.;
+        for (int setup = 0; setup < 3; ++setup)
+        {
+            Scene scene;
+            generateRandomWorld(scene);
+            if (setup >= 1)
+            {
+                scene.addMedium(vec3(0.f, 0.f, 0.f), BENCHMARK_FOG_RADIUS, BENCHMARK_FOG_DENSITY, scene.addMaterial(makeIsotropicRecord(vec3(1.f, 1.f, 1.f))));
+            }
+            if (setup >= 2)
+            {
+                std::uint32_t smokeMaterial = scene.addMaterial(makeIsotropicRecord(vec3(0.2f, 0.2f, 0.2f)));
+                for (int i = 0; i < 8; ++i)
+                {
+                    scene.addMedium(vec3(-8.f + 2.f * i, 1.5f, -2.f), 0.8f, 3.f, smokeMaterial);
+                }
+            }
+            scene.commit();
+            std::unique_ptr<Camera> camera = scene.createCamera(static_cast<float>(BENCHMARK_MEDIUM_WIDTH) / BENCHMARK_MEDIUM_HEIGHT);
+
+            HdrImage image;
+            image.resize(BENCHMARK_MEDIUM_WIDTH, BENCHMARK_MEDIUM_HEIGHT);
+            Timer timer;
+            timer.setStartTime();
+            rayTracingMainTask(*camera, scene, BENCHMARK_MEDIUM_RAY_COUNT, &image);
+            double renderTime = timer.getElapsedTime();
+            if (setup == 0)
+            {
+                referenceTime = renderTime;
+            }
+
+            const char* names[] = { "no medium", "fog", "fog and 8 balls of smoke" };
+            double sampleRate = static_cast<double>(BENCHMARK_MEDIUM_WIDTH) * BENCHMARK_MEDIUM_HEIGHT * BENCHMARK_MEDIUM_RAY_COUNT / renderTime;
+            std::cout << "    " << names[setup] << ": " << renderTime << "s, " << sampleRate / 1e6 << " Msamples/s ("
+                << renderTime / referenceTime << "x)" << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkEnvironment()
+    {
+        // The sky is saved to be loaded as a scene would
+        if (!saveHdrFile(generateSkyImage(512, 256), BENCHMARK_ENVIRONMENT_FILE_PATH))
+        {
+            return;
+        }
+        Scene scene;
+        generateRandomWorld(scene);
+        if (!scene.setEnvironment({ BENCHMARK_ENVIRONMENT_FILE_PATH, 1.f, 0.f }))
+        {
+            return;
+        }
+        scene.commit();
+        std::unique_ptr<Camera> camera = scene.createCamera(static_cast<float>(BENCHMARK_ENVIRONMENT_WIDTH) / BENCHMARK_ENVIRONMENT_HEIGHT);
+
+        std::cout << "Random world under a sky with a sun at " << BENCHMARK_ENVIRONMENT_WIDTH << "x" << BENCHMARK_ENVIRONMENT_HEIGHT << ", "
+            << BENCHMARK_ENVIRONMENT_RAY_COUNT << " rays per pixel, relative MSE against a " << BENCHMARK_ENVIRONMENT_REFERENCE_RAY_COUNT
+            << " rays per pixel reference" << std::endl;
+
+        bool previousEnvironmentSampling = isEnvironmentSampling();
+        setEnvironmentSampling(true);
+        HdrImage reference;
+        reference.resize(BENCHMARK_ENVIRONMENT_WIDTH, BENCHMARK_ENVIRONMENT_HEIGHT);
+        rayTracingMainTask(*camera, scene, BENCHMARK_ENVIRONMENT_REFERENCE_RAY_COUNT, &reference);
+
+        // The environment hit by the bounces only, then sampled at the diffuse hits as well
+        for (bool environmentSampling : { false, true })
+        {
+            setEnvironmentSampling(environmentSampling);
+            HdrImage image;
+            image.resize(BENCHMARK_ENVIRONMENT_WIDTH, BENCHMARK_ENVIRONMENT_HEIGHT);
+            Timer timer;
+            timer.setStartTime();
+            rayTracingMainTask(*camera, scene, BENCHMARK_ENVIRONMENT_RAY_COUNT, &image);
+            double renderTime = timer.getElapsedTime();
+
+            std::cout << "    " << (environmentSampling ? "environment sampled with MIS" : "environment hit by chance") << ": " << renderTime
+                << "s, relative MSE " << computeRelativeMse(image, reference) << std::endl;
+        }
+        setEnvironmentSampling(previousEnvironmentSampling);
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkRoughMaterials()
+    {
+        std::cout << "Rough metals at " << BENCHMARK_ROUGH_WIDTH << "x" << BENCHMARK_ROUGH_HEIGHT << ", " << BENCHMARK_ROUGH_RAY_COUNT
+            << " rays per pixel on a single thread" << std::endl;
+
+        // The fuzzy metals absorb the rays scattered below their surface, the whole path is then black
+        // the rough conductors rarely do, then they're lit by the sky as well, where the sun is sampled at their hits
+        if (!saveHdrFile(generateSkyImage(512, 256), BENCHMARK_ENVIRONMENT_FILE_PATH))
+        {
+            return;
+        }
+        for (int setup = 0; setup < 3; ++setup)
+        {
+            Scene scene;
+            generateRoughWorld(scene, setup >= 1);
+            if (setup == 2 && !scene.setEnvironment({ BENCHMARK_ENVIRONMENT_FILE_PATH, 1.f, 0.f }))
+            {
+                return;
+            }
+            scene.commit();
+            std::unique_ptr<Camera> camera = scene.createCamera(static_cast<float>(BENCHMARK_ROUGH_WIDTH) / BENCHMARK_ROUGH_HEIGHT);
+
+            // The samples are traced one by one to count the ones which don't bring any light to their pixel
+            Random random;
+            std::size_t blackCount = 0;
+            Timer timer;
+            timer.setStartTime();
+            for (int j = 0; j < BENCHMARK_ROUGH_HEIGHT; ++j)
+            {
+                for (int i = 0; i < BENCHMARK_ROUGH_WIDTH; ++i)
+                {
+                    for (int s = 0; s < BENCHMARK_ROUGH_RAY_COUNT; ++s)
+                    {
+                        float u = (i + random.get()) / BENCHMARK_ROUGH_WIDTH;
+                        float v = (j + random.get()) / BENCHMARK_ROUGH_HEIGHT;
+                        vec3 color = getColor(camera->getRay(u, v, random), scene, 0, random);
+                        if (color.r() <= 0.f && color.g() <= 0.f && color.b() <= 0.f)
+                        {
+                            ++blackCount;
+                        }
+                    }
+                }
+            }
+            double renderTime = timer.getElapsedTime();
+
+            const char* names[] = { "fuzzy metals", "rough conductors", "rough conductors under a sky" };
+            double sampleCount = static_cast<double>(BENCHMARK_ROUGH_WIDTH) * BENCHMARK_ROUGH_HEIGHT * BENCHMARK_ROUGH_RAY_COUNT;
+            std::cout << "    " << names[setup] << ": " << renderTime << "s, " << 100. * blackCount / sampleCount
+                << "% of the samples black" << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkSpectral()
+    {
+        std::cout << "Spectral rendering of the random world at " << BENCHMARK_SPECTRAL_WIDTH << "x" << BENCHMARK_SPECTRAL_HEIGHT << ", "
+            << BENCHMARK_SPECTRAL_RAY_COUNT << " rays per pixel" << std::endl;
+
+        // The RGB mode, then the spectral mode with the same glass, whose wavelengths all follow the same paths,
+        // and with dispersive glass, where they're split at each refraction
+        DispersionRecord dispersion = makeNoDispersionRecord();
+        dispersion.model = DispersionModel::Cauchy;
+        dispersion.coefficients[0] = BENCHMARK_GLASS_CAUCHY_B;
+
+        bool previousSpectralRendering = isSpectralRendering();
+        double referenceTime = 0.;
+        for (int setup = 0; setup < 3; ++setup)
+        {
+            Scene scene;
+            generateRandomWorld(scene, (setup == 2) ? dispersion : makeNoDispersionRecord());
+            scene.commit();
+            std::unique_ptr<Camera> camera = scene.createCamera(static_cast<float>(BENCHMARK_SPECTRAL_WIDTH) / BENCHMARK_SPECTRAL_HEIGHT);
+
+            setSpectralRendering(setup >= 1);
+            HdrImage image;
+            image.resize(BENCHMARK_SPECTRAL_WIDTH, BENCHMARK_SPECTRAL_HEIGHT);
+            Timer timer;
+            timer.setStartTime();
+            rayTracingMainTask(*camera, scene, BENCHMARK_SPECTRAL_RAY_COUNT, &image);
+            double renderTime = timer.getElapsedTime();
+            if (setup == 0)
+            {
+                referenceTime = renderTime;
+            }
+
+            const char* names[] = { "RGB", "spectral", "spectral with dispersive glass" };
+            double sampleRate = static_cast<double>(BENCHMARK_SPECTRAL_WIDTH) * BENCHMARK_SPECTRAL_HEIGHT * BENCHMARK_SPECTRAL_RAY_COUNT / renderTime;
+            std::cout << "    " << names[setup] << ": " << renderTime << "s, " << sampleRate / 1e6 << " Msamples/s ("
+                << renderTime / referenceTime << "x)" << std::endl;
+        }
+        setSpectralRendering(previousSpectralRendering);
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkDenoiser()
+    {
+        Scene scene;
+        generateDenoiserWorld(scene);
+        scene.commit();
+        std::unique_ptr<Camera> camera = scene.createCamera(static_cast<float>(BENCHMARK_DENOISER_WIDTH) / BENCHMARK_DENOISER_HEIGHT);
+
+        std::cout << "Denoiser at " << BENCHMARK_DENOISER_WIDTH << "x" << BENCHMARK_DENOISER_HEIGHT
+            << ", relative MSE against a " << BENCHMARK_DENOISER_REFERENCE_RAY_COUNT << " rays per pixel reference" << std::endl;
+
+        HdrImage reference;
+        reference.resize(BENCHMARK_DENOISER_WIDTH, BENCHMARK_DENOISER_HEIGHT);
+        rayTracingMainTask(*camera, scene, BENCHMARK_DENOISER_REFERENCE_RAY_COUNT, &reference);
+
+        for (int sampleCount : { 16, 32, 64, RAY_COUNT_PER_PIXEL })
+        {
+            HdrImage image;
+            image.resize(BENCHMARK_DENOISER_WIDTH, BENCHMARK_DENOISER_HEIGHT);
+            AovImages aovs;
+            aovs.resize(BENCHMARK_DENOISER_WIDTH, BENCHMARK_DENOISER_HEIGHT);
+
+            Timer timer;
+            timer.setStartTime();
+            rayTracingMainTask(*camera, scene, sampleCount, &image, &aovs);
+            double renderTime = timer.getElapsedTime();
+
+            HdrImage denoisedImage;
+            timer.setStartTime();
+            denoise(image, aovs, getDefaultDenoiserSettings(), denoisedImage);
+            double denoiseTime = timer.getElapsedTime();
+
+            std::cout << "    " << sampleCount << " rays per pixel: render " << renderTime << "s, noisy " << computeRelativeMse(image, reference)
+                << ", denoised " << computeRelativeMse(denoisedImage, reference) << " (" << denoiseTime << "s)" << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkThreadScaling()
+    {
+        ThreadPool* sharedPool = getThreadPool();
+        if (sharedPool == nullptr)
+        {
+            return;
+        }
+
+        // A copy of the random world per NUMA node, set up by the workers of the node, the pools of every size below
+        // fill the nodes in the same order as the shared pool so their nodes match the copies
+        std::vector<std::unique_ptr<Scene>> scenes(sharedPool->getNodeCount());
+        runOnEachNode(sharedPool, [&](unsigned int node)
+        {
+            scenes[node] = std::make_unique<Scene>();
+            generateRandomWorld(*scenes[node]);
+            scenes[node]->commit();
+        });
+        std::vector<const Scene*> nodeScenes;
+        for (const auto& scene : scenes)
+        {
+            nodeScenes.push_back(scene.get());
+        }
+        std::unique_ptr<Camera> camera = scenes[0]->createCamera(static_cast<float>(BENCHMARK_SCALING_WIDTH) / BENCHMARK_SCALING_HEIGHT);
+
+        std::vector<unsigned int> threadCounts;
+        unsigned int maxThreadCount = sharedPool->getThreadCount();
+        for (unsigned int threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+        {
+            threadCounts.push_back(threadCount);
+        }
+        threadCounts.push_back(maxThreadCount);
+
+        std::cout << "Ray tracing scaling on the random world at " << BENCHMARK_SCALING_WIDTH << "x" << BENCHMARK_SCALING_HEIGHT << ", "
+            << BENCHMARK_SCALING_RAY_COUNT << " rays per pixel (" << getNumaNodes().size() << " NUMA nodes)" << std::endl;
+
+        // The samples draw their random numbers from their own streams (see setFrameIndex), every render must be the same to the bit
+        HdrImage reference;
+        double singleThreadTime = 0.;
+        for (unsigned int threadCount : threadCounts)
+        {
+            ThreadPool pool(threadCount);
+            HdrImage image;
+            double time = measureScalingRender(pool, nodeScenes, *camera, image);
+            if (threadCount == 1)
+            {
+                singleThreadTime = time;
+                reference = image;
+            }
+            double speedup = singleThreadTime / time;
+            std::cout << "    " << threadCount << " threads on " << pool.getNodeCount() << " nodes: " << time << "s, x" << speedup
+                << ", efficiency " << 100. * speedup / threadCount << "%, " << countDifferentPixels(image, reference) << " pixels differ";
+
+            // The same pool with all the nodes reading the copy of the first one
+            if (pool.getNodeCount() > 1)
+            {
+                double sharedSceneTime = measureScalingRender(pool, std::vector<const Scene*>(1, nodeScenes[0]), *camera, image);
+                std::cout << ", " << sharedSceneTime << "s with a single copy of the scene";
+            }
+            std::cout << std::endl;
+        }
+
+        // The whole image as a single band on the calling thread, as without multithreading, then in bands which don't match the sub tasks
+        for (int bandHeight : { BENCHMARK_SCALING_HEIGHT, 7 })
+        {
+            HdrImage image;
+            image.resize(BENCHMARK_SCALING_WIDTH, BENCHMARK_SCALING_HEIGHT);
+            for (int startLine = 0; startLine < image.height; startLine += bandHeight)
+            {
+                rayTracingSubTask(*camera, *nodeScenes[0], BENCHMARK_SCALING_RAY_COUNT, &image, nullptr, nullptr, startLine,
+                    std::min(startLine + bandHeight, image.height), 0);
+            }
+            std::cout << "    bands of " << bandHeight << " lines on the calling thread: " << countDifferentPixels(image, reference)
+                << " pixels differ" << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkPreview()
+    {
+        Scene scene;
+        generateRandomWorld(scene);
+        scene.commit();
+
+        // The renderer runs on its own thread, the benchmark is the consumer and watches the framebuffer through a mapping of its own
+        PreviewFramebuffer framebuffer, consumer;
+        if (!framebuffer.create(BENCHMARK_PREVIEW_FRAMEBUFFER_NAME, IMAGE_WIDTH, IMAGE_HEIGHT) || !consumer.open(BENCHMARK_PREVIEW_FRAMEBUFFER_NAME))
+        {
+            return;
+        }
+
+        HdrImage image;
+        PreviewStats stats;
+        Timer timer;
+        timer.setStartTime();
+        std::thread renderer([&]() { runPreview(scene, RAY_COUNT_PER_PIXEL, getDefaultToneMapSettings(), framebuffer, image, stats); });
+
+        std::vector<std::uint8_t> rgb;
+        PreviewFrameInfo info = { 0, 0, 0 };
+        auto waitForFrame = [&](std::uint32_t cameraSequence, std::uint32_t sampleCount)
+        {
+            while (!consumer.readFrame(rgb, info) || info.cameraSequence != cameraSequence || info.sampleCount < sampleCount)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            return timer.getElapsedTime();
+        };
+
+        double coarseTime = waitForFrame(0, 0);
+        double firstPassTime = waitForFrame(0, 1);
+        double convergedTime = waitForFrame(0, BENCHMARK_PREVIEW_SAMPLE_COUNT);
+
+        // Orbit the camera around its target
+        CameraRecord camera = scene.getCameraAt(0.f);
+        vec3 lookAt(camera.lookAt[0], camera.lookAt[1], camera.lookAt[2]);
+        vec3 offset = vec3(camera.lookFrom[0], camera.lookFrom[1], camera.lookFrom[2]) - lookAt;
+        vec3 lookFrom = lookAt + vec3(offset.z(), offset.y(), -offset.x());
+        timer.setStartTime();
+        std::uint32_t cameraSequence = consumer.requestCamera(lookFrom, lookAt);
+        double restartTime = waitForFrame(cameraSequence, 0);
+
+        consumer.requestStop();
+        renderer.join();
+
+        std::cout << "Progressive preview of the random world at " << IMAGE_WIDTH << "x" << IMAGE_HEIGHT << std::endl;
+        std::cout << "    first image (" << PREVIEW_COARSE_BLOCK_SIZE << "x" << PREVIEW_COARSE_BLOCK_SIZE << " blocks): " << coarseTime * 1000. << " ms" << std::endl;
+        std::cout << "    first image of 1 ray per pixel: " << firstPassTime * 1000. << " ms" << std::endl;
+        std::cout << "    " << BENCHMARK_PREVIEW_SAMPLE_COUNT << " rays per pixel: " << convergedTime * 1000. << " ms ("
+            << (convergedTime - firstPassTime) * 1000. / (BENCHMARK_PREVIEW_SAMPLE_COUNT - 1) << " ms per pass)" << std::endl;
+        std::cout << "    first image after a camera change: " << restartTime * 1000. << " ms" << std::endl;
+        std::cout << "    " << stats.publishedImageCount << " images published, " << stats.sampleCount << " rays per pixel when stopped" << std::endl;
+
+        std::cout << std::endl;
+    }
+
+    void benchmarkVectorMath()
+    {
+        // Each ray is paired with a sphere placed at a short distance from its origin
+        Random random;
+        BenchmarkVectors origins, directions, centers, normals, randomPoints;
+        std::vector<float> radii;
+        for (std::size_t i = 0; i < BENCHMARK_VECTOR_COUNT; ++i)
+        {
+            origins.add(vec3(random.get(), random.get(), random.get()));
+            directions.add(getRandomPointInUnitSphere(random));
+            centers.add(origins.vectors.back() + 2.f * unitVector(getRandomPointInUnitSphere(random)));
+            normals.add(unitVector(getRandomPointInUnitSphere(random)));
+            randomPoints.add(getRandomPointInUnitSphere(random));
+            radii.push_back(0.5f + random.get());
+        }
+
+        std::size_t scalarHitCount = 0, sseHitCount = 0, wideHitCount = 0;
+        double scalarTime = measureIntersectionKernel<vec3>(origins, directions, centers, radii, scalarHitCount);
+        double sseTime = measureIntersectionKernel<vec3a>(origins, directions, centers, radii, sseHitCount);
+
+        Timer timer;
+        timer.setStartTime();
+        for (int pass = 0; pass < BENCHMARK_VECTOR_PASS_COUNT; ++pass)
+        {
+            wideHitCount = 0;
+            for (std::size_t i = 0; i < BENCHMARK_VECTOR_COUNT; i += 8)
+            {
+                floatx8 t;
+                int mask = intersectSphereKernel(origins.load(i), directions.load(i), centers.load(i), floatx8::load(&radii[i]), t).getMask();
+                for (; mask != 0; mask &= mask - 1)
+                {
+                    ++wideHitCount;
+                }
+            }
+        }
+        double wideTime = timer.getElapsedTime() / BENCHMARK_VECTOR_PASS_COUNT;
+
+#if defined(__AVX__)
+        const char* wideName = "vec3x8 (AVX)";
+#else
+        const char* wideName = "vec3x8 (SSE2)";
+#endif
+        std::cout << "Vector math kernels over " << BENCHMARK_VECTOR_COUNT << " vectors" << std::endl;
+        std::cout << "    sphere intersection, vec3: " << scalarTime * 1e9 / BENCHMARK_VECTOR_COUNT << " ns (" << scalarHitCount << " hits)" << std::endl;
+        std::cout << "    sphere intersection, vec3a: " << sseTime * 1e9 / BENCHMARK_VECTOR_COUNT << " ns, x" << scalarTime / sseTime
+            << " (" << sseHitCount << " hits)" << std::endl;
+        std::cout << "    sphere intersection, " << wideName << ": " << wideTime * 1e9 / BENCHMARK_VECTOR_COUNT << " ns, x" << scalarTime / wideTime
+            << " (" << wideHitCount << " hits)" << std::endl;
+
+        // The scattered directions of the SSE and the wide kernels are compared against the scalar ones
+        std::vector<vec3> scalarScattered(BENCHMARK_VECTOR_COUNT), sseScattered(BENCHMARK_VECTOR_COUNT);
+        std::vector<float> wideX(BENCHMARK_VECTOR_COUNT), wideY(BENCHMARK_VECTOR_COUNT), wideZ(BENCHMARK_VECTOR_COUNT);
+        scalarTime = measureScatterKernel<vec3>(directions, normals, randomPoints, scalarScattered);
+        sseTime = measureScatterKernel<vec3a>(directions, normals, randomPoints, sseScattered);
+
+        timer.setStartTime();
+        for (int pass = 0; pass < BENCHMARK_VECTOR_PASS_COUNT; ++pass)
+        {
+            for (std::size_t i = 0; i < BENCHMARK_VECTOR_COUNT; i += 8)
+            {
+                scatterMetalKernel(directions.load(i), normals.load(i), randomPoints.load(i), floatx8(0.3f)).store(&wideX[i], &wideY[i], &wideZ[i]);
+            }
+        }
+        wideTime = timer.getElapsedTime() / BENCHMARK_VECTOR_PASS_COUNT;
+
+        float sseError = 0.f, wideError = 0.f;
+        for (std::size_t i = 0; i < BENCHMARK_VECTOR_COUNT; ++i)
+        {
+            sseError = std::max(sseError, (sseScattered[i] - scalarScattered[i]).length());
+            wideError = std::max(wideError, (vec3(wideX[i], wideY[i], wideZ[i]) - scalarScattered[i]).length());
+        }
+
+        std::cout << "    metal scatter, vec3: " << scalarTime * 1e9 / BENCHMARK_VECTOR_COUNT << " ns" << std::endl;
+        std::cout << "    metal scatter, vec3a: " << sseTime * 1e9 / BENCHMARK_VECTOR_COUNT << " ns, x" << scalarTime / sseTime
+            << " (max error " << sseError << ")" << std::endl;
+        std::cout << "    metal scatter, " << wideName << ": " << wideTime * 1e9 / BENCHMARK_VECTOR_COUNT << " ns, x" << scalarTime / wideTime
+            << " (max error " << wideError << ")" << std::endl;
+
+        std::cout << std::endl;
+    }
+
+    int runBenchmarks()
+    {
+        std::cout << "Running the benchmarks...\n\n";
+
+        benchmarkVectorMath();
+        benchmarkFastMath();
+        benchmarkSphereIntersection();
+        benchmarkSceneLoading();
+        benchmarkBvhConstruction();
+        benchmarkCompressedBvh();
+        benchmarkOutOfCore();
+        benchmarkBvhRefit();
+        benchmarkInstancing();
+        benchmarkMotionBlur();
+        benchmarkTriangleMesh();
+        benchmarkTextures();
+        benchmarkMedia();
+        benchmarkEnvironment();
+        benchmarkRoughMaterials();
+        benchmarkSpectral();
+        benchmarkDenoiser();
+        benchmarkThreadScaling();
+        benchmarkPreview();
+
+        return 0;
+    }
+}
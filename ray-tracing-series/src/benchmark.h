@@ -0,0 +1,75 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+namespace rts // for ray tracing series
+{
+    // Compare the scalar vec3 against the SSE vec3a and the 8-wide vec3x8 on the sphere intersection and the metal scatter kernels
+    void benchmarkVectorMath();
+
+    // Compare the speed and the accuracy of the fast-math approximations against the precise computations
+    void benchmarkFastMath();
+
+    // Compare the sphere intersection of the book against the robust one of Sphere::intersect, in speed, in precision against a double
+    // precision reference and in self-intersections of the rays scattered by the ground sphere, which a ground plane avoids altogether
+    void benchmarkSphereIntersection();
+
+    // Measure the time it takes to save and load large scenes in both the text and the binary formats
+    void benchmarkSceneLoading();
+
+    // Compare the BVH builders, their build time against the quality of the resulting tree and its trace performance
+    void benchmarkBvhConstruction();
+
+    // Compare the memory per sphere and the trace performance of the compressed hierarchy against the regular one
+    void benchmarkCompressedBvh();
+
+    // Compare the trace performance of spheres streamed from a brick file through a small cache, one ray at a time and queued per brick
+    void benchmarkOutOfCore();
+
+    // Compare the cost of updating a hierarchy where a few spheres move, appear and disappear from frame to frame against a full build
+    void benchmarkBvhRefit();
+
+    // Compare the memory and the trace performance of a world made of instances against the same world flattened
+    void benchmarkInstancing();
+
+    // Compare the trace performance of moving spheres against static ones, with and without interpolated BVH bounds
+    void benchmarkMotionBlur();
+
+    // Measure the build time and the trace performance of a procedural mesh of a few million triangles
+    void benchmarkTriangleMesh();
+
+    // Compare filtered lookups in the tiled mip chain of an image texture against a row-major image, in memory and streamed through the cache
+    void benchmarkTextures();
+
+    // Compare the rendering of the random world without any medium, in fog and with balls of smoke in the fog
+    void benchmarkMedia();
+
+    // Compare the noise of the random world lit by an environment map with a sun, hit by chance or sampled at the hits
+    void benchmarkEnvironment();
+
+    // Compare the samples absorbed by the fuzzy metals of the book against the rough conductors, which sample visible microfacets
+    void benchmarkRoughMaterials();
+
+    // Compare the rendering of the random world in the RGB mode against the spectral mode, with and without dispersive glass
+    void benchmarkSpectral();
+
+    // Compare the error of noisy and denoised renders of a few sample counts against a converged reference
+    void benchmarkDenoiser();
+
+    // Measure the scaling of the ray tracing from 1 thread to all of them, with and without a copy of the scene per NUMA node
+    // and check that the image is the same to the bit whatever the number of threads or the split of the lines
+    void benchmarkThreadScaling();
+
+    // Measure the time to the first image of the progressive preview on the random world, and the time to restart it after a camera change
+    void benchmarkPreview();
+
+    // Run all the benchmarks and output their results, return the process exit code
+    int runBenchmarks();
+}
@@ -0,0 +1,16 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "benchmark.h"
+
+// The benchmarks as a standalone executable, it's the same as running ray-tracing-series --benchmark
+int main()
+{
+    return rts::runBenchmarks();
+}
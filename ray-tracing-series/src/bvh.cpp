@@ -0,0 +1,939 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "bvh.h"
+
+#include <atomic>
+#include <functional>
+#include <utility>
+
+#include "threadpool.h"
+
+namespace rts
+{
+    namespace
+    {
+        // The relative costs of traversing a node and intersecting a primitive used by the SAH
+        const float SAH_TRAVERSAL_COST = 1.f;
+        const float SAH_INTERSECTION_COST = 1.f;
+
+        const int SAH_BIN_COUNT = 16;
+        const std::uint32_t SAH_MAX_LEAF_SIZE = 8;
+        const std::uint32_t LBVH_LEAF_SIZE = 4;
+
+        // Below those primitive counts the work isn't worth being split into parallel tasks
+        const std::uint32_t PARALLEL_BINNING_THRESHOLD = 1 << 16;   // the binning and partitioning of a node is split into chunks
+        const std::uint32_t PARALLEL_SUBTREE_THRESHOLD = 1 << 12;   // the subtrees are built by independent tasks
+        const std::uint32_t PARALLEL_CHUNK_SIZE = 1 << 14;
+        const std::size_t PARALLEL_REFIT_THRESHOLD = 1 << 14;      // the node count from which the refit is split into tasks
+        const int PARALLEL_REFIT_DEPTH = 6;                         // the subtrees below are refitted by the task of their ancestor
+
+        // A partial rebuild isn't worth it past that fraction of the primitives, the whole tree is built again instead
+        const float MAX_PARTIAL_REBUILD_FRACTION = 0.5f;
+
+        // The fraction of the cost gained since the tree was built that the rebuilt subtree must hold
+        const float REBUILT_EXCESS_COST_FRACTION = 0.75f;
+
+        // The primitives removed from a tree until it's compacted
+        const std::uint32_t REMOVED_PRIMITIVE = 0xFFFFFFFF;
+
+        struct Bin
+        {
+            Aabb bounds;
+            std::uint32_t count = 0;
+        };
+
+        // Split [begin, end) into chunks processed in parallel, the callback signature is void(chunkIndex, chunkBegin, chunkEnd)
+        std::uint32_t getChunkCount(std::uint32_t begin, std::uint32_t end)
+        {
+            return (end - begin + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+        }
+
+        void parallelChunks(ThreadPool* pool, std::uint32_t begin, std::uint32_t end,
+            const std::function<void(std::uint32_t, std::uint32_t, std::uint32_t)>& process)
+        {
+            TaskGroup group(pool);
+            std::uint32_t chunkCount = getChunkCount(begin, end);
+            for (std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+            {
+                std::uint32_t chunkBegin = begin + chunk * PARALLEL_CHUNK_SIZE;
+                std::uint32_t chunkEnd = std::min(chunkBegin + PARALLEL_CHUNK_SIZE, end);
+                group.run([&process, chunk, chunkBegin, chunkEnd]() { process(chunk, chunkBegin, chunkEnd); });
+            }
+            group.wait();
+        }
+
+        void setNodeBounds(BvhNode& node, const Aabb& bounds)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                node.boundsMin[axis] = bounds.min()[axis];
+                node.boundsMax[axis] = bounds.max()[axis];
+            }
+        }
+
+        Aabb getNodeBounds(const BvhNode& node)
+        {
+            return Aabb(vec3(node.boundsMin[0], node.boundsMin[1], node.boundsMin[2]), vec3(node.boundsMax[0], node.boundsMax[1], node.boundsMax[2]));
+        }
+
+        // The cost of a subtree relative to the area of its root, the cost of the whole tree is the one of the SAH
+        float getRelativeCost(const BvhNode& node, float cost)
+        {
+            float area = getNodeBounds(node).halfArea();
+            return (area > 0.f) ? cost / area : 0.f;
+        }
+
+        // The cost gained by a subtree since it was built, given the area of its root now
+        float getExcessCost(const BvhNode& node, float cost, float builtCost)
+        {
+            return cost - builtCost * getNodeBounds(node).halfArea();
+        }
+
+        // Spread the lower 10 bits of the value so that there are 2 zero bits between each of them
+        std::uint32_t expandBits(std::uint32_t v)
+        {
+            v = (v * 0x00010001u) & 0xFF0000FFu;
+            v = (v * 0x00000101u) & 0x0F00F00Fu;
+            v = (v * 0x00000011u) & 0xC30C30C3u;
+            v = (v * 0x00000005u) & 0x49249249u;
+            return v;
+        }
+
+        // Find the index of the highest set bit
+        int getHighestBit(std::uint32_t v)
+        {
+            int bit = -1;
+            while (v != 0)
+            {
+                v >>= 1;
+                ++bit;
+            }
+            return bit;
+        }
+    }
+
+    struct Bvh::BuildContext
+    {
+        const std::vector<Aabb>& primitiveBounds;
+        std::vector<vec3> centroids;
+        std::vector<std::uint32_t> scratch;     // the temporary storage of the parallel partitioning
+        std::vector<std::uint32_t> mortonCodes; // sorted along with the primitive indices for the LBVH
+        std::atomic<std::uint32_t> nodeCount;
+        ThreadPool* pool;
+
+        BuildContext(const std::vector<Aabb>& bounds, ThreadPool* threadPool) : primitiveBounds(bounds), nodeCount(1), pool(threadPool) {}
+    };
+
+    std::uint32_t getMortonCode(const vec3& p)
+    {
+        auto quantize = [](float value) { return static_cast<std::uint32_t>(std::min(std::max(value * 1024.f, 0.f), 1023.f)); };
+        return (expandBits(quantize(p.x())) << 2) | (expandBits(quantize(p.y())) << 1) | expandBits(quantize(p.z()));
+    }
+
+    void Bvh::build(const std::vector<Aabb>& primitiveBounds, BvhBuildMethod method, ThreadPool* pool)
+    {
+        m_buildMethod = method;
+        m_nodes.clear();
+        m_primitiveIndices.clear();
+        m_endBounds.clear();
+        m_builtCosts.clear();
+        m_structureChanged = false;
+        m_needsRebuild = false;
+
+        auto primitiveCount = static_cast<std::uint32_t>(primitiveBounds.size());
+        if (primitiveCount == 0)
+        {
+            return;
+        }
+
+        // A binary tree with one primitive per leaf at most has 2N-1 nodes
+        m_nodes.resize(2 * static_cast<std::size_t>(primitiveCount) - 1);
+        m_primitiveIndices.resize(primitiveCount);
+
+        BuildContext context(primitiveBounds, pool);
+        context.centroids.resize(primitiveCount);
+        parallelChunks(pool, 0, primitiveCount, [&](std::uint32_t, std::uint32_t begin, std::uint32_t end)
+        {
+            for (std::uint32_t i = begin; i < end; ++i)
+            {
+                m_primitiveIndices[i] = i;
+                context.centroids[i] = primitiveBounds[i].centroid();
+            }
+        });
+
+        if (method == BvhBuildMethod::Lbvh)
+        {
+            // Compute the Morton code of each primitive relative to the bounds of the centroids
+            std::vector<Aabb> chunkBounds(getChunkCount(0, primitiveCount));
+            parallelChunks(pool, 0, primitiveCount, [&](std::uint32_t chunk, std::uint32_t begin, std::uint32_t end)
+            {
+                for (std::uint32_t i = begin; i < end; ++i)
+                {
+                    chunkBounds[chunk].expand(context.centroids[i]);
+                }
+            });
+            Aabb centroidBounds;
+            for (const auto& bounds : chunkBounds)
+            {
+                centroidBounds.expand(bounds);
+            }
+
+            vec3 extent = centroidBounds.max() - centroidBounds.min();
+            vec3 scale(extent.x() > 0.f ? 1.f / extent.x() : 0.f, extent.y() > 0.f ? 1.f / extent.y() : 0.f, extent.z() > 0.f ? 1.f / extent.z() : 0.f);
+            std::vector<std::uint32_t> codes(primitiveCount);
+            parallelChunks(pool, 0, primitiveCount, [&](std::uint32_t, std::uint32_t begin, std::uint32_t end)
+            {
+                for (std::uint32_t i = begin; i < end; ++i)
+                {
+                    codes[i] = getMortonCode((context.centroids[i] - centroidBounds.min()) * scale);
+                }
+            });
+
+            // Sort the primitives by Morton code with a radix sort, 3 passes of 10 bits
+            std::vector<std::uint32_t> sortedIndices(primitiveCount);
+            for (int shift = 0; shift < 30; shift += 10)
+            {
+                std::vector<std::uint32_t> offsets(1025, 0);
+                for (std::uint32_t i = 0; i < primitiveCount; ++i)
+                {
+                    ++offsets[((codes[m_primitiveIndices[i]] >> shift) & 1023u) + 1];
+                }
+                for (std::size_t digit = 1; digit < offsets.size(); ++digit)
+                {
+                    offsets[digit] += offsets[digit - 1];
+                }
+                for (std::uint32_t i = 0; i < primitiveCount; ++i)
+                {
+                    std::uint32_t index = m_primitiveIndices[i];
+                    sortedIndices[offsets[(codes[index] >> shift) & 1023u]++] = index;
+                }
+                m_primitiveIndices.swap(sortedIndices);
+            }
+
+            context.mortonCodes.resize(primitiveCount);
+            for (std::uint32_t i = 0; i < primitiveCount; ++i)
+            {
+                context.mortonCodes[i] = codes[m_primitiveIndices[i]];
+            }
+
+            buildLbvhNode(context, 0, 0, primitiveCount, 0);
+        }
+        else
+        {
+            context.scratch.resize(primitiveCount);
+            buildBinnedSahNode(context, 0, 0, primitiveCount, 0);
+        }
+
+        m_nodes.resize(context.nodeCount.load());
+        m_nodes.shrink_to_fit();
+    }
+
+    void Bvh::buildWithMotion(const std::vector<Aabb>& boundsAtTime0, const std::vector<Aabb>& boundsAtTime1, float time0, float time1,
+        BvhBuildMethod method, ThreadPool* pool)
+    {
+        // The tree is built over the bounds of the whole motion, then refitted to get the bounds of the nodes at both ends
+        std::vector<Aabb> motionBounds(boundsAtTime0);
+        for (std::size_t i = 0; i < motionBounds.size(); ++i)
+        {
+            motionBounds[i].expand(boundsAtTime1[i]);
+        }
+        build(motionBounds, method, pool);
+
+        m_time0 = time0;
+        m_time1 = time1;
+        m_endBounds.resize(m_nodes.size());
+
+        // The children are always stored after their parent, a reverse pass visits them first
+        for (std::size_t i = m_nodes.size(); i-- > 0;)
+        {
+            BvhNode& node = m_nodes[i];
+            Aabb startBounds, endBounds;
+            if (node.primitiveCount > 0)
+            {
+                for (std::uint32_t j = node.offset; j < node.offset + node.primitiveCount; ++j)
+                {
+                    startBounds.expand(boundsAtTime0[m_primitiveIndices[j]]);
+                    endBounds.expand(boundsAtTime1[m_primitiveIndices[j]]);
+                }
+            }
+            else
+            {
+                for (std::uint32_t child = node.offset; child < node.offset + 2; ++child)
+                {
+                    startBounds.expand(getNodeBounds(m_nodes[child]));
+                    const BvhMotionBounds& childEnd = m_endBounds[child];
+                    endBounds.expand(Aabb(vec3(childEnd.boundsMin[0], childEnd.boundsMin[1], childEnd.boundsMin[2]),
+                        vec3(childEnd.boundsMax[0], childEnd.boundsMax[1], childEnd.boundsMax[2])));
+                }
+            }
+
+            setNodeBounds(node, startBounds);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                m_endBounds[i].boundsMin[axis] = endBounds.min()[axis];
+                m_endBounds[i].boundsMax[axis] = endBounds.max()[axis];
+            }
+        }
+    }
+
+    void Bvh::makeLeaf(BuildContext& context, std::uint32_t nodeIndex, std::uint32_t begin, std::uint32_t end)
+    {
+        Aabb bounds;
+        for (std::uint32_t i = begin; i < end; ++i)
+        {
+            bounds.expand(context.primitiveBounds[m_primitiveIndices[i]]);
+        }
+
+        BvhNode& node = m_nodes[nodeIndex];
+        setNodeBounds(node, bounds);
+        node.offset = begin;
+        node.primitiveCount = end - begin;
+    }
+
+    void Bvh::buildBinnedSahNode(BuildContext& context, std::uint32_t nodeIndex, std::uint32_t begin, std::uint32_t end, int depth)
+    {
+        // The depth is bounded by the size of the traversal stack
+        std::uint32_t count = end - begin;
+        if (count == 1 || depth >= BVH_MAX_DEPTH - 1)
+        {
+            makeLeaf(context, nodeIndex, begin, end);
+            return;
+        }
+
+        bool parallel = context.pool != nullptr && count >= PARALLEL_BINNING_THRESHOLD;
+        ThreadPool* pool = parallel ? context.pool : nullptr;
+
+        // Compute the bounds of the node and the bounds of its primitive centroids
+        std::uint32_t chunkCount = getChunkCount(begin, end);
+        std::vector<Aabb> chunkBounds(chunkCount);
+        std::vector<Aabb> chunkCentroidBounds(chunkCount);
+        parallelChunks(pool, begin, end, [&](std::uint32_t chunk, std::uint32_t chunkBegin, std::uint32_t chunkEnd)
+        {
+            for (std::uint32_t i = chunkBegin; i < chunkEnd; ++i)
+            {
+                std::uint32_t index = m_primitiveIndices[i];
+                chunkBounds[chunk].expand(context.primitiveBounds[index]);
+                chunkCentroidBounds[chunk].expand(context.centroids[index]);
+            }
+        });
+
+        Aabb bounds;
+        Aabb centroidBounds;
+        for (std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            bounds.expand(chunkBounds[chunk]);
+            centroidBounds.expand(chunkCentroidBounds[chunk]);
+        }
+        setNodeBounds(m_nodes[nodeIndex], bounds);
+
+        // Bin the primitives along each axis based on their centroid
+        vec3 extent = centroidBounds.max() - centroidBounds.min();
+        vec3 binScale;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            binScale[axis] = (extent[axis] > 0.f) ? SAH_BIN_COUNT / extent[axis] : 0.f;
+        }
+        auto getBinIndex = [&](const vec3& centroid, int axis)
+        {
+            int bin = static_cast<int>((centroid[axis] - centroidBounds.min()[axis]) * binScale[axis]);
+            return std::min(std::max(bin, 0), SAH_BIN_COUNT - 1);
+        };
+
+        std::vector<Bin> chunkBins(static_cast<std::size_t>(chunkCount) * 3 * SAH_BIN_COUNT);
+        parallelChunks(pool, begin, end, [&](std::uint32_t chunk, std::uint32_t chunkBegin, std::uint32_t chunkEnd)
+        {
+            Bin* bins = &chunkBins[static_cast<std::size_t>(chunk) * 3 * SAH_BIN_COUNT];
+            for (std::uint32_t i = chunkBegin; i < chunkEnd; ++i)
+            {
+                std::uint32_t index = m_primitiveIndices[i];
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    Bin& bin = bins[axis * SAH_BIN_COUNT + getBinIndex(context.centroids[index], axis)];
+                    bin.bounds.expand(context.primitiveBounds[index]);
+                    ++bin.count;
+                }
+            }
+        });
+
+        Bin bins[3 * SAH_BIN_COUNT];
+        for (std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            for (int b = 0; b < 3 * SAH_BIN_COUNT; ++b)
+            {
+                const Bin& chunkBin = chunkBins[static_cast<std::size_t>(chunk) * 3 * SAH_BIN_COUNT + b];
+                bins[b].bounds.expand(chunkBin.bounds);
+                bins[b].count += chunkBin.count;
+            }
+        }
+
+        // Evaluate the SAH cost of splitting after each bin, the right side is swept first
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        int bestSplit = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (binScale[axis] == 0.f)
+            {
+                continue;
+            }
+
+            const Bin* axisBins = &bins[axis * SAH_BIN_COUNT];
+            float rightCosts[SAH_BIN_COUNT];
+            Aabb rightBounds;
+            std::uint32_t rightCount = 0;
+            for (int b = SAH_BIN_COUNT - 1; b > 0; --b)
+            {
+                rightBounds.expand(axisBins[b].bounds);
+                rightCount += axisBins[b].count;
+                rightCosts[b] = rightBounds.halfArea() * rightCount;
+            }
+
+            Aabb leftBounds;
+            std::uint32_t leftCount = 0;
+            for (int b = 0; b < SAH_BIN_COUNT - 1; ++b)
+            {
+                leftBounds.expand(axisBins[b].bounds);
+                leftCount += axisBins[b].count;
+                float cost = leftBounds.halfArea() * leftCount + rightCosts[b + 1];
+                if (leftCount > 0 && leftCount < count && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        // Compare the best split to the cost of making a leaf
+        float leafCost = SAH_INTERSECTION_COST * count;
+        float splitCost = SAH_TRAVERSAL_COST + SAH_INTERSECTION_COST * bestCost / bounds.halfArea();
+        if (count <= SAH_MAX_LEAF_SIZE && (bestAxis < 0 || leafCost <= splitCost))
+        {
+            makeLeaf(context, nodeIndex, begin, end);
+            return;
+        }
+
+        // Partition the primitives around the split, fall back to a median split when there's no valid split
+        std::uint32_t middle;
+        if (bestAxis < 0)
+        {
+            middle = begin + count / 2;
+        }
+        else if (!parallel)
+        {
+            auto it = std::partition(m_primitiveIndices.begin() + begin, m_primitiveIndices.begin() + end,
+                [&](std::uint32_t index) { return getBinIndex(context.centroids[index], bestAxis) <= bestSplit; });
+            middle = static_cast<std::uint32_t>(it - m_primitiveIndices.begin());
+        }
+        else
+        {
+            // Count the primitives on the left side of each chunk, then scatter them at their final position
+            std::vector<std::uint32_t> leftCounts(chunkCount);
+            parallelChunks(pool, begin, end, [&](std::uint32_t chunk, std::uint32_t chunkBegin, std::uint32_t chunkEnd)
+            {
+                std::uint32_t leftCount = 0;
+                for (std::uint32_t i = chunkBegin; i < chunkEnd; ++i)
+                {
+                    leftCount += (getBinIndex(context.centroids[m_primitiveIndices[i]], bestAxis) <= bestSplit) ? 1 : 0;
+                }
+                leftCounts[chunk] = leftCount;
+            });
+
+            std::vector<std::uint32_t> leftOffsets(chunkCount);
+            std::vector<std::uint32_t> rightOffsets(chunkCount);
+            std::uint32_t totalLeftCount = 0;
+            for (std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+            {
+                leftOffsets[chunk] = begin + totalLeftCount;
+                totalLeftCount += leftCounts[chunk];
+            }
+            middle = begin + totalLeftCount;
+            for (std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+            {
+                std::uint32_t chunkBegin = begin + chunk * PARALLEL_CHUNK_SIZE;
+                rightOffsets[chunk] = middle + (chunkBegin - begin) - (leftOffsets[chunk] - begin);
+            }
+
+            parallelChunks(pool, begin, end, [&](std::uint32_t chunk, std::uint32_t chunkBegin, std::uint32_t chunkEnd)
+            {
+                std::uint32_t left = leftOffsets[chunk];
+                std::uint32_t right = rightOffsets[chunk];
+                for (std::uint32_t i = chunkBegin; i < chunkEnd; ++i)
+                {
+                    std::uint32_t index = m_primitiveIndices[i];
+                    bool isLeft = getBinIndex(context.centroids[index], bestAxis) <= bestSplit;
+                    context.scratch[isLeft ? left++ : right++] = index;
+                }
+            });
+            parallelChunks(pool, begin, end, [&](std::uint32_t, std::uint32_t chunkBegin, std::uint32_t chunkEnd)
+            {
+                std::copy(context.scratch.begin() + chunkBegin, context.scratch.begin() + chunkEnd, m_primitiveIndices.begin() + chunkBegin);
+            });
+        }
+
+        // Build the children, the biggest subtrees are built by independent tasks
+        std::uint32_t childIndex = context.nodeCount.fetch_add(2);
+        m_nodes[nodeIndex].offset = childIndex;
+        m_nodes[nodeIndex].primitiveCount = 0;
+
+        TaskGroup group((context.pool != nullptr && count >= PARALLEL_SUBTREE_THRESHOLD) ? context.pool : nullptr);
+        group.run([&, childIndex, begin, middle, depth]() { buildBinnedSahNode(context, childIndex, begin, middle, depth + 1); });
+        buildBinnedSahNode(context, childIndex + 1, middle, end, depth + 1);
+        group.wait();
+    }
+
+    void Bvh::buildLbvhNode(BuildContext& context, std::uint32_t nodeIndex, std::uint32_t begin, std::uint32_t end, int depth)
+    {
+        std::uint32_t count = end - begin;
+        if (count <= LBVH_LEAF_SIZE || depth >= BVH_MAX_DEPTH - 1)
+        {
+            makeLeaf(context, nodeIndex, begin, end);
+            return;
+        }
+
+        // Split where the highest differing bit of the sorted Morton codes flips, or in the middle if they're identical
+        std::uint32_t middle = begin + count / 2;
+        std::uint32_t firstCode = context.mortonCodes[begin];
+        std::uint32_t lastCode = context.mortonCodes[end - 1];
+        if (firstCode != lastCode)
+        {
+            std::uint32_t bit = 1u << getHighestBit(firstCode ^ lastCode);
+            auto it = std::partition_point(context.mortonCodes.begin() + begin, context.mortonCodes.begin() + end,
+                [bit](std::uint32_t code) { return (code & bit) == 0; });
+            middle = static_cast<std::uint32_t>(it - context.mortonCodes.begin());
+        }
+
+        std::uint32_t childIndex = context.nodeCount.fetch_add(2);
+        TaskGroup group((context.pool != nullptr && count >= PARALLEL_SUBTREE_THRESHOLD) ? context.pool : nullptr);
+        group.run([&, childIndex, begin, middle, depth]() { buildLbvhNode(context, childIndex, begin, middle, depth + 1); });
+        buildLbvhNode(context, childIndex + 1, middle, end, depth + 1);
+        group.wait();
+
+        // The bounds are computed bottom-up once both children are complete
+        Aabb bounds = getNodeBounds(m_nodes[childIndex]);
+        bounds.expand(getNodeBounds(m_nodes[childIndex + 1]));
+
+        BvhNode& node = m_nodes[nodeIndex];
+        setNodeBounds(node, bounds);
+        node.offset = childIndex;
+        node.primitiveCount = 0;
+    }
+
+    void Bvh::insertPrimitive(std::uint32_t primitiveIndex, const Aabb& bounds)
+    {
+        updateBuiltCosts();
+
+        BvhNode leaf;
+        setNodeBounds(leaf, bounds);
+        leaf.offset = static_cast<std::uint32_t>(m_primitiveIndices.size());
+        leaf.primitiveCount = 1;
+        if (m_nodes.empty())
+        {
+            m_nodes.push_back(leaf);
+            m_builtCosts.push_back(-1.f);
+            m_primitiveIndices.push_back(primitiveIndex);
+            return;
+        }
+
+        // Go down the child whose area grows the least, the nodes on the way are grown to contain the primitive
+        std::uint32_t nodeIndex = 0;
+        int depth = 0;
+        Aabb siblingBounds;
+        for (;;)
+        {
+            BvhNode& node = m_nodes[nodeIndex];
+            siblingBounds = getNodeBounds(node);
+            Aabb grownBounds = siblingBounds;
+            grownBounds.expand(bounds);
+            setNodeBounds(node, grownBounds);
+            if (node.primitiveCount > 0)
+            {
+                break;
+            }
+
+            auto getAreaIncrease = [&](std::uint32_t childIndex)
+            {
+                Aabb childBounds = getNodeBounds(m_nodes[childIndex]);
+                float area = childBounds.halfArea();
+                childBounds.expand(bounds);
+                return childBounds.halfArea() - area;
+            };
+            nodeIndex = (getAreaIncrease(node.offset) <= getAreaIncrease(node.offset + 1)) ? node.offset : node.offset + 1;
+            ++depth;
+        }
+
+        // The primitive is left out until the next refit builds the tree again
+        if (depth >= BVH_MAX_DEPTH - 1)
+        {
+            m_needsRebuild = true;
+            return;
+        }
+
+        // The leaf becomes an interior node whose children are the former leaf and the new one, the primitives of its
+        // subtree aren't contiguous anymore until the tree is compacted
+        BvhNode sibling = m_nodes[nodeIndex];
+        setNodeBounds(sibling, siblingBounds);
+        auto childIndex = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes[nodeIndex].offset = childIndex;
+        m_nodes[nodeIndex].primitiveCount = 0;
+        m_nodes.push_back(sibling);
+        m_nodes.push_back(leaf);
+        m_builtCosts[nodeIndex] = -1.f;
+        m_builtCosts.resize(m_nodes.size(), -1.f);
+        m_primitiveIndices.push_back(primitiveIndex);
+        m_structureChanged = true;
+    }
+
+    void Bvh::removePrimitive(std::uint32_t primitiveIndex)
+    {
+        updateBuiltCosts();
+
+        // The primitive is only marked as removed, the emptied leaves are dropped when the tree is compacted
+        auto it = std::find(m_primitiveIndices.begin(), m_primitiveIndices.end(), primitiveIndex);
+        if (it != m_primitiveIndices.end())
+        {
+            *it = REMOVED_PRIMITIVE;
+            m_structureChanged = true;
+        }
+    }
+
+    void Bvh::renamePrimitive(std::uint32_t primitiveIndex, std::uint32_t newPrimitiveIndex)
+    {
+        auto it = std::find(m_primitiveIndices.begin(), m_primitiveIndices.end(), primitiveIndex);
+        if (it != m_primitiveIndices.end())
+        {
+            *it = newPrimitiveIndex;
+        }
+    }
+
+    BvhRefitStats Bvh::refit(const std::vector<Aabb>& primitiveBounds, float rebuildThreshold, ThreadPool* pool)
+    {
+        BvhRefitStats stats = {};
+        updateBuiltCosts();
+        if (m_structureChanged)
+        {
+            compact();
+        }
+        if (m_nodes.empty())
+        {
+            return stats;
+        }
+
+        // The pool is only worth it for the bigger trees
+        ThreadPool* refitPool = (m_nodes.size() >= PARALLEL_REFIT_THRESHOLD) ? pool : nullptr;
+        std::vector<float> costs(m_nodes.size());
+        refitNode(primitiveBounds, costs, 0, 0, refitPool);
+
+        // The nodes created by the edits take their current cost as a reference
+        for (std::size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            if (m_builtCosts[i] < 0.f)
+            {
+                m_builtCosts[i] = getRelativeCost(m_nodes[i], costs[i]);
+            }
+        }
+        stats.builtSahCost = m_builtCosts[0];
+        stats.refittedSahCost = getRelativeCost(m_nodes[0], costs[0]);
+        stats.sahCost = stats.refittedSahCost;
+
+        // Once the cost of the whole tree has grown past the threshold, the degraded part is located and built again
+        bool degraded = stats.refittedSahCost > rebuildThreshold * stats.builtSahCost;
+        std::uint32_t subtreeIndex = 0;
+        int subtreeDepth = 0;
+        if (degraded)
+        {
+            findDegradedSubtree(costs, getExcessCost(m_nodes[0], costs[0], m_builtCosts[0]), subtreeIndex, subtreeDepth);
+        }
+
+        // The primitives of a subtree are contiguous once the tree is compact, from its leftmost to its rightmost leaf
+        std::uint32_t begin = subtreeIndex;
+        while (m_nodes[begin].primitiveCount == 0)
+        {
+            begin = m_nodes[begin].offset;
+        }
+        std::uint32_t end = subtreeIndex;
+        while (m_nodes[end].primitiveCount == 0)
+        {
+            end = m_nodes[end].offset + 1;
+        }
+        begin = m_nodes[begin].offset;
+        end = m_nodes[end].offset + m_nodes[end].primitiveCount;
+
+        bool fullRebuild = m_needsRebuild || (degraded && (subtreeIndex == 0 || end - begin > MAX_PARTIAL_REBUILD_FRACTION * m_primitiveIndices.size()));
+        if (fullRebuild)
+        {
+            build(primitiveBounds, m_buildMethod, pool);
+            stats.sahCost = computeSahCost();
+            stats.rebuiltPrimitiveCount = static_cast<std::uint32_t>(primitiveBounds.size());
+            stats.fullRebuild = true;
+            return stats;
+        }
+        if (!degraded)
+        {
+            return stats;
+        }
+
+        // The subtree is built again with the binned SAH in place of its root, its former nodes are dropped by the compaction
+        BuildContext context(primitiveBounds, pool);
+        context.centroids.resize(primitiveBounds.size());
+        context.scratch.resize(m_primitiveIndices.size());
+        for (std::uint32_t i = begin; i < end; ++i)
+        {
+            context.centroids[m_primitiveIndices[i]] = primitiveBounds[m_primitiveIndices[i]].centroid();
+        }
+        context.nodeCount = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes.resize(m_nodes.size() + 2 * static_cast<std::size_t>(end - begin));
+        buildBinnedSahNode(context, subtreeIndex, begin, end, subtreeDepth);
+        m_builtCosts[subtreeIndex] = -1.f;
+        m_nodes.resize(context.nodeCount.load());
+        m_builtCosts.resize(m_nodes.size(), -1.f);
+        compact();
+
+        // The bounds are left unchanged but the costs of the ancestors of the subtree aren't
+        costs.assign(m_nodes.size(), 0.f);
+        refitNode(primitiveBounds, costs, 0, 0, refitPool);
+        for (std::size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            if (m_builtCosts[i] < 0.f)
+            {
+                m_builtCosts[i] = getRelativeCost(m_nodes[i], costs[i]);
+            }
+        }
+        stats.sahCost = getRelativeCost(m_nodes[0], costs[0]);
+        stats.rebuiltPrimitiveCount = end - begin;
+        return stats;
+    }
+
+    float Bvh::refitNode(const std::vector<Aabb>& primitiveBounds, std::vector<float>& costs, std::uint32_t nodeIndex, int depth, ThreadPool* pool)
+    {
+        // The cost of a subtree is the sum of the costs of its nodes weighted by their area
+        BvhNode& node = m_nodes[nodeIndex];
+        Aabb bounds;
+        float cost;
+        if (node.primitiveCount > 0)
+        {
+            for (std::uint32_t i = node.offset; i < node.offset + node.primitiveCount; ++i)
+            {
+                bounds.expand(primitiveBounds[m_primitiveIndices[i]]);
+            }
+            cost = SAH_INTERSECTION_COST * node.primitiveCount * bounds.halfArea();
+        }
+        else
+        {
+            // Only the top levels are split into tasks, the task of a node refits its whole subtree
+            float leftCost = 0.f;
+            float rightCost = 0.f;
+            if (pool != nullptr && depth < PARALLEL_REFIT_DEPTH)
+            {
+                TaskGroup group(pool);
+                group.run([&]() { leftCost = refitNode(primitiveBounds, costs, node.offset, depth + 1, pool); });
+                rightCost = refitNode(primitiveBounds, costs, node.offset + 1, depth + 1, pool);
+                group.wait();
+            }
+            else
+            {
+                leftCost = refitNode(primitiveBounds, costs, node.offset, depth + 1, nullptr);
+                rightCost = refitNode(primitiveBounds, costs, node.offset + 1, depth + 1, nullptr);
+            }
+
+            bounds = getNodeBounds(m_nodes[node.offset]);
+            bounds.expand(getNodeBounds(m_nodes[node.offset + 1]));
+            cost = SAH_TRAVERSAL_COST * bounds.halfArea() + leftCost + rightCost;
+        }
+
+        setNodeBounds(node, bounds);
+        costs[nodeIndex] = cost;
+        return cost;
+    }
+
+    void Bvh::findDegradedSubtree(const std::vector<float>& costs, float excessCost, std::uint32_t& nodeIndex, int& depth) const
+    {
+        // Go down the child which holds most of the excess cost of the tree, so that the smallest subtree which explains it
+        // is rebuilt, the degradation caused by spheres moving in a small region is located while a widespread one isn't
+        for (;;)
+        {
+            const BvhNode& node = m_nodes[nodeIndex];
+            if (node.primitiveCount > 0)
+            {
+                return;
+            }
+
+            std::uint32_t child = node.offset;
+            float childExcessCost = getExcessCost(m_nodes[child], costs[child], m_builtCosts[child]);
+            float rightExcessCost = getExcessCost(m_nodes[child + 1], costs[child + 1], m_builtCosts[child + 1]);
+            if (rightExcessCost > childExcessCost)
+            {
+                ++child;
+                childExcessCost = rightExcessCost;
+            }
+            if (childExcessCost < REBUILT_EXCESS_COST_FRACTION * excessCost)
+            {
+                return;
+            }
+            nodeIndex = child;
+            ++depth;
+        }
+    }
+
+    void Bvh::computeCosts(std::vector<float>& costs) const
+    {
+        // The children are always stored after their parent, a reverse pass visits them first
+        costs.resize(m_nodes.size());
+        for (std::size_t i = m_nodes.size(); i-- > 0;)
+        {
+            const BvhNode& node = m_nodes[i];
+            float area = getNodeBounds(node).halfArea();
+            costs[i] = (node.primitiveCount > 0) ? SAH_INTERSECTION_COST * node.primitiveCount * area
+                : SAH_TRAVERSAL_COST * area + costs[node.offset] + costs[node.offset + 1];
+        }
+    }
+
+    void Bvh::updateBuiltCosts()
+    {
+        // The reference costs are computed before the first edit or refit, the tree is still the one which has been built
+        if (m_builtCosts.size() == m_nodes.size())
+        {
+            return;
+        }
+
+        std::vector<float> costs;
+        computeCosts(costs);
+        m_builtCosts.resize(m_nodes.size());
+        for (std::size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            m_builtCosts[i] = getRelativeCost(m_nodes[i], costs[i]);
+        }
+    }
+
+    void Bvh::compact()
+    {
+        m_structureChanged = false;
+
+        // Count the primitives left in each subtree
+        std::vector<std::uint32_t> counts(m_nodes.size(), 0);
+        for (std::size_t i = m_nodes.size(); i-- > 0;)
+        {
+            const BvhNode& node = m_nodes[i];
+            if (node.primitiveCount > 0)
+            {
+                for (std::uint32_t j = node.offset; j < node.offset + node.primitiveCount; ++j)
+                {
+                    counts[i] += (m_primitiveIndices[j] != REMOVED_PRIMITIVE) ? 1 : 0;
+                }
+            }
+            else
+            {
+                counts[i] = counts[node.offset] + counts[node.offset + 1];
+            }
+        }
+
+        std::vector<BvhNode> nodes;
+        std::vector<std::uint32_t> primitiveIndices;
+        std::vector<float> builtCosts;
+        if (m_nodes.empty() || counts[0] == 0)
+        {
+            m_nodes.swap(nodes);
+            m_primitiveIndices.swap(primitiveIndices);
+            m_builtCosts.swap(builtCosts);
+            return;
+        }
+
+        // Copy the reachable nodes depth-first, so that the leaves of each subtree reference contiguous primitives
+        // an interior node with an empty child is replaced by its other child
+        nodes.reserve(m_nodes.size());
+        primitiveIndices.reserve(m_primitiveIndices.size());
+        builtCosts.reserve(m_nodes.size());
+        nodes.resize(1);
+        builtCosts.resize(1);
+        std::pair<std::uint32_t, std::uint32_t> stack[BVH_MAX_DEPTH + 1];   // the source and the destination of the nodes to copy
+        int stackSize = 0;
+        stack[stackSize++] = std::make_pair(0u, 0u);
+        while (stackSize > 0)
+        {
+            std::uint32_t source = stack[stackSize - 1].first;
+            std::uint32_t destination = stack[stackSize - 1].second;
+            --stackSize;
+            while (m_nodes[source].primitiveCount == 0 && (counts[m_nodes[source].offset] == 0 || counts[m_nodes[source].offset + 1] == 0))
+            {
+                source = (counts[m_nodes[source].offset] == 0) ? m_nodes[source].offset + 1 : m_nodes[source].offset;
+            }
+
+            BvhNode node = m_nodes[source];
+            builtCosts[destination] = m_builtCosts[source];
+            if (node.primitiveCount > 0)
+            {
+                auto offset = static_cast<std::uint32_t>(primitiveIndices.size());
+                for (std::uint32_t j = node.offset; j < node.offset + node.primitiveCount; ++j)
+                {
+                    if (m_primitiveIndices[j] != REMOVED_PRIMITIVE)
+                    {
+                        primitiveIndices.push_back(m_primitiveIndices[j]);
+                    }
+                }
+                node.offset = offset;
+                node.primitiveCount = static_cast<std::uint32_t>(primitiveIndices.size()) - offset;
+            }
+            else
+            {
+                // The right child is pushed first so that the left subtree is copied first
+                auto childIndex = static_cast<std::uint32_t>(nodes.size());
+                nodes.resize(nodes.size() + 2);
+                builtCosts.resize(nodes.size());
+                stack[stackSize++] = std::make_pair(node.offset + 1, childIndex + 1);
+                stack[stackSize++] = std::make_pair(node.offset, childIndex);
+                node.offset = childIndex;
+            }
+            nodes[destination] = node;
+        }
+
+        m_nodes.swap(nodes);
+        m_primitiveIndices.swap(primitiveIndices);
+        m_builtCosts.swap(builtCosts);
+    }
+
+    float Bvh::computeSahCost() const
+    {
+        if (m_nodes.empty())
+        {
+            return 0.f;
+        }
+
+        float rootArea = getNodeBounds(m_nodes[0]).halfArea();
+        if (rootArea <= 0.f)
+        {
+            return SAH_INTERSECTION_COST * m_primitiveIndices.size();
+        }
+
+        // Every node is reached with a probability proportional to its surface area
+        double cost = 0.0;
+        for (const auto& node : m_nodes)
+        {
+            float nodeCost = (node.primitiveCount > 0) ? SAH_INTERSECTION_COST * node.primitiveCount : SAH_TRAVERSAL_COST;
+            cost += nodeCost * getNodeBounds(node).halfArea() / rootArea;
+        }
+        return static_cast<float>(cost);
+    }
+
+    Aabb Bvh::getBounds() const
+    {
+        if (m_nodes.empty())
+        {
+            return Aabb();
+        }
+
+        Aabb bounds = getNodeBounds(m_nodes[0]);
+        if (!m_endBounds.empty())
+        {
+            const BvhMotionBounds& end = m_endBounds[0];
+            bounds.expand(Aabb(vec3(end.boundsMin[0], end.boundsMin[1], end.boundsMin[2]), vec3(end.boundsMax[0], end.boundsMax[1], end.boundsMax[2])));
+        }
+        return bounds;
+    }
+}
@@ -0,0 +1,256 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "aabb.h"
+#include "ray.h"
+
+namespace rts // for ray tracing series
+{
+    class ThreadPool;
+
+    // The maximum depth of a hierarchy, the builders fall back to median splits when they reach it
+    const int BVH_MAX_DEPTH = 64;
+
+    // A node of the hierarchy, the two children of an interior node are stored next to each other
+    struct BvhNode
+    {
+        float boundsMin[3];
+        std::uint32_t offset;           // the index of the first child, or of the first primitive for a leaf
+        float boundsMax[3];
+        std::uint32_t primitiveCount;   // 0 for an interior node
+    };
+
+    // The bounds of a node at the end of the motion interval, the start bounds are the ones of the node itself
+    struct BvhMotionBounds
+    {
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    enum class BvhBuildMethod
+    {
+        BinnedSah,  // the best trace performance, the top levels are built with parallel binning and partitioning
+        Lbvh        // a faster build based on the Morton codes of the primitives, meant for interactive previews
+    };
+
+    // The outcome of a refit, the SAH costs tell how much the tree has degraded since it was built
+    struct BvhRefitStats
+    {
+        float builtSahCost;                 // the cost of the tree when it was built (see Bvh::computeSahCost)
+        float refittedSahCost;              // the cost once refitted, before the degraded subtree is built again
+        float sahCost;                      // the final cost
+        std::uint32_t rebuiltPrimitiveCount;
+        bool fullRebuild;
+    };
+
+    // A bounding volume hierarchy over a set of primitives only known by their bounding boxes
+    // the primitives themselves are tested through a callback during the traversal
+    // the primitives may be moving, in that case each node has bounds at both ends of the motion interval
+    // which are linearly interpolated at the time of the ray, the primitives must move linearly for the bounds to be conservative
+    class Bvh final
+    {
+    public:
+        Bvh() : m_buildMethod(BvhBuildMethod::BinnedSah), m_time0(0.f), m_time1(0.f), m_structureChanged(false), m_needsRebuild(false) {}
+
+        // Build the hierarchy, the tasks are spread over the thread pool if one is given
+        void build(const std::vector<Aabb>& primitiveBounds, BvhBuildMethod method, ThreadPool* pool);
+
+        // Build the hierarchy of moving primitives given their bounds at time0 and time1
+        void buildWithMotion(const std::vector<Aabb>& boundsAtTime0, const std::vector<Aabb>& boundsAtTime1, float time0, float time1,
+            BvhBuildMethod method, ThreadPool* pool);
+
+        // Edit the primitives of a built hierarchy without motion, the tree can't be traversed until refit() is called
+        // an inserted primitive becomes a new leaf next to the leaf whose bounds grow the least
+        // the removal and the renaming search the primitive, they're linear in the primitive count
+        void insertPrimitive(std::uint32_t primitiveIndex, const Aabb& bounds);
+        void removePrimitive(std::uint32_t primitiveIndex);
+        void renamePrimitive(std::uint32_t primitiveIndex, std::uint32_t newPrimitiveIndex);
+
+        // Update the bounds of the nodes bottom-up given the current bounds of every primitive, it's much faster than a build
+        // but the tree degrades as the primitives move, once its SAH cost has grown by more than rebuildThreshold since
+        // it was built, the subtree which holds most of the degradation is built again, or the whole tree if it's too big
+        BvhRefitStats refit(const std::vector<Aabb>& primitiveBounds, float rebuildThreshold, ThreadPool* pool);
+
+        // Find the closest primitive hit by the ray in (tMin, tMax), tMax is updated with the distance of the closest hit
+        // the callback signature is bool(std::uint32_t primitiveIndex, float tMin, float tMax, float& t)
+        template <typename IntersectPrimitive>
+        bool intersect(const Ray& r, float tMin, float& tMax, IntersectPrimitive&& intersectPrimitive) const;
+
+        // The expected cost of tracing a ray through the hierarchy, a lower cost means a better tree
+        float computeSahCost() const;
+
+        // The bounds of the whole hierarchy, they cover the entire motion interval
+        Aabb getBounds() const;
+        std::size_t getNodeCount() const { return m_nodes.size(); }
+        std::size_t getPrimitiveCount() const { return m_primitiveIndices.size(); }
+        std::size_t getMemoryUsage() const
+        {
+            return m_nodes.size() * sizeof(BvhNode) + m_endBounds.size() * sizeof(BvhMotionBounds) + m_primitiveIndices.size() * sizeof(std::uint32_t)
+                + m_builtCosts.size() * sizeof(float);
+        }
+        bool hasMotion() const { return !m_endBounds.empty(); }
+
+        // The nodes and the primitives in the order of the leaves, they're read by the compact layouts (see CompressedBvh)
+        const std::vector<BvhNode>& getNodes() const { return m_nodes; }
+        const std::vector<std::uint32_t>& getPrimitiveIndices() const { return m_primitiveIndices; }
+
+    private:
+        struct BuildContext;
+
+        void buildBinnedSahNode(BuildContext& context, std::uint32_t nodeIndex, std::uint32_t begin, std::uint32_t end, int depth);
+        void buildLbvhNode(BuildContext& context, std::uint32_t nodeIndex, std::uint32_t begin, std::uint32_t end, int depth);
+        void makeLeaf(BuildContext& context, std::uint32_t nodeIndex, std::uint32_t begin, std::uint32_t end);
+
+        float refitNode(const std::vector<Aabb>& primitiveBounds, std::vector<float>& costs, std::uint32_t nodeIndex, int depth, ThreadPool* pool);
+        void findDegradedSubtree(const std::vector<float>& costs, float excessCost, std::uint32_t& nodeIndex, int& depth) const;
+        void computeCosts(std::vector<float>& costs) const;
+        void updateBuiltCosts();
+        void compact();
+
+        BvhBuildMethod m_buildMethod;
+        std::vector<BvhNode> m_nodes;
+        std::vector<std::uint32_t> m_primitiveIndices;
+
+        // Only filled for moving primitives, along with the motion interval
+        std::vector<BvhMotionBounds> m_endBounds;
+        float m_time0;
+        float m_time1;
+
+        // Only filled once the tree is edited or refitted, the SAH cost of each subtree relative to its root when it was built
+        // a negative cost marks a node which has just been created, its current cost becomes its reference
+        std::vector<float> m_builtCosts;
+        bool m_structureChanged;    // the edits left removed primitives or leaves whose primitives aren't contiguous
+        bool m_needsRebuild;        // an insertion reached the maximum depth
+    };
+
+    // Compute the 30-bit Morton code of a point whose coordinates are in [0, 1]
+    std::uint32_t getMortonCode(const vec3& p);
+
+    // Return the distance at which the ray enters the box, or a negative value if it misses it
+    // the signs of the ray direction select the near and the far plane of each slab, which saves a min and a max per axis
+    // a ray parallel to an axis whose origin lies on a plane of the slab computes 0 * inf, i.e. NaN, std::max and std::min return
+    // their first argument when the second one is NaN, so the slabs come second and such a slab is ignored, the box is then hit
+    inline float intersectBox(const float boundsMin[3], const float boundsMax[3], const Ray& r, float tMin, float tMax)
+    {
+        const float* bounds[2] = { boundsMin, boundsMax };
+        const vec3& origin = r.origin();
+        const vec3& invDirection = r.invDirection();
+        const int* sign = r.sign();
+
+        float txNear = (bounds[sign[0]][0] - origin.x()) * invDirection.x();
+        float txFar = (bounds[1 - sign[0]][0] - origin.x()) * invDirection.x();
+        float tyNear = (bounds[sign[1]][1] - origin.y()) * invDirection.y();
+        float tyFar = (bounds[1 - sign[1]][1] - origin.y()) * invDirection.y();
+        float tzNear = (bounds[sign[2]][2] - origin.z()) * invDirection.z();
+        float tzFar = (bounds[1 - sign[2]][2] - origin.z()) * invDirection.z();
+
+        float tEnter = std::max(std::max(std::max(tMin, txNear), tyNear), tzNear);
+        float tExit = std::min(std::min(std::min(tMax, txFar), tyFar), tzFar);
+        return (tEnter <= tExit) ? tEnter : -1.f;
+    }
+
+    inline float intersectNode(const BvhNode& node, const Ray& r, float tMin, float tMax)
+    {
+        return intersectBox(node.boundsMin, node.boundsMax, r, tMin, tMax);
+    }
+
+    // Intersect the bounds of a moving node interpolated at the given fraction of the motion interval
+    inline float intersectMotionNode(const BvhNode& node, const BvhMotionBounds& endBounds, float s, const Ray& r, float tMin, float tMax)
+    {
+        float boundsMin[3], boundsMax[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            boundsMin[axis] = node.boundsMin[axis] + s * (endBounds.boundsMin[axis] - node.boundsMin[axis]);
+            boundsMax[axis] = node.boundsMax[axis] + s * (endBounds.boundsMax[axis] - node.boundsMax[axis]);
+        }
+        return intersectBox(boundsMin, boundsMax, r, tMin, tMax);
+    }
+
+    template <typename IntersectPrimitive>
+    bool Bvh::intersect(const Ray& r, float tMin, float& tMax, IntersectPrimitive&& intersectPrimitive) const
+    {
+        if (m_nodes.empty())
+        {
+            return false;
+        }
+
+        // The fraction of the motion interval at the time of the ray, the static hierarchies skip the interpolation
+        bool hasMotion = !m_endBounds.empty();
+        float s = (hasMotion && m_time1 > m_time0) ? std::min(std::max((r.time() - m_time0) / (m_time1 - m_time0), 0.f), 1.f) : 0.f;
+        auto intersectChild = [&](std::uint32_t index)
+        {
+            return hasMotion ? intersectMotionNode(m_nodes[index], m_endBounds[index], s, r, tMin, tMax) : intersectNode(m_nodes[index], r, tMin, tMax);
+        };
+
+        if (intersectChild(0) < 0.f)
+        {
+            return false;
+        }
+
+        // Depth-first traversal, the closest child is visited first so that tMax shrinks as fast as possible
+        // the entry distance of the postponed nodes is kept to skip them if a closer hit has been found since
+        std::uint32_t stack[BVH_MAX_DEPTH];
+        float stackDistances[BVH_MAX_DEPTH];
+        int stackSize = 0;
+        std::uint32_t nodeIndex = 0;
+        bool hitAnything = false;
+        for (;;)
+        {
+            const BvhNode& node = m_nodes[nodeIndex];
+            if (node.primitiveCount > 0)
+            {
+                for (std::uint32_t i = 0; i < node.primitiveCount; ++i)
+                {
+                    float t;
+                    if (intersectPrimitive(m_primitiveIndices[node.offset + i], tMin, tMax, t))
+                    {
+                        hitAnything = true;
+                        tMax = t;
+                    }
+                }
+            }
+            else
+            {
+                float tLeft = intersectChild(node.offset);
+                float tRight = intersectChild(node.offset + 1);
+                if (tLeft >= 0.f && tRight >= 0.f)
+                {
+                    bool leftFirst = tLeft <= tRight;
+                    stack[stackSize] = leftFirst ? node.offset + 1 : node.offset;
+                    stackDistances[stackSize++] = leftFirst ? tRight : tLeft;
+                    nodeIndex = leftFirst ? node.offset : node.offset + 1;
+                    continue;
+                }
+                else if (tLeft >= 0.f || tRight >= 0.f)
+                {
+                    nodeIndex = (tLeft >= 0.f) ? node.offset : node.offset + 1;
+                    continue;
+                }
+            }
+
+            // Pop the next node which may still contain a closer hit
+            do
+            {
+                if (stackSize == 0)
+                {
+                    return hitAnything;
+                }
+                --stackSize;
+            } while (stackDistances[stackSize] > tMax);
+            nodeIndex = stack[stackSize];
+        }
+    }
+}
@@ -15,12 +15,17 @@
 
 namespace rts
 {
-    Camera::Camera(vec3 lookFrom, vec3 lookAt, vec3 vUp, float vFov, float aspectRatio, float aperture, float focusDist)
+    Camera::Camera(vec3 lookFrom, vec3 lookAt, vec3 vUp, float vFov, float aspectRatio, float aperture, float focusDist,
+        float time0, float time1)
         : m_origin(lookFrom)
+        , m_halfHeight(0.f)
         , m_lensRadius(aperture / 2.f)
+        , m_time0(time0)
+        , m_time1(time1)
     {
         float theta = vFov * static_cast<int>(M_PI) / 180.f; // the FOV converted in radian
         float halfHeight = tan(theta / 2.f);
+        m_halfHeight = halfHeight;
         float halfWidth = aspectRatio * halfHeight;
 
         // Compute the orthonormal basis (u, v, w)
@@ -40,6 +45,9 @@ namespace rts
     {
         vec3 rd = m_lensRadius * getRandomPointInUnitDisk(random);
         vec3 offset = u * rd.x() + v * rd.y();
-        return Ray(m_origin + offset, m_lowerLeftCorner + s * m_horizontal + t * m_vertical - m_origin - offset);
+
+        // No random number is drawn when the shutter is instantaneous, the rendering of a static scene is left unchanged
+        float time = (m_time1 > m_time0) ? m_time0 + random.get() * (m_time1 - m_time0) : m_time0;
+        return Ray(m_origin + offset, m_lowerLeftCorner + s * m_horizontal + t * m_vertical - m_origin - offset, time);
     }
 }
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <cmath>
+
 #include "ray.h"
 
 namespace rts // for ray tracing series
@@ -18,18 +20,26 @@ namespace rts // for ray tracing series
     class Camera final
     {
     public:
-        Camera(vec3 lookFrom, vec3 lookAt, vec3 vUp, float vFov, float aspectRatio, float aperture, float focusDist);
+        // The shutter is open between time0 and time1, the rays are spread over this interval to render the motion blur
+        Camera(vec3 lookFrom, vec3 lookAt, vec3 vUp, float vFov, float aspectRatio, float aperture, float focusDist,
+            float time0 = 0.f, float time1 = 0.f);
 
         // Return the ray starting at the camera position and oriented towards a specific point in space
         // this point is determined by applying the given offset to the point corresponding to the lower-left corner
         Ray getRay(float s, float t, Random& random) const;
 
+        // The angle covered by a pixel of an image of the given height, it's the spread of the ray cones (see Ray::setCone)
+        float getPixelSpreadAngle(int imageHeight) const { return 2.f * atan(m_halfHeight / imageHeight); }
+
     private:
         vec3 m_origin;
         vec3 m_lowerLeftCorner;
         vec3 m_horizontal;
         vec3 m_vertical;
         vec3 u, v, w; // camera's orthonormal basis
+        float m_halfHeight; // tan(vFov / 2)
         float m_lensRadius;
+        float m_time0;
+        float m_time1;
     };
 }
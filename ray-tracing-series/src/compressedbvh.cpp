@@ -0,0 +1,233 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+
+#include "compressedbvh.h"
+
+#include <cmath>
+
+namespace rts
+{
+    namespace
+    {
+        const std::uint32_t NO_NODE = 0xFFFFFFFF;
+
+        // The subtrees of up to this many primitives become a single leaf, the binned SAH builder mostly leaves a single
+        // primitive per leaf, the collapse removes most of the nodes for a few more primitive tests
+        const std::uint32_t COLLAPSED_SUBTREE_SIZE = 4;
+
+        std::uint32_t countSubtreePrimitives(const std::vector<BvhNode>& nodes, std::uint32_t nodeIndex, std::vector<std::uint32_t>& counts)
+        {
+            const BvhNode& node = nodes[nodeIndex];
+            std::uint32_t count = node.primitiveCount;
+            if (count == 0)
+            {
+                count = countSubtreePrimitives(nodes, node.offset, counts) + countSubtreePrimitives(nodes, node.offset + 1, counts);
+            }
+            counts[nodeIndex] = count;
+            return count;
+        }
+
+        // Quantize the bounds of a child within the decoded bounds of its parent and return the decoded bounds of the child
+        // the steps are rounded inward from the sides of the parent, i.e. outward for the child, then the decoded bounds are checked
+        // one more step covers the rounding differences of the decoding between the build and the traversal (e.g. a contracted multiply-add)
+        void quantizeChildBounds(const float boundsMin[3], const float boundsMax[3], const Aabb& bounds, std::uint8_t childBounds[6],
+            float childMin[3], float childMax[3])
+        {
+            float scale[3];
+            getQuantizationScale(boundsMin, boundsMax, scale);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                int stepsToMin = 0;
+                int stepsToMax = 0;
+                if (scale[axis] > 0.f)
+                {
+                    float toMin = std::floor((bounds.min()[axis] - boundsMin[axis]) / scale[axis]);
+                    float toMax = std::floor((boundsMax[axis] - bounds.max()[axis]) / scale[axis]);
+                    stepsToMin = static_cast<int>(std::min(std::max(toMin, 0.f), 255.f));
+                    stepsToMax = static_cast<int>(std::min(std::max(toMax, 0.f), 255.f));
+                    while (stepsToMin > 0 && boundsMin[axis] + static_cast<float>(stepsToMin) * scale[axis] > bounds.min()[axis])
+                    {
+                        --stepsToMin;
+                    }
+                    while (stepsToMax > 0 && boundsMax[axis] - static_cast<float>(stepsToMax) * scale[axis] < bounds.max()[axis])
+                    {
+                        --stepsToMax;
+                    }
+                    stepsToMin = std::max(stepsToMin - 1, 0);
+                    stepsToMax = std::max(stepsToMax - 1, 0);
+                }
+                childBounds[axis] = static_cast<std::uint8_t>(stepsToMin);
+                childBounds[axis + 3] = static_cast<std::uint8_t>(stepsToMax);
+            }
+            decodeChildBounds(boundsMin, boundsMax, scale, childBounds, childMin, childMax);
+        }
+    }
+
+    // Either a node of the source hierarchy or a range of the leaf order which is too big for a leaf reference
+    struct CompressedBvh::Subtree
+    {
+        std::uint32_t nodeIndex;    // NO_NODE for a range
+        std::uint32_t begin;
+        std::uint32_t end;
+        Aabb bounds;
+    };
+
+    bool CompressedBvh::build(const Bvh& bvh, const std::vector<Aabb>& primitiveBounds)
+    {
+        m_nodes.clear();
+        m_root = 0;
+        m_primitiveCount = 0;
+
+        const std::vector<BvhNode>& nodes = bvh.getNodes();
+        std::size_t primitiveCount = bvh.getPrimitiveIndices().size();
+        if (nodes.empty() || primitiveCount == 0)
+        {
+            return true;
+        }
+        if (primitiveCount > MAX_PRIMITIVE_COUNT)
+        {
+            return false;
+        }
+
+        // An interior node per interior node of the source, plus the ones splitting the big leaves
+        m_nodes.reserve(nodes.size() / 2);
+        Aabb bounds = bvh.getBounds();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            m_boundsMin[axis] = bounds.min()[axis];
+            m_boundsMax[axis] = bounds.max()[axis];
+        }
+        Subtree root = { 0, 0, 0, bounds };
+        std::vector<std::uint32_t> subtreeCounts(nodes.size());
+        countSubtreePrimitives(nodes, 0, subtreeCounts);
+        m_root = compressSubtree(bvh, primitiveBounds, subtreeCounts, root, m_boundsMin, m_boundsMax);
+        m_primitiveCount = primitiveCount;
+        return true;
+    }
+
+    std::uint32_t CompressedBvh::compressSubtree(const Bvh& bvh, const std::vector<Aabb>& primitiveBounds, const std::vector<std::uint32_t>& subtreeCounts,
+        const Subtree& subtree, const float boundsMin[3], const float boundsMax[3])
+    {
+        const std::vector<BvhNode>& nodes = bvh.getNodes();
+        Subtree children[2];
+        if (subtree.nodeIndex != NO_NODE && nodes[subtree.nodeIndex].primitiveCount == 0 && subtreeCounts[subtree.nodeIndex] > COLLAPSED_SUBTREE_SIZE)
+        {
+            const BvhNode& node = nodes[subtree.nodeIndex];
+            for (std::uint32_t i = 0; i < 2; ++i)
+            {
+                const BvhNode& child = nodes[node.offset + i];
+                children[i] = { node.offset + i, 0, 0,
+                    Aabb(vec3(child.boundsMin[0], child.boundsMin[1], child.boundsMin[2]), vec3(child.boundsMax[0], child.boundsMax[1], child.boundsMax[2])) };
+            }
+        }
+        else
+        {
+            std::uint32_t begin = subtree.begin;
+            std::uint32_t end = subtree.end;
+            if (subtree.nodeIndex != NO_NODE)
+            {
+                // The primitives of a subtree are contiguous in an unedited hierarchy, its leftmost leaf holds the first one
+                std::uint32_t leftmost = subtree.nodeIndex;
+                while (nodes[leftmost].primitiveCount == 0)
+                {
+                    leftmost = nodes[leftmost].offset;
+                }
+                begin = nodes[leftmost].offset;
+                end = begin + subtreeCounts[subtree.nodeIndex];
+            }
+            if (end - begin <= MAX_LEAF_SIZE)
+            {
+                return LEAF_FLAG | ((end - begin - 1) << LEAF_COUNT_SHIFT) | begin;
+            }
+
+            // The big leaves are only left by the builders when they reach the maximum depth, they're split in halves
+            const std::vector<std::uint32_t>& primitiveIndices = bvh.getPrimitiveIndices();
+            std::uint32_t middle = begin + (end - begin) / 2;
+            children[0] = { NO_NODE, begin, middle, Aabb() };
+            children[1] = { NO_NODE, middle, end, Aabb() };
+            for (auto& child : children)
+            {
+                for (std::uint32_t i = child.begin; i < child.end; ++i)
+                {
+                    child.bounds.expand(primitiveBounds[primitiveIndices[i]]);
+                }
+            }
+        }
+
+        // The node is created before its children so that the top of the hierarchy is stored first
+        auto nodeIndex = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes.push_back(CompressedBvhNode());
+        for (int i = 0; i < 2; ++i)
+        {
+            float childMin[3], childMax[3];
+            quantizeChildBounds(boundsMin, boundsMax, children[i].bounds, m_nodes[nodeIndex].childBounds[i], childMin, childMax);
+            std::uint32_t child = compressSubtree(bvh, primitiveBounds, subtreeCounts, children[i], childMin, childMax);
+            m_nodes[nodeIndex].children[i] = child;
+        }
+        return nodeIndex;
+    }
+
+    bool CompressedBvh::load(const CompressedBvhNode* nodes, std::size_t nodeCount, std::uint32_t root, const Aabb& bounds, std::size_t primitiveCount)
+    {
+        m_nodes.clear();
+        m_root = 0;
+        m_primitiveCount = 0;
+        if (primitiveCount == 0)
+        {
+            return true;
+        }
+
+        // The children are stored after their parent, which rules out the cycles, and the depth must fit in the traversal stack
+        std::vector<int> depths(nodeCount, 0);
+        auto isValidReference = [&](std::uint32_t reference, std::size_t parent)
+        {
+            if (isLeaf(reference))
+            {
+                return getLeafFirst(reference) + getLeafCount(reference) <= primitiveCount;
+            }
+            return reference < nodeCount && (parent == nodeCount || reference > parent);
+        };
+        bool valid = primitiveCount <= MAX_PRIMITIVE_COUNT && isValidReference(root, nodeCount);
+        for (std::size_t i = 0; valid && i < nodeCount; ++i)
+        {
+            for (std::uint32_t child : nodes[i].children)
+            {
+                valid = valid && isValidReference(child, i) && depths[i] + 1 < COMPRESSED_BVH_MAX_DEPTH;
+                if (valid && !isLeaf(child))
+                {
+                    depths[child] = std::max(depths[child], depths[i] + 1);
+                }
+            }
+        }
+        if (!valid)
+        {
+            return false;
+        }
+
+        m_nodes.assign(nodes, nodes + nodeCount);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            m_boundsMin[axis] = bounds.min()[axis];
+            m_boundsMax[axis] = bounds.max()[axis];
+        }
+        m_root = root;
+        m_primitiveCount = primitiveCount;
+        return true;
+    }
+
+    Aabb CompressedBvh::getBounds() const
+    {
+        if (m_primitiveCount == 0)
+        {
+            return Aabb();
+        }
+        return Aabb(vec3(m_boundsMin[0], m_boundsMin[1], m_boundsMin[2]), vec3(m_boundsMax[0], m_boundsMax[1], m_boundsMax[2]));
+    }
+}
@@ -0,0 +1,197 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "aabb.h"
+#include "bvh.h"
+#include "ray.h"
+
+namespace rts // for ray tracing series
+{
+    // The maximum depth of a compressed hierarchy, the leaves too big for a reference are split below the depth of the source hierarchy
+    const int COMPRESSED_BVH_MAX_DEPTH = BVH_MAX_DEPTH + 32;
+
+    // A node of the compressed hierarchy, the bounds of its two children are quantized to 8 bits within the bounds of the node
+    // the leaves have no node of their own, they're referenced by their parent along with their primitive range
+    struct CompressedBvhNode
+    {
+        std::uint8_t childBounds[2][6]; // per axis, the steps from the min of the node to the min of the child then from its max to the max of the child
+        std::uint32_t children[2];      // either the index of a node or a leaf reference (see CompressedBvh::isLeaf)
+    };
+
+    // A memory-compact copy of a hierarchy for the very large scenes, 20 bytes per interior node against 32 per node of a Bvh
+    // the primitives are referenced by their position in the leaf order of the source hierarchy rather than through an index array
+    // so that their owner stores them in that order, the quantized bounds are rounded outward which makes them a bit looser
+    class CompressedBvh final
+    {
+    public:
+        // A leaf reference holds up to MAX_LEAF_SIZE primitives and its first primitive on 28 bits
+        static const std::uint32_t MAX_LEAF_SIZE = 8;
+        static const std::size_t MAX_PRIMITIVE_COUNT = std::size_t(1) << 28;
+
+        CompressedBvh() : m_root(0), m_primitiveCount(0) {}
+
+        // Compress a hierarchy built without motion and left unedited (see Bvh::getPrimitiveIndices), the bounds of its primitives
+        // are needed to split the leaves bigger than MAX_LEAF_SIZE, return false if there are more than MAX_PRIMITIVE_COUNT primitives
+        bool build(const Bvh& bvh, const std::vector<Aabb>& primitiveBounds);
+
+        // Restore a hierarchy from the nodes and the root of another one, e.g. read from a file (see OutOfCoreSphereSet)
+        // the references are checked against the node and the primitive counts, return false if one is invalid
+        bool load(const CompressedBvhNode* nodes, std::size_t nodeCount, std::uint32_t root, const Aabb& bounds, std::size_t primitiveCount);
+
+        // Find the closest primitive hit by the ray in (tMin, tMax), tMax is updated with the distance of the closest hit
+        // the callback signature is bool(std::uint32_t primitivePosition, float tMin, float tMax, float& t)
+        template <typename IntersectPrimitive>
+        bool intersect(const Ray& r, float tMin, float& tMax, IntersectPrimitive&& intersectPrimitive) const;
+
+        Aabb getBounds() const;
+        std::size_t getNodeCount() const { return m_nodes.size(); }
+        std::size_t getPrimitiveCount() const { return m_primitiveCount; }
+        std::size_t getMemoryUsage() const { return m_nodes.size() * sizeof(CompressedBvhNode); }
+        const std::vector<CompressedBvhNode>& getNodes() const { return m_nodes; }
+        std::uint32_t getRoot() const { return m_root; }
+
+    private:
+        struct Subtree;
+
+        static const std::uint32_t LEAF_FLAG = 0x80000000;
+        static const int LEAF_COUNT_SHIFT = 28;
+        static const std::uint32_t LEAF_FIRST_MASK = (1u << LEAF_COUNT_SHIFT) - 1;
+
+        static bool isLeaf(std::uint32_t reference) { return (reference & LEAF_FLAG) != 0; }
+        static std::uint32_t getLeafFirst(std::uint32_t reference) { return reference & LEAF_FIRST_MASK; }
+        static std::uint32_t getLeafCount(std::uint32_t reference) { return ((reference & ~LEAF_FLAG) >> LEAF_COUNT_SHIFT) + 1; }
+
+        std::uint32_t compressSubtree(const Bvh& bvh, const std::vector<Aabb>& primitiveBounds, const std::vector<std::uint32_t>& subtreeCounts,
+            const Subtree& subtree, const float boundsMin[3], const float boundsMax[3]);
+
+        std::vector<CompressedBvhNode> m_nodes;
+        float m_boundsMin[3];   // the bounds of the root are kept in full precision
+        float m_boundsMax[3];
+        std::uint32_t m_root;   // a node index or a leaf reference when the whole hierarchy is a single leaf
+        std::size_t m_primitiveCount;
+    };
+
+    // The size of a quantization step of the bounds of the children of a node
+    inline void getQuantizationScale(const float boundsMin[3], const float boundsMax[3], float scale[3])
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            scale[axis] = (boundsMax[axis] - boundsMin[axis]) * (1.f / 255.f);
+        }
+    }
+
+    // Decode the bounds of a child, the steps are counted inward from each side so that 0 gives back the bounds of the node exactly
+    inline void decodeChildBounds(const float boundsMin[3], const float boundsMax[3], const float scale[3], const std::uint8_t childBounds[6],
+        float childMin[3], float childMax[3])
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            childMin[axis] = boundsMin[axis] + static_cast<float>(childBounds[axis]) * scale[axis];
+            childMax[axis] = boundsMax[axis] - static_cast<float>(childBounds[axis + 3]) * scale[axis];
+        }
+    }
+
+    template <typename IntersectPrimitive>
+    bool CompressedBvh::intersect(const Ray& r, float tMin, float& tMax, IntersectPrimitive&& intersectPrimitive) const
+    {
+        if (m_primitiveCount == 0 || intersectBox(m_boundsMin, m_boundsMax, r, tMin, tMax) < 0.f)
+        {
+            return false;
+        }
+
+        // The same traversal as the one of Bvh::intersect, except that the bounds of a node are decoded from the ones of its parent
+        // which is why the postponed nodes are stacked along with their bounds
+        struct StackEntry
+        {
+            std::uint32_t reference;
+            float distance;
+            float boundsMin[3];
+            float boundsMax[3];
+        };
+        StackEntry stack[COMPRESSED_BVH_MAX_DEPTH];
+        int stackSize = 0;
+        std::uint32_t reference = m_root;
+        float boundsMin[3] = { m_boundsMin[0], m_boundsMin[1], m_boundsMin[2] };
+        float boundsMax[3] = { m_boundsMax[0], m_boundsMax[1], m_boundsMax[2] };
+        bool hitAnything = false;
+        for (;;)
+        {
+            if (isLeaf(reference))
+            {
+                std::uint32_t first = getLeafFirst(reference);
+                std::uint32_t end = first + getLeafCount(reference);
+                for (std::uint32_t i = first; i < end; ++i)
+                {
+                    float t;
+                    if (intersectPrimitive(i, tMin, tMax, t))
+                    {
+                        hitAnything = true;
+                        tMax = t;
+                    }
+                }
+            }
+            else
+            {
+                const CompressedBvhNode& node = m_nodes[reference];
+                float scale[3];
+                float childMin[2][3], childMax[2][3];
+                getQuantizationScale(boundsMin, boundsMax, scale);
+                decodeChildBounds(boundsMin, boundsMax, scale, node.childBounds[0], childMin[0], childMax[0]);
+                decodeChildBounds(boundsMin, boundsMax, scale, node.childBounds[1], childMin[1], childMax[1]);
+                float tLeft = intersectBox(childMin[0], childMax[0], r, tMin, tMax);
+                float tRight = intersectBox(childMin[1], childMax[1], r, tMin, tMax);
+
+                int next = -1;
+                if (tLeft >= 0.f && tRight >= 0.f)
+                {
+                    next = (tLeft <= tRight) ? 0 : 1;
+                    StackEntry& entry = stack[stackSize++];
+                    entry.reference = node.children[1 - next];
+                    entry.distance = (next == 0) ? tRight : tLeft;
+                    std::copy(childMin[1 - next], childMin[1 - next] + 3, entry.boundsMin);
+                    std::copy(childMax[1 - next], childMax[1 - next] + 3, entry.boundsMax);
+                }
+                else if (tLeft >= 0.f || tRight >= 0.f)
+                {
+                    next = (tLeft >= 0.f) ? 0 : 1;
+                }
+
+                if (next >= 0)
+                {
+                    reference = node.children[next];
+                    std::copy(childMin[next], childMin[next] + 3, boundsMin);
+                    std::copy(childMax[next], childMax[next] + 3, boundsMax);
+                    continue;
+                }
+            }
+
+            // Pop the next node which may still contain a closer hit
+            do
+            {
+                if (stackSize == 0)
+                {
+                    return hitAnything;
+                }
+                --stackSize;
+            } while (stack[stackSize].distance > tMax);
+            const StackEntry& entry = stack[stackSize];
+            reference = entry.reference;
+            std::copy(entry.boundsMin, entry.boundsMin + 3, boundsMin);
+            std::copy(entry.boundsMax, entry.boundsMax + 3, boundsMax);
+        }
+    }
+}
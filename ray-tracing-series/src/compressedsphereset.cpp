@@ -0,0 +1,104 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+
+#include "compressedsphereset.h"
+
+#include <cmath>
+#include <utility>
+
+#include "material.h"
+#include "ray.h"
+#include "sphere.h"
+
+namespace rts
+{
+    CompressedSphereSet::CompressedSphereSet(const SphereRecord* spheres, std::size_t sphereCount, const std::vector<std::unique_ptr<Material>>& materials,
+        BvhBuildMethod buildMethod, ThreadPool* pool)
+        : m_materials(materials)
+    {
+        // The regular hierarchy is only needed for the build, it's released once compressed
+        std::vector<Aabb> bounds(sphereCount);
+        for (std::size_t i = 0; i < sphereCount; ++i)
+        {
+            vec3 center(spheres[i].center[0], spheres[i].center[1], spheres[i].center[2]);
+            float radius = std::fabs(spheres[i].radius); // a negative radius is used for hollow spheres
+            bounds[i] = Aabb(center - vec3(radius, radius, radius), center + vec3(radius, radius, radius));
+        }
+        Bvh bvh;
+        bvh.build(bounds, buildMethod, pool);
+        m_bvh.build(bvh, bounds);
+
+        const std::vector<std::uint32_t>& order = bvh.getPrimitiveIndices();
+        m_spheres.resize(order.size());
+        m_materialIndices.resize(order.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            const SphereRecord& sphere = spheres[order[i]];
+            m_spheres[i] = { { sphere.center[0], sphere.center[1], sphere.center[2] }, sphere.radius };
+            m_materialIndices[i] = sphere.materialIndex;
+        }
+        computeRadiusTerms();
+    }
+
+    CompressedSphereSet::CompressedSphereSet(std::vector<CompactSphere>&& spheres, std::vector<std::uint32_t>&& materialIndices, CompressedBvh&& bvh,
+        const std::vector<std::unique_ptr<Material>>& materials)
+        : m_spheres(std::move(spheres))
+        , m_materialIndices(std::move(materialIndices))
+        , m_materials(materials)
+        , m_bvh(std::move(bvh))
+    {
+        computeRadiusTerms();
+    }
+
+    bool CompressedSphereSet::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        std::uint32_t closest = 0;
+        bool hitAnything = m_bvh.intersect(r, tMin, tMax, [&](std::uint32_t position, float tMinPrimitive, float tMaxPrimitive, float& t)
+        {
+            const CompactSphere& sphere = m_spheres[position];
+            if (Sphere::intersect(vec3(sphere.center[0], sphere.center[1], sphere.center[2]), m_radiusTerms[position].radiusSquared, r,
+                tMinPrimitive, tMaxPrimitive, t))
+            {
+                closest = position;
+                return true;
+            }
+            return false;
+        });
+
+        if (!hitAnything)
+        {
+            return false;
+        }
+
+        const CompactSphere& sphere = m_spheres[closest];
+        vec3 center(sphere.center[0], sphere.center[1], sphere.center[2]);
+        rec.t = tMax;
+        rec.p = r.pointAtParameter(rec.t);
+        rec.normal = (rec.p - center) * m_radiusTerms[closest].inverseRadius;
+        rec.matPtr = m_materials[m_materialIndices[closest]].get();
+        Sphere::setTextureCoordinates(rec, sphere.radius);
+        return true;
+    }
+
+    void CompressedSphereSet::computeRadiusTerms()
+    {
+        m_radiusTerms.resize(m_spheres.size());
+        for (std::size_t i = 0; i < m_spheres.size(); ++i)
+        {
+            m_radiusTerms[i] = makeSphereRadiusTerms(m_spheres[i].radius);
+        }
+    }
+
+    bool CompressedSphereSet::boundingBox(Aabb& box) const
+    {
+        box = m_bvh.getBounds();
+        return !box.isEmpty();
+    }
+}
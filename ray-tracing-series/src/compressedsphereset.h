@@ -0,0 +1,67 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bvh.h"
+#include "compressedbvh.h"
+#include "hitable.h"
+#include "sphere.h"
+#include "sphereset.h"
+
+namespace rts // for ray tracing series
+{
+    // A sphere of a compressed set, the material indices are stored apart since they're only read for the closest hit
+    // it's also the layout of the brick files (see OutOfCoreSphereSet)
+    struct CompactSphere
+    {
+        float center[3];
+        float radius;
+    };
+
+    // The counterpart of SphereSet for the very large scenes, the spheres are copied in the leaf order of a compressed hierarchy
+    // which removes the index array of the BVH, they can't be edited, the scene is committed again instead
+    class CompressedSphereSet final : public Hitable
+    {
+    public:
+        CompressedSphereSet(const SphereRecord* spheres, std::size_t sphereCount, const std::vector<std::unique_ptr<Material>>& materials,
+            BvhBuildMethod buildMethod, ThreadPool* pool);
+
+        // Take over spheres which are already in the leaf order of the given hierarchy, e.g. a brick read from a file (see OutOfCoreSphereSet)
+        CompressedSphereSet(std::vector<CompactSphere>&& spheres, std::vector<std::uint32_t>&& materialIndices, CompressedBvh&& bvh,
+            const std::vector<std::unique_ptr<Material>>& materials);
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
+
+        const CompressedBvh& getBvh() const { return m_bvh; }
+        const std::vector<CompactSphere>& getSpheres() const { return m_spheres; }
+        const std::vector<std::uint32_t>& getMaterialIndices() const { return m_materialIndices; }
+        std::size_t getMemoryUsage() const
+        {
+            return m_spheres.size() * sizeof(CompactSphere) + m_radiusTerms.size() * sizeof(SphereRadiusTerms)
+                + m_materialIndices.size() * sizeof(std::uint32_t) + m_bvh.getMemoryUsage();
+        }
+
+    private:
+        void computeRadiusTerms();
+
+        std::vector<CompactSphere> m_spheres;
+        std::vector<SphereRadiusTerms> m_radiusTerms;   // in the order of the spheres, see SphereSet
+        std::vector<std::uint32_t> m_materialIndices;
+        const std::vector<std::unique_ptr<Material>>& m_materials;
+        CompressedBvh m_bvh;
+    };
+}
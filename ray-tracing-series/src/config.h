@@ -11,6 +11,7 @@
 
 #include "vec3.h"
 
+#include <cstddef>
 #include <limits>
 #include <string>
 
@@ -18,9 +19,25 @@ namespace rts // for ray tracing series
 {
     // Image
     const std::string IMAGE_FILE_PATH("output/image.ppm");
+    const std::string IMAGE_HDR_FILE_PATH("output/image.pfm");  // the linear radiance, before tonemapping
     const int IMAGE_WIDTH = 800;
     const int IMAGE_HEIGHT = 600;
     const float IMAGE_GAMMA_CORRECTION = 2.f;
+    const float IMAGE_EXPOSURE = 0.f;   // in stops
+    const std::string IMAGE_NOISY_HDR_FILE_PATH("output/image_noisy.pfm");     // the radiance before denoising
+    const std::string IMAGE_ALBEDO_FILE_PATH("output/albedo.pfm");
+    const std::string IMAGE_NORMAL_FILE_PATH("output/normal.pfm");
+    const std::string IMAGE_DEPTH_FILE_PATH("output/depth.pfm");
+    const std::string IMAGE_INVALID_SAMPLES_FILE_PATH("output/invalid_samples.pfm");    // the pixels with NaN or infinite samples
+
+    // Animation, the frames of an animated scene are written to <prefix><frame index>.ppm and .pfm
+    const std::string ANIMATION_FRAME_FILE_PREFIX("output/frame_");
+    const float ANIMATION_FRAME_RATE = 30.f;    // in frames per second
+
+    // Preview, the progressive render published to a shared memory framebuffer (see preview.h)
+    const std::string PREVIEW_FRAMEBUFFER_NAME("rts_preview");
+    const float PREVIEW_PUBLISH_RATE = 10.f;        // the maximum number of images published per second
+    const int PREVIEW_COARSE_BLOCK_SIZE = 4;        // the first pass traces a single ray per block of 4x4 pixels
 
     // Camera
     const float CAMERA_ASPECT_RATIO = static_cast<float>(IMAGE_WIDTH) / IMAGE_HEIGHT;
@@ -32,16 +49,35 @@ namespace rts // for ray tracing series
     const float RAY_LENGTH_MIN = 0.001f;
     const float RAY_LENGTH_MAX = std::numeric_limits<float>::max();
 
+    // Spectral rendering, the wavelengths are sampled in [min, max], in nanometers (see spectrum.h)
+    const float SPECTRAL_WAVELENGTH_MIN = 380.f;
+    const float SPECTRAL_WAVELENGTH_MAX = 720.f;
+
+    // Denoiser
+    const int DENOISER_RAY_COUNT_PER_PIXEL = 32;    // the number of rays per pixel when denoising, unless --spp is given
+    const int DENOISER_ITERATION_COUNT = 5;         // the filter reaches 2^(count + 1) - 2 pixels away
+    const float DENOISER_COLOR_SIGMA = 4.f;         // in standard deviations of the noise
+    const float DENOISER_NORMAL_SIGMA = 0.1f;
+    const float DENOISER_DEPTH_SIGMA = 0.03f;       // relative to the depth of the filtered pixel
+
     // Multithreading
     const int MULTITHREADING_SUBTASK_COUNT = 16;
+    const bool MULTITHREADING_NUMA_REPLICATION = true;  // give each NUMA node of the thread pool its own copy of the scene
+
+    // Acceleration structure
+    const bool BVH_FAST_BUILD = false;  // use the Morton code based builder (faster to build but slower to trace) instead of the binned SAH one
+    const bool BVH_COMPRESSED = false;  // store the spheres in the compact layout of the very large scenes (see CompressedSphereSet) which can't be refitted
+    const float BVH_REFIT_REBUILD_THRESHOLD = 1.3f; // a refitted subtree is built again once its SAH cost has grown by this factor
+
+    // Out-of-core geometry
+    const std::size_t OUT_OF_CORE_BRICK_SPHERE_COUNT = 1 << 16;        // the spheres per brick of the brick files (see saveSphereBricks)
+    const std::size_t OUT_OF_CORE_CACHE_SIZE = std::size_t(1) << 30;  // the memory of the loaded bricks, beyond it the least recently used are released
+
+    // Textures
+    const std::size_t TEXTURE_CACHE_SIZE = std::size_t(1) << 28;      // the memory of the pages of the textures read in place from tiled texture files
 
     // World
     const bool WORLD_GENERATION_RANDOM = true;
     const vec3 WORLD_BACKGROUND_COLOR_TOP(0.5f, 0.7f, 1.f);
     const vec3 WORLD_BACKGROUND_COLOR_BOTTOM(1.f, 1.f, 1.f);
-
-    // Optimization
-    // The following configuration parameter can be changed to speed up the image generation:
-    // Project Properties > C/C++ > Code Generation > Floating Point Model
-    // its value can be changed from Precise to Fast
 }
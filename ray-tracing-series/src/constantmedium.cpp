@@ -0,0 +1,68 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "constantmedium.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "random.h"
+#include "ray.h"
+
+namespace rts
+{
+    namespace
+    {
+        // The offset past the entry point to find the exit point, so that the entry isn't found again
+        const float BOUNDARY_EPSILON = 0.0001f;
+    }
+
+    ConstantMedium::ConstantMedium(std::unique_ptr<Hitable> boundary, float density, const Material* phaseFunction)
+        : m_boundary(std::move(boundary))
+        , m_density(density)
+        , m_negInvDensity(-1.f / density)
+        , m_phaseFunction(phaseFunction)
+    {
+    }
+
+    bool ConstantMedium::sampleScattering(const Ray& r, float tMin, float tMax, HitRecord& rec, Random& random) const
+    {
+        // Find where the line of the ray enters and exits the boundary, the origin of the ray may already be inside
+        const float infinity = std::numeric_limits<float>::infinity();
+        HitRecord entry, exit;
+        if (!m_boundary->hit(r, -infinity, infinity, entry) || !m_boundary->hit(r, entry.t + BOUNDARY_EPSILON, infinity, exit))
+        {
+            return false;
+        }
+
+        float t0 = std::max(entry.t, tMin);
+        float t1 = std::min(exit.t, tMax);
+        if (t0 >= t1)
+        {
+            return false;
+        }
+
+        // The direction is a unit vector so t is the distance, 1 - random.get() is in (0, 1] which keeps the log finite
+        float distance = m_negInvDensity * std::log(1.f - random.get());
+        if (distance >= t1 - t0)
+        {
+            return false;
+        }
+
+        rec.t = t0 + distance;
+        rec.p = r.pointAtParameter(rec.t);
+        rec.normal = -r.direction();
+        rec.matPtr = m_phaseFunction;
+        rec.u = 0.f;
+        rec.v = 0.f;
+        rec.uvDensity = 0.f;
+        return true;
+    }
+}
@@ -0,0 +1,44 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "hitable.h"
+
+namespace rts // for ray tracing series
+{
+    class Random;
+
+    // A participating medium of constant density such as fog or smoke, it fills a closed convex boundary
+    // the probability for a ray to go through a distance d of the medium without being scattered is exp(-density * d)
+    // so the distance to the scattering event is sampled analytically from that exponential rather than by marching the ray
+    // the medium isn't a hitable of the world since the sampling needs the random generator of the ray, which Hitable::hit doesn't get
+    // the ray tracer samples the media of the scene along each segment between two surfaces instead (see getColor)
+    class ConstantMedium final
+    {
+    public:
+        // The material is the phase function of the medium, usually an Isotropic one, it isn't owned by the medium
+        ConstantMedium(std::unique_ptr<Hitable> boundary, float density, const Material* phaseFunction);
+
+        // Sample the distance to a scattering event of the ray within (tMin, tMax), rec is set to the event when there's one
+        // the record has no meaningful normal, it's set against the ray for the auxiliary images
+        bool sampleScattering(const Ray& r, float tMin, float tMax, HitRecord& rec, Random& random) const;
+
+        bool boundingBox(Aabb& box) const { return m_boundary->boundingBox(box); }
+        float getDensity() const { return m_density; }
+
+    private:
+        std::unique_ptr<Hitable> m_boundary;
+        float m_density;
+        float m_negInvDensity;
+        const Material* m_phaseFunction;
+    };
+}
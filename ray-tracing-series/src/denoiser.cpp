@@ -0,0 +1,229 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "denoiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "config.h"
+#include "hdrimage.h"
+#include "threadpool.h"
+#include "utils.h"
+#include "vec3x8.h"
+
+namespace rts
+{
+    namespace
+    {
+        const float ALBEDO_EPSILON = 0.01f;  // keeps the division by the albedo finite on black surfaces
+        const int ROWS_PER_TASK = 16;
+
+        // The B3 spline kernel, separable so the weight of a tap is KERNEL[dx] * KERNEL[dy]
+        const float KERNEL[5] = { 1.f / 16.f, 1.f / 4.f, 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+        const float GAUSSIAN_KERNEL[3] = { 1.f / 4.f, 1.f / 2.f, 1.f / 4.f };
+
+        // exp(-x) approximated by (1 - x / 8)^8, it's accurate enough for weights and only needs multiplications
+        inline floatx8 approximateExpNeg(const floatx8& x)
+        {
+            floatx8 y = maxx8(floatx8(0.f), floatx8(1.f) - x * floatx8(0.125f));
+            y = y * y;
+            y = y * y;
+            return y * y;
+        }
+
+        inline floatx8 getLuminance(const vec3x8& color)
+        {
+            return floatx8(0.2126f) * color.x() + floatx8(0.7152f) * color.y() + floatx8(0.0722f) * color.z();
+        }
+
+        // The images stored as planes of floats, one per component, with a border around them
+        // the border is wide enough for the farthest tap of the last iteration, so the taps never need to be clamped,
+        // and its pixels are marked as invalid so that they get no weight
+        struct Planes
+        {
+            int width;
+            int height;
+            int border;
+            int stride;
+            std::vector<float> color[2][3];     // the input and the output of an iteration
+            std::vector<float> variance[2];
+            std::vector<float> normal[3];
+            std::vector<float> depth;
+            std::vector<float> valid;
+
+            std::size_t getIndex(int i, int j) const { return (j + border) * static_cast<std::size_t>(stride) + i + border; }
+        };
+
+        void filterRows(Planes& planes, int source, int step, const DenoiserSettings& settings, int startLine, int endLine)
+        {
+            const floatx8 colorSigmaSquared(settings.colorSigma * settings.colorSigma);
+            const floatx8 normalScale(1.f / (settings.normalSigma * settings.normalSigma));
+            const floatx8 depthScale(1.f / (settings.depthSigma * settings.depthSigma));
+            const std::vector<float>* input = planes.color[source];
+            const std::vector<float>& inputVariance = planes.variance[source];
+            std::vector<float>* output = planes.color[1 - source];
+            std::vector<float>& outputVariance = planes.variance[1 - source];
+
+            for (int j = startLine; j < endLine; ++j)
+            {
+                // The last pixels of a row spill over the border, which is wide enough for it
+                for (int i = 0; i < planes.width; i += 8)
+                {
+                    std::size_t p = planes.getIndex(i, j);
+                    floatx8 luminance = getLuminance(vec3x8::load(&input[0][p], &input[1][p], &input[2][p]));
+                    vec3x8 normal = vec3x8::load(&planes.normal[0][p], &planes.normal[1][p], &planes.normal[2][p]);
+                    floatx8 depth = floatx8::load(&planes.depth[p]);
+
+                    // The difference of luminance is measured in standard deviations of the noise, so that the noisy areas
+                    // are smoothed while the converged ones keep their details
+                    floatx8 colorScale = floatx8(1.f) / (colorSigmaSquared * floatx8::load(&inputVariance[p]) + floatx8(1e-6f));
+                    floatx8 relativeDepthScale = depthScale / (depth * depth + floatx8(1e-6f));
+
+                    vec3x8 sum;
+                    floatx8 varianceSum(0.f);
+                    floatx8 weightSum(0.f);
+                    for (int dy = -2; dy <= 2; ++dy)
+                    {
+                        for (int dx = -2; dx <= 2; ++dx)
+                        {
+                            std::size_t q = p + static_cast<std::ptrdiff_t>(dy) * step * planes.stride + dx * step;
+                            vec3x8 tapColor = vec3x8::load(&input[0][q], &input[1][q], &input[2][q]);
+                            vec3x8 tapNormal = vec3x8::load(&planes.normal[0][q], &planes.normal[1][q], &planes.normal[2][q]);
+                            floatx8 tapDepth = floatx8::load(&planes.depth[q]);
+
+                            floatx8 luminanceDifference = getLuminance(tapColor) - luminance;
+                            floatx8 depthDifference = tapDepth - depth;
+                            floatx8 distance = luminanceDifference * luminanceDifference * colorScale
+                                + (tapNormal - normal).squaredLength() * normalScale
+                                + depthDifference * depthDifference * relativeDepthScale;
+                            floatx8 weight = floatx8(KERNEL[dx + 2] * KERNEL[dy + 2]) * floatx8::load(&planes.valid[q]) * approximateExpNeg(distance);
+
+                            sum += tapColor * weight;
+                            varianceSum += weight * weight * floatx8::load(&inputVariance[q]);
+                            weightSum += weight;
+                        }
+                    }
+
+                    // The variance of the weighted mean guides the next iteration
+                    // the pixels of the border have no weight at all, they're left at 0
+                    floatx8 inverseWeightSum = floatx8(1.f) / maxx8(weightSum, floatx8(1e-12f));
+                    (sum * inverseWeightSum).store(&output[0][p], &output[1][p], &output[2][p]);
+                    (varianceSum * inverseWeightSum * inverseWeightSum).store(&outputVariance[p]);
+                }
+            }
+        }
+    }
+
+    DenoiserSettings getDefaultDenoiserSettings()
+    {
+        DenoiserSettings settings;
+        settings.iterationCount = DENOISER_ITERATION_COUNT;
+        settings.colorSigma = DENOISER_COLOR_SIGMA;
+        settings.normalSigma = DENOISER_NORMAL_SIGMA;
+        settings.depthSigma = DENOISER_DEPTH_SIGMA;
+        return settings;
+    }
+
+    void denoise(const HdrImage& image, const AovImages& aovs, const DenoiserSettings& settings, HdrImage& output)
+    {
+        Planes planes;
+        planes.width = image.width;
+        planes.height = image.height;
+        planes.border = (settings.iterationCount > 0) ? 2 << (settings.iterationCount - 1) : 1;
+        planes.stride = image.width + 2 * planes.border + 8;
+        std::size_t planeSize = static_cast<std::size_t>(planes.stride) * (image.height + 2 * planes.border);
+        for (int k = 0; k < 2; ++k)
+        {
+            planes.variance[k].assign(planeSize, 0.f);
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            planes.color[0][c].assign(planeSize, 0.f);
+            planes.color[1][c].assign(planeSize, 0.f);
+            planes.normal[c].assign(planeSize, 0.f);
+        }
+        planes.depth.assign(planeSize, 0.f);
+        planes.valid.assign(planeSize, 0.f);
+
+        // The color and its variance are demodulated by the albedo, the pixels whose samples all failed are set to 0
+        for (int j = 0; j < image.height; ++j)
+        {
+            for (int i = 0; i < image.width; ++i)
+            {
+                std::size_t p = planes.getIndex(i, j);
+                const vec3& color = image.at(i, j);
+                vec3 albedo = aovs.albedo.at(i, j) + vec3(ALBEDO_EPSILON, ALBEDO_EPSILON, ALBEDO_EPSILON);
+                const vec3& normal = aovs.normal.at(i, j);
+                for (int c = 0; c < 3; ++c)
+                {
+                    planes.color[0][c][p] = std::isfinite(color[c]) ? color[c] / albedo[c] : 0.f;
+                    planes.normal[c][p] = normal[c];
+                }
+                float albedoLuminance = getLuminance(albedo);
+                float variance = aovs.variance.at(i, j)[0];
+                planes.variance[1][p] = std::isfinite(variance) ? variance / (albedoLuminance * albedoLuminance) : 0.f;
+                planes.depth[p] = aovs.depth.at(i, j)[0];
+                planes.valid[p] = 1.f;
+            }
+        }
+
+        // The variance of a few samples is a noisy estimate itself, it's smoothed by a 3x3 gaussian kernel first
+        for (int j = 0; j < image.height; ++j)
+        {
+            for (int i = 0; i < image.width; ++i)
+            {
+                float sum = 0.f;
+                float weightSum = 0.f;
+                for (int dy = -1; dy <= 1; ++dy)
+                {
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        std::size_t q = planes.getIndex(i + dx, j + dy);
+                        float weight = GAUSSIAN_KERNEL[dx + 1] * GAUSSIAN_KERNEL[dy + 1] * planes.valid[q];
+                        sum += weight * planes.variance[1][q];
+                        weightSum += weight;
+                    }
+                }
+                planes.variance[0][planes.getIndex(i, j)] = sum / weightSum;
+            }
+        }
+
+        // Each iteration depends on the whole result of the previous one
+        int source = 0;
+        for (int iteration = 0; iteration < settings.iterationCount; ++iteration)
+        {
+            int step = 1 << iteration;
+            TaskGroup tasks(getThreadPool());
+            for (int startLine = 0; startLine < image.height; startLine += ROWS_PER_TASK)
+            {
+                int endLine = std::min(startLine + ROWS_PER_TASK, image.height);
+                tasks.run([&, source, step, startLine, endLine]() { filterRows(planes, source, step, settings, startLine, endLine); });
+            }
+            tasks.wait();
+
+            source = 1 - source;
+        }
+
+        output.resize(image.width, image.height);
+        for (int j = 0; j < image.height; ++j)
+        {
+            for (int i = 0; i < image.width; ++i)
+            {
+                std::size_t p = planes.getIndex(i, j);
+                const vec3& albedo = aovs.albedo.at(i, j);
+                output.at(i, j) = vec3(planes.color[source][0][p] * (albedo[0] + ALBEDO_EPSILON),
+                    planes.color[source][1][p] * (albedo[1] + ALBEDO_EPSILON),
+                    planes.color[source][2][p] * (albedo[2] + ALBEDO_EPSILON));
+            }
+        }
+    }
+}
@@ -0,0 +1,35 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+namespace rts // for ray tracing series
+{
+    struct AovImages;
+    struct HdrImage;
+
+    struct DenoiserSettings
+    {
+        int iterationCount;     // the step between the filtered pixels doubles after each iteration
+        float colorSigma;       // how quickly the weight falls off with the difference of luminance, in standard deviations of the noise
+        float normalSigma;      // the same for the difference of normal, in absolute terms
+        float depthSigma;       // the same for the difference of depth, relative to the depth of the filtered pixel
+    };
+
+    // The settings from config.h
+    DenoiserSettings getDefaultDenoiserSettings();
+
+    // Filter the Monte Carlo noise of a render with an edge-avoiding A-Trous wavelet filter (Dammertz et al. 2010)
+    // each iteration applies a 5x5 B3 spline kernel whose taps are spread further apart, weighted by how close the
+    // neighbors are in normal and depth so that the edges found in the auxiliary images are preserved, and in luminance
+    // relative to the estimated noise so that the converged areas are left alone (as in SVGF, Schied et al. 2017)
+    // the color is divided by the albedo before filtering and multiplied back after, so that the textures stay sharp
+    // the rows are filtered in parallel on the thread pool, 8 pixels at a time
+    void denoise(const HdrImage& image, const AovImages& aovs, const DenoiserSettings& settings, HdrImage& output);
+}
@@ -18,28 +18,89 @@
 
 namespace rts
 {
+    namespace
+    {
+        // The wavelength of the Fraunhofer d line in micrometers, the reference of the Cauchy equation
+        const float CAUCHY_REFERENCE_WAVELENGTH = 0.5876f;
+    }
+
     bool Dielectric::scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const
     {
-        attenuation = m_albedo;
+        attenuation = getAlbedo(rec);
+
+        // Reflect or refract depending on the reflection probability
+        vec3 refracted;
+        float reflectProb = getReflectProbability(rIn, rec, m_refIdx, refracted);
+        if (reflectProb == 1.f || random.get() < reflectProb)
+        {
+            vec3 reflected = getReflectedVector(rIn.direction(), rec.normal);
+            scattered = Ray(rec.p, reflected, rIn.time());
+        }
+        else
+        {
+            scattered = Ray(rec.p, refracted, rIn.time());
+        }
+        
+        return true;
+    }
+
+    bool Dielectric::scatterWavelength(const Ray& rIn, const HitRecord& rec, float wavelength, float sample, vec3& attenuation, Ray& scattered) const
+    {
+        attenuation = getAlbedo(rec);
+
+        // The same as scatter with the refraction index of the wavelength, the reflected direction doesn't depend on it
+        // so the wavelengths which share the sample and are all reflected keep following the same ray
+        vec3 refracted;
+        float reflectProb = getReflectProbability(rIn, rec, getRefractionIndex(wavelength), refracted);
+        if (reflectProb == 1.f || sample < reflectProb)
+        {
+            vec3 reflected = getReflectedVector(rIn.direction(), rec.normal);
+            scattered = Ray(rec.p, reflected, rIn.time());
+        }
+        else
+        {
+            scattered = Ray(rec.p, refracted, rIn.time());
+        }
+
+        return true;
+    }
+
+    float Dielectric::getRefractionIndex(float wavelength) const
+    {
+        float micrometers = wavelength * 0.001f;
+        float squared = micrometers * micrometers;
+        const float* c = m_dispersion.coefficients;
+        switch (m_dispersion.model)
+        {
+        case DispersionModel::Cauchy:
+            return m_refIdx + c[0] / squared - c[0] / (CAUCHY_REFERENCE_WAVELENGTH * CAUCHY_REFERENCE_WAVELENGTH);
+        case DispersionModel::Sellmeier:
+            return sqrt(1.f + c[0] * squared / (squared - c[3]) + c[1] * squared / (squared - c[4]) + c[2] * squared / (squared - c[5]));
+        case DispersionModel::None:
+        default:
+            return m_refIdx;
+        }
+    }
 
+    float Dielectric::getReflectProbability(const Ray& rIn, const HitRecord& rec, float refIdx, vec3& refracted) const
+    {
         // Dielectric scattering: Determine the outward normal and the refraction indexes ratio
         vec3 outwardNormal;
         float refIdxRatio;
-        vec3 unitDirection = unitVector(rIn.direction());
+        const vec3& unitDirection = rIn.direction();
         float dt = dot(unitDirection, rec.normal);
         if (dt > 0.f)
         {
             outwardNormal = -rec.normal;
-            refIdxRatio = m_refIdx;
+            refIdxRatio = refIdx;
         }
         else
         {
             outwardNormal = rec.normal;
-            refIdxRatio = 1.f / m_refIdx;
+            refIdxRatio = 1.f / refIdx;
         }
 
         // Determine the reflection probability
-        vec3 refracted;
         float reflectProb = 1.f;
         if (getRefractedVector(unitDirection, outwardNormal, refIdxRatio, refracted))
         {
@@ -47,7 +108,7 @@ namespace rts
             if (dt > 0.f)
             {
                 // Previous computation of cosine as described in the book (it's bugged!)
-                //cosine = m_refIdx * dt / rIn.direction().length();
+                //cosine = refIdx * dt / rIn.direction().length();
 
                 // Compute the cosine to pass to Schlick's approximation function as fixed by the following post
                 // http://psgraphics.blogspot.com/2016/03/my-buggy-implimentation-of-schlick.html
@@ -58,32 +119,21 @@ namespace rts
 
                 // dt is the cosine of the incoming angle (the smallest of the 2 angles)
                 // compute the cosine of the exiting angle
-                float discriminant = 1.f - m_refIdx * m_refIdx * (1.f - dt * dt);
+                float discriminant = 1.f - refIdx * refIdx * (1.f - dt * dt);
 
                 // Proceed with the Schlick approximation only if the discriminant is positive
                 // when it's negative it means that there's total internal reflection
                 if (discriminant > 0.f)
                 {
-                    reflectProb = getSchlickApproximation(sqrt(discriminant), m_refIdx);
+                    reflectProb = getSchlickApproximation(sqrt(discriminant), refIdx);
                 }
             }
             else
             {
-                reflectProb = getSchlickApproximation(-dt, m_refIdx);
+                reflectProb = getSchlickApproximation(-dt, refIdx);
             }
         }
 
-        // Reflect or refract depending on the reflection probability
-        if (reflectProb == 1.f || random.get() < reflectProb)
-        {
-            vec3 reflected = getReflectedVector(rIn.direction(), rec.normal);
-            scattered = Ray(rec.p, reflected);
-        }
-        else
-        {
-            scattered = Ray(rec.p, refracted);
-        }
-        
-        return true;
+        return reflectProb;
     }
 }
@@ -9,21 +9,62 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include "material.h"
+#include "texture.h"
 #include "vec3.h"
 
 namespace rts // for ray tracing series
 {
+    // How the refraction index of a dielectric varies with the wavelength, it's only used by the spectral mode (see raytracer.h)
+    //  - Cauchy: n = A + B / wavelength^2, coefficients[0] is B in square micrometers and A is chosen so that n matches the refraction
+    //    index of the material at 587.6 nm (the Fraunhofer d line, where the refraction indexes of glasses are usually given)
+    //  - Sellmeier: n^2 = 1 + sum of Bi * wavelength^2 / (wavelength^2 - Ci), the coefficients are B1, B2, B3, C1, C2 and C3
+    //    with the Ci in square micrometers, the refraction index of the material should be their value at 587.6 nm
+    enum class DispersionModel : std::uint32_t
+    {
+        None = 0,
+        Cauchy = 1,
+        Sellmeier = 2
+    };
+
+    struct DispersionRecord
+    {
+        DispersionModel model;
+        float coefficients[6];
+    };
+
+    inline DispersionRecord makeNoDispersionRecord()
+    {
+        return { DispersionModel::None, { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f } };
+    }
+
     class Dielectric final : public Material
     {
     public:
-        Dielectric(float refIdx) : m_albedo(1.f, 1.f, 1.f), m_refIdx(refIdx) {}
-        Dielectric(const vec3& albedo, float refIdx) : m_albedo(albedo), m_refIdx(refIdx) {}
+        Dielectric(float refIdx) : m_albedo(1.f, 1.f, 1.f), m_refIdx(refIdx), m_texture(nullptr), m_dispersion(makeNoDispersionRecord()) {}
+
+        // The texture, if any, modulates the albedo
+        Dielectric(const vec3& albedo, float refIdx, const Texture* texture = nullptr, const DispersionRecord& dispersion = makeNoDispersionRecord())
+            : m_albedo(albedo), m_refIdx(refIdx), m_texture(texture), m_dispersion(dispersion) {}
 
         virtual bool scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const override;
+        virtual vec3 getAlbedo(const HitRecord& rec) const override { return (m_texture != nullptr) ? m_albedo * m_texture->value(rec) : m_albedo; }
+
+        virtual bool isDispersive() const override { return m_dispersion.model != DispersionModel::None; }
+        virtual bool scatterWavelength(const Ray& rIn, const HitRecord& rec, float wavelength, float sample, vec3& attenuation, Ray& scattered) const override;
+
+        // The refraction index at the given wavelength in nanometers
+        float getRefractionIndex(float wavelength) const;
 
     private:
+        // The probability for the ray to be reflected with the given refraction index, refracted is set when it can be refracted
+        float getReflectProbability(const Ray& rIn, const HitRecord& rec, float refIdx, vec3& refracted) const;
+
         vec3 m_albedo;
         float m_refIdx; // the refraction index
+        const Texture* m_texture;
+        DispersionRecord m_dispersion;
     };
 }
@@ -0,0 +1,154 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "environmentmap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "defines.h"
+#include "utils.h"
+
+namespace rts
+{
+    namespace
+    {
+        const float PI = static_cast<float>(M_PI);
+
+        // Pick the bin of the cumulated weights where x falls, x is rescaled to its position within the bin
+        int sampleCdf(const float* cdf, int binCount, float& x)
+        {
+            float total = cdf[binCount];
+            float target = x * total;
+            int bin = static_cast<int>(std::upper_bound(cdf + 1, cdf + binCount + 1, target) - (cdf + 1));
+            bin = std::min(bin, binCount - 1);
+            float width = cdf[bin + 1] - cdf[bin];
+            x = (width > 0.f) ? std::min((target - cdf[bin]) / width, 0.99999994f) : 0.5f;
+            return bin;
+        }
+    }
+
+    void EnvironmentMap::create(const HdrImage& image, float intensity, float rotation)
+    {
+        m_image = image;
+        for (auto& pixel : m_image.pixels)
+        {
+            pixel *= intensity;
+        }
+        m_rotation = rotation * PI / 180.f;
+
+        // A pixel is weighted by its luminance and by the solid angle it covers, which shrinks towards the poles
+        int width = m_image.width;
+        int height = m_image.height;
+        m_rowCdf.assign(height + 1, 0.f);
+        m_columnCdfs.assign(static_cast<std::size_t>(width + 1) * height, 0.f);
+        for (int j = 0; j < height; ++j)
+        {
+            float sinTheta = std::sin(PI * (j + 0.5f) / height);
+            float* columnCdf = &m_columnCdfs[static_cast<std::size_t>(width + 1) * j];
+            for (int i = 0; i < width; ++i)
+            {
+                columnCdf[i + 1] = columnCdf[i] + getLuminance(m_image.at(i, j)) * sinTheta;
+            }
+            m_rowCdf[j + 1] = m_rowCdf[j] + columnCdf[width];
+        }
+    }
+
+    bool EnvironmentMap::load(const std::string& filePath, float intensity, float rotation)
+    {
+        HdrImage image;
+        if (!loadHdrFile(filePath, image))
+        {
+            return false;
+        }
+        create(image, intensity, rotation);
+        return true;
+    }
+
+    void EnvironmentMap::getCoordinates(const vec3& direction, float& u, float& v) const
+    {
+        float phi = std::atan2(direction.z(), direction.x()) + m_rotation;
+        u = phi / (2.f * PI);
+        u -= std::floor(u);
+        v = 1.f - std::acos(std::min(std::max(direction.y(), -1.f), 1.f)) / PI;
+    }
+
+    vec3 EnvironmentMap::getRadiance(const vec3& direction) const
+    {
+        float u, v;
+        getCoordinates(direction, u, v);
+
+        // Wrap around horizontally and clamp vertically
+        float x = u * m_image.width - 0.5f;
+        float y = std::min(std::max(v * m_image.height - 0.5f, 0.f), static_cast<float>(m_image.height - 1));
+        int x0 = static_cast<int>(std::floor(x));
+        int y0 = static_cast<int>(y);
+        float fx = x - x0;
+        float fy = y - y0;
+        x0 = (x0 + m_image.width) % m_image.width;
+        int x1 = (x0 + 1) % m_image.width;
+        int y1 = std::min(y0 + 1, m_image.height - 1);
+        return (1.f - fy) * ((1.f - fx) * m_image.at(x0, y0) + fx * m_image.at(x1, y0)) + fy * ((1.f - fx) * m_image.at(x0, y1) + fx * m_image.at(x1, y1));
+    }
+
+    bool EnvironmentMap::sample(float u1, float u2, vec3& direction, vec3& radiance, float& pdf) const
+    {
+        int width = m_image.width;
+        int height = m_image.height;
+        if (height == 0 || !(m_rowCdf[height] > 0.f))
+        {
+            return false;
+        }
+
+        // Pick the row then the column, the position within the pixel is uniform
+        int j = sampleCdf(m_rowCdf.data(), height, u2);
+        const float* columnCdf = &m_columnCdfs[static_cast<std::size_t>(width + 1) * j];
+        int i = sampleCdf(columnCdf, width, u1);
+        float u = (i + u1) / width;
+        float v = (j + u2) / height;
+
+        float theta = (1.f - v) * PI;
+        float phi = 2.f * PI * u - m_rotation;
+        float sinTheta = std::sin(theta);
+        if (sinTheta <= 0.f)
+        {
+            return false;
+        }
+        direction = vec3(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi));
+
+        // The density of the pixel over the unit square of the coordinates, then over the sphere of directions
+        float pixelProbability = (columnCdf[i + 1] - columnCdf[i]) / m_rowCdf[height];
+        pdf = pixelProbability * width * height / (2.f * PI * PI * sinTheta);
+        radiance = getRadiance(direction);
+        return pdf > 0.f;
+    }
+
+    float EnvironmentMap::getPdf(const vec3& direction) const
+    {
+        int width = m_image.width;
+        int height = m_image.height;
+        if (height == 0 || !(m_rowCdf[height] > 0.f))
+        {
+            return 0.f;
+        }
+
+        float u, v;
+        getCoordinates(direction, u, v);
+        float sinTheta = std::sin((1.f - v) * PI);
+        if (sinTheta <= 0.f)
+        {
+            return 0.f;
+        }
+        int i = std::min(static_cast<int>(u * width), width - 1);
+        int j = std::min(static_cast<int>(v * height), height - 1);
+        const float* columnCdf = &m_columnCdfs[static_cast<std::size_t>(width + 1) * j];
+        float pixelProbability = (columnCdf[i + 1] - columnCdf[i]) / m_rowCdf[height];
+        return pixelProbability * width * height / (2.f * PI * PI * sinTheta);
+    }
+}
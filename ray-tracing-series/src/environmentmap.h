@@ -0,0 +1,56 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "hdrimage.h"
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // The light coming from every direction around the scene, a latitude-longitude HDR image which replaces the background gradient
+    // the columns go around the vertical axis and the rows from straight down (the bottom row) to straight up (the top row)
+    // the image is also a light source, the directions are sampled in proportion to their radiance through a 2D distribution,
+    // the rows are picked by their marginal distribution and the column by the distribution of the row, so that a small bright sun
+    // is found by most of the samples where a diffuse bounce would only hit it by chance (see getColor)
+    class EnvironmentMap final
+    {
+    public:
+        // Build the map from a linear image, its radiance is scaled by intensity and it's turned by rotation degrees around the vertical axis
+        void create(const HdrImage& image, float intensity, float rotation);
+
+        // Load the map from a PFM image
+        bool load(const std::string& filePath, float intensity, float rotation);
+
+        // The radiance coming from the given unit direction, filtered bilinearly
+        vec3 getRadiance(const vec3& direction) const;
+
+        // Sample a direction from two random numbers in [0, 1), its probability density is with respect to the solid angle
+        // return false when the map is black, there's nothing to sample then
+        bool sample(float u1, float u2, vec3& direction, vec3& radiance, float& pdf) const;
+
+        // The probability density of sampling the given unit direction
+        float getPdf(const vec3& direction) const;
+
+        int getWidth() const { return m_image.width; }
+        int getHeight() const { return m_image.height; }
+
+    private:
+        // The coordinates of a direction in [0, 1), u around the vertical axis and v from the bottom
+        void getCoordinates(const vec3& direction, float& u, float& v) const;
+
+        HdrImage m_image;
+        float m_rotation = 0.f;                 // in radians
+        std::vector<float> m_rowCdf;            // the cumulated weights of the rows, height + 1 values
+        std::vector<float> m_columnCdfs;        // the cumulated weights within each row, width + 1 values per row
+    };
+}
@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "fastmath.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace rts
+{
+    unsigned FastMath::s_features = FAST_MATH_ALL;
+
+    namespace
+    {
+        // The table covers [2^-24, 1], below it the gamma corrected values are too small to reach the first level
+        // each power of two is split into 2^LUT_MANTISSA_BITS entries, the last entry starts at 1
+        const int LUT_MANTISSA_BITS = 5;
+        const int LUT_SHIFT = 23 - LUT_MANTISSA_BITS;
+        const int LUT_FIRST_EXPONENT = 127 - 24;
+        const int LUT_ENTRY_COUNT = (24 << LUT_MANTISSA_BITS) + 1;
+        const int LUT_FIRST_KEY = LUT_FIRST_EXPONENT << LUT_MANTISSA_BITS;
+
+        float getFloatFromBits(std::uint32_t bits)
+        {
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+
+        // The scaled gamma curve 255.99 * x^(1/gamma) approximated by a line over each entry
+        // the chord of the concave curve stays within 0.01 level of it
+        class GammaLut final
+        {
+        public:
+            explicit GammaLut(float gamma) : m_gamma(gamma)
+            {
+                for (int i = 0; i < LUT_ENTRY_COUNT; ++i)
+                {
+                    float x0 = getFloatFromBits(static_cast<std::uint32_t>(LUT_FIRST_KEY + i) << LUT_SHIFT);
+                    float x1 = getFloatFromBits(static_cast<std::uint32_t>(LUT_FIRST_KEY + i + 1) << LUT_SHIFT);
+                    float y0 = 255.99f * std::pow(x0, 1.f / gamma);
+                    float y1 = 255.99f * std::pow(x1, 1.f / gamma);
+                    m_slope[i] = (y1 - y0) / (x1 - x0);
+                    m_offset[i] = y0 - m_slope[i] * x0;
+                }
+            }
+
+            float getGamma() const { return m_gamma; }
+
+            void convert(const vec3& color, int rgb[3]) const
+            {
+                // Clamp to [0, 1], the NaNs are turned into 0 since maxps returns its second operand when the first one is a NaN
+                __m128 x = _mm_set_ps(0.f, color.z(), color.y(), color.x());
+                x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.f));
+
+                // The key of a float is made of its exponent and its leading mantissa bits, the values below the table use its first entry
+                __m128i key = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(x), LUT_SHIFT), _mm_set1_epi32(LUT_FIRST_KEY));
+                key = _mm_and_si128(key, _mm_cmpgt_epi32(key, _mm_set1_epi32(-1)));
+
+                // There's no gather before AVX2, the entries are fetched one by one
+                alignas(16) std::int32_t keys[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(keys), key);
+                __m128 slope = _mm_set_ps(0.f, m_slope[keys[2]], m_slope[keys[1]], m_slope[keys[0]]);
+                __m128 offset = _mm_set_ps(0.f, m_offset[keys[2]], m_offset[keys[1]], m_offset[keys[0]]);
+
+                alignas(16) std::int32_t levels[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(levels), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(slope, x), offset)));
+                for (int i = 0; i < 3; ++i)
+                {
+                    rgb[i] = std::min(std::max(levels[i], 0), 255);
+                }
+            }
+
+        private:
+            float m_gamma;
+            float m_slope[LUT_ENTRY_COUNT];
+            float m_offset[LUT_ENTRY_COUNT];
+        };
+    }
+
+    void convertToRgb8(const vec3& color, float gamma, int rgb[3])
+    {
+        static const GammaLut lut(gamma);
+        if (FastMath::isEnabled(FAST_MATH_GAMMA_LUT) && lut.getGamma() == gamma)
+        {
+            lut.convert(color, rgb);
+            return;
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            float value = std::min(std::max(color[i], 0.f), 1.f);
+            rgb[i] = static_cast<int>(255.99f * applyGammaCorrection(value, gamma));
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // The approximations of the fast-math layer, each one is used instead of the precise computation when its feature is enabled
+    // this replaces the global Fast floating point model of the compiler with explicit trade-offs and known accuracy bounds
+    enum FastMathFeature : unsigned
+    {
+        FAST_MATH_INTEGER_POW = 1 << 0,         // pow with a small integer exponent expanded into multiplications, within 3 ulps
+        FAST_MATH_GAMMA_SQRT = 1 << 1,          // a gamma correction of 2 computed with sqrt instead of pow, correctly rounded
+        FAST_MATH_GAMMA_LUT = 1 << 2,           // the gamma correction and the 8-bit conversion through a lookup table, at most 1 level off
+        FAST_MATH_RSQRT_NORMALIZE = 1 << 3,     // the ray directions normalized with rsqrt and a Newton-Raphson step, length within 1e-6 of 1
+
+        FAST_MATH_NONE = 0,
+        FAST_MATH_ALL = FAST_MATH_INTEGER_POW | FAST_MATH_GAMMA_SQRT | FAST_MATH_GAMMA_LUT | FAST_MATH_RSQRT_NORMALIZE
+    };
+
+    // The features are switched at runtime, all of them are enabled by default
+    // they're meant to be changed before rendering, not while the worker threads are running
+    class FastMath final
+    {
+    public:
+        static void setFeatures(unsigned features) { s_features = features; }
+        static unsigned getFeatures() { return s_features; }
+        static bool isEnabled(FastMathFeature feature) { return (s_features & feature) != 0; }
+
+    private:
+        static unsigned s_features;
+    };
+
+    // Raise x to a small positive integer power by squaring, the loop is unrolled when n is a constant
+    inline float powInt(float x, unsigned n)
+    {
+        float result = 1.f;
+        for (; n > 0; n >>= 1)
+        {
+            if (n & 1)
+            {
+                result *= x;
+            }
+            x *= x;
+        }
+        return result;
+    }
+
+    // Apply the gamma correction to a color component in [0, 1]
+    inline float applyGammaCorrection(float value, float gamma)
+    {
+        if (gamma == 2.f && FastMath::isEnabled(FAST_MATH_GAMMA_SQRT))
+        {
+            return std::sqrt(value);
+        }
+        return std::pow(value, 1.f / gamma);
+    }
+
+    // Normalize a vector with the approximated reciprocal square root refined by one Newton-Raphson step
+    // the relative error of the length goes from 2^-12 for rsqrt alone down to about 2^-22
+    inline vec3 getFastUnitVector(const vec3& v)
+    {
+        __m128 squaredLength = _mm_set_ss(v.squaredLength());
+        __m128 r = _mm_rsqrt_ss(squaredLength);
+
+        // r' = r * (1.5 - 0.5 * x * r * r)
+        __m128 halfXrr = _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), squaredLength), _mm_mul_ss(r, r));
+        r = _mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f), halfXrr));
+        return v * _mm_cvtss_f32(r);
+    }
+
+    // Normalize a vector, with rsqrt when the feature is enabled
+    inline vec3 getUnitVector(const vec3& v)
+    {
+        return FastMath::isEnabled(FAST_MATH_RSQRT_NORMALIZE) ? getFastUnitVector(v) : unitVector(v);
+    }
+
+    // Convert a linear color to gamma corrected components in [0, 255], the linear components are clamped to [0, 1]
+    // the lookup table is used when the feature is enabled, it's indexed by the exponent and the leading mantissa bits
+    // and interpolates linearly within each entry, the three components are processed together with SSE
+    void convertToRgb8(const vec3& color, float gamma, int rgb[3]);
+}
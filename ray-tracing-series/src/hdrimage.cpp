@@ -0,0 +1,152 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "hdrimage.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+namespace rts
+{
+    namespace
+    {
+        bool isLittleEndian()
+        {
+            const std::uint32_t one = 1;
+            unsigned char firstByte;
+            std::memcpy(&firstByte, &one, 1);
+            return firstByte == 1;
+        }
+
+        void swapBytes(float& value)
+        {
+            unsigned char bytes[sizeof(float)];
+            std::memcpy(bytes, &value, sizeof(float));
+            std::swap(bytes[0], bytes[3]);
+            std::swap(bytes[1], bytes[2]);
+            std::memcpy(&value, bytes, sizeof(float));
+        }
+    }
+
+    void AccumulationImage::resolve(HdrImage& image) const
+    {
+        if (image.width != sum.width || image.height != sum.height)
+        {
+            image.resize(sum.width, sum.height);
+        }
+        for (std::size_t i = 0; i < sum.pixels.size(); ++i)
+        {
+            image.pixels[i] = (sampleCounts[i] > 0) ? sum.pixels[i] / static_cast<float>(sampleCounts[i]) : sum.pixels[i];
+        }
+    }
+
+    bool saveHdrFile(const HdrImage& image, const std::string& filePath)
+    {
+        std::ofstream file(filePath, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to create the HDR image file " << filePath << std::endl;
+            return false;
+        }
+
+        // A negative scale means that the floats are little-endian, the rows go from bottom to top
+        file << "PF\n" << image.width << " " << image.height << "\n-1.0\n";
+        if (isLittleEndian())
+        {
+            static_assert(sizeof(vec3) == 3 * sizeof(float), "the pixels are written as packed floats");
+            file.write(reinterpret_cast<const char*>(image.pixels.data()), image.pixels.size() * sizeof(vec3));
+        }
+        else
+        {
+            for (const auto& pixel : image.pixels)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    float value = pixel[c];
+                    swapBytes(value);
+                    file.write(reinterpret_cast<const char*>(&value), sizeof(float));
+                }
+            }
+        }
+
+        return file.good();
+    }
+
+    bool loadHdrFile(const std::string& filePath, HdrImage& image)
+    {
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to open the HDR image file " << filePath << std::endl;
+            return false;
+        }
+
+        // The header is made of the "PF" magic, the size and the scale, separated by a single whitespace character from the data
+        std::string magic;
+        int width = 0, height = 0;
+        float scale = 0.f;
+        if (!(file >> magic >> width >> height >> scale) || magic != "PF" || width <= 0 || height <= 0 || scale == 0.f)
+        {
+            std::cerr << "HDR image file " << filePath << ": only color PFM files are supported" << std::endl;
+            return false;
+        }
+        file.get();
+
+        image.resize(width, height);
+        file.read(reinterpret_cast<char*>(image.pixels.data()), image.pixels.size() * sizeof(vec3));
+        if (!file)
+        {
+            std::cerr << "HDR image file " << filePath << ": the pixel data is truncated" << std::endl;
+            return false;
+        }
+
+        if ((scale < 0.f) != isLittleEndian())
+        {
+            for (auto& pixel : image.pixels)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    swapBytes(pixel[c]);
+                }
+            }
+        }
+        return true;
+    }
+
+    double computeRelativeMse(const HdrImage& image, const HdrImage& reference)
+    {
+        double error = 0.0;
+        for (std::size_t i = 0; i < image.pixels.size(); ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                double difference = image.pixels[i][c] - reference.pixels[i][c];
+                double value = reference.pixels[i][c];
+                error += difference * difference / (value * value + 0.01);
+            }
+        }
+        return error / (3.0 * image.pixels.size());
+    }
+
+    std::size_t countDifferentPixels(const HdrImage& image, const HdrImage& reference)
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < image.pixels.size(); ++i)
+        {
+            if (std::memcmp(&image.pixels[i], &reference.pixels[i], sizeof(vec3)) != 0)
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+}
@@ -0,0 +1,104 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // The linear radiance computed by the ray tracer, before any tonemapping
+    // the rows are stored from bottom to top, the way they're traced and the way PFM files store them
+    struct HdrImage
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<vec3> pixels;
+
+        void resize(int w, int h)
+        {
+            width = w;
+            height = h;
+            pixels.assign(static_cast<std::size_t>(w) * h, vec3());
+        }
+
+        vec3& at(int i, int j) { return pixels[i + static_cast<std::size_t>(j) * width]; }
+        const vec3& at(int i, int j) const { return pixels[i + static_cast<std::size_t>(j) * width]; }
+    };
+
+    // The auxiliary images of a render, averaged over the first hit of the samples of each pixel
+    // the denoiser relies on them to find the edges that the noise hides (see denoiser.h)
+    struct AovImages
+    {
+        HdrImage albedo;    // the albedo of the material, the background color for the rays which hit nothing
+        HdrImage normal;    // the world space normal, left to 0 for the background
+        HdrImage depth;     // the distance to the camera in the 3 components, left to 0 for the background
+        HdrImage variance;  // the variance of the mean luminance of the pixel in the 3 components, an estimate of its noise
+
+        void resize(int w, int h)
+        {
+            albedo.resize(w, h);
+            normal.resize(w, h);
+            depth.resize(w, h);
+            variance.resize(w, h);
+        }
+    };
+
+    // The samples of a render whose radiance isn't finite, a single NaN or infinity would spoil its whole pixel so they're left out
+    // they're counted per sub task of the render, i.e. per band of lines (see rayTracingMainTask), for a render farm to catch them
+    // the debug image marks the pixels where they happened with the fraction of their samples which were NaN in the red component
+    // and infinite in the green one, it's only written when it has the size of the rendered image
+    struct SampleDiagnostics
+    {
+        std::vector<std::uint64_t> invalidSampleCounts;
+        HdrImage invalidSamples;
+
+        std::uint64_t getInvalidSampleCount() const
+        {
+            std::uint64_t count = 0;
+            for (std::uint64_t taskCount : invalidSampleCounts)
+            {
+                count += taskCount;
+            }
+            return count;
+        }
+    };
+
+    // The samples of a progressive render, summed over the passes along with the number of valid samples of each pixel
+    struct AccumulationImage
+    {
+        HdrImage sum;
+        std::vector<std::uint32_t> sampleCounts;
+
+        void resize(int w, int h)
+        {
+            sum.resize(w, h);
+            sampleCounts.assign(static_cast<std::size_t>(w) * h, 0);
+        }
+
+        // Average the samples, a pixel without any valid sample keeps its sum (see rayTracingProgressivePass)
+        void resolve(HdrImage& image) const;
+    };
+
+    // Save and load an image in the Portable Float Map format, 3 little-endian floats per pixel
+    // it keeps the full range of the radiance so that the image can be tonemapped again without being rendered
+    bool saveHdrFile(const HdrImage& image, const std::string& filePath);
+    bool loadHdrFile(const std::string& filePath, HdrImage& image);
+
+    // The relative mean squared error against a reference of the same size, (x - r)^2 / (r^2 + 0.01) averaged over the components
+    // the normalization keeps the bright areas from dominating the error of an HDR image
+    double computeRelativeMse(const HdrImage& image, const HdrImage& reference);
+
+    // The number of pixels whose bits differ from a reference of the same size, 0 for a render which is reproduced exactly
+    std::size_t countDifferentPixels(const HdrImage& image, const HdrImage& reference);
+}
@@ -13,15 +13,22 @@
 
 namespace rts // for ray tracing series
 {
+    class Aabb;
     class Material;
     class Ray;
 
+    // The texture coordinates are set by every hitable along with uvDensity, the texture units per world unit around the hit point
+    // the footprint is the width of the ray cone at the hit point, it's set by the ray tracer rather than by the hitables
     struct HitRecord
     {
         float t;
         vec3 p;
         vec3 normal;
         const Material* matPtr;
+        float u;
+        float v;
+        float uvDensity;
+        float footprint;
     };
 
     class Hitable
@@ -30,5 +37,8 @@ namespace rts // for ray tracing series
         virtual ~Hitable() {}
 
         virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const = 0;
+
+        // Compute the box enclosing the hitable, return false if it has no bounds (e.g. an empty list)
+        virtual bool boundingBox(Aabb& box) const = 0;
     };
 }
@@ -0,0 +1,92 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "hitablebvh.h"
+
+#include "aabb.h"
+#include "config.h"
+
+namespace rts
+{
+    void HitableBvh::clear()
+    {
+        m_list.clear();
+        m_unboundedList.clear();
+        m_bvh = Bvh();
+    }
+
+    void HitableBvh::build(BvhBuildMethod buildMethod, ThreadPool* pool)
+    {
+        std::vector<Aabb> bounds;
+        std::vector<std::unique_ptr<const Hitable>> boundedList;
+        bounds.reserve(m_list.size());
+        boundedList.reserve(m_list.size());
+        for (auto& hitable : m_list)
+        {
+            Aabb box;
+            if (hitable->boundingBox(box))
+            {
+                bounds.push_back(box);
+                boundedList.push_back(std::move(hitable));
+            }
+            else
+            {
+                m_unboundedList.push_back(std::move(hitable));
+            }
+        }
+        m_list = std::move(boundedList);
+        m_bvh.build(bounds, buildMethod, pool);
+    }
+
+    BvhRefitStats HitableBvh::refit(ThreadPool* pool)
+    {
+        std::vector<Aabb> bounds(m_list.size());
+        for (std::size_t i = 0; i < m_list.size(); ++i)
+        {
+            m_list[i]->boundingBox(bounds[i]);
+        }
+        return m_bvh.refit(bounds, BVH_REFIT_REBUILD_THRESHOLD, pool);
+    }
+
+    bool HitableBvh::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        HitRecord tempRec;
+        float closestSoFar = tMax;
+
+        // The hitables without bounds come first, a hit on a ground plane then culls the boxes below it
+        bool hitAnything = false;
+        for (const auto& hitable : m_unboundedList)
+        {
+            if (hitable->hit(r, tMin, closestSoFar, tempRec))
+            {
+                closestSoFar = tempRec.t;
+                rec = tempRec;
+                hitAnything = true;
+            }
+        }
+
+        // Only the hitables whose box is pierced by the ray are tested, closest first
+        return m_bvh.intersect(r, tMin, closestSoFar, [&](std::uint32_t index, float tMinHitable, float tMaxHitable, float& t)
+        {
+            if (m_list[index]->hit(r, tMinHitable, tMaxHitable, tempRec))
+            {
+                t = tempRec.t;
+                rec = tempRec;
+                return true;
+            }
+            return false;
+        }) || hitAnything;
+    }
+
+    bool HitableBvh::boundingBox(Aabb& box) const
+    {
+        box = m_bvh.getBounds();
+        return !box.isEmpty();
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "bvh.h"
+#include "hitable.h"
+
+namespace rts // for ray tracing series
+{
+    // A list of hitables intersected through a BVH over their bounding boxes
+    // it's the top level of the hierarchy when the world is made of instances (see Instance)
+    // the hitables without bounds, such as a plane, are kept out of the hierarchy and tested against every ray before it
+    class HitableBvh final : public Hitable
+    {
+    public:
+        HitableBvh() : m_list() {}
+
+        void reserve(std::size_t capacity) { m_list.reserve(capacity); }
+        void add(std::unique_ptr<const Hitable> value) { m_list.push_back(std::move(value)); }
+        void clear();
+
+        // Build the hierarchy once every hitable has been added, the ones which have no bounding box are set apart
+        void build(BvhBuildMethod buildMethod, ThreadPool* pool);
+
+        // Refit the hierarchy once the bounds of the hitables have changed (see Bvh::refit)
+        BvhRefitStats refit(ThreadPool* pool);
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+
+        // The bounds of the hierarchy, the hitables without bounds are left out
+        virtual bool boundingBox(Aabb& box) const override;
+
+        std::size_t getHitableCount() const { return m_list.size() + m_unboundedList.size(); }
+        const Bvh& getBvh() const { return m_bvh; }
+
+    private:
+        std::vector<std::unique_ptr<const Hitable>> m_list;
+        std::vector<std::unique_ptr<const Hitable>> m_unboundedList;
+        Bvh m_bvh;
+    };
+}
@@ -7,7 +7,9 @@
  * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
  */
 
-#include "hitableList.h"
+#include "hitablelist.h"
+
+#include "aabb.h"
 
 namespace rts
 {
@@ -30,4 +32,19 @@ namespace rts
 
         return hitAnything;
     }
+
+    bool HitableList::boundingBox(Aabb& box) const
+    {
+        box = Aabb();
+        for (const auto& h : m_list)
+        {
+            Aabb hitableBox;
+            if (!h->boundingBox(hitableBox))
+            {
+                return false;
+            }
+            box.expand(hitableBox);
+        }
+        return !box.isEmpty();
+    }
 }
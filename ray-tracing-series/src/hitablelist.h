@@ -23,8 +23,10 @@ namespace rts // for ray tracing series
 
         void reserve(std::size_t capacity) { m_list.reserve(capacity); }
         void add(std::unique_ptr<const Hitable> value) { m_list.push_back(std::move(value)); }
+        void clear() { m_list.clear(); }
 
         virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
 
     private:
         std::vector<std::unique_ptr<const Hitable>> m_list;
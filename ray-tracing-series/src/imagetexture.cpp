@@ -0,0 +1,467 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "imagetexture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "hdrimage.h"
+#include "hitable.h"
+#include "texturecache.h"
+#include "tonemap.h"
+#include "utils.h"
+
+namespace rts
+{
+    namespace
+    {
+        const char TEXTURE_FILE_MAGIC[4] = { 'R', 'T', 'S', 'T' };
+        const std::uint32_t TEXTURE_FILE_VERSION = 1;
+        const std::uint32_t TEXTURE_LEVEL_COUNT_MAX = 32;
+        const std::uint64_t PAGE_BYTE_COUNT = TextureCache::PAGE_SIZE;
+
+        // The header of a tiled texture file, followed by the level table, the levels start on page boundaries
+        struct TextureFileHeader
+        {
+            char magic[4];
+            std::uint32_t version;
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint32_t levelCount;
+            std::uint32_t reserved;
+        };
+
+        static_assert(ImageTexture::PAGE_TEXEL_COUNT * ImageTexture::PAGE_TEXEL_COUNT * 4 == TextureCache::PAGE_SIZE,
+            "A page of texels is the cache unit");
+
+        std::uint64_t alignOffset(std::uint64_t offset)
+        {
+            return (offset + PAGE_BYTE_COUNT - 1) / PAGE_BYTE_COUNT * PAGE_BYTE_COUNT;
+        }
+
+        // The 8-bit sRGB values converted to linear values once and for all
+        const float* getSrgbToLinearTable()
+        {
+            static const auto table = []()
+            {
+                std::vector<float> values(256);
+                for (int i = 0; i < 256; ++i)
+                {
+                    float c = i / 255.f;
+                    values[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return values;
+            }();
+            return table.data();
+        }
+
+        std::uint32_t linearToSrgb8(float value)
+        {
+            float c = std::min(std::max(value, 0.f), 1.f);
+            c = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+            return static_cast<std::uint32_t>(c * 255.f + 0.5f);
+        }
+
+        std::uint32_t packTexel(std::uint32_t r, std::uint32_t g, std::uint32_t b)
+        {
+            return r | (g << 8) | (b << 16) | (0xFFu << 24);
+        }
+
+        vec3 unpackTexel(std::uint32_t texel, const float* table)
+        {
+            return vec3(table[texel & 0xFF], table[(texel >> 8) & 0xFF], table[(texel >> 16) & 0xFF]);
+        }
+
+        // The byte offset of a texel from the start of its level, see ImageTexture for the layout
+        std::uint64_t getTexelOffset(const ImageTexture::Level& level, std::uint32_t x, std::uint32_t y)
+        {
+            std::uint64_t page = static_cast<std::uint64_t>(y / ImageTexture::PAGE_TEXEL_COUNT) * level.pagesX + x / ImageTexture::PAGE_TEXEL_COUNT;
+            std::uint32_t tileX = (x / ImageTexture::TILE_TEXEL_COUNT) & 3;
+            std::uint32_t tileY = (y / ImageTexture::TILE_TEXEL_COUNT) & 3;
+            std::uint32_t tile = (tileX & 1) | ((tileY & 1) << 1) | ((tileX & 2) << 1) | ((tileY & 2) << 2);
+            std::uint32_t texel = (y % ImageTexture::TILE_TEXEL_COUNT) * ImageTexture::TILE_TEXEL_COUNT + x % ImageTexture::TILE_TEXEL_COUNT;
+            return page * PAGE_BYTE_COUNT + (tile * ImageTexture::TILE_TEXEL_COUNT * ImageTexture::TILE_TEXEL_COUNT + texel) * 4;
+        }
+
+        std::uint32_t getPageCount(std::uint32_t size)
+        {
+            return (size + ImageTexture::PAGE_TEXEL_COUNT - 1) / ImageTexture::PAGE_TEXEL_COUNT;
+        }
+
+        // The texels of a level covered by a texel of the next one along an axis, an odd size gives a texel a fraction of 3 texels
+        struct FilterTaps
+        {
+            std::uint32_t first;
+            int count;
+            float weights[4];
+        };
+
+        std::vector<FilterTaps> getBoxFilterTaps(std::uint32_t sourceSize, std::uint32_t size)
+        {
+            std::vector<FilterTaps> taps(size);
+            double ratio = static_cast<double>(sourceSize) / size;
+            for (std::uint32_t i = 0; i < size; ++i)
+            {
+                double start = i * ratio;
+                double end = (i + 1) * ratio;
+                FilterTaps& tap = taps[i];
+                tap.first = static_cast<std::uint32_t>(start);
+                tap.count = 0;
+                for (std::uint32_t t = tap.first; t < sourceSize && t < end && tap.count < 4; ++t)
+                {
+                    double overlap = std::min(end, t + 1.0) - std::max(start, static_cast<double>(t));
+                    tap.weights[tap.count++] = static_cast<float>(overlap / ratio);
+                }
+            }
+            return taps;
+        }
+
+        // The coordinate of the first texel of a bilinear lookup and its weight, the texels wrap around
+        void getBilinearTexels(float coordinate, std::uint32_t size, std::uint32_t& t0, std::uint32_t& t1, float& weight)
+        {
+            float position = (coordinate - std::floor(coordinate)) * size - 0.5f;
+            float first = std::floor(position);
+            weight = position - first;
+            int t = static_cast<int>(first);
+            t0 = (t < 0) ? size - 1 : std::min(static_cast<std::uint32_t>(t), size - 1);
+            t1 = (t0 + 1 < size) ? t0 + 1 : 0;
+        }
+    }
+
+    ImageTexture::ImageTexture()
+        : m_texels(nullptr)
+        , m_cache(nullptr)
+        , m_textureId(0)
+    {
+    }
+
+    void ImageTexture::clear()
+    {
+        m_levels.clear();
+        m_ownedTexels.clear();
+        m_texels = nullptr;
+        m_file.close();
+        m_cache = nullptr;
+    }
+
+    void ImageTexture::create(const HdrImage& image)
+    {
+        std::vector<std::uint32_t> texels(image.pixels.size());
+        for (std::size_t i = 0; i < texels.size(); ++i)
+        {
+            const vec3& color = image.pixels[i];
+            texels[i] = packTexel(linearToSrgb8(color.r()), linearToSrgb8(color.g()), linearToSrgb8(color.b()));
+        }
+        createLevels(texels, image.width, image.height);
+    }
+
+    void ImageTexture::create(int width, int height, const std::vector<std::uint8_t>& rgb)
+    {
+        std::vector<std::uint32_t> texels(static_cast<std::size_t>(width) * height);
+        for (std::size_t i = 0; i < texels.size(); ++i)
+        {
+            texels[i] = packTexel(rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2]);
+        }
+        createLevels(texels, width, height);
+    }
+
+    void ImageTexture::createLevels(const std::vector<std::uint32_t>& texels, int width, int height)
+    {
+        clear();
+        if (width <= 0 || height <= 0)
+        {
+            return;
+        }
+
+        // Lay out the levels down to 1x1, each one starts on a page boundary
+        std::uint64_t offset = 0;
+        for (std::uint32_t w = width, h = height;; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+        {
+            Level level = { w, h, getPageCount(w), getPageCount(h), offset };
+            m_levels.push_back(level);
+            offset += static_cast<std::uint64_t>(level.pagesX) * level.pagesY * PAGE_BYTE_COUNT;
+            if (w == 1 && h == 1)
+            {
+                break;
+            }
+        }
+        m_ownedTexels.assign(static_cast<std::size_t>(offset / sizeof(std::uint32_t)), 0);
+        m_texels = reinterpret_cast<const std::uint8_t*>(m_ownedTexels.data());
+
+        // Each level is a box filter of the previous one in linear space, the first level keeps the given texels as they are
+        const float* table = getSrgbToLinearTable();
+        std::vector<vec3> current(texels.size());
+        for (std::size_t i = 0; i < texels.size(); ++i)
+        {
+            current[i] = unpackTexel(texels[i], table);
+        }
+        std::vector<vec3> next;
+        for (std::size_t l = 0; l < m_levels.size(); ++l)
+        {
+            const Level& level = m_levels[l];
+            auto* levelTexels = reinterpret_cast<std::uint8_t*>(m_ownedTexels.data()) + level.offset;
+            for (std::uint32_t y = 0; y < level.height; ++y)
+            {
+                for (std::uint32_t x = 0; x < level.width; ++x)
+                {
+                    std::size_t index = x + static_cast<std::size_t>(y) * level.width;
+                    const vec3& color = current[index];
+                    std::uint32_t texel = (l == 0) ? texels[index] : packTexel(linearToSrgb8(color.r()), linearToSrgb8(color.g()), linearToSrgb8(color.b()));
+                    std::memcpy(levelTexels + getTexelOffset(level, x, y), &texel, sizeof(texel));
+                }
+            }
+
+            if (l + 1 == m_levels.size())
+            {
+                break;
+            }
+
+            const Level& nextLevel = m_levels[l + 1];
+            std::vector<FilterTaps> tapsX = getBoxFilterTaps(level.width, nextLevel.width);
+            std::vector<FilterTaps> tapsY = getBoxFilterTaps(level.height, nextLevel.height);
+            next.assign(static_cast<std::size_t>(nextLevel.width) * nextLevel.height, vec3(0.f, 0.f, 0.f));
+            for (std::uint32_t y = 0; y < nextLevel.height; ++y)
+            {
+                for (std::uint32_t x = 0; x < nextLevel.width; ++x)
+                {
+                    vec3& sum = next[x + static_cast<std::size_t>(y) * nextLevel.width];
+                    for (int j = 0; j < tapsY[y].count; ++j)
+                    {
+                        for (int i = 0; i < tapsX[x].count; ++i)
+                        {
+                            std::size_t index = tapsX[x].first + i + static_cast<std::size_t>(tapsY[y].first + j) * level.width;
+                            sum += (tapsX[x].weights[i] * tapsY[y].weights[j]) * current[index];
+                        }
+                    }
+                }
+            }
+            current.swap(next);
+        }
+    }
+
+    bool ImageTexture::load(const std::string& filePath, TextureCache* cache)
+    {
+        clear();
+
+        if (endsWith(filePath, ".pfm"))
+        {
+            HdrImage image;
+            if (!loadHdrFile(filePath, image))
+            {
+                return false;
+            }
+            create(image);
+            return true;
+        }
+
+        if (!endsWith(filePath, ".rtst"))
+        {
+            int width, height;
+            std::vector<std::uint8_t> rgb;
+            if (!loadPpmFile(filePath, width, height, rgb))
+            {
+                return false;
+            }
+            create(width, height, rgb);
+            return true;
+        }
+
+        if (!m_file.open(filePath))
+        {
+            std::cerr << "Unable to map the texture file " << filePath << std::endl;
+            return false;
+        }
+
+        // Check the header and that the levels are the mip chain of the size, laid out in pages within the file
+        TextureFileHeader header;
+        std::size_t fileSize = m_file.size();
+        bool valid = fileSize >= sizeof(TextureFileHeader);
+        if (valid)
+        {
+            std::memcpy(&header, m_file.data(), sizeof(TextureFileHeader));
+            valid = std::memcmp(header.magic, TEXTURE_FILE_MAGIC, sizeof(header.magic)) == 0 && header.version == TEXTURE_FILE_VERSION
+                && header.width > 0 && header.height > 0 && header.levelCount > 0 && header.levelCount <= TEXTURE_LEVEL_COUNT_MAX
+                && header.levelCount <= (fileSize - sizeof(TextureFileHeader)) / sizeof(Level);
+        }
+        for (std::uint32_t l = 0; valid && l < header.levelCount; ++l)
+        {
+            Level level;
+            std::memcpy(&level, m_file.data() + sizeof(TextureFileHeader) + l * sizeof(Level), sizeof(Level));
+            std::uint32_t width = (l == 0) ? header.width : std::max(m_levels.back().width / 2, 1u);
+            std::uint32_t height = (l == 0) ? header.height : std::max(m_levels.back().height / 2, 1u);
+            std::uint64_t levelSize = static_cast<std::uint64_t>(level.pagesX) * level.pagesY * PAGE_BYTE_COUNT;
+            valid = level.width == width && level.height == height && level.pagesX == getPageCount(width) && level.pagesY == getPageCount(height)
+                && level.offset % PAGE_BYTE_COUNT == 0 && level.offset <= fileSize && levelSize <= fileSize - level.offset;
+            m_levels.push_back(level);
+        }
+        valid = valid && m_levels.back().width == 1 && m_levels.back().height == 1;
+        if (!valid)
+        {
+            std::cerr << "Invalid texture file " << filePath << std::endl;
+            clear();
+            return false;
+        }
+
+        if (cache != nullptr)
+        {
+            m_texels = m_file.data();
+            m_cache = cache;
+            m_textureId = cache->registerTexture();
+        }
+        else
+        {
+            m_ownedTexels.resize((fileSize + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t));
+            std::memcpy(m_ownedTexels.data(), m_file.data(), fileSize);
+            m_texels = reinterpret_cast<const std::uint8_t*>(m_ownedTexels.data());
+            m_file.close();
+        }
+        return true;
+    }
+
+    bool ImageTexture::save(const std::string& filePath) const
+    {
+        if (m_levels.empty())
+        {
+            std::cerr << "Unable to save the empty texture to " << filePath << std::endl;
+            return false;
+        }
+
+        std::ofstream file(filePath, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to create the texture file " << filePath << std::endl;
+            return false;
+        }
+
+        // The levels keep their layout, they're moved past the level table
+        std::uint64_t dataOffset = alignOffset(sizeof(TextureFileHeader) + m_levels.size() * sizeof(Level));
+        TextureFileHeader header;
+        std::memcpy(header.magic, TEXTURE_FILE_MAGIC, sizeof(header.magic));
+        header.version = TEXTURE_FILE_VERSION;
+        header.width = m_levels[0].width;
+        header.height = m_levels[0].height;
+        header.levelCount = static_cast<std::uint32_t>(m_levels.size());
+        header.reserved = 0;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        std::vector<Level> levels = m_levels;
+        std::uint64_t sourceOffset = levels[0].offset;
+        for (auto& level : levels)
+        {
+            level.offset = level.offset - sourceOffset + dataOffset;
+        }
+        file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(Level));
+
+        std::vector<char> padding(static_cast<std::size_t>(dataOffset - sizeof(TextureFileHeader) - levels.size() * sizeof(Level)), 0);
+        file.write(padding.data(), padding.size());
+        const Level& last = m_levels.back();
+        std::uint64_t dataSize = last.offset + static_cast<std::uint64_t>(last.pagesX) * last.pagesY * PAGE_BYTE_COUNT - sourceOffset;
+        file.write(reinterpret_cast<const char*>(m_texels + sourceOffset), static_cast<std::streamsize>(dataSize));
+
+        if (!file.good())
+        {
+            std::cerr << "Unable to write the texture file " << filePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    vec3 ImageTexture::value(const HitRecord& rec) const
+    {
+        if (m_levels.empty())
+        {
+            return vec3(0.f, 0.f, 0.f);
+        }
+
+        // The width of the footprint in texels of the first level, the level where it covers a single texel is read
+        float texelFootprint = rec.footprint * rec.uvDensity * std::max(m_levels[0].width, m_levels[0].height);
+        float lod = (texelFootprint > 1.f) ? std::log2(texelFootprint) : 0.f;
+        return sample(rec.u, rec.v, lod);
+    }
+
+    vec3 ImageTexture::sample(float u, float v, float lod) const
+    {
+        // A degenerate hit may give coordinates which aren't finite
+        if (m_levels.empty() || !std::isfinite(u) || !std::isfinite(v))
+        {
+            return vec3(0.f, 0.f, 0.f);
+        }
+
+        lod = std::min(std::max(lod, 0.f), static_cast<float>(m_levels.size() - 1));
+        int level = static_cast<int>(lod);
+        float weight = lod - level;
+        vec3 color = sampleLevel(level, u, v);
+        if (weight > 0.f && level + 1 < static_cast<int>(m_levels.size()))
+        {
+            color = (1.f - weight) * color + weight * sampleLevel(level + 1, u, v);
+        }
+        return color;
+    }
+
+    vec3 ImageTexture::sampleLevel(int levelIndex, float u, float v) const
+    {
+        const Level& level = m_levels[levelIndex];
+        std::uint32_t x[2], y[2];
+        float wx, wy;
+        getBilinearTexels(u, level.width, x[0], x[1], wx);
+        getBilinearTexels(v, level.height, y[0], y[1], wy);
+
+        std::uint64_t offsets[4] = {
+            getTexelOffset(level, x[0], y[0]), getTexelOffset(level, x[1], y[0]),
+            getTexelOffset(level, x[0], y[1]), getTexelOffset(level, x[1], y[1]) };
+        std::uint32_t texels[4];
+        if (m_cache == nullptr)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                std::memcpy(&texels[i], m_texels + level.offset + offsets[i], sizeof(std::uint32_t));
+            }
+        }
+        else
+        {
+            // The texels of the same page are read together, the 4 of them usually share a page
+            bool done[4] = { false, false, false, false };
+            for (int i = 0; i < 4; ++i)
+            {
+                if (done[i])
+                {
+                    continue;
+                }
+                std::uint64_t page = offsets[i] / PAGE_BYTE_COUNT;
+                std::uint32_t pageOffsets[4];
+                int indices[4];
+                int count = 0;
+                for (int j = i; j < 4; ++j)
+                {
+                    if (!done[j] && offsets[j] / PAGE_BYTE_COUNT == page)
+                    {
+                        pageOffsets[count] = static_cast<std::uint32_t>(offsets[j] % PAGE_BYTE_COUNT);
+                        indices[count++] = j;
+                        done[j] = true;
+                    }
+                }
+                std::uint32_t pageTexels[4];
+                m_cache->readTexels(m_textureId, m_file, level.offset + page * PAGE_BYTE_COUNT, pageOffsets, count, pageTexels);
+                for (int k = 0; k < count; ++k)
+                {
+                    texels[indices[k]] = pageTexels[k];
+                }
+            }
+        }
+
+        const float* table = getSrgbToLinearTable();
+        vec3 bottom = (1.f - wx) * unpackTexel(texels[0], table) + wx * unpackTexel(texels[1], table);
+        vec3 top = (1.f - wx) * unpackTexel(texels[2], table) + wx * unpackTexel(texels[3], table);
+        return (1.f - wy) * bottom + wy * top;
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+#include "texture.h"
+
+namespace rts // for ray tracing series
+{
+    struct HdrImage;
+    class TextureCache;
+
+    // An image mapped over the surfaces by their texture coordinates, it wraps around in both directions
+    // the texels are stored in 8-bit sRGB (4 bytes with an unused alpha) along with a mip chain, each level is half the size
+    // of the previous one down to 1x1, the level is selected by the footprint of the ray cone and 2 levels are blended (trilinear)
+    // the levels are split in pages of 32x32 texels, the cache unit of the texture files, a page holds 4x4 tiles of 8x8 texels
+    // in Morton order and the texels of a tile are stored by rows, the 4 texels of a bilinear lookup hence share a tile
+    // most of the time, i.e. 1 or 2 cache lines of 64 bytes, where a row-major image would spread them over 2 distant rows
+    class ImageTexture final : public Texture
+    {
+    public:
+        ImageTexture();
+
+        ImageTexture(const ImageTexture&) = delete;
+        ImageTexture& operator=(const ImageTexture&) = delete;
+
+        // Build the texture in memory from a linear image or from 8-bit sRGB colors, 3 bytes per texel
+        // the rows are from bottom to top in both cases, v = 0 being the bottom
+        void create(const HdrImage& image);
+        void create(int width, int height, const std::vector<std::uint8_t>& rgb);
+
+        // Load a texture, the format is deduced from the extension, a tiled texture file (.rtst) is memory-mapped and read
+        // through the cache, or copied in memory when the cache is null, a PFM (.pfm) or a PPM image is built in memory
+        bool load(const std::string& filePath, TextureCache* cache);
+
+        // Save the texture as a tiled texture file, the levels are written in their layout to be read in place
+        bool save(const std::string& filePath) const;
+
+        virtual vec3 value(const HitRecord& rec) const override;
+
+        // The filtered color at the given coordinates, lod is the level to read, the fractional part blends it with the next one
+        vec3 sample(float u, float v, float lod) const;
+
+        int getWidth() const { return m_levels.empty() ? 0 : static_cast<int>(m_levels[0].width); }
+        int getHeight() const { return m_levels.empty() ? 0 : static_cast<int>(m_levels[0].height); }
+        int getLevelCount() const { return static_cast<int>(m_levels.size()); }
+        bool isStreamed() const { return m_cache != nullptr; }
+
+        // The memory of the texels held by the texture, the pages of a streamed texture are counted by the cache instead
+        std::size_t getMemoryUsage() const { return m_ownedTexels.size() * sizeof(std::uint32_t); }
+
+        static const int PAGE_TEXEL_COUNT = 32; // the width and the height of a page
+        static const int TILE_TEXEL_COUNT = 8;  // the same for a tile
+
+        // The level table of the texture files, the offset of a level is from the start of the file, or of the texels in memory
+        struct Level
+        {
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint32_t pagesX;
+            std::uint32_t pagesY;
+            std::uint64_t offset;
+        };
+
+    private:
+        void clear();
+
+        // Build the mip chain of the row-major texels of the first level and swizzle the levels into the pages
+        void createLevels(const std::vector<std::uint32_t>& texels, int width, int height);
+
+        // Bilinear lookup in a single level
+        vec3 sampleLevel(int level, float u, float v) const;
+
+        std::vector<Level> m_levels;
+        std::vector<std::uint32_t> m_ownedTexels;
+        const std::uint8_t* m_texels;   // either the owned texels or the memory-mapped file
+        MappedFile m_file;
+        TextureCache* m_cache;          // only for the textures read in place from a file
+        std::uint32_t m_textureId;
+    };
+}
@@ -0,0 +1,55 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "instance.h"
+
+#include "ray.h"
+
+namespace rts
+{
+    Instance::Instance(std::shared_ptr<const Hitable> object, const Transform& objectToWorld)
+        : m_object(std::move(object))
+        , m_objectToWorld(objectToWorld)
+        , m_worldToObject(objectToWorld.inverse())
+    {
+    }
+
+    bool Instance::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        // The object ray is normalized again after the transform, the distances along it are scaled by the length
+        // of the transformed direction and they're converted back to world distances once the object is hit
+        vec3 objectDirection = m_worldToObject.transformVector(r.direction());
+        float scale = objectDirection.length();
+        Ray objectRay(m_worldToObject.transformPoint(r.origin()), objectDirection, r.time());
+        if (!m_object->hit(objectRay, tMin * scale, tMax * scale, rec))
+        {
+            return false;
+        }
+        rec.t /= scale;
+
+        // The texture units per world unit follow the scale of the transform along the ray
+        rec.uvDensity *= scale;
+
+        // The normals are transformed by the inverse transpose to stay perpendicular to the surface
+        rec.p = m_objectToWorld.transformPoint(rec.p);
+        rec.normal = unitVector(m_worldToObject.transformNormalTransposed(rec.normal));
+        return true;
+    }
+
+    bool Instance::boundingBox(Aabb& box) const
+    {
+        Aabb objectBox;
+        if (!m_object->boundingBox(objectBox))
+        {
+            return false;
+        }
+        box = m_objectToWorld.transformBox(objectBox);
+        return true;
+    }
+}
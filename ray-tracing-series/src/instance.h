@@ -0,0 +1,37 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "hitable.h"
+#include "transform.h"
+
+namespace rts // for ray tracing series
+{
+    // A placement of a shared hitable in the world through an affine transform
+    // the rays are brought into the object space of the hitable so that its acceleration structure
+    // is built once no matter how many instances reference it (bottom level of a two-level hierarchy)
+    class Instance final : public Hitable
+    {
+    public:
+        Instance(std::shared_ptr<const Hitable> object, const Transform& objectToWorld);
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
+
+        const Transform& getTransform() const { return m_objectToWorld; }
+
+    private:
+        std::shared_ptr<const Hitable> m_object;
+        Transform m_objectToWorld;
+        Transform m_worldToObject;
+    };
+}
@@ -0,0 +1,27 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "isotropic.h"
+
+#include "hitable.h"
+#include "ray.h"
+#include "utils.h"
+
+namespace rts
+{
+    bool Isotropic::scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const
+    {
+        // The points uniformly distributed in the unit sphere give directions uniformly distributed over the sphere
+        scattered = Ray(rec.p, getRandomPointInUnitSphere(random), rIn.time());
+
+        attenuation = getAlbedo(rec);
+
+        return true;
+    }
+}
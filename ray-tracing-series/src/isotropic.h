@@ -0,0 +1,33 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include "material.h"
+#include "texture.h"
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // The phase function of a participating medium which scatters the light uniformly in all the directions (see ConstantMedium)
+    // the albedo is the fraction of the light scattered rather than absorbed at each scattering event
+    class Isotropic final : public Material
+    {
+    public:
+        // The texture, if any, modulates the albedo
+        Isotropic(const vec3& albedo, const Texture* texture = nullptr) : m_albedo(albedo), m_texture(texture) {}
+
+        virtual bool scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const override;
+        virtual vec3 getAlbedo(const HitRecord& rec) const override { return (m_texture != nullptr) ? m_albedo * m_texture->value(rec) : m_albedo; }
+
+    private:
+        vec3 m_albedo;
+        const Texture* m_texture;
+    };
+}
@@ -9,6 +9,8 @@
 
 #include "lambertian.h"
 
+#include <cmath>
+
 #include "defines.h"
 #include "hitable.h"
 #include "ray.h"
@@ -18,14 +20,36 @@ namespace rts
 {
     bool Lambertian::scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const
     {
-        RTS_UNUSED(rIn);
-
         // Diffuse scattering: determine a new random target to bounce off the surface
         vec3 target = rec.p + rec.normal + getRandomPointInUnitSphere(random);
-        scattered = Ray(rec.p, target - rec.p);
+        scattered = Ray(rec.p, target - rec.p, rIn.time());
 
-        attenuation = m_albedo;
+        attenuation = getAlbedo(rec);
 
         return true;
     }
+
+    bool Lambertian::evaluate(const Ray& rIn, const HitRecord& rec, const vec3& direction, vec3& value, float& pdf) const
+    {
+        RTS_UNUSED(rIn);
+        float cosine = dot(rec.normal, direction);
+        if (cosine <= 0.f)
+        {
+            return false;
+        }
+
+        // The BSDF is albedo / pi
+        pdf = cosine / static_cast<float>(M_PI);
+        value = pdf * getAlbedo(rec);
+        return true;
+    }
+
+    bool Lambertian::sample(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, float& pdf, Random& random) const
+    {
+        vec3 direction = getCosineWeightedDirection(rec.normal, random);
+        scattered = Ray(rec.p, direction, rIn.time());
+        pdf = dot(rec.normal, direction) / static_cast<float>(M_PI);
+        attenuation = getAlbedo(rec);
+        return true;
+    }
 }
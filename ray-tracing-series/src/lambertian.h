@@ -10,6 +10,7 @@
 #pragma once
 
 #include "material.h"
+#include "texture.h"
 #include "vec3.h"
 
 namespace rts // for ray tracing series
@@ -17,11 +18,20 @@ namespace rts // for ray tracing series
     class Lambertian final : public Material
     {
     public:
-        Lambertian(const vec3& albedo) : m_albedo(albedo) {}
+        // The texture, if any, modulates the albedo
+        Lambertian(const vec3& albedo, const Texture* texture = nullptr) : m_albedo(albedo), m_texture(texture) {}
 
         virtual bool scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const override;
+        virtual vec3 getAlbedo(const HitRecord& rec) const override { return (m_texture != nullptr) ? m_albedo * m_texture->value(rec) : m_albedo; }
+
+        // The evaluation and the sampling follow the cosine, whereas scatter keeps the distribution of the book, a point in the unit sphere
+        // above the hit, which is closer to the normal but has no simple density
+        virtual bool canEvaluate() const override { return true; }
+        virtual bool evaluate(const Ray& rIn, const HitRecord& rec, const vec3& direction, vec3& value, float& pdf) const override;
+        virtual bool sample(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, float& pdf, Random& random) const override;
 
     private:
         vec3 m_albedo;
+        const Texture* m_texture;
     };
 }
@@ -0,0 +1,160 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <intrin.h>
+#include <process.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// The launcher of the builds made with RTS_ISA_DISPATCH (see CMakeLists.txt)
+// it runs the build of the widest instruction set supported by the CPU, found next to the launcher
+// the RTS_ISA environment variable (sse4.2, avx2 or avx512) forces a build
+namespace
+{
+    const char* const ISA_NAMES[] = { "sse4.2", "avx2", "avx512" };
+    const char* const ISA_SUFFIXES[] = { "-sse42", "-avx2", "-avx512" };
+    const int ISA_COUNT = 3;
+
+#ifdef _WIN32
+    bool isOsSavingAvxState(unsigned long long mask)
+    {
+        int info[4];
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        return osxsave && (_xgetbv(0) & mask) == mask;
+    }
+
+    // The features match the x86-64 micro-architecture levels the builds are compiled for
+    bool isIsaSupported(int isa)
+    {
+        int info[4];
+        __cpuid(info, 1);
+        bool sse42 = (info[2] & (1 << 20)) != 0 && (info[2] & (1 << 23)) != 0;
+        bool fma = (info[2] & (1 << 12)) != 0;
+        __cpuidex(info, 7, 0);
+        bool avx2 = (info[1] & (1 << 5)) != 0 && (info[1] & (1 << 3)) != 0 && (info[1] & (1 << 8)) != 0;
+        bool avx512 = (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 17)) != 0 && (info[1] & (1 << 28)) != 0
+            && (info[1] & (1 << 30)) != 0 && (info[1] & (1 << 31)) != 0;
+        switch (isa)
+        {
+        case 0: return sse42;
+        case 1: return sse42 && avx2 && fma && isOsSavingAvxState(0x6);
+        default: return sse42 && avx2 && fma && avx512 && isOsSavingAvxState(0xe6);
+        }
+    }
+
+    std::string getExecutablePath()
+    {
+        char path[MAX_PATH];
+        DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+        return std::string(path, length);
+    }
+#else
+    bool isIsaSupported(int isa)
+    {
+        __builtin_cpu_init();
+        bool sse42 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+        bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2");
+        bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+        switch (isa)
+        {
+        case 0: return sse42;
+        case 1: return sse42 && avx2;
+        default: return sse42 && avx2 && avx512;
+        }
+    }
+
+    std::string getExecutablePath()
+    {
+        std::vector<char> path(4096);
+        ssize_t length = readlink("/proc/self/exe", path.data(), path.size() - 1);
+        return length > 0 ? std::string(path.data(), length) : std::string();
+    }
+#endif
+
+    int selectIsa()
+    {
+        const char* forcedIsa = std::getenv("RTS_ISA");
+        if (forcedIsa && *forcedIsa)
+        {
+            for (int isa = 0; isa < ISA_COUNT; ++isa)
+            {
+                if (ISA_NAMES[isa] == std::string(forcedIsa))
+                {
+                    return isa;
+                }
+            }
+            std::cerr << "Unknown instruction set " << forcedIsa << " in RTS_ISA, expected sse4.2, avx2 or avx512" << std::endl;
+            return -1;
+        }
+
+        for (int isa = ISA_COUNT - 1; isa >= 0; --isa)
+        {
+            if (isIsaSupported(isa))
+            {
+                return isa;
+            }
+        }
+        std::cerr << "The CPU doesn't support SSE4.2, which all the builds require" << std::endl;
+        return -1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int isa = selectIsa();
+    if (isa < 0)
+    {
+        return 1;
+    }
+
+    // The builds are named after the launcher, e.g. ray-tracing-series-avx2 next to ray-tracing-series
+    std::string path = getExecutablePath();
+    if (path.empty())
+    {
+        path = argv[0];
+    }
+#ifdef _WIN32
+    std::string extension;
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".exe") == 0)
+    {
+        extension = ".exe";
+        path.resize(path.size() - 4);
+    }
+    path += ISA_SUFFIXES[isa] + extension;
+#else
+    path += ISA_SUFFIXES[isa];
+#endif
+
+    std::vector<char*> args(argv, argv + argc);
+    args[0] = const_cast<char*>(path.c_str());
+    args.push_back(nullptr);
+
+#ifdef _WIN32
+    // There's no exec on Windows, the build runs as a child process and its exit code is forwarded
+    intptr_t exitCode = _spawnv(_P_WAIT, path.c_str(), args.data());
+    if (exitCode != -1)
+    {
+        return static_cast<int>(exitCode);
+    }
+#else
+    execv(path.c_str(), args.data());
+#endif
+    std::cerr << "Unable to run " << path << std::endl;
+    return 1;
+}
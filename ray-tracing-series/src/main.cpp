@@ -7,121 +7,332 @@
  * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
  */
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <future>
 #include <iostream>
 #include <memory>
-#include <tuple>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "benchmark.h"
 #include "camera.h"
 #include "config.h"
 #include "defines.h"
-#include "dielectric.h"
-#include "hitableList.h"
-#include "lambertian.h"
-#include "metal.h"
-#include "random.h"
+#include "denoiser.h"
+#include "fastmath.h"
+#include "hdrimage.h"
+#include "imagetexture.h"
+#include "preview.h"
 #include "raytracer.h"
-#include "sphere.h"
+#include "scene.h"
+#include "threadpool.h"
 #include "timer.h"
+#include "tonemap.h"
 #include "vec3.h"
+#include "worlds.h"
 
 namespace rts // for ray tracing series
 {
-    void generateCustomWorld(HitableList& world)
+    // Save the linear radiance, it can be tonemapped again with --tonemap-only, then the tonemapped image
+    bool saveImageFiles(const HdrImage& image, const ToneMapSettings& toneMapSettings, const std::string& hdrFilePath, const std::string& filePath)
     {
-        auto lambertianMat1 = std::make_shared<Lambertian>(vec3(0.1f, 0.2f, 0.5f));
-        auto lambertianMat2 = std::make_shared<Lambertian>(vec3(0.8f, 0.8f, 0.f));
-        auto metallicMat = std::make_shared<Metal>(vec3(0.8f, 0.6f, 0.2f), 0.3f);
-        auto dielectricMat = std::make_shared<Dielectric>(1.5f);
-
-        world.reserve(5);
-        world.add(std::make_unique<Sphere>(vec3(0.f, 0.f, -1.f), 0.5f, lambertianMat1));        // diffuse sphere at the center of the screen
-        world.add(std::make_unique<Sphere>(vec3(0.f, -100.5f, -1.f), 100.f, lambertianMat2));   // diffuse sphere representing the ground
-        world.add(std::make_unique<Sphere>(vec3(1.f, 0.f, -1.f), 0.5f, metallicMat));           // metallic sphere on the right side of the diffuse one
-        world.add(std::make_unique<Sphere>(vec3(-1.f, 0.f, -1.f), 0.5f, dielectricMat));        // glass sphere on the left side of the diffuse one
-        world.add(std::make_unique<Sphere>(vec3(-1.f, 0.f, -1.f), -0.45f, dielectricMat));      // activate this to make the glass sphere hollow (negative radius)
-    }
-
-    void generateSimpleCustomWorld(HitableList& world)
-    {
-        float R = cos(static_cast<int>(M_PI) / 4.f);
-        world.reserve(2);
-        world.add(std::make_unique<Sphere>(vec3(-R, 0.f, -1.f), R, std::make_shared<Lambertian>(vec3(0.f, 0.f, 1.f))));
-        world.add(std::make_unique<Sphere>(vec3(R, 0.f, -1.f), R, std::make_shared<Lambertian>(vec3(1.f, 0.f, 0.f))));
+        if (!saveHdrFile(image, hdrFilePath))
+        {
+            return false;
+        }
+        std::vector<std::uint8_t> rgb;
+        toneMap(image, toneMapSettings, rgb);
+        return savePpmFile(filePath, image.width, image.height, rgb);
     }
 
-    void generateRandomWorld(HitableList& world)
+    // Warn about the samples of a render which weren't finite, per sub task so that the band of lines can be told, return their count
+    std::uint64_t reportInvalidSamples(const SampleDiagnostics& diagnostics)
     {
-        world.reserve(500);
-        world.add(std::make_unique<Sphere>(vec3(0.f, -1000.f, 0.f), 1000.f, std::make_shared<Lambertian>(vec3(0.5f, 0.5f, 0.5f))));
-
-        Random random;
-        for (int a = -11; a < 11; ++a)
+        std::uint64_t count = diagnostics.getInvalidSampleCount();
+        if (count > 0)
         {
-            for (int b = -11; b < 11; ++b)
+            std::cerr << "Warning: " << count << " samples with a NaN or infinite radiance have been left out, per sub task:";
+            for (std::size_t taskId = 0; taskId < diagnostics.invalidSampleCounts.size(); ++taskId)
             {
-                float chooseMat = random.get();
-                vec3 center(a + 0.9f * random.get(), 0.2f, b + 0.9f * random.get());
-
-                if ((center - vec3(4.f, 0.2f, 0.f)).length() > 0.9f)
+                if (diagnostics.invalidSampleCounts[taskId] > 0)
                 {
-                    if (chooseMat < 0.8f) // diffuse
-                    {
-                        world.add(std::make_unique<Sphere>(center, 0.2f,
-                            std::make_shared<Lambertian>(vec3(random.get() * random.get(), random.get() * random.get(), random.get() * random.get()))));
-                    }
-                    else if (chooseMat < 0.95f) // metal
-                    {
-                        world.add(std::make_unique<Sphere>(center, 0.2f,
-                            std::make_shared<Metal>(vec3(0.5f * (1.f + random.get()), 0.5f * (1.f + random.get()), 0.5f * (1.f + random.get())), 0.5f * random.get())));
-                    }
-                    else // glass
-                    {
-                        world.add(std::make_unique<Sphere>(center, 0.2f, std::make_shared<Dielectric>(1.5f)));
-                    }
+                    std::cerr << " [" << taskId << "] " << diagnostics.invalidSampleCounts[taskId];
                 }
             }
+            std::cerr << std::endl;
         }
+        return count;
+    }
 
-        world.add(std::make_unique<Sphere>(vec3(0.f, 1.f, 0.f), 1.f, std::make_shared<Dielectric>(1.5f)));
-        world.add(std::make_unique<Sphere>(vec3(-4.f, 1.f, 0.f), 1.f, std::make_shared<Lambertian>(vec3(0.4f, 0.2f, 0.1f))));
-        world.add(std::make_unique<Sphere>(vec3(4.f, 1.f, 0.f), 1.f, std::make_shared<Metal>(vec3(0.7f, 0.6f, 0.5f), 0.f)));
+    // Set up the scene from the file, or from one of the built-in worlds without any file, it still has to be committed
+    bool setupScene(Scene& scene, const std::string& sceneFilePath)
+    {
+        if (!sceneFilePath.empty())
+        {
+            return scene.loadFile(sceneFilePath);
+        }
+        if (WORLD_GENERATION_RANDOM)
+        {
+            generateRandomWorld(scene);
+        }
+        else
+        {
+            generateCustomWorld(scene);
+            //generateSimpleCustomWorld(scene);
+        }
+        return true;
     }
 
-    void writeImageFile(const ImageData* imageData)
+    // Render all the frames of an animated scene, the scene and its acceleration structure are built once for all of them
+    // the files of a frame are written by another thread while the next frame is being rendered
+    // the scene has a copy per NUMA node of the thread pool, see rayTracingMainTask
+    // the samples which aren't finite are added to invalidSampleCount, checking them writes the debug image of the frames which have some
+    bool renderAnimation(const std::vector<const Scene*>& nodeScenes, int sampleCount, bool denoising, bool checkingSamples,
+        const ToneMapSettings& toneMapSettings, float frameRate, std::uint64_t& invalidSampleCount)
     {
-        // Write the ray tracer output to the image file
-        std::ofstream imageFile(IMAGE_FILE_PATH);
-        if (imageFile.is_open())
+        const Scene& scene = *nodeScenes.front();
+        float startTime = scene.getAnimationStartTime();
+        int frameCount = std::max(1, static_cast<int>(std::lround((scene.getAnimationEndTime() - startTime) * frameRate)));
+        std::cout << "Rendering " << frameCount << " frames at " << frameRate << " fps (" << sampleCount << " rays per pixel)..." << std::endl;
+
+        Timer timer;
+        timer.setStartTime();
+        std::future<bool> pendingWrite;
+        for (int frame = 0; frame < frameCount; ++frame)
         {
-            // Write the image file header
-            imageFile << "P3" << std::endl;
-            imageFile << IMAGE_WIDTH << " " << IMAGE_HEIGHT << std::endl;
-            imageFile << "255" << std::endl;
+            Timer frameTimer;
+            frameTimer.setStartTime();
 
-            // Iterate over the ray tracer output
-            for (int j = IMAGE_HEIGHT - 1; j >= 0; --j)
+            float time = startTime + frame / frameRate;
+            setFrameIndex(static_cast<unsigned int>(frame));
+            std::unique_ptr<Camera> camera = scene.createCamera(CAMERA_ASPECT_RATIO, time);
+            HdrImage image;
+            image.resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+            AovImages aovs;
+            if (denoising)
             {
-                for (int i = 0; i < IMAGE_WIDTH; ++i)
-                {
-                    // Output the color to the image file
-                    auto col = (*imageData)[i + j * IMAGE_WIDTH];
-                    imageFile << std::get<0>(col) << " " << std::get<1>(col) << " " << std::get<2>(col) << std::endl;
-                }
+                aovs.resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+            }
+            SampleDiagnostics diagnostics;
+            if (checkingSamples)
+            {
+                diagnostics.invalidSamples.resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+            }
+            rayTracingMainTask(*camera, nodeScenes, sampleCount, &image, denoising ? &aovs : nullptr, getThreadPool(), &diagnostics);
+            if (denoising)
+            {
+                HdrImage noisyImage = std::move(image);
+                denoise(noisyImage, aovs, getDefaultDenoiserSettings(), image);
             }
 
-            imageFile.close();
+            // Wait for the previous frame to be written before handing this one over
+            if (pendingWrite.valid() && !pendingWrite.get())
+            {
+                return false;
+            }
+            char frameIndex[16];
+            std::snprintf(frameIndex, sizeof(frameIndex), "%04d", frame);
+            std::string framePath = ANIMATION_FRAME_FILE_PREFIX + frameIndex;
+            std::uint64_t frameInvalidSampleCount = reportInvalidSamples(diagnostics);
+            invalidSampleCount += frameInvalidSampleCount;
+            if (checkingSamples && frameInvalidSampleCount > 0 && !saveHdrFile(diagnostics.invalidSamples, framePath + "_invalid_samples.pfm"))
+            {
+                return false;
+            }
+            pendingWrite = std::async(std::launch::async, [framePath, &toneMapSettings, frameImage = std::move(image)]()
+                { return saveImageFiles(frameImage, toneMapSettings, framePath + ".pfm", framePath + ".ppm"); });
+
+            std::cout << "    frame " << frame << " at " << time << "s (" << frameTimer.getElapsedTime() << "s)" << std::endl;
+        }
+
+        if (!pendingWrite.get())
+        {
+            return false;
         }
+        std::cout << "Done! (" << timer.getElapsedTime() << "s, " << timer.getElapsedTime() / frameCount << "s per frame)\n\n";
+        return true;
     }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     using namespace rts;
 
+    // Usage: ray-tracing-series [scene file] [--save-binary <binary scene file>] [--precise-math] [--spectral] [--spp <count>] [--denoise]
+    //            [--check-samples] [tonemapping options]
+    //        ray-tracing-series [scene file] --preview [--spp <count>] [tonemapping options]
+    //        ray-tracing-series [scene file] --save-bricks <text scene file>
+    //        ray-tracing-series --tonemap-only <HDR image file> [tonemapping options]
+    //        ray-tracing-series --save-texture <image file> <tiled texture file>
+    //        ray-tracing-series <animated scene file> [--fps <rate>] [--spp <count>] [--denoise] [--check-samples] [tonemapping options]
+    //        ray-tracing-series --benchmark
+    // the fast-math approximations are used unless --precise-math is given (see fastmath.h)
+    // --spectral traces wavelengths rather than RGB components, the dispersive dielectrics then split the light (see raytracer.h)
+    // --denoise filters the image with the help of the auxiliary images (see denoiser.h), with fewer rays per pixel by default
+    // the samples with a NaN or infinite radiance are left out and reported, --check-samples also writes an image of the pixels which had some
+    // (see SampleDiagnostics) and makes the exit code 2 when there are any, for a render farm to catch the numerical failures
+    // the tonemapping options are --exposure <stops>, --tonemap <clamp|reinhard|aces> and --grayscale
+    // a scene with camera keyframes renders all the frames of the animation, see the keyframe statement in scene.cpp
+    // --preview renders progressively to a shared memory framebuffer until its consumer stops it, see preview.h
+    // --save-bricks converts the scene for out-of-core rendering, its world spheres are written to a brick file next to the text scene file
+    // --save-texture converts a PFM or a PPM image to a tiled texture file with its mip chain, read in place by the scenes (see imagetexture.h)
+    std::string sceneFilePath;
+    std::string binarySceneFilePath;
+    std::string brickSceneFilePath;
+    std::string hdrInputFilePath;
+    std::string textureInputFilePath;
+    std::string textureOutputFilePath;
+    ToneMapSettings toneMapSettings = getDefaultToneMapSettings();
+    int sampleCount = 0;
+    bool denoising = false;
+    bool checkingSamples = false;
+    bool preview = false;
+    float frameRate = ANIMATION_FRAME_RATE;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--benchmark")
+        {
+            return runBenchmarks();
+        }
+        else if (arg == "--precise-math")
+        {
+            FastMath::setFeatures(FAST_MATH_NONE);
+        }
+        else if (arg == "--spectral")
+        {
+            setSpectralRendering(true);
+        }
+        else if (arg == "--tonemap-only" && i + 1 < argc)
+        {
+            hdrInputFilePath = argv[++i];
+        }
+        else if (arg == "--exposure" && i + 1 < argc)
+        {
+            toneMapSettings.exposure = std::strtof(argv[++i], nullptr);
+        }
+        else if (arg == "--tonemap" && i + 1 < argc)
+        {
+            if (!parseToneMapOperator(argv[++i], toneMapSettings.toneMapOperator))
+            {
+                return 1;
+            }
+        }
+        else if (arg == "--grayscale")
+        {
+            toneMapSettings.grayscale = true;
+        }
+        else if (arg == "--spp" && i + 1 < argc)
+        {
+            sampleCount = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+            if (sampleCount <= 0)
+            {
+                std::cerr << "The number of rays per pixel must be positive" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--fps" && i + 1 < argc)
+        {
+            frameRate = std::strtof(argv[++i], nullptr);
+            if (!(frameRate > 0.f))
+            {
+                std::cerr << "The frame rate must be positive" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--denoise")
+        {
+            denoising = true;
+        }
+        else if (arg == "--check-samples")
+        {
+            checkingSamples = true;
+        }
+        else if (arg == "--preview")
+        {
+            preview = true;
+        }
+        else if (arg == "--save-binary" && i + 1 < argc)
+        {
+            binarySceneFilePath = argv[++i];
+        }
+        else if (arg == "--save-bricks" && i + 1 < argc)
+        {
+            brickSceneFilePath = argv[++i];
+        }
+        else if (arg == "--save-texture" && i + 2 < argc)
+        {
+            textureInputFilePath = argv[++i];
+            textureOutputFilePath = argv[++i];
+        }
+        else
+        {
+            sceneFilePath = arg;
+        }
+    }
+
+    if (sampleCount == 0)
+    {
+        sampleCount = denoising ? DENOISER_RAY_COUNT_PER_PIXEL : RAY_COUNT_PER_PIXEL;
+    }
+
     std::cout << "A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/\n\n";
+
+    // Tonemap a previously rendered image without tracing any ray
+    if (!hdrInputFilePath.empty())
+    {
+        Timer timer;
+        timer.setStartTime();
+        HdrImage image;
+        if (!loadHdrFile(hdrInputFilePath, image))
+        {
+            return 1;
+        }
+        std::vector<std::uint8_t> rgb;
+        toneMap(image, toneMapSettings, rgb);
+        if (!savePpmFile(IMAGE_FILE_PATH, image.width, image.height, rgb))
+        {
+            return 1;
+        }
+        std::cout << "Tonemapped " << hdrInputFilePath << " to " << IMAGE_FILE_PATH << " (" << timer.getElapsedTime() << "s)" << std::endl;
+        return 0;
+    }
+
+    // Convert an image without setting up any scene
+    if (!textureInputFilePath.empty())
+    {
+        Timer timer;
+        timer.setStartTime();
+        ImageTexture texture;
+        if (!texture.load(textureInputFilePath, nullptr) || !texture.save(textureOutputFilePath))
+        {
+            return 1;
+        }
+        std::cout << "Converted the " << texture.getWidth() << "x" << texture.getHeight() << " image " << textureInputFilePath << " with "
+            << texture.getLevelCount() << " levels to " << textureOutputFilePath << " (" << timer.getElapsedTime() << "s)" << std::endl;
+        return 0;
+    }
+
+    // The conversion doesn't commit the scene, its spheres may only fit in memory as long as they're read in place from a binary file
+    if (!brickSceneFilePath.empty())
+    {
+        Timer timer;
+        timer.setStartTime();
+        Scene scene;
+        if (!setupScene(scene, sceneFilePath) || !scene.saveTextFile(brickSceneFilePath, true))
+        {
+            return 1;
+        }
+        std::cout << "Converted the " << scene.getSphereCount() << " spheres of the world to bricks for " << brickSceneFilePath
+            << " (" << timer.getElapsedTime() << "s)" << std::endl;
+        return 0;
+    }
+
     Timer globalTimer;
     globalTimer.setStartTime();
 
@@ -130,40 +341,118 @@ int main()
     Timer stepTimer;
     stepTimer.setStartTime();
 
-    HitableList world;
-    std::unique_ptr<Camera> camera;
-    if (WORLD_GENERATION_RANDOM)
+    // On a NUMA machine, each node of the thread pool gets its own copy of the scene, set up and committed by one of its workers
+    // so that the memory is allocated on the node (first touch), the ray tracing tasks then read the copy of their node
+    ThreadPool* pool = getThreadPool();
+    unsigned int nodeCount = (pool != nullptr && MULTITHREADING_NUMA_REPLICATION) ? pool->getNodeCount() : 1;
+    std::vector<std::unique_ptr<Scene>> scenes(nodeCount);
+    if (nodeCount > 1)
     {
-        generateRandomWorld(world);
-
-        vec3 lookFrom(6.f, 1.5f, -2.f);
-        vec3 lookAt(4.f, 1.1667f, -1.333f);
-        float distToFocus = (lookFrom - lookAt).length();
-        float aperture = 0.02f;
-        camera = std::make_unique<Camera>(lookFrom, lookAt, vec3(0.f, 1.f, 0.f), CAMERA_FOV, CAMERA_ASPECT_RATIO, aperture, distToFocus);
+        std::vector<char> sceneReady(nodeCount, 0);
+        runOnEachNode(pool, [&](unsigned int node)
+        {
+            scenes[node] = std::make_unique<Scene>();
+            if (setupScene(*scenes[node], sceneFilePath))
+            {
+                scenes[node]->copyMappedData();
+                scenes[node]->commit();
+                sceneReady[node] = 1;
+            }
+        });
+        if (std::find(sceneReady.begin(), sceneReady.end(), 0) != sceneReady.end())
+        {
+            return 1;
+        }
     }
     else
     {
-        generateCustomWorld(world);
-        //generateSimpleCustomWorld(world);
+        scenes[0] = std::make_unique<Scene>();
+        if (!setupScene(*scenes[0], sceneFilePath))
+        {
+            return 1;
+        }
+        scenes[0]->commit();
+    }
 
-        vec3 lookFrom(3.f, 3.f, 2.f);
-        vec3 lookAt(0.f, 0.f, -1.f);
-        float distToFocus = (lookFrom - lookAt).length();
-        float aperture = 2.f;
-        camera = std::make_unique<Camera>(lookFrom, lookAt, vec3(0.f, 1.f, 0.f), 20.f, CAMERA_ASPECT_RATIO, aperture, distToFocus);
+    const Scene& scene = *scenes[0];
+    std::vector<const Scene*> nodeScenes;
+    for (const auto& nodeScene : scenes)
+    {
+        nodeScenes.push_back(nodeScene.get());
     }
 
-    std::cout << "Done! (" << stepTimer.getElapsedTime() << "s)\n\n";
+    if (!binarySceneFilePath.empty() && !scene.saveBinaryFile(binarySceneFilePath))
+    {
+        return 1;
+    }
+
+    std::cout << "Done! (" << stepTimer.getElapsedTime() << "s";
+    if (nodeCount > 1)
+    {
+        std::cout << ", a copy on each of the " << nodeCount << " NUMA nodes";
+    }
+    std::cout << ")\n\n";
+
+    ////////////////////////////////////////////////////////////////////////////////
+    if (preview)
+    {
+        PreviewFramebuffer framebuffer;
+        if (!framebuffer.create(PREVIEW_FRAMEBUFFER_NAME, IMAGE_WIDTH, IMAGE_HEIGHT))
+        {
+            return 1;
+        }
+        std::cout << "Rendering a progressive preview to the framebuffer " << PREVIEW_FRAMEBUFFER_NAME << " (up to " << sampleCount
+            << " rays per pixel), until its consumer stops it..." << std::endl;
+        stepTimer.setStartTime();
+
+        HdrImage image;
+        PreviewStats stats;
+        runPreview(scene, sampleCount, toneMapSettings, framebuffer, image, stats);
+        std::cout << "Done! (" << stepTimer.getElapsedTime() << "s, first image after " << stats.timeToFirstImage * 1000. << "ms, "
+            << stats.publishedImageCount << " images published, " << stats.restartCount << " camera changes, "
+            << stats.sampleCount << " rays per pixel)\n\n";
+
+        // The last image of the preview is saved like a regular render
+        if (!saveImageFiles(image, toneMapSettings, IMAGE_HDR_FILE_PATH, IMAGE_FILE_PATH))
+        {
+            return 1;
+        }
+        std::cout << "All done! (" << globalTimer.getElapsedTime() << "s)" << std::endl;
+        return 0;
+    }
+
+    if (scene.isAnimated())
+    {
+        std::uint64_t invalidSampleCount = 0;
+        if (!renderAnimation(nodeScenes, sampleCount, denoising, checkingSamples, toneMapSettings, frameRate, invalidSampleCount))
+        {
+            return 1;
+        }
+        std::cout << "All done! (" << globalTimer.getElapsedTime() << "s)" << std::endl;
+        return (checkingSamples && invalidSampleCount > 0) ? 2 : 0;
+    }
+
+    std::unique_ptr<Camera> camera = scene.createCamera(CAMERA_ASPECT_RATIO);
 
     ////////////////////////////////////////////////////////////////////////////////
-    std::cout << "Performing ray tracing..." << std::endl;
+    std::cout << "Performing ray tracing (" << sampleCount << " rays per pixel)..." << std::endl;
     stepTimer.setStartTime();
 
     // Start the ray tracing main task
-    auto imageData = std::make_unique<ImageData>();
+    HdrImage image;
+    image.resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+    AovImages aovs;
+    if (denoising)
+    {
+        aovs.resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+    }
+    SampleDiagnostics diagnostics;
+    if (checkingSamples)
+    {
+        diagnostics.invalidSamples.resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+    }
     auto mainTask = std::async(std::launch::async,
-        [&]() { rayTracingMainTask(*camera.get(), world, imageData.get()); });
+        [&]() { rayTracingMainTask(*camera.get(), nodeScenes, sampleCount, &image, denoising ? &aovs : nullptr, pool, &diagnostics); });
 
     // Check periodically if the main task is completed
     while (mainTask.wait_for(std::chrono::milliseconds(500)) != std::future_status::ready)
@@ -173,17 +462,40 @@ int main()
     std::cout << std::endl;
 
     std::cout << "Done! (" << stepTimer.getElapsedTime() << "s)\n\n";
+    std::uint64_t invalidSampleCount = reportInvalidSamples(diagnostics);
 
     ////////////////////////////////////////////////////////////////////////////////
-    std::cout << "Writing the image file..." << std::endl;
+    if (denoising)
+    {
+        std::cout << "Denoising..." << std::endl;
+        stepTimer.setStartTime();
+
+        // The noisy image and the auxiliary images are saved as well, to compare the result against them
+        if (!saveHdrFile(image, IMAGE_NOISY_HDR_FILE_PATH) || !saveHdrFile(aovs.albedo, IMAGE_ALBEDO_FILE_PATH)
+            || !saveHdrFile(aovs.normal, IMAGE_NORMAL_FILE_PATH) || !saveHdrFile(aovs.depth, IMAGE_DEPTH_FILE_PATH))
+        {
+            return 1;
+        }
+        HdrImage noisyImage = std::move(image);
+        denoise(noisyImage, aovs, getDefaultDenoiserSettings(), image);
+
+        std::cout << "Done! (" << stepTimer.getElapsedTime() << "s)\n\n";
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Writing the image files..." << std::endl;
     stepTimer.setStartTime();
 
-    writeImageFile(imageData.get());
+    if (!saveImageFiles(image, toneMapSettings, IMAGE_HDR_FILE_PATH, IMAGE_FILE_PATH)
+        || (checkingSamples && !saveHdrFile(diagnostics.invalidSamples, IMAGE_INVALID_SAMPLES_FILE_PATH)))
+    {
+        return 1;
+    }
 
     std::cout << "Done! (" << stepTimer.getElapsedTime() << "s)\n\n";
 
     ////////////////////////////////////////////////////////////////////////////////
     std::cout << "All done! (" << globalTimer.getElapsedTime() << "s)" << std::endl;
 
-    return 0;
+    return (checkingSamples && invalidSampleCount > 0) ? 2 : 0;
 }
@@ -0,0 +1,159 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "mappedfile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace rts
+{
+    MappedFile::MappedFile()
+        : m_data(nullptr)
+        , m_size(0)
+#ifdef _WIN32
+        , m_fileHandle(INVALID_HANDLE_VALUE)
+        , m_mappingHandle(nullptr)
+#endif // _WIN32
+    {
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const std::string& filePath)
+    {
+        close();
+
+#ifdef _WIN32
+        m_fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_fileHandle, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+
+        m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle == nullptr)
+        {
+            close();
+            return false;
+        }
+
+        m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr)
+        {
+            close();
+            return false;
+        }
+        m_size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(filePath.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void* data = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping keeps its own reference to the file
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const unsigned char*>(data);
+        m_size = static_cast<std::size_t>(fileStat.st_size);
+#endif // _WIN32
+
+        return true;
+    }
+
+    void MappedFile::release(std::size_t offset, std::size_t size) const
+    {
+        if (m_data == nullptr || offset >= m_size)
+        {
+            return;
+        }
+        size = std::min(size, m_size - offset);
+
+#ifdef _WIN32
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        std::size_t pageSize = systemInfo.dwPageSize;
+#else
+        std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif // _WIN32
+        std::size_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+        std::size_t end = (offset + size) / pageSize * pageSize;
+        if (begin >= end)
+        {
+            return;
+        }
+
+#ifdef _WIN32
+        // Unlocking pages which aren't locked removes them from the working set of the process
+        VirtualUnlock(const_cast<unsigned char*>(m_data) + begin, end - begin);
+#else
+        madvise(const_cast<unsigned char*>(m_data) + begin, end - begin, MADV_DONTNEED);
+#endif // _WIN32
+    }
+
+    void MappedFile::close()
+    {
+#ifdef _WIN32
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mappingHandle != nullptr)
+        {
+            CloseHandle(m_mappingHandle);
+            m_mappingHandle = nullptr;
+        }
+        if (m_fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_fileHandle);
+            m_fileHandle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (m_data != nullptr)
+        {
+            munmap(const_cast<unsigned char*>(m_data), m_size);
+        }
+#endif // _WIN32
+
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
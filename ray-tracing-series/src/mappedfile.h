@@ -0,0 +1,49 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace rts // for ray tracing series
+{
+    // A read-only view of a whole file mapped in memory
+    // the pages are loaded lazily by the OS the first time they're accessed
+    class MappedFile final
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Map the given file, any previously mapped file is unmapped first
+        bool open(const std::string& filePath);
+        void close();
+
+        bool isOpen() const { return m_data != nullptr; }
+        const unsigned char* data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+
+        // Let the system reclaim the pages of the given range once they've been read, they're read from the file again if needed
+        // it keeps the memory of a process reading a file larger than memory bounded, only the pages entirely in the range are released
+        void release(std::size_t offset, std::size_t size) const;
+
+    private:
+        const unsigned char* m_data;
+        std::size_t m_size;
+
+#ifdef _WIN32
+        void* m_fileHandle;
+        void* m_mappingHandle;
+#endif // _WIN32
+    };
+}
@@ -22,5 +22,28 @@ namespace rts // for ray tracing series
         virtual ~Material() {}
 
         virtual bool scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const = 0;
+
+        // The color of the surface regardless of the lighting, it's written to the albedo image used by the denoiser
+        virtual vec3 getAlbedo(const HitRecord& rec) const = 0;
+
+        // The materials whose scattering can be evaluated for any pair of directions are lit by the environment map directly (see getColor)
+        // evaluate gives the light scattered from the direction towards the incoming ray, i.e. the BSDF times the cosine, per unit of light
+        // along with the density of sample picking that direction, it returns false when there's none, sample scatters the ray with
+        // a known density and the attenuation is then the scattered light over the density, a black attenuation means that the light is absorbed
+        // the ray tracer only calls them when the scene has an environment map, it calls scatter otherwise
+        virtual bool canEvaluate() const { return false; }
+        virtual bool evaluate(const Ray& /*rIn*/, const HitRecord& /*rec*/, const vec3& /*direction*/, vec3& /*value*/, float& /*pdf*/) const { return false; }
+        virtual bool sample(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, float& pdf, Random& random) const
+        {
+            pdf = 0.f;
+            return scatter(rIn, rec, attenuation, scattered, random);
+        }
+
+        // A dispersive material scatters each wavelength differently, the spectral mode traces its wavelengths separately (see raytracer.h)
+        // the scattering of a single wavelength in nanometers takes its random number from sample, which the wavelengths of a path share
+        // the other materials don't depend on the wavelength and aren't asked to scatter a single one
+        virtual bool isDispersive() const { return false; }
+        virtual bool scatterWavelength(const Ray& /*rIn*/, const HitRecord& /*rec*/, float /*wavelength*/, float /*sample*/, vec3& /*attenuation*/,
+            Ray& /*scattered*/) const { return false; }
     };
 }
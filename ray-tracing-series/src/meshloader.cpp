@@ -0,0 +1,503 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "meshloader.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include "utils.h"
+
+namespace rts
+{
+    namespace
+    {
+        // The indices of an OBJ face vertex, UINT32_MAX for a missing normal or texture coordinates
+        struct ObjVertexKey
+        {
+            std::uint32_t position;
+            std::uint32_t texCoord;
+            std::uint32_t normal;
+
+            bool operator==(const ObjVertexKey& other) const
+            {
+                return position == other.position && texCoord == other.texCoord && normal == other.normal;
+            }
+        };
+
+        struct ObjVertexKeyHash
+        {
+            std::size_t operator()(const ObjVertexKey& key) const
+            {
+                std::uint64_t hash = (static_cast<std::uint64_t>(key.normal) << 32) | key.position;
+                hash ^= static_cast<std::uint64_t>(key.texCoord) * 0x9E3779B97F4A7C15ull;
+                return static_cast<std::size_t>(hash ^ (hash >> 29));
+            }
+        };
+
+        // Parse an OBJ face vertex such as "v", "v/vt", "v//vn" or "v/vt/vn", the indices are 1-based or relative when negative
+        bool parseObjFaceVertex(const char*& cursor, std::size_t positionCount, std::size_t texCoordCount, std::size_t normalCount, ObjVertexKey& key)
+        {
+            auto resolve = [](long index, std::size_t count, std::uint32_t& result)
+            {
+                long resolved = (index < 0) ? static_cast<long>(count) + index : index - 1;
+                result = static_cast<std::uint32_t>(resolved);
+                return resolved >= 0 && static_cast<std::size_t>(resolved) < count;
+            };
+
+            char* end;
+            long index = std::strtol(cursor, &end, 10);
+            if (end == cursor || !resolve(index, positionCount, key.position))
+            {
+                return false;
+            }
+            cursor = end;
+
+            key.texCoord = UINT32_MAX;
+            key.normal = UINT32_MAX;
+            if (*cursor == '/')
+            {
+                ++cursor;
+                index = std::strtol(cursor, &end, 10);
+                if (end != cursor && !resolve(index, texCoordCount, key.texCoord))
+                {
+                    return false;
+                }
+                cursor = end;
+                if (*cursor == '/')
+                {
+                    ++cursor;
+                    index = std::strtol(cursor, &end, 10);
+                    if (end == cursor || !resolve(index, normalCount, key.normal))
+                    {
+                        return false;
+                    }
+                    cursor = end;
+                }
+            }
+            return true;
+        }
+
+        bool parseFloats(const char* cursor, float* values, int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                char* end;
+                values[i] = std::strtof(cursor, &end);
+                if (end == cursor)
+                {
+                    return false;
+                }
+                cursor = end;
+            }
+            return true;
+        }
+
+        enum class PlyType
+        {
+            Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid
+        };
+
+        struct PlyProperty
+        {
+            std::string name;
+            PlyType type;
+            PlyType countType; // only for the list properties
+            bool isList;
+        };
+
+        struct PlyElement
+        {
+            std::string name;
+            std::size_t count;
+            std::vector<PlyProperty> properties;
+        };
+
+        PlyType getPlyType(const std::string& name)
+        {
+            if (name == "char" || name == "int8") return PlyType::Int8;
+            if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+            if (name == "short" || name == "int16") return PlyType::Int16;
+            if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+            if (name == "int" || name == "int32") return PlyType::Int32;
+            if (name == "uint" || name == "uint32") return PlyType::UInt32;
+            if (name == "float" || name == "float32") return PlyType::Float32;
+            if (name == "double" || name == "float64") return PlyType::Float64;
+            return PlyType::Invalid;
+        }
+
+        template <typename T>
+        bool readBinaryValue(std::istream& is, double& value)
+        {
+            T binaryValue;
+            is.read(reinterpret_cast<char*>(&binaryValue), sizeof(binaryValue));
+            value = static_cast<double>(binaryValue);
+            return is.good();
+        }
+
+        // Read a single value, the binary values are little-endian as are the supported platforms
+        bool readPlyValue(std::istream& is, bool binary, PlyType type, double& value)
+        {
+            if (!binary)
+            {
+                return static_cast<bool>(is >> value);
+            }
+
+            switch (type)
+            {
+            case PlyType::Int8: return readBinaryValue<std::int8_t>(is, value);
+            case PlyType::UInt8: return readBinaryValue<std::uint8_t>(is, value);
+            case PlyType::Int16: return readBinaryValue<std::int16_t>(is, value);
+            case PlyType::UInt16: return readBinaryValue<std::uint16_t>(is, value);
+            case PlyType::Int32: return readBinaryValue<std::int32_t>(is, value);
+            case PlyType::UInt32: return readBinaryValue<std::uint32_t>(is, value);
+            case PlyType::Float32: return readBinaryValue<float>(is, value);
+            case PlyType::Float64: return readBinaryValue<double>(is, value);
+            default: return false;
+            }
+        }
+
+        // Split a polygon into a fan of triangles
+        void addPolygon(const std::vector<std::uint32_t>& polygon, std::vector<std::uint32_t>& indices)
+        {
+            for (std::size_t i = 2; i < polygon.size(); ++i)
+            {
+                indices.push_back(polygon[0]);
+                indices.push_back(polygon[i - 1]);
+                indices.push_back(polygon[i]);
+            }
+        }
+    }
+
+    bool loadObjFile(const std::string& filePath, TriangleMeshData& mesh)
+    {
+        std::ifstream file(filePath);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to open the mesh file " << filePath << std::endl;
+            return false;
+        }
+
+        mesh = TriangleMeshData();
+        mesh.hasNormals = true;
+
+        // The OBJ format indexes the positions, the texture coordinates and the normals separately,
+        // a vertex is created for each combination in use
+        std::vector<vec3> positions;
+        std::vector<vec3> normals;
+        std::vector<float> texCoords;
+        std::unordered_map<ObjVertexKey, std::uint32_t, ObjVertexKeyHash> vertexIndexes;
+        std::vector<std::uint32_t> polygon;
+        bool hasTexCoords = true;
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            ++lineNumber;
+            const char* cursor = line.c_str();
+            while (*cursor == ' ' || *cursor == '\t')
+            {
+                ++cursor;
+            }
+
+            bool valid = true;
+            if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+            {
+                float values[3];
+                valid = parseFloats(cursor + 1, values, 3);
+                positions.push_back(vec3(values[0], values[1], values[2]));
+            }
+            else if (cursor[0] == 'v' && cursor[1] == 'n')
+            {
+                float values[3];
+                valid = parseFloats(cursor + 2, values, 3);
+                normals.push_back(vec3(values[0], values[1], values[2]));
+            }
+            else if (cursor[0] == 'v' && cursor[1] == 't')
+            {
+                // The optional third coordinate is ignored
+                float values[2];
+                valid = parseFloats(cursor + 2, values, 2);
+                texCoords.insert(texCoords.end(), values, values + 2);
+            }
+            else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t'))
+            {
+                polygon.clear();
+                ++cursor;
+                for (;;)
+                {
+                    while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')
+                    {
+                        ++cursor;
+                    }
+                    if (*cursor == '\0')
+                    {
+                        break;
+                    }
+
+                    ObjVertexKey key;
+                    if (!parseObjFaceVertex(cursor, positions.size(), texCoords.size() / 2, normals.size(), key))
+                    {
+                        valid = false;
+                        break;
+                    }
+
+                    auto it = vertexIndexes.find(key);
+                    if (it == vertexIndexes.end())
+                    {
+                        const vec3& position = positions[key.position];
+                        MeshVertex vertex = { { position.x(), position.y(), position.z() }, { 0.f, 0.f, 0.f } };
+                        if (key.normal != UINT32_MAX)
+                        {
+                            vec3 n = unitVector(normals[key.normal]);
+                            vertex.normal[0] = n.x();
+                            vertex.normal[1] = n.y();
+                            vertex.normal[2] = n.z();
+                        }
+                        mesh.hasNormals = mesh.hasNormals && key.normal != UINT32_MAX;
+
+                        // The texture coordinates are only kept when every vertex has some
+                        hasTexCoords = hasTexCoords && key.texCoord != UINT32_MAX;
+                        if (hasTexCoords)
+                        {
+                            mesh.texCoords.push_back(texCoords[2 * key.texCoord]);
+                            mesh.texCoords.push_back(texCoords[2 * key.texCoord + 1]);
+                        }
+
+                        it = vertexIndexes.emplace(key, static_cast<std::uint32_t>(mesh.vertices.size())).first;
+                        mesh.vertices.push_back(vertex);
+                    }
+                    polygon.push_back(it->second);
+                }
+                addPolygon(polygon, mesh.indices);
+            }
+
+            // Everything else (groups, materials...) is ignored
+            if (!valid)
+            {
+                std::cerr << "Mesh file " << filePath << " line " << lineNumber << ": invalid statement" << std::endl;
+                return false;
+            }
+        }
+
+        mesh.hasNormals = mesh.hasNormals && !mesh.vertices.empty();
+        if (!hasTexCoords)
+        {
+            mesh.texCoords.clear();
+        }
+        return true;
+    }
+
+    bool loadPlyFile(const std::string& filePath, TriangleMeshData& mesh)
+    {
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to open the mesh file " << filePath << std::endl;
+            return false;
+        }
+
+        mesh = TriangleMeshData();
+
+        // Parse the header which describes the elements and their properties
+        std::vector<PlyElement> elements;
+        std::string line;
+        bool binary = false;
+        bool valid = std::getline(file, line) && line.compare(0, 3, "ply") == 0;
+        while (valid && std::getline(file, line))
+        {
+            std::istringstream is(line);
+            std::string keyword;
+            is >> keyword;
+            if (keyword == "format")
+            {
+                std::string format;
+                is >> format;
+                binary = (format == "binary_little_endian");
+                valid = binary || format == "ascii";
+            }
+            else if (keyword == "element")
+            {
+                PlyElement element;
+                valid = static_cast<bool>(is >> element.name >> element.count);
+                elements.push_back(element);
+            }
+            else if (keyword == "property")
+            {
+                PlyProperty property;
+                std::string type;
+                valid = !elements.empty() && (is >> type);
+                property.isList = (type == "list");
+                if (valid && property.isList)
+                {
+                    std::string countType;
+                    valid = static_cast<bool>(is >> countType >> type);
+                    property.countType = getPlyType(countType);
+                    valid = valid && property.countType != PlyType::Invalid;
+                }
+                property.type = getPlyType(type);
+                valid = valid && property.type != PlyType::Invalid && (is >> property.name);
+                if (valid)
+                {
+                    elements.back().properties.push_back(property);
+                }
+            }
+            else if (keyword == "end_header")
+            {
+                break;
+            }
+        }
+
+        // Read the elements, only the vertices and the faces are kept
+        bool hasNormals = false;
+        bool hasTexCoords = false;
+        std::vector<std::uint32_t> polygon;
+        for (const auto& element : elements)
+        {
+            bool isVertex = (element.name == "vertex");
+            bool isFace = (element.name == "face");
+            if (isVertex)
+            {
+                mesh.vertices.resize(element.count, { { 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f } });
+                for (const auto& property : element.properties)
+                {
+                    hasNormals = hasNormals || property.name == "nx";
+                    hasTexCoords = hasTexCoords || property.name == "u" || property.name == "s";
+                }
+                if (hasTexCoords)
+                {
+                    mesh.texCoords.resize(2 * element.count, 0.f);
+                }
+            }
+
+            for (std::size_t i = 0; valid && i < element.count; ++i)
+            {
+                for (const auto& property : element.properties)
+                {
+                    if (!property.isList)
+                    {
+                        double value;
+                        valid = readPlyValue(file, binary, property.type, value);
+                        if (valid && isVertex)
+                        {
+                            const char* names[] = { "x", "y", "z", "nx", "ny", "nz" };
+                            for (int j = 0; j < 6; ++j)
+                            {
+                                if (property.name == names[j])
+                                {
+                                    float* target = (j < 3) ? mesh.vertices[i].position : mesh.vertices[i].normal;
+                                    target[j % 3] = static_cast<float>(value);
+                                }
+                            }
+                            if (hasTexCoords && (property.name == "u" || property.name == "s"))
+                            {
+                                mesh.texCoords[2 * i] = static_cast<float>(value);
+                            }
+                            else if (hasTexCoords && (property.name == "v" || property.name == "t"))
+                            {
+                                mesh.texCoords[2 * i + 1] = static_cast<float>(value);
+                            }
+                        }
+                        continue;
+                    }
+
+                    double count;
+                    valid = readPlyValue(file, binary, property.countType, count);
+                    polygon.clear();
+                    for (int j = 0; valid && j < static_cast<int>(count); ++j)
+                    {
+                        double index;
+                        valid = readPlyValue(file, binary, property.type, index) && index >= 0.0 && index < static_cast<double>(mesh.vertices.size());
+                        polygon.push_back(static_cast<std::uint32_t>(index));
+                    }
+                    if (valid && isFace && (property.name == "vertex_indices" || property.name == "vertex_index"))
+                    {
+                        addPolygon(polygon, mesh.indices);
+                    }
+                }
+            }
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Invalid mesh file " << filePath << std::endl;
+            return false;
+        }
+
+        mesh.hasNormals = hasNormals;
+        if (hasNormals)
+        {
+            for (auto& vertex : mesh.vertices)
+            {
+                vec3 n = unitVector(vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]));
+                vertex.normal[0] = n.x();
+                vertex.normal[1] = n.y();
+                vertex.normal[2] = n.z();
+            }
+        }
+        return true;
+    }
+
+    bool loadMeshFile(const std::string& filePath, TriangleMeshData& mesh)
+    {
+        return endsWith(filePath, ".ply") ? loadPlyFile(filePath, mesh) : loadObjFile(filePath, mesh);
+    }
+
+    bool saveObjFile(const std::string& filePath, const MeshVertex* vertices, std::size_t vertexCount,
+        const std::uint32_t* indices, std::size_t triangleCount, bool hasNormals, const float* texCoords)
+    {
+        std::ofstream file(filePath);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to create the mesh file " << filePath << std::endl;
+            return false;
+        }
+
+        for (std::size_t i = 0; i < vertexCount; ++i)
+        {
+            const auto& v = vertices[i];
+            file << "v " << v.position[0] << " " << v.position[1] << " " << v.position[2] << "\n";
+            if (hasNormals)
+            {
+                file << "vn " << v.normal[0] << " " << v.normal[1] << " " << v.normal[2] << "\n";
+            }
+            if (texCoords != nullptr)
+            {
+                file << "vt " << texCoords[2 * i] << " " << texCoords[2 * i + 1] << "\n";
+            }
+        }
+
+        // The positions, the texture coordinates and the normals share the same indices
+        for (std::size_t i = 0; i < triangleCount; ++i)
+        {
+            file << "f";
+            for (int j = 0; j < 3; ++j)
+            {
+                std::uint32_t index = indices[3 * i + j] + 1;
+                file << " " << index;
+                if (texCoords != nullptr)
+                {
+                    file << "/" << index;
+                }
+                if (hasNormals)
+                {
+                    file << ((texCoords != nullptr) ? "/" : "//") << index;
+                }
+            }
+            file << "\n";
+        }
+
+        return file.good();
+    }
+}
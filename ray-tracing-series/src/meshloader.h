@@ -0,0 +1,43 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "trianglemesh.h"
+
+namespace rts // for ray tracing series
+{
+    // The content of a mesh file, the polygons are split into triangles
+    struct TriangleMeshData
+    {
+        std::vector<MeshVertex> vertices;
+        std::vector<std::uint32_t> indices; // 3 per triangle
+        std::vector<float> texCoords;       // 2 per vertex, empty when the mesh has none
+        bool hasNormals = false;
+    };
+
+    // Load a Wavefront OBJ file, only the positions, the normals, the texture coordinates and the faces are read (no materials)
+    bool loadObjFile(const std::string& filePath, TriangleMeshData& mesh);
+
+    // Load a PLY file in the ascii or the binary little-endian format, only the vertex positions, normals, texture coordinates
+    // (u and v, or s and t) and faces are read
+    bool loadPlyFile(const std::string& filePath, TriangleMeshData& mesh);
+
+    // Load a mesh file, the format is deduced from the extension (.ply for PLY, OBJ otherwise)
+    bool loadMeshFile(const std::string& filePath, TriangleMeshData& mesh);
+
+    // The texture coordinates are written when they aren't null, 2 per vertex
+    bool saveObjFile(const std::string& filePath, const MeshVertex* vertices, std::size_t vertexCount,
+        const std::uint32_t* indices, std::size_t triangleCount, bool hasNormals, const float* texCoords = nullptr);
+}
@@ -19,10 +19,10 @@ namespace rts
     {
         // Metallic scattering: determine a new target to bounce off the surface
         // the fuzziness adds some noise to the reflected vector
-        vec3 reflected = getReflectedVector(unitVector(rIn.direction()), rec.normal);
-        scattered = Ray(rec.p, reflected + m_fuzz * getRandomPointInUnitSphere(random));
+        vec3 reflected = getReflectedVector(rIn.direction(), rec.normal);
+        scattered = Ray(rec.p, reflected + m_fuzz * getRandomPointInUnitSphere(random), rIn.time());
 
-        attenuation = m_albedo;
+        attenuation = getAlbedo(rec);
 
         // Due to the fuzz factor or grazing rays we may scatter below the surface
         // in that case absorb the scattered ray by returning false
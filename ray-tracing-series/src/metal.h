@@ -12,6 +12,7 @@
 #include <algorithm>
 
 #include "material.h"
+#include "texture.h"
 #include "vec3.h"
 
 namespace rts // for ray tracing series
@@ -19,12 +20,15 @@ namespace rts // for ray tracing series
     class Metal final : public Material
     {
     public:
-        Metal(const vec3& albedo, float fuzz) : m_albedo(albedo), m_fuzz(std::min(fuzz, 1.f)) {}
+        // The texture, if any, modulates the albedo
+        Metal(const vec3& albedo, float fuzz, const Texture* texture = nullptr) : m_albedo(albedo), m_fuzz(std::min(fuzz, 1.f)), m_texture(texture) {}
 
         virtual bool scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const override;
+        virtual vec3 getAlbedo(const HitRecord& rec) const override { return (m_texture != nullptr) ? m_albedo * m_texture->value(rec) : m_albedo; }
 
     private:
         vec3 m_albedo;
         float m_fuzz;
+        const Texture* m_texture;
     };
 }
@@ -0,0 +1,114 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "microfacet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "defines.h"
+
+namespace rts
+{
+    namespace
+    {
+        const float PI = static_cast<float>(M_PI);
+        const float ALPHA_MIN = 0.001f;
+
+        // The ratio of the shadowed facets for the direction w, Lambda in the literature
+        float getGgxLambda(const vec3& w, float alpha)
+        {
+            float squaredCosine = w.z() * w.z();
+            if (squaredCosine <= 0.f)
+            {
+                return 1e8f;
+            }
+            float squaredTangent = std::max(1.f - squaredCosine, 0.f) / squaredCosine;
+            return 0.5f * (std::sqrt(1.f + alpha * alpha * squaredTangent) - 1.f);
+        }
+    }
+
+    SurfaceFrame::SurfaceFrame(const vec3& normal) : m_normal(normal)
+    {
+        float sign = std::copysign(1.f, normal.z());
+        float a = -1.f / (sign + normal.z());
+        float b = normal.x() * normal.y() * a;
+        m_tangent = vec3(1.f + sign * normal.x() * normal.x() * a, sign * b, -sign * normal.x());
+        m_bitangent = vec3(b, sign + normal.y() * normal.y() * a, -normal.y());
+    }
+
+    float getGgxAlpha(float roughness)
+    {
+        return std::min(std::max(roughness * roughness, ALPHA_MIN), 1.f);
+    }
+
+    float getGgxDistribution(const vec3& m, float alpha)
+    {
+        if (m.z() <= 0.f)
+        {
+            return 0.f;
+        }
+        float squaredAlpha = alpha * alpha;
+        float d = m.z() * m.z() * (squaredAlpha - 1.f) + 1.f;
+        return squaredAlpha / (PI * d * d);
+    }
+
+    float getGgxMasking(const vec3& w, float alpha)
+    {
+        return 1.f / (1.f + getGgxLambda(w, alpha));
+    }
+
+    float getGgxMaskingShadowing(const vec3& wo, const vec3& wi, float alpha)
+    {
+        return 1.f / (1.f + getGgxLambda(wo, alpha) + getGgxLambda(wi, alpha));
+    }
+
+    vec3 sampleGgxVisibleNormal(const vec3& wo, float alpha, float u1, float u2)
+    {
+        // Stretch the view to the configuration of a unit roughness, where the visible normals project to a disk
+        vec3 view = unitVector(vec3(alpha * wo.x(), alpha * wo.y(), wo.z()));
+        float squaredLength = view.x() * view.x() + view.y() * view.y();
+        vec3 t1 = (squaredLength > 0.f) ? vec3(-view.y(), view.x(), 0.f) / std::sqrt(squaredLength) : vec3(1.f, 0.f, 0.f);
+        vec3 t2 = cross(view, t1);
+
+        // A point of the disk, the half of it hidden by the view is squeezed onto the visible projection
+        float r = std::sqrt(u1);
+        float phi = 2.f * PI * u2;
+        float p1 = r * std::cos(phi);
+        float p2 = r * std::sin(phi);
+        float s = 0.5f * (1.f + view.z());
+        p2 = (1.f - s) * std::sqrt(std::max(1.f - p1 * p1, 0.f)) + s * p2;
+
+        // Lift it onto the hemisphere and unstretch the normal
+        vec3 normal = p1 * t1 + p2 * t2 + std::sqrt(std::max(1.f - p1 * p1 - p2 * p2, 0.f)) * view;
+        return unitVector(vec3(alpha * normal.x(), alpha * normal.y(), std::max(normal.z(), 1e-6f)));
+    }
+
+    float getGgxVisibleNormalPdf(const vec3& wo, const vec3& m, float alpha)
+    {
+        if (wo.z() <= 0.f)
+        {
+            return 0.f;
+        }
+        return getGgxMasking(wo, alpha) * std::max(dot(wo, m), 0.f) * getGgxDistribution(m, alpha) / wo.z();
+    }
+
+    float getDielectricFresnel(float cosine, float eta)
+    {
+        float squaredSine = std::max(1.f - cosine * cosine, 0.f) / (eta * eta);
+        if (squaredSine >= 1.f)
+        {
+            return 1.f;
+        }
+        float cosineT = std::sqrt(1.f - squaredSine);
+        float rs = (cosine - eta * cosineT) / (cosine + eta * cosineT);
+        float rp = (eta * cosine - cosineT) / (eta * cosine + cosineT);
+        return 0.5f * (rs * rs + rp * rp);
+    }
+}
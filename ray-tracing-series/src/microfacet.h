@@ -0,0 +1,57 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // The GGX distribution of microfacet normals shared by the rough materials (Walter et al., Microfacet Models for Refraction
+    // through Rough Surfaces), the directions are given in the frame of the surface where the normal is the z axis
+    // and the normals are sampled among the ones visible from the outgoing direction (Heitz, Sampling the GGX Distribution
+    // of Visible Normals), which never picks a facet facing away from the ray and keeps the weight of the samples close to 1
+
+    // The frame of a surface around its unit normal (Duff et al., Building an Orthonormal Basis, Revisited)
+    class SurfaceFrame final
+    {
+    public:
+        explicit SurfaceFrame(const vec3& normal);
+
+        vec3 toLocal(const vec3& v) const { return vec3(dot(v, m_tangent), dot(v, m_bitangent), dot(v, m_normal)); }
+        vec3 toWorld(const vec3& v) const { return v.x() * m_tangent + v.y() * m_bitangent + v.z() * m_normal; }
+
+    private:
+        vec3 m_tangent;
+        vec3 m_bitangent;
+        vec3 m_normal;
+    };
+
+    // The width of the distribution for a perceptual roughness in [0, 1], it's kept above a mirror for the densities to stay finite
+    float getGgxAlpha(float roughness);
+
+    // The density of the normal m over the solid angle, projected onto the surface
+    float getGgxDistribution(const vec3& m, float alpha);
+
+    // Smith's masking of the direction w, the fraction of the facets visible from it
+    float getGgxMasking(const vec3& w, float alpha);
+
+    // The masking and the shadowing of a pair of directions, with the correlation of their heights
+    float getGgxMaskingShadowing(const vec3& wo, const vec3& wi, float alpha);
+
+    // Sample a visible normal from the outgoing direction wo above the surface and two random numbers in [0, 1)
+    vec3 sampleGgxVisibleNormal(const vec3& wo, float alpha, float u1, float u2);
+
+    // The density of sampleGgxVisibleNormal picking the normal m
+    float getGgxVisibleNormalPdf(const vec3& wo, const vec3& m, float alpha);
+
+    // The Fresnel reflectance of a dielectric for the cosine of the incident angle with the facet, eta is the refraction index
+    // of the other side over the one of the incident side, it's 1 in case of total internal reflection
+    float getDielectricFresnel(float cosine, float eta);
+}
@@ -0,0 +1,44 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "movingsphere.h"
+
+#include <cmath>
+
+#include "aabb.h"
+#include "ray.h"
+#include "sphere.h"
+
+namespace rts
+{
+    bool MovingSphere::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        vec3 center = getCenter(r.time());
+        float t;
+        if (Sphere::intersect(center, m_radiusSquared, r, tMin, tMax, t))
+        {
+            rec.t = t;
+            rec.p = r.pointAtParameter(rec.t);
+            rec.normal = (rec.p - center) * m_inverseRadius;
+            rec.matPtr = m_material.get();
+            Sphere::setTextureCoordinates(rec, m_radius);
+            return true;
+        }
+        return false;
+    }
+
+    bool MovingSphere::boundingBox(Aabb& box) const
+    {
+        float radius = std::fabs(m_radius);
+        vec3 extent(radius, radius, radius);
+        box = Aabb(m_center0 - extent, m_center0 + extent);
+        box.expand(Aabb(m_center1 - extent, m_center1 + extent));
+        return true;
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "hitable.h"
+
+namespace rts // for ray tracing series
+{
+    // A sphere moving linearly from center0 at time0 to center1 at time1, its position is extrapolated outside of this interval
+    class MovingSphere final : public Hitable
+    {
+    public:
+        MovingSphere(vec3 center0, vec3 center1, float time0, float time1, float radius, std::shared_ptr<Material> material)
+            : m_center0(center0)
+            , m_center1(center1)
+            , m_time0(time0)
+            , m_time1(time1)
+            , m_radius(radius)
+            , m_radiusSquared(radius * radius)
+            , m_inverseRadius(1.f / radius)
+            , m_material(material)
+        {
+        }
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+
+        // The bounds cover the motion between time0 and time1
+        virtual bool boundingBox(Aabb& box) const override;
+
+        vec3 getCenter(float time) const { return getCenter(m_center0, m_center1, m_time0, m_time1, time); }
+
+        // Compute the center at the given time, it's shared with the hitables storing their spheres in a compact form (see MovingSphereSet)
+        static vec3 getCenter(const vec3& center0, const vec3& center1, float time0, float time1, float time)
+        {
+            return (time1 > time0) ? center0 + ((time - time0) / (time1 - time0)) * (center1 - center0) : center0;
+        }
+
+    private:
+        vec3 m_center0;
+        vec3 m_center1;
+        float m_time0;
+        float m_time1;
+        float m_radius;
+        float m_radiusSquared;  // for the intersection
+        float m_inverseRadius;  // for the normal, negative as well for a hollow sphere
+        std::shared_ptr<Material> m_material;
+    };
+}
@@ -0,0 +1,89 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "movingsphereset.h"
+
+#include <cmath>
+
+#include "material.h"
+#include "movingsphere.h"
+#include "ray.h"
+#include "sphere.h"
+
+namespace rts
+{
+    namespace
+    {
+        vec3 getCenter(const MovingSphereRecord& sphere, float time)
+        {
+            return MovingSphere::getCenter(vec3(sphere.center0[0], sphere.center0[1], sphere.center0[2]),
+                vec3(sphere.center1[0], sphere.center1[1], sphere.center1[2]), sphere.time0, sphere.time1, time);
+        }
+    }
+
+    MovingSphereSet::MovingSphereSet(const MovingSphereRecord* spheres, std::size_t sphereCount, const std::vector<std::unique_ptr<Material>>& materials,
+        float shutterOpen, float shutterClose, BvhBuildMethod buildMethod, ThreadPool* pool)
+        : m_spheres(spheres)
+        , m_sphereCount(sphereCount)
+        , m_materials(materials)
+    {
+        // The motion is linear so the bounds at the shutter times are enough to bound the spheres in between
+        std::vector<Aabb> boundsAtOpen(sphereCount);
+        std::vector<Aabb> boundsAtClose(sphereCount);
+        m_radiusTerms.resize(sphereCount);
+        for (std::size_t i = 0; i < sphereCount; ++i)
+        {
+            m_radiusTerms[i] = makeSphereRadiusTerms(spheres[i].radius);
+            float radius = std::fabs(spheres[i].radius);
+            vec3 extent(radius, radius, radius);
+            vec3 centerAtOpen = getCenter(spheres[i], shutterOpen);
+            vec3 centerAtClose = getCenter(spheres[i], shutterClose);
+            boundsAtOpen[i] = Aabb(centerAtOpen - extent, centerAtOpen + extent);
+            boundsAtClose[i] = Aabb(centerAtClose - extent, centerAtClose + extent);
+        }
+        m_bvh.buildWithMotion(boundsAtOpen, boundsAtClose, shutterOpen, shutterClose, buildMethod, pool);
+    }
+
+    bool MovingSphereSet::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        const MovingSphereRecord* closest = nullptr;
+        std::uint32_t closestIndex = 0;
+        float closestSoFar = tMax;
+
+        m_bvh.intersect(r, tMin, closestSoFar, [&](std::uint32_t index, float tMinPrimitive, float tMaxPrimitive, float& t)
+        {
+            const MovingSphereRecord& sphere = m_spheres[index];
+            if (Sphere::intersect(getCenter(sphere, r.time()), m_radiusTerms[index].radiusSquared, r, tMinPrimitive, tMaxPrimitive, t))
+            {
+                closest = &sphere;
+                closestIndex = index;
+                return true;
+            }
+            return false;
+        });
+
+        if (closest == nullptr)
+        {
+            return false;
+        }
+
+        rec.t = closestSoFar;
+        rec.p = r.pointAtParameter(rec.t);
+        rec.normal = (rec.p - getCenter(*closest, r.time())) * m_radiusTerms[closestIndex].inverseRadius;
+        rec.matPtr = m_materials[closest->materialIndex].get();
+        Sphere::setTextureCoordinates(rec, closest->radius);
+        return true;
+    }
+
+    bool MovingSphereSet::boundingBox(Aabb& box) const
+    {
+        box = m_bvh.getBounds();
+        return !box.isEmpty();
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bvh.h"
+#include "hitable.h"
+#include "sphere.h"
+
+namespace rts // for ray tracing series
+{
+    // The compact description of a moving sphere (see MovingSphere), it's also the layout used by the binary scene files
+    struct MovingSphereRecord
+    {
+        float center0[3];
+        float center1[3];
+        float time0;
+        float time1;
+        float radius;
+        std::uint32_t materialIndex;
+    };
+
+    // A set of moving spheres stored contiguously, the counterpart of SphereSet
+    // the BVH bounds the spheres at both ends of the shutter interval and interpolates them at the time of each ray
+    // so that the nodes remain nearly as tight as in the static case
+    class MovingSphereSet final : public Hitable
+    {
+    public:
+        MovingSphereSet(const MovingSphereRecord* spheres, std::size_t sphereCount, const std::vector<std::unique_ptr<Material>>& materials,
+            float shutterOpen, float shutterClose, BvhBuildMethod buildMethod, ThreadPool* pool);
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
+
+        const Bvh& getBvh() const { return m_bvh; }
+        std::size_t getMemoryUsage() const { return m_radiusTerms.size() * sizeof(SphereRadiusTerms) + m_bvh.getMemoryUsage(); }
+
+    private:
+        const MovingSphereRecord* m_spheres;
+        std::size_t m_sphereCount;
+        std::vector<SphereRadiusTerms> m_radiusTerms;   // in the order of the records, see SphereSet
+        const std::vector<std::unique_ptr<Material>>& m_materials;
+        Bvh m_bvh;
+    };
+}
@@ -0,0 +1,192 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "numa.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "defines.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <cstdlib>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#endif // _WIN32, __linux__
+
+namespace rts
+{
+    namespace
+    {
+#ifdef _WIN32
+        // Windows keeps each node within a single processor group of 64 CPUs at most
+        const unsigned int CPUS_PER_GROUP = 64;
+
+        std::vector<NumaNode> detectNumaNodes()
+        {
+            std::vector<NumaNode> nodes;
+            ULONG highestNode = 0;
+            if (GetNumaHighestNodeNumber(&highestNode))
+            {
+                for (ULONG id = 0; id <= highestNode; ++id)
+                {
+                    GROUP_AFFINITY affinity;
+                    if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(id), &affinity))
+                    {
+                        continue;
+                    }
+                    NumaNode node = { static_cast<unsigned int>(id), {} };
+                    for (unsigned int bit = 0; bit < CPUS_PER_GROUP; ++bit)
+                    {
+                        if ((affinity.Mask >> bit) & 1)
+                        {
+                            node.cpus.push_back(affinity.Group * CPUS_PER_GROUP + bit);
+                        }
+                    }
+                    if (!node.cpus.empty())
+                    {
+                        nodes.push_back(node);
+                    }
+                }
+            }
+            return nodes;
+        }
+#elif defined(__linux__)
+        // Parse a list of CPUs such as 0-3,8-11 as found in sysfs, a malformed list is ignored
+        std::vector<unsigned int> parseCpuList(const std::string& list)
+        {
+            std::vector<unsigned int> cpus;
+            const char* text = list.c_str();
+            while (*text != '\0')
+            {
+                char* end;
+                unsigned long first = std::strtoul(text, &end, 10);
+                unsigned long last = first;
+                if (end == text)
+                {
+                    return {};
+                }
+                if (*end == '-')
+                {
+                    text = end + 1;
+                    last = std::strtoul(text, &end, 10);
+                    if (end == text || last < first)
+                    {
+                        return {};
+                    }
+                }
+                for (unsigned long cpu = first; cpu <= last; ++cpu)
+                {
+                    cpus.push_back(static_cast<unsigned int>(cpu));
+                }
+                if (*end != ',')
+                {
+                    return (*end == '\0' || *end == '\n') ? cpus : std::vector<unsigned int>();
+                }
+                text = end + 1;
+            }
+            return cpus;
+        }
+
+        std::vector<NumaNode> detectNumaNodes()
+        {
+            // The CPUs of the nodes are filtered by the affinity of the process, which a container or taskset may restrict
+            cpu_set_t allowedCpus;
+            bool hasAffinity = sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus) == 0;
+
+            std::vector<NumaNode> nodes;
+            std::string possibleNodes;
+            std::ifstream possibleFile("/sys/devices/system/node/possible");
+            if (!std::getline(possibleFile, possibleNodes))
+            {
+                return nodes;
+            }
+            for (unsigned int id : parseCpuList(possibleNodes))
+            {
+                std::ifstream cpuListFile("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+                std::string cpuList;
+                if (!std::getline(cpuListFile, cpuList))
+                {
+                    continue;
+                }
+                NumaNode node = { id, {} };
+                for (unsigned int cpu : parseCpuList(cpuList))
+                {
+                    if (!hasAffinity || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowedCpus)))
+                    {
+                        node.cpus.push_back(cpu);
+                    }
+                }
+                if (!node.cpus.empty())
+                {
+                    nodes.push_back(node);
+                }
+            }
+            return nodes;
+        }
+#else
+        std::vector<NumaNode> detectNumaNodes()
+        {
+            return {};
+        }
+#endif // _WIN32, __linux__
+    }
+
+    const std::vector<NumaNode>& getNumaNodes()
+    {
+        static const std::vector<NumaNode> nodes = []()
+        {
+            std::vector<NumaNode> detectedNodes = detectNumaNodes();
+            if (detectedNodes.empty())
+            {
+                NumaNode node = { 0, {} };
+                for (unsigned int cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu)
+                {
+                    node.cpus.push_back(cpu);
+                }
+                detectedNodes.push_back(node);
+            }
+            return detectedNodes;
+        }();
+        return nodes;
+    }
+
+    bool pinThreadToNumaNode(const NumaNode& node)
+    {
+#ifdef _WIN32
+        GROUP_AFFINITY affinity = {};
+        for (unsigned int cpu : node.cpus)
+        {
+            affinity.Group = static_cast<WORD>(cpu / CPUS_PER_GROUP);
+            affinity.Mask |= KAFFINITY(1) << (cpu % CPUS_PER_GROUP);
+        }
+        return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (unsigned int cpu : node.cpus)
+        {
+            if (cpu < CPU_SETSIZE)
+            {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+        RTS_UNUSED(node);
+        return false;
+#endif // _WIN32, __linux__
+    }
+}
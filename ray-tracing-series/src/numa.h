@@ -0,0 +1,30 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace rts // for ray tracing series
+{
+    // A NUMA node and the CPUs of the node which the process is allowed to run on
+    struct NumaNode
+    {
+        unsigned int id;
+        std::vector<unsigned int> cpus;
+    };
+
+    // The NUMA nodes of the machine, detected once, the nodes without any allowed CPU are left out
+    // when the topology is unknown it's a single node holding all the CPUs
+    const std::vector<NumaNode>& getNumaNodes();
+
+    // Restrict the calling thread to the CPUs of the node, the OS still balances the thread between them
+    // return false if the thread couldn't be pinned
+    bool pinThreadToNumaNode(const NumaNode& node);
+}
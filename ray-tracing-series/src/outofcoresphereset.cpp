@@ -0,0 +1,401 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+
+#include "outofcoresphereset.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "material.h"
+#include "ray.h"
+
+namespace rts
+{
+    namespace
+    {
+        const char BRICK_FILE_MAGIC[4] = { 'R', 'T', 'S', 'K' };
+        const std::uint32_t BRICK_FILE_VERSION = 1;
+        const std::uint64_t BRICK_FILE_ALIGNMENT = 16;
+
+        // The header of a brick file, the brick table follows the data of the bricks
+        struct BrickFileHeader
+        {
+            char magic[4];
+            std::uint32_t version;
+            std::uint64_t sphereCount;
+            std::uint32_t brickCount;
+            std::uint32_t materialCount;    // one more than the highest material index
+            std::uint64_t brickOffset;
+        };
+
+        struct MortonKey
+        {
+            std::uint32_t code;
+            std::uint32_t sphereIndex;
+        };
+
+        std::uint64_t alignOffset(std::uint64_t offset)
+        {
+            return (offset + BRICK_FILE_ALIGNMENT - 1) / BRICK_FILE_ALIGNMENT * BRICK_FILE_ALIGNMENT;
+        }
+
+        bool isArrayInFile(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t fileSize)
+        {
+            return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+        }
+    }
+
+    bool saveSphereBricks(const std::string& filePath, const SphereRecord* spheres, std::size_t sphereCount, std::size_t brickSphereCount,
+        ThreadPool* pool)
+    {
+        if (sphereCount > 0xFFFFFFFF || brickSphereCount == 0 || brickSphereCount > CompressedBvh::MAX_PRIMITIVE_COUNT)
+        {
+            std::cerr << "Unable to split " << sphereCount << " spheres in bricks of " << brickSphereCount << " spheres" << std::endl;
+            return false;
+        }
+
+        std::ofstream file(filePath, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to create the brick file " << filePath << std::endl;
+            return false;
+        }
+
+        // Sort the spheres along a Morton curve over their centers, the consecutive runs of the curve make compact bricks
+        Aabb centerBounds;
+        std::uint32_t materialCount = 0;
+        for (std::size_t i = 0; i < sphereCount; ++i)
+        {
+            centerBounds.expand(vec3(spheres[i].center[0], spheres[i].center[1], spheres[i].center[2]));
+            materialCount = std::max(materialCount, spheres[i].materialIndex + 1);
+        }
+        vec3 extent = centerBounds.max() - centerBounds.min();
+        vec3 scale(extent.x() > 0.f ? 1.f / extent.x() : 0.f, extent.y() > 0.f ? 1.f / extent.y() : 0.f, extent.z() > 0.f ? 1.f / extent.z() : 0.f);
+        std::vector<MortonKey> keys(sphereCount);
+        for (std::size_t i = 0; i < sphereCount; ++i)
+        {
+            vec3 center(spheres[i].center[0], spheres[i].center[1], spheres[i].center[2]);
+            keys[i] = { getMortonCode((center - centerBounds.min()) * scale), static_cast<std::uint32_t>(i) };
+        }
+        std::sort(keys.begin(), keys.end(), [](const MortonKey& a, const MortonKey& b)
+        {
+            return a.code < b.code || (a.code == b.code && a.sphereIndex < b.sphereIndex);
+        });
+
+        BrickFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, BRICK_FILE_MAGIC, sizeof(BRICK_FILE_MAGIC));
+        header.version = BRICK_FILE_VERSION;
+        header.sphereCount = sphereCount;
+        header.materialCount = materialCount;
+
+        const char padding[BRICK_FILE_ALIGNMENT] = {};
+        std::uint64_t position = 0;
+        auto writeArray = [&file, &padding, &position](std::uint64_t offset, const void* data, std::uint64_t size)
+        {
+            file.write(padding, offset - position);
+            file.write(static_cast<const char*>(data), size);
+            position = offset + size;
+        };
+        writeArray(0, &header, sizeof(header));
+
+        // Each brick is built as a compressed set whose arrays are written as they are, the materials aren't needed for that
+        const std::vector<std::unique_ptr<Material>> noMaterials;
+        std::vector<SphereBrickRecord> bricks;
+        std::vector<SphereRecord> brickSpheres;
+        for (std::size_t begin = 0; begin < sphereCount && file.good(); begin += brickSphereCount)
+        {
+            std::size_t end = std::min(begin + brickSphereCount, sphereCount);
+            brickSpheres.clear();
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                brickSpheres.push_back(spheres[keys[i].sphereIndex]);
+            }
+            CompressedSphereSet brick(brickSpheres.data(), brickSpheres.size(), noMaterials, BvhBuildMethod::BinnedSah, pool);
+
+            const CompressedBvh& bvh = brick.getBvh();
+            Aabb bounds = bvh.getBounds();
+            SphereBrickRecord record;
+            std::memset(&record, 0, sizeof(record));
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                record.boundsMin[axis] = bounds.min()[axis];
+                record.boundsMax[axis] = bounds.max()[axis];
+            }
+            record.sphereCount = static_cast<std::uint32_t>(brick.getSpheres().size());
+            record.nodeCount = static_cast<std::uint32_t>(bvh.getNodeCount());
+            record.root = bvh.getRoot();
+            record.sphereOffset = alignOffset(position);
+            writeArray(record.sphereOffset, brick.getSpheres().data(), record.sphereCount * sizeof(CompactSphere));
+            record.materialOffset = alignOffset(position);
+            writeArray(record.materialOffset, brick.getMaterialIndices().data(), record.sphereCount * sizeof(std::uint32_t));
+            record.nodeOffset = alignOffset(position);
+            writeArray(record.nodeOffset, bvh.getNodes().data(), record.nodeCount * sizeof(CompressedBvhNode));
+            bricks.push_back(record);
+        }
+
+        // The table is written last, once the size of every brick is known
+        header.brickCount = static_cast<std::uint32_t>(bricks.size());
+        header.brickOffset = alignOffset(position);
+        writeArray(header.brickOffset, bricks.data(), bricks.size() * sizeof(SphereBrickRecord));
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        if (!file.good())
+        {
+            std::cerr << "Unable to write the brick file " << filePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    OutOfCoreSphereSet::OutOfCoreSphereSet(const std::vector<std::unique_ptr<Material>>& materials, std::size_t cacheSize)
+        : m_materials(materials)
+        , m_cacheSize(cacheSize)
+        , m_sphereCount(0)
+        , m_materialCount(0)
+        , m_cacheStats()
+    {
+    }
+
+    bool OutOfCoreSphereSet::open(const std::string& filePath)
+    {
+        m_bricks.clear();
+        m_cacheEntries.clear();
+        m_cacheOrder.clear();
+        m_cacheStats = BrickCacheStats();
+        m_sphereCount = 0;
+        m_materialCount = 0;
+        if (!m_file.open(filePath))
+        {
+            std::cerr << "Unable to open the brick file " << filePath << std::endl;
+            return false;
+        }
+
+        // Validate the header and the arrays of every brick against the size of the file, the bricks are checked further when loaded
+        BrickFileHeader header;
+        std::size_t fileSize = m_file.size();
+        bool valid = fileSize >= sizeof(header);
+        if (valid)
+        {
+            std::memcpy(&header, m_file.data(), sizeof(header));
+            valid = std::memcmp(header.magic, BRICK_FILE_MAGIC, sizeof(BRICK_FILE_MAGIC)) == 0
+                && header.version == BRICK_FILE_VERSION
+                && isArrayInFile(header.brickOffset, header.brickCount, sizeof(SphereBrickRecord), fileSize);
+        }
+        if (valid)
+        {
+            m_bricks.resize(header.brickCount);
+            std::memcpy(m_bricks.data(), m_file.data() + header.brickOffset, m_bricks.size() * sizeof(SphereBrickRecord));
+        }
+        std::uint64_t sphereCount = 0;
+        for (const auto& brick : m_bricks)
+        {
+            valid = valid && brick.sphereCount <= CompressedBvh::MAX_PRIMITIVE_COUNT
+                && isArrayInFile(brick.sphereOffset, brick.sphereCount, sizeof(CompactSphere), fileSize)
+                && isArrayInFile(brick.materialOffset, brick.sphereCount, sizeof(std::uint32_t), fileSize)
+                && isArrayInFile(brick.nodeOffset, brick.nodeCount, sizeof(CompressedBvhNode), fileSize)
+                && brick.nodeOffset % alignof(CompressedBvhNode) == 0; // the nodes are read in place
+            sphereCount += brick.sphereCount;
+        }
+        if (!valid || sphereCount != header.sphereCount)
+        {
+            std::cerr << "Invalid brick file " << filePath << std::endl;
+            m_bricks.clear();
+            m_file.close();
+            return false;
+        }
+
+        // The top level is small, a brick of a scene larger than memory holds tens of thousands of spheres
+        std::vector<Aabb> bounds;
+        bounds.reserve(m_bricks.size());
+        for (const auto& brick : m_bricks)
+        {
+            bounds.push_back(Aabb(vec3(brick.boundsMin[0], brick.boundsMin[1], brick.boundsMin[2]), vec3(brick.boundsMax[0], brick.boundsMax[1], brick.boundsMax[2])));
+        }
+        m_bvh.build(bounds, BvhBuildMethod::BinnedSah, nullptr);
+
+        m_filePath = filePath;
+        m_sphereCount = static_cast<std::size_t>(header.sphereCount);
+        m_materialCount = header.materialCount;
+        m_cacheEntries.assign(m_bricks.size(), { nullptr, m_cacheOrder.end(), false });
+        return true;
+    }
+
+    std::shared_ptr<const CompressedSphereSet> OutOfCoreSphereSet::loadBrick(std::uint32_t brickIndex) const
+    {
+        const SphereBrickRecord& record = m_bricks[brickIndex];
+        std::vector<CompactSphere> spheres(record.sphereCount);
+        std::vector<std::uint32_t> materialIndices(record.sphereCount);
+        std::memcpy(spheres.data(), m_file.data() + record.sphereOffset, spheres.size() * sizeof(CompactSphere));
+        std::memcpy(materialIndices.data(), m_file.data() + record.materialOffset, materialIndices.size() * sizeof(std::uint32_t));
+
+        CompressedBvh bvh;
+        Aabb bounds(vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]), vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]));
+        bool valid = bvh.load(reinterpret_cast<const CompressedBvhNode*>(m_file.data() + record.nodeOffset), record.nodeCount, record.root,
+            bounds, record.sphereCount);
+        for (std::uint32_t materialIndex : materialIndices)
+        {
+            valid = valid && materialIndex < m_materials.size();
+        }
+
+        // The copy is all that's read from now on, the mapped pages would otherwise add up to the whole file
+        m_file.release(static_cast<std::size_t>(record.sphereOffset),
+            static_cast<std::size_t>(record.nodeOffset + record.nodeCount * sizeof(CompressedBvhNode) - record.sphereOffset));
+        if (!valid)
+        {
+            return nullptr;
+        }
+        return std::make_shared<const CompressedSphereSet>(std::move(spheres), std::move(materialIndices), std::move(bvh), m_materials);
+    }
+
+    std::shared_ptr<const CompressedSphereSet> OutOfCoreSphereSet::acquireBrick(std::uint32_t brickIndex) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_cacheMutex);
+            CacheEntry& entry = m_cacheEntries[brickIndex];
+            if (entry.brick)
+            {
+                m_cacheOrder.splice(m_cacheOrder.begin(), m_cacheOrder, entry.position);
+                return entry.brick;
+            }
+            if (entry.invalid)
+            {
+                return nullptr;
+            }
+        }
+
+        // The bricks are loaded outside of the lock so that the threads can load different bricks at the same time
+        auto brick = loadBrick(brickIndex);
+
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        CacheEntry& entry = m_cacheEntries[brickIndex];
+        ++m_cacheStats.loadCount;
+        if (entry.brick)
+        {
+            // Another thread has loaded it in the meantime
+            m_cacheOrder.splice(m_cacheOrder.begin(), m_cacheOrder, entry.position);
+            return entry.brick;
+        }
+        if (!brick)
+        {
+            if (!entry.invalid)
+            {
+                std::cerr << "Invalid brick " << brickIndex << " in the brick file " << m_filePath << ", it's ignored" << std::endl;
+                entry.invalid = true;
+            }
+            return nullptr;
+        }
+
+        entry.brick = brick;
+        m_cacheOrder.push_front(brickIndex);
+        entry.position = m_cacheOrder.begin();
+        m_cacheStats.residentSize += brick->getMemoryUsage();
+
+        // Evict the least recently used bricks, at least the brick which has just been loaded stays
+        while (m_cacheStats.residentSize > m_cacheSize && m_cacheOrder.size() > 1)
+        {
+            CacheEntry& evicted = m_cacheEntries[m_cacheOrder.back()];
+            m_cacheStats.residentSize -= evicted.brick->getMemoryUsage();
+            evicted.brick.reset();
+            m_cacheOrder.pop_back();
+            ++m_cacheStats.evictionCount;
+        }
+        return brick;
+    }
+
+    bool OutOfCoreSphereSet::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        bool hitAnything = false;
+        m_bvh.intersect(r, tMin, tMax, [&](std::uint32_t brickIndex, float tMinBrick, float tMaxBrick, float& t)
+        {
+            // A leaf of the top level holds several bricks, only the ones actually reached by the ray are loaded
+            const SphereBrickRecord& record = m_bricks[brickIndex];
+            if (intersectBox(record.boundsMin, record.boundsMax, r, tMinBrick, tMaxBrick) < 0.f)
+            {
+                return false;
+            }
+
+            auto brick = acquireBrick(brickIndex);
+            if (brick && brick->hit(r, tMinBrick, tMaxBrick, rec))
+            {
+                t = rec.t;
+                hitAnything = true;
+                return true;
+            }
+            return false;
+        });
+        return hitAnything;
+    }
+
+    void OutOfCoreSphereSet::hitBatch(const std::vector<Ray>& rays, float tMin, float tMax, std::vector<HitRecord>& records) const
+    {
+        // Queue each ray on every brick it crosses, along with the distance at which it enters the brick
+        struct QueuedRay
+        {
+            std::uint32_t rayIndex;
+            float distance;
+        };
+        std::vector<std::vector<QueuedRay>> queues(m_bricks.size());
+        for (std::size_t i = 0; i < rays.size(); ++i)
+        {
+            float rayTMax = tMax;
+            m_bvh.intersect(rays[i], tMin, rayTMax, [&](std::uint32_t brickIndex, float tMinBrick, float tMaxBrick, float&)
+            {
+                const SphereBrickRecord& record = m_bricks[brickIndex];
+                float distance = intersectBox(record.boundsMin, record.boundsMax, rays[i], tMinBrick, tMaxBrick);
+                if (distance >= 0.f)
+                {
+                    queues[brickIndex].push_back({ static_cast<std::uint32_t>(i), distance });
+                }
+                return false;
+            });
+        }
+
+        // Then go through the bricks in the order of the file, which follows the Morton curve, and load each one once for all its rays
+        // a ray skips the bricks it enters beyond its closest hit so far
+        records.assign(rays.size(), HitRecord()); // value-initialized, with a null material
+        std::vector<float> closest(rays.size(), tMax);
+        for (std::uint32_t brickIndex = 0; brickIndex < queues.size(); ++brickIndex)
+        {
+            std::vector<QueuedRay>& queue = queues[brickIndex];
+            if (queue.empty())
+            {
+                continue;
+            }
+
+            auto brick = acquireBrick(brickIndex);
+            for (const auto& queuedRay : queue)
+            {
+                std::uint32_t i = queuedRay.rayIndex;
+                if (brick && queuedRay.distance <= closest[i] && brick->hit(rays[i], tMin, closest[i], records[i]))
+                {
+                    closest[i] = records[i].t;
+                }
+            }
+            std::vector<QueuedRay>().swap(queue);
+        }
+    }
+
+    bool OutOfCoreSphereSet::boundingBox(Aabb& box) const
+    {
+        box = m_bvh.getBounds();
+        return !box.isEmpty();
+    }
+
+    BrickCacheStats OutOfCoreSphereSet::getCacheStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        return m_cacheStats;
+    }
+}
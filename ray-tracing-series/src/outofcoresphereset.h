@@ -0,0 +1,117 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bvh.h"
+#include "compressedsphereset.h"
+#include "hitable.h"
+#include "mappedfile.h"
+#include "sphereset.h"
+
+namespace rts // for ray tracing series
+{
+    // The description of a brick in a brick file, its arrays are laid out for a CompressedSphereSet
+    struct SphereBrickRecord
+    {
+        float boundsMin[3];
+        float boundsMax[3];
+        std::uint32_t sphereCount;
+        std::uint32_t nodeCount;
+        std::uint32_t root;             // see CompressedBvh::getRoot
+        std::uint32_t padding;
+        std::uint64_t sphereOffset;     // the CompactSphere array
+        std::uint64_t materialOffset;   // the material indices
+        std::uint64_t nodeOffset;       // the CompressedBvhNode array
+    };
+
+    // The cumulative statistics of the brick cache of a set
+    struct BrickCacheStats
+    {
+        std::uint64_t loadCount;
+        std::uint64_t evictionCount;
+        std::size_t residentSize;   // the memory of the bricks in the cache
+    };
+
+    // Write the spheres to a brick file for OutOfCoreSphereSet, they're partitioned along a Morton curve over their centers
+    // in bricks of up to brickSphereCount spheres and each brick gets its own compressed hierarchy, only the sorted Morton codes
+    // and a single brick are held in memory, the spheres can be read in place from a memory-mapped scene file larger than memory
+    bool saveSphereBricks(const std::string& filePath, const SphereRecord* spheres, std::size_t sphereCount, std::size_t brickSphereCount,
+        ThreadPool* pool);
+
+    // Spheres streamed from a brick file which may be larger than memory, the file is memory-mapped and only the bounds of the bricks
+    // and a BVH over them stay resident, a brick is loaded as a CompressedSphereSet when a ray first reaches it and kept in an LRU cache
+    // of a bounded size, its pages of the mapping are released as soon as it's loaded
+    // hit() serves the integrator one ray at a time while hitBatch() queues a batch of rays per brick, so that each brick is loaded
+    // once per batch rather than once per ray when the bricks reached by the rays don't fit in the cache
+    class OutOfCoreSphereSet final : public Hitable
+    {
+    public:
+        OutOfCoreSphereSet(const std::vector<std::unique_ptr<Material>>& materials, std::size_t cacheSize);
+
+        OutOfCoreSphereSet(const OutOfCoreSphereSet&) = delete;
+        OutOfCoreSphereSet& operator=(const OutOfCoreSphereSet&) = delete;
+
+        // Map the brick file and build the hierarchy over its bricks, the bricks themselves are only read on demand
+        bool open(const std::string& filePath);
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
+
+        // Find the closest hit of each ray of the batch, the records of the rays which hit nothing have a null material
+        void hitBatch(const std::vector<Ray>& rays, float tMin, float tMax, std::vector<HitRecord>& records) const;
+
+        std::size_t getBrickCount() const { return m_bricks.size(); }
+        std::size_t getSphereCount() const { return m_sphereCount; }
+        std::uint32_t getMaterialCount() const { return m_materialCount; } // one more than the highest material index of the spheres
+        BrickCacheStats getCacheStats() const;
+
+        // The memory which stays resident, the bricks in the cache aren't included (see getCacheStats)
+        std::size_t getMemoryUsage() const
+        {
+            return m_bricks.size() * (sizeof(SphereBrickRecord) + sizeof(CacheEntry)) + m_bvh.getMemoryUsage();
+        }
+
+    private:
+        // A brick in the cache, the least recently used bricks are at the back of the order list
+        struct CacheEntry
+        {
+            std::shared_ptr<const CompressedSphereSet> brick;
+            std::list<std::uint32_t>::iterator position;
+            bool invalid;   // the brick couldn't be loaded, it's reported once and then ignored
+        };
+
+        // Return the brick from the cache or load it, a brick evicted while another thread is using it is released once it's done
+        std::shared_ptr<const CompressedSphereSet> acquireBrick(std::uint32_t brickIndex) const;
+        std::shared_ptr<const CompressedSphereSet> loadBrick(std::uint32_t brickIndex) const;
+
+        const std::vector<std::unique_ptr<Material>>& m_materials;
+        std::size_t m_cacheSize;
+        std::string m_filePath;
+        MappedFile m_file;
+        std::vector<SphereBrickRecord> m_bricks;
+        std::size_t m_sphereCount;
+        std::uint32_t m_materialCount;
+        Bvh m_bvh;
+
+        mutable std::mutex m_cacheMutex;
+        mutable std::vector<CacheEntry> m_cacheEntries; // one per brick
+        mutable std::list<std::uint32_t> m_cacheOrder;
+        mutable BrickCacheStats m_cacheStats;
+    };
+}
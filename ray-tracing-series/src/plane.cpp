@@ -0,0 +1,77 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "plane.h"
+
+#include <cmath>
+#include <limits>
+
+#include "aabb.h"
+#include "defines.h"
+#include "ray.h"
+
+namespace rts
+{
+    namespace
+    {
+        // The bound of the rounding error of the distance to the plane relative to the magnitude of its terms, the projected hit
+        // points are a few ulps away from the plane, the rays starting from them are well within it
+        const float PLANE_DISTANCE_ERROR = 16.f * std::numeric_limits<float>::epsilon();
+    }
+
+    Plane::Plane(const vec3& point, const vec3& normal, const Material* material)
+        : m_point(point)
+        , m_normal(unitVector(normal))
+        , m_offset(dot(m_normal, point))
+        , m_frame(m_normal)
+        , m_material(material)
+    {
+    }
+
+    bool Plane::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        // The signed distance between the origin of the ray and the plane, along with the bound of its rounding error
+        const vec3& origin = r.origin();
+        float distance = dot(m_normal, origin) - m_offset;
+        float error = PLANE_DISTANCE_ERROR * (std::fabs(m_normal.x() * origin.x()) + std::fabs(m_normal.y() * origin.y())
+            + std::fabs(m_normal.z() * origin.z()) + std::fabs(m_offset));
+
+        // A ray which starts on the plane has been scattered by it, one which is parallel to it or moves away never hits it
+        float cosine = dot(m_normal, r.direction());
+        if (std::fabs(distance) <= error || distance * cosine >= 0.f)
+        {
+            return false;
+        }
+
+        float t = -distance / cosine;
+        if (!(tMin < t && t < tMax))
+        {
+            return false;
+        }
+
+        // The hit point is projected onto the plane, what's left of its distance is the rounding of the projection
+        rec.t = t;
+        rec.p = r.pointAtParameter(t);
+        rec.p -= (dot(m_normal, rec.p) - m_offset) * m_normal;
+        rec.normal = m_normal; // not flipped for the rays coming from behind, the plane is one-sided (see Plane)
+        rec.matPtr = m_material;
+        vec3 local = m_frame.toLocal(rec.p - m_point);
+        rec.u = local.x();
+        rec.v = local.y();
+        rec.uvDensity = 1.f;
+        return true;
+    }
+
+    bool Plane::boundingBox(Aabb& box) const
+    {
+        // The plane is infinite, the box is left as it is
+        RTS_UNUSED(box);
+        return false;
+    }
+}
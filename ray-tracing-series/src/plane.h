@@ -0,0 +1,41 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include "hitable.h"
+#include "microfacet.h"
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // An infinite plane, the exact counterpart of the huge sphere used as the ground of the book's worlds
+    // it has no bounds, the hierarchies keep it apart and test it against every ray (see HitableBvh)
+    // the hit points are projected onto the plane and a ray which starts on it, within the rounding error of its distance
+    // to the plane, doesn't hit it again, so the rays it scatters leave it without relying on RAY_LENGTH_MIN
+    // the plane is one-sided, it's the boundary of the half-space behind it as the surface of a sphere is the boundary of its volume
+    // the normal of the hits is its own whatever the side of the ray, a ray coming from behind is inside, which the dielectrics
+    // rely on to refract out of it, the other materials are meant to be seen from the front only
+    class Plane final : public Hitable
+    {
+    public:
+        // The normal doesn't need to be a unit vector, it's the side of the plane which the normal of the hits points to
+        Plane(const vec3& point, const vec3& normal, const Material* material);
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
+
+    private:
+        vec3 m_point;
+        vec3 m_normal;          // a unit vector
+        float m_offset;         // the dot product of the normal and the points of the plane
+        SurfaceFrame m_frame;   // the texture coordinates are the coordinates along its tangents, one unit per world unit
+        const Material* m_material;
+    };
+}
@@ -0,0 +1,458 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "preview.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include "camera.h"
+#include "config.h"
+#include "hdrimage.h"
+#include "raytracer.h"
+#include "scene.h"
+#include "timer.h"
+#include "tonemap.h"
+
+namespace rts
+{
+    namespace
+    {
+        const std::uint32_t PREVIEW_FRAMEBUFFER_MAGIC = 0x56505452; // "RTPV" in little-endian
+        const std::uint32_t PREVIEW_FRAMEBUFFER_VERSION = 1;
+        const auto PREVIEW_IDLE_POLL_INTERVAL = std::chrono::milliseconds(10);
+
+        // The header at the start of the shared memory, the atomics are lock-free so that they work across processes
+        struct SharedHeader
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t width;
+            std::uint32_t height;
+
+            // Written by the renderer, the sequence is odd while the image is being written
+            std::atomic<std::uint32_t> frameSequence;
+            std::uint32_t frameIndex;
+            std::uint32_t sampleCount;
+            std::uint32_t cameraSequence;
+
+            // Written by the consumer, the sequence is odd while the request is being written and twice the number of requests otherwise
+            std::atomic<std::uint32_t> cameraRequestSequence;
+            float lookFrom[3];
+            float lookAt[3];
+            std::atomic<std::uint32_t> stopRequested;
+        };
+
+        // The image starts on its own cache line
+        const std::size_t PREVIEW_IMAGE_OFFSET = (sizeof(SharedHeader) + 63) & ~static_cast<std::size_t>(63);
+
+        std::size_t getFramebufferSize(std::uint32_t width, std::uint32_t height)
+        {
+            return PREVIEW_IMAGE_OFFSET + static_cast<std::size_t>(width) * height * 3;
+        }
+    }
+
+    PreviewFramebuffer::PreviewFramebuffer()
+        : m_data(nullptr)
+        , m_size(0)
+        , m_owner(false)
+#ifdef _WIN32
+        , m_mappingHandle(nullptr)
+#endif // _WIN32
+    {
+    }
+
+    PreviewFramebuffer::~PreviewFramebuffer()
+    {
+        close();
+    }
+
+    bool PreviewFramebuffer::create(const std::string& name, int width, int height)
+    {
+        close();
+
+        if (width <= 0 || height <= 0)
+        {
+            std::cerr << "Invalid preview framebuffer size " << width << "x" << height << std::endl;
+            return false;
+        }
+        if (!map(name, getFramebufferSize(width, height), true))
+        {
+            std::cerr << "Unable to create the preview framebuffer " << name << std::endl;
+            return false;
+        }
+
+        static_assert(ATOMIC_INT_LOCK_FREE == 2, "the atomics of the shared header must be lock-free");
+        SharedHeader* header = new (m_data) SharedHeader();
+        header->version = PREVIEW_FRAMEBUFFER_VERSION;
+        header->width = static_cast<std::uint32_t>(width);
+        header->height = static_cast<std::uint32_t>(height);
+        header->frameSequence = 0;
+        header->frameIndex = 0;
+        header->sampleCount = 0;
+        header->cameraSequence = 0;
+        header->cameraRequestSequence = 0;
+        header->stopRequested = 0;
+
+        // The magic comes last, the consumer doesn't use the framebuffer until it's set
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = PREVIEW_FRAMEBUFFER_MAGIC;
+        return true;
+    }
+
+    bool PreviewFramebuffer::open(const std::string& name)
+    {
+        close();
+
+        if (!map(name, 0, false))
+        {
+            return false;
+        }
+
+        const SharedHeader* header = reinterpret_cast<const SharedHeader*>(m_data);
+        if (m_size < sizeof(SharedHeader) || header->magic != PREVIEW_FRAMEBUFFER_MAGIC || header->version != PREVIEW_FRAMEBUFFER_VERSION
+            || m_size < getFramebufferSize(header->width, header->height))
+        {
+            close();
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    bool PreviewFramebuffer::map(const std::string& name, std::size_t size, bool create)
+    {
+#ifdef _WIN32
+        // The mapping is backed by the paging file and released once the last handle is closed
+        std::string mappingName = "Local\\" + name;
+        if (create)
+        {
+            std::uint64_t size64 = size;
+            m_mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), mappingName.c_str());
+        }
+        else
+        {
+            m_mappingHandle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName.c_str());
+        }
+        if (m_mappingHandle == nullptr)
+        {
+            return false;
+        }
+
+        void* data = MapViewOfFile(m_mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if (data == nullptr)
+        {
+            close();
+            return false;
+        }
+        if (!create)
+        {
+            // The view covers the whole mapping, rounded up to the page size
+            MEMORY_BASIC_INFORMATION info;
+            size = (VirtualQuery(data, &info, sizeof(info)) != 0) ? info.RegionSize : 0;
+        }
+#else
+        // A previous framebuffer of the same name is unlinked first, its consumers keep it until they open the new one
+        std::string objectName = "/" + name;
+        int fd;
+        if (create)
+        {
+            shm_unlink(objectName.c_str());
+            fd = shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd >= 0 && ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                ::close(fd);
+                shm_unlink(objectName.c_str());
+                return false;
+            }
+        }
+        else
+        {
+            fd = shm_open(objectName.c_str(), O_RDWR, 0);
+            struct stat objectStat;
+            if (fd >= 0 && fstat(fd, &objectStat) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            size = (fd >= 0) ? static_cast<std::size_t>(objectStat.st_size) : 0;
+        }
+        if (fd < 0 || size == 0)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            return false;
+        }
+
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping keeps its own reference to the object
+        if (data == MAP_FAILED)
+        {
+            if (create)
+            {
+                shm_unlink(objectName.c_str());
+            }
+            return false;
+        }
+#endif // _WIN32
+
+        m_data = static_cast<unsigned char*>(data);
+        m_size = size;
+        m_name = name;
+        m_owner = create;
+        return true;
+    }
+
+    void PreviewFramebuffer::close()
+    {
+#ifdef _WIN32
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mappingHandle != nullptr)
+        {
+            CloseHandle(m_mappingHandle);
+            m_mappingHandle = nullptr;
+        }
+#else
+        if (m_data != nullptr)
+        {
+            munmap(m_data, m_size);
+            if (m_owner)
+            {
+                shm_unlink(("/" + m_name).c_str());
+            }
+        }
+#endif // _WIN32
+
+        m_data = nullptr;
+        m_size = 0;
+        m_name.clear();
+        m_owner = false;
+    }
+
+    int PreviewFramebuffer::getWidth() const
+    {
+        return isOpen() ? static_cast<int>(reinterpret_cast<const SharedHeader*>(m_data)->width) : 0;
+    }
+
+    int PreviewFramebuffer::getHeight() const
+    {
+        return isOpen() ? static_cast<int>(reinterpret_cast<const SharedHeader*>(m_data)->height) : 0;
+    }
+
+    void PreviewFramebuffer::publish(const std::vector<std::uint8_t>& rgb, std::uint32_t sampleCount, std::uint32_t cameraSequence)
+    {
+        SharedHeader* header = reinterpret_cast<SharedHeader*>(m_data);
+        std::size_t rowSize = static_cast<std::size_t>(header->width) * 3;
+        if (rgb.size() != rowSize * header->height)
+        {
+            return;
+        }
+
+        std::uint32_t sequence = header->frameSequence.load(std::memory_order_relaxed);
+        header->frameSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        header->frameIndex += 1;
+        header->sampleCount = sampleCount;
+        header->cameraSequence = cameraSequence;
+        unsigned char* image = m_data + PREVIEW_IMAGE_OFFSET;
+        for (std::uint32_t j = 0; j < header->height; ++j)
+        {
+            std::memcpy(image + j * rowSize, rgb.data() + (header->height - 1 - j) * rowSize, rowSize);
+        }
+
+        header->frameSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    bool PreviewFramebuffer::hasCameraRequest(std::uint32_t cameraSequence) const
+    {
+        // A request being written counts as well, it's going to be completed shortly
+        const SharedHeader* header = reinterpret_cast<const SharedHeader*>(m_data);
+        return (header->cameraRequestSequence.load(std::memory_order_acquire) + 1) / 2 != cameraSequence;
+    }
+
+    bool PreviewFramebuffer::getCameraRequest(std::uint32_t& cameraSequence, vec3& lookFrom, vec3& lookAt) const
+    {
+        const SharedHeader* header = reinterpret_cast<const SharedHeader*>(m_data);
+        std::uint32_t sequence = header->cameraRequestSequence.load(std::memory_order_acquire);
+        if ((sequence & 1) != 0 || sequence / 2 == cameraSequence)
+        {
+            return false;
+        }
+
+        vec3 requestedLookFrom(header->lookFrom[0], header->lookFrom[1], header->lookFrom[2]);
+        vec3 requestedLookAt(header->lookAt[0], header->lookAt[1], header->lookAt[2]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->cameraRequestSequence.load(std::memory_order_relaxed) != sequence)
+        {
+            return false;
+        }
+
+        cameraSequence = sequence / 2;
+        lookFrom = requestedLookFrom;
+        lookAt = requestedLookAt;
+        return true;
+    }
+
+    bool PreviewFramebuffer::isStopRequested() const
+    {
+        return reinterpret_cast<const SharedHeader*>(m_data)->stopRequested.load(std::memory_order_acquire) != 0;
+    }
+
+    bool PreviewFramebuffer::readFrame(std::vector<std::uint8_t>& rgb, PreviewFrameInfo& info) const
+    {
+        const SharedHeader* header = reinterpret_cast<const SharedHeader*>(m_data);
+        std::size_t imageSize = static_cast<std::size_t>(header->width) * header->height * 3;
+
+        // The renderer never waits, so the copy is tried again when an image has been published in the middle of it
+        const int maxAttemptCount = 100;
+        for (int attempt = 0; attempt < maxAttemptCount; ++attempt)
+        {
+            std::uint32_t sequence = header->frameSequence.load(std::memory_order_acquire);
+            if ((sequence & 1) != 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            PreviewFrameInfo frameInfo = { header->frameIndex, header->sampleCount, header->cameraSequence };
+            if (frameInfo.frameIndex == 0)
+            {
+                return false;
+            }
+            rgb.resize(imageSize);
+            std::memcpy(rgb.data(), m_data + PREVIEW_IMAGE_OFFSET, imageSize);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->frameSequence.load(std::memory_order_relaxed) == sequence)
+            {
+                info = frameInfo;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::uint32_t PreviewFramebuffer::requestCamera(const vec3& lookFrom, const vec3& lookAt)
+    {
+        SharedHeader* header = reinterpret_cast<SharedHeader*>(m_data);
+        std::uint32_t sequence = header->cameraRequestSequence.load(std::memory_order_relaxed);
+        header->cameraRequestSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int c = 0; c < 3; ++c)
+        {
+            header->lookFrom[c] = lookFrom[c];
+            header->lookAt[c] = lookAt[c];
+        }
+
+        header->cameraRequestSequence.store(sequence + 2, std::memory_order_release);
+        return (sequence + 2) / 2;
+    }
+
+    void PreviewFramebuffer::requestStop()
+    {
+        reinterpret_cast<SharedHeader*>(m_data)->stopRequested.store(1, std::memory_order_release);
+    }
+
+    void runPreview(const Scene& scene, int maxSampleCount, const ToneMapSettings& toneMapSettings, PreviewFramebuffer& framebuffer,
+        HdrImage& image, PreviewStats& stats)
+    {
+        Timer timer;
+        timer.setStartTime();
+        stats = { 0., 0, 0, 0 };
+
+        int width = framebuffer.getWidth();
+        int height = framebuffer.getHeight();
+        float aspectRatio = static_cast<float>(width) / height;
+        CameraRecord cameraRecord = scene.getCameraAt(scene.getAnimationStartTime());
+        std::unique_ptr<Camera> camera = createCameraFromRecord(cameraRecord, aspectRatio);
+        std::uint32_t cameraSequence = 0;
+
+        // The buffers are allocated once, a restart only rewinds the pass index since the first full pass overwrites the sums
+        AccumulationImage accumulation;
+        accumulation.resize(width, height);
+        std::vector<std::uint8_t> rgb;
+
+        // The coarse pass is only cancelled to stop, so that a consumer moving the camera continuously still gets its images
+        bool coarse = true;
+        auto isCancelled = [&]() { return framebuffer.isStopRequested() || (!coarse && framebuffer.hasCameraRequest(cameraSequence)); };
+
+        Timer publishTimer;
+        int passIndex = -1; // the coarse pass
+        while (!framebuffer.isStopRequested())
+        {
+            vec3 lookFrom, lookAt;
+            if (framebuffer.getCameraRequest(cameraSequence, lookFrom, lookAt))
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    cameraRecord.lookFrom[c] = lookFrom[c];
+                    cameraRecord.lookAt[c] = lookAt[c];
+                }
+                camera = createCameraFromRecord(cameraRecord, aspectRatio);
+                passIndex = -1;
+                ++stats.restartCount;
+            }
+
+            // Once converged, only the requests of the consumer are waited for
+            if (passIndex >= maxSampleCount)
+            {
+                std::this_thread::sleep_for(PREVIEW_IDLE_POLL_INTERVAL);
+                continue;
+            }
+
+            coarse = passIndex < 0;
+            if (!rayTracingProgressivePass(*camera, scene, std::max(passIndex, 0), coarse ? PREVIEW_COARSE_BLOCK_SIZE : 1, &accumulation, isCancelled))
+            {
+                continue;
+            }
+            ++passIndex;
+
+            if (coarse || passIndex == maxSampleCount || publishTimer.getElapsedTime() >= 1. / PREVIEW_PUBLISH_RATE)
+            {
+                accumulation.resolve(image);
+                toneMap(image, toneMapSettings, rgb);
+                framebuffer.publish(rgb, coarse ? 0 : static_cast<std::uint32_t>(passIndex), cameraSequence);
+                publishTimer.setStartTime();
+
+                if (stats.publishedImageCount++ == 0)
+                {
+                    stats.timeToFirstImage = timer.getElapsedTime();
+                }
+            }
+        }
+
+        stats.sampleCount = std::max(passIndex, 0);
+        accumulation.resolve(image);
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    struct HdrImage;
+    class Scene;
+    struct ToneMapSettings;
+
+    // The description of a published image
+    struct PreviewFrameInfo
+    {
+        std::uint32_t frameIndex;       // starts at 1 and grows with each published image
+        std::uint32_t sampleCount;      // the number of rays per pixel, 0 for the coarse image
+        std::uint32_t cameraSequence;   // the last camera request taken into account, 0 for the camera of the scene
+    };
+
+    // A framebuffer in named shared memory through which the preview renderer publishes its images to a local consumer (a viewer)
+    // it holds a header followed by the tonemapped image, 3 bytes per pixel with the rows from top to bottom
+    // the image is guarded by a sequence counter which is odd while it's being written, the consumer copies it and checks
+    // that the counter hasn't changed meanwhile, so that neither side ever waits for the other
+    // the consumer can move the camera and stop the renderer through the same header
+    // on Linux the framebuffer is the file /dev/shm/<name>, on Windows a named file mapping in the session namespace
+    class PreviewFramebuffer final
+    {
+    public:
+        PreviewFramebuffer();
+        ~PreviewFramebuffer();
+
+        PreviewFramebuffer(const PreviewFramebuffer&) = delete;
+        PreviewFramebuffer& operator=(const PreviewFramebuffer&) = delete;
+
+        // The renderer creates the framebuffer, any previous one of the same name is replaced, it's removed once closed
+        bool create(const std::string& name, int width, int height);
+
+        // The consumer opens the framebuffer of a running renderer, it fails until the framebuffer has been created
+        bool open(const std::string& name);
+        void close();
+
+        bool isOpen() const { return m_data != nullptr; }
+        int getWidth() const;
+        int getHeight() const;
+
+        // Renderer side, publish the image of the given size (rows from bottom to top, see toneMap)
+        void publish(const std::vector<std::uint8_t>& rgb, std::uint32_t sampleCount, std::uint32_t cameraSequence);
+
+        // Renderer side, return true if the consumer has requested a camera other than the one of the given sequence
+        // getCameraRequest also returns the requested camera and updates the sequence
+        bool hasCameraRequest(std::uint32_t cameraSequence) const;
+        bool getCameraRequest(std::uint32_t& cameraSequence, vec3& lookFrom, vec3& lookAt) const;
+        bool isStopRequested() const;
+
+        // Consumer side, copy the latest image, return false if none has been published yet
+        bool readFrame(std::vector<std::uint8_t>& rgb, PreviewFrameInfo& info) const;
+
+        // Consumer side, move the camera and return the sequence of the request, which the images report once they use it
+        std::uint32_t requestCamera(const vec3& lookFrom, const vec3& lookAt);
+        void requestStop();
+
+    private:
+        bool map(const std::string& name, std::size_t size, bool create);
+
+        unsigned char* m_data;
+        std::size_t m_size;
+        std::string m_name;
+        bool m_owner;
+
+#ifdef _WIN32
+        void* m_mappingHandle;
+#endif // _WIN32
+    };
+
+    struct PreviewStats
+    {
+        double timeToFirstImage;    // in seconds
+        int publishedImageCount;
+        int restartCount;           // the number of camera requests
+        int sampleCount;            // the number of rays per pixel of the last image
+    };
+
+    // Render the scene progressively and publish its images to the framebuffer until the consumer requests to stop
+    // a coarse pass comes first, then full passes of a single ray per pixel are accumulated up to maxSampleCount
+    // the images are published at PREVIEW_PUBLISH_RATE at most, the coarse one and the last one always are
+    // a camera request cancels the current full pass and restarts the accumulation, which doesn't reallocate anything
+    // the image receives the averaged radiance of the last camera
+    void runPreview(const Scene& scene, int maxSampleCount, const ToneMapSettings& toneMapSettings, PreviewFramebuffer& framebuffer,
+        HdrImage& image, PreviewStats& stats);
+}
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <random>
 
 namespace rts // for ray tracing series
@@ -27,16 +28,50 @@ namespace rts // for ray tracing series
 #ifndef DETERMINISTIC_RNG
             std::random_device rd;                      // create a random device to seed the pseudo-random generator
             m_gen = std::mt19937(customSeed + rd());    // initialize the mersenne twister engine with a random seed (we could also use the clock)
+            m_streamKey = (static_cast<std::uint64_t>(rd()) << 32) | rd();
 #endif // !DETERMINISTIC_RNG
         }
 
+        // Restart on the stream of a sample of a pixel, the numbers it returns from then on only depend on the frame, the pixel and the
+        // sample index, not on the thread tracing it or on what was traced before, with DETERMINISTIC_RNG they're the same for every run
+        // the streams come from a PCG32 generator seeded by a hash of the three, much cheaper to restart per sample than the mersenne twister
+        void setSampleStream(std::uint32_t frame, std::uint32_t pixel, std::uint32_t sample)
+        {
+            std::uint64_t key = mix((static_cast<std::uint64_t>(frame) << 32) | pixel) ^ m_streamKey;
+            m_streamState = mix(key + sample);
+            m_streaming = true;
+        }
+
         // Return a random float in [0, 1)
-        float get() { return m_dist(m_gen); }
+        float get() { return m_streaming ? getFromStream() : m_dist(m_gen); }
 
     private:
+        // A step of the PCG32 generator (XSH RR), its top 24 bits make a float in [0, 1)
+        float getFromStream()
+        {
+            std::uint64_t state = m_streamState;
+            m_streamState = state * 6364136223846793005ull + 1442695040888963407ull;
+            std::uint32_t xorShifted = static_cast<std::uint32_t>(((state >> 18) ^ state) >> 27);
+            std::uint32_t rotation = static_cast<std::uint32_t>(state >> 59);
+            std::uint32_t value = (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+            return static_cast<float>(value >> 8) * (1.f / 16777216.f);
+        }
+
+        // The finalizer of SplitMix64, each bit of the input affects all the bits of the output
+        static std::uint64_t mix(std::uint64_t value)
+        {
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+            return value ^ (value >> 31);
+        }
+
         std::uniform_real_distribution<float> m_dist;
         std::mt19937 m_gen;
 
+        std::uint64_t m_streamKey = 0;      // tells the runs apart without DETERMINISTIC_RNG
+        std::uint64_t m_streamState = 0;
+        bool m_streaming = false;           // whether the numbers come from the stream of a sample rather than from m_gen
+
         static const unsigned int DEFAULT_SEED = std::mt19937::default_seed;
     };
 }
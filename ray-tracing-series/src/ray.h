@@ -9,23 +9,61 @@
 
 #pragma once
 
+#include <limits>
+
+#include "fastmath.h"
 #include "vec3.h"
 
 namespace rts // for ray tracing series
 {
+    // A ray whose direction is always normalized, its parameter t is hence the distance from its origin
+    // the inverse direction and its signs are computed once when the ray is created, they're shared by all the box tests
+    // the ray also carries a cone, the width of the footprint at its origin and its spread angle, which drives the filtering
+    // of the textures (see ImageTexture), a ray created by a material is a thin one until the ray tracer sets its cone
     class Ray final
     {
     public:
-        Ray() : m_origin(), m_direction() {}
-        Ray(const vec3& origin, const vec3& direction) : m_origin(origin), m_direction(direction) {}
+        Ray() : m_origin(), m_direction(0.f, 0.f, 1.f), m_invDirection(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), 1.f), m_time(0.f)
+            , m_coneWidth(0.f), m_coneSpread(0.f)
+        {
+            m_sign[0] = m_sign[1] = m_sign[2] = 0;
+        }
+
+        // The direction doesn't need to be normalized, it's done here (see FAST_MATH_RSQRT_NORMALIZE for the accuracy)
+        Ray(const vec3& origin, const vec3& direction, float time = 0.f)
+            : m_origin(origin)
+            , m_direction(getUnitVector(direction))
+            , m_invDirection(1.f / m_direction.x(), 1.f / m_direction.y(), 1.f / m_direction.z())
+            , m_time(time)
+            , m_coneWidth(0.f)
+            , m_coneSpread(0.f)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                m_sign[axis] = (m_invDirection[axis] < 0.f) ? 1 : 0;
+            }
+        }
 
-        vec3 origin() const { return m_origin; }
-        vec3 direction() const { return m_direction; }
+        const vec3& origin() const { return m_origin; }
+        const vec3& direction() const { return m_direction; } // a unit vector
+        const vec3& invDirection() const { return m_invDirection; }
+        const int* sign() const { return m_sign; } // 1 for the axes along which the direction is negative, 0 otherwise
+        float time() const { return m_time; } // the instant at which the ray is traced, within the camera's shutter interval
 
         vec3 pointAtParameter(float t) const { return m_origin + t * m_direction; }
 
+        // The spread angle is in radians, the width of the footprint grows linearly along the ray
+        void setCone(float width, float spreadAngle) { m_coneWidth = width; m_coneSpread = spreadAngle; }
+        float coneWidthAt(float t) const { return m_coneWidth + t * m_coneSpread; }
+        float coneSpread() const { return m_coneSpread; }
+
     private:
         vec3 m_origin;
         vec3 m_direction;
+        vec3 m_invDirection;
+        int m_sign[3];
+        float m_time;
+        float m_coneWidth;
+        float m_coneSpread;
     };
 }
@@ -9,88 +9,483 @@
 
 #include "raytracer.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <cmath>
-#include <future>
 #include <mutex>
-#include <utility>
-#include <vector>
 
 #include "camera.h"
 #include "config.h"
+#include "constantmedium.h"
+#include "defines.h"
+#include "hdrimage.h"
 #include "hitable.h"
-#include "hitableList.h"
 #include "material.h"
 #include "random.h"
 #include "ray.h"
+#include "scene.h"
+#include "spectrum.h"
+#include "threadpool.h"
+#include "utils.h"
 
 namespace rts
 {
-    bool getColor(const Ray& r, const HitableList& world, int depth, vec3& color, Random& random)
+    namespace
     {
-        // Check if the ray hits any object
-        HitRecord rec;
-        if (world.hit(r, RAY_LENGTH_MIN, RAY_LENGTH_MAX, rec))
+        bool s_environmentSampling = true;
+
+        // Whether the light of the environment map is sampled directly at the hit, see sampleEnvironmentLight
+        bool isEnvironmentSampled(const Scene& scene, const HitRecord& rec)
         {
-#ifdef RENDER_NORMAL_MAP
-            // The normal is a unit vector ie its components fall between -1 and +1
-            // map those components between 0 and +1 before returning the value
-            color = 0.5f * vec3(rec.normal.x() + 1.f, rec.normal.y() + 1.f, rec.normal.z() + 1.f);
-            return true;
-#elif defined RENDER_NO_MATERIAL
-            // The ray hit a surface, determine a new target to bounce off of it
-            // also check the depth to avoid infinite recursions, it can happen with spheres of negative radius
-            // rays end up being trapped inside and there's no refraction possible since we ignore the material
-            if (depth < RAY_DEPTH_MAX)
+            return s_environmentSampling && scene.getEnvironment() != nullptr && rec.matPtr->canEvaluate();
+        }
+
+        // The power heuristic of multiple importance sampling, the weight of the strategy of density pdf against the other one
+        float getMisWeight(float pdf, float otherPdf)
+        {
+            float squared = pdf * pdf;
+            return squared / (squared + otherPdf * otherPdf);
+        }
+
+        // Sample a direction of the environment map from a hit, radiance is the light coming from it when it isn't shadowed
+        // and scattering turns it into the estimate of the direct light, the material is evaluated in that direction
+        // and the sample is weighted against the one of the material
+        // a medium blocks the shadow ray when it would scatter it, which happens as often as the light is scattered away
+        bool sampleEnvironmentLight(const Ray& r, const Scene& scene, const HitRecord& rec, Random& random, vec3& scattering, vec3& radiance)
+        {
+            float u1 = random.get();
+            float u2 = random.get();
+            vec3 direction;
+            float lightPdf;
+            if (!scene.getEnvironment()->sample(u1, u2, direction, radiance, lightPdf))
+            {
+                return false;
+            }
+
+            vec3 value;
+            float scatteringPdf;
+            if (!rec.matPtr->evaluate(r, rec, direction, value, scatteringPdf))
+            {
+                return false;
+            }
+
+            Ray shadowRay(rec.p, direction, r.time());
+            HitRecord shadowRec;
+            if (scene.getWorld().hit(shadowRay, RAY_LENGTH_MIN, RAY_LENGTH_MAX, shadowRec))
+            {
+                return false;
+            }
+            for (const auto& medium : scene.getMedia())
             {
-                vec3 target = rec.p + rec.normal + getRandomPointInUnitSphere(random);
-                if (getColor(Ray(rec.p, target - rec.p), world, depth + 1, color, random))
+                if (medium->sampleScattering(shadowRay, RAY_LENGTH_MIN, RAY_LENGTH_MAX, shadowRec, random))
                 {
-                    // A color has been found, apply an attenuation factor to it
-                    color *= 0.5f;
-                    return true;
+                    return false;
                 }
-                // A color couldn't be found, so this ray shouldn't contribute to the pixel's color
-                return false;
             }
-            // The maximum depth has been reached, return the black color
-            color = vec3(0.f, 0.f, 0.f);
+
+            scattering = value * (getMisWeight(lightPdf, scatteringPdf) / lightPdf);
             return true;
-#else
-            // The surface must have a material
-            assert(rec.matPtr != nullptr);
-            
+        }
+
+        // The weight of the environment hit by a bounce of the given density, 0 for the rays which don't come from a sampled hit
+        float getEnvironmentWeight(const Scene& scene, const vec3& direction, float scatteringPdf)
+        {
+            return (scatteringPdf > 0.f) ? getMisWeight(scatteringPdf, scene.getEnvironment()->getPdf(direction)) : 1.f;
+        }
+
+        // Check if the ray hits any object, then if it's scattered by a medium before, a single distance is sampled per medium
+        // along the segment and the closest scattering event wins, which is the same as sampling the media together
+        bool hitScene(const Ray& r, const Scene& scene, Random& random, HitRecord& rec, bool& scatteredByMedium)
+        {
+            bool hit = scene.getWorld().hit(r, RAY_LENGTH_MIN, RAY_LENGTH_MAX, rec);
+            float tMax = hit ? rec.t : RAY_LENGTH_MAX;
+            scatteredByMedium = false;
+            for (const auto& medium : scene.getMedia())
+            {
+                if (medium->sampleScattering(r, RAY_LENGTH_MIN, tMax, rec, random))
+                {
+                    hit = true;
+                    scatteredByMedium = true;
+                    tMax = rec.t;
+                }
+            }
+
+            if (hit)
+            {
+                // The footprint of the ray cone selects the mip level of the textures
+                rec.footprint = r.coneWidthAt(rec.t);
+            }
+            return hit;
+        }
+
+        void setHitAovs(const HitRecord& rec, SampleAovs* aovs)
+        {
+            if (aovs != nullptr)
+            {
+                aovs->albedo = (rec.matPtr != nullptr) ? rec.matPtr->getAlbedo(rec) : vec3(1.f, 1.f, 1.f);
+                aovs->normal = rec.normal;
+                aovs->depth = rec.t;
+            }
+        }
+
+        // The color of the background in the direction of a ray which hits nothing, before its weight (see getEnvironmentWeight)
+        vec3 getMissColor(const Ray& r, const Scene& scene, SampleAovs* aovs)
+        {
+            vec3 color = scene.getBackgroundColor(r.direction());
+            if (aovs != nullptr)
+            {
+                aovs->albedo = color;
+                aovs->normal = vec3(0.f, 0.f, 0.f);
+                aovs->depth = 0.f;
+            }
+            return color;
+        }
+
+        // What a hit does to the path: the ray it scatters with its attenuation, and the direct light of the environment
+        // scatteringPdf is the density of the bounce when the environment has been sampled at the hit, 0 otherwise
+        struct Bounce
+        {
             Ray scattered;
             vec3 attenuation;
+            float scatteringPdf = 0.f;
+            bool hasDirectLight = false;
+            vec3 directScattering;
+            vec3 directRadiance;
+        };
 
-            // The ray hit a surface, get the attenuation and scattered information from its material
-            if (depth < RAY_DEPTH_MAX)
+        // Sample the bounce of a hit whose material scatters all the wavelengths the same way, the RGB and the spectral
+        // integrators share it so that they weight their paths the same, it returns false when the path ends at the hit
+        // bounce then only holds the direct light, if any
+        bool sampleBounce(const Ray& r, const Scene& scene, const HitRecord& rec, bool scatteredByMedium, Random& random, Bounce& bounce)
+        {
+            // A surface whose material can be evaluated gets its direct light from a sample of the environment map, then
+            // its bounce is sampled by the material, a density known to the ray so that the environment it may hit is weighted
+            // against the sample
+            if (isEnvironmentSampled(scene, rec))
             {
-                if (rec.matPtr->scatter(r, rec, attenuation, scattered, random)
-                    && getColor(scattered, world, depth + 1, color, random))
+                bounce.hasDirectLight = sampleEnvironmentLight(r, scene, rec, random, bounce.directScattering, bounce.directRadiance);
+
+                // The bounce is absorbed, e.g. reflected below a rough surface, only the direct light remains
+                if (!rec.matPtr->sample(r, rec, bounce.attenuation, bounce.scattered, bounce.scatteringPdf, random)
+                    || (bounce.attenuation.r() <= 0.f && bounce.attenuation.g() <= 0.f && bounce.attenuation.b() <= 0.f))
                 {
-                    // A color has been found, apply an attenuation factor to it
-                    color *= attenuation;
-                    return true;
+                    return false;
+                }
+            }
+            else
+            {
+                // The ray may be absorbed, e.g. scattered below a fuzzy metal, it then carries no light
+                // but it's still a sample of its pixel, leaving it out would brighten the pixel
+                if (!rec.matPtr->scatter(r, rec, bounce.attenuation, bounce.scattered, random))
+                {
+                    return false;
+                }
+
+                // A dark medium scatters the ray many times while it keeps little of the light, the path is ended
+                // with the probability of losing it (Russian roulette) and the surviving ones are weighted up to stay unbiased
+                if (scatteredByMedium)
+                {
+                    float survival = std::max(bounce.attenuation.r(), std::max(bounce.attenuation.g(), bounce.attenuation.b()));
+                    if (survival < 1.f)
+                    {
+                        if (random.get() >= survival)
+                        {
+                            return false;
+                        }
+                        bounce.attenuation /= survival;
+                    }
                 }
-                // The ray couldn't be scattered or a color couldn't be found, so this ray shouldn't contribute to the pixel's color
-                return false;
             }
-            // The maximum depth has been reached, return the black color
-            color = vec3(0.f, 0.f, 0.f);
+
+            // The scattered ray goes on from the footprint with the same spread, which ignores the curvature of the surface
+            bounce.scattered.setCone(rec.footprint, r.coneSpread());
             return true;
+        }
+
+        // The color of a ray (see getColor), scatteringPdf is the density of the bounce it comes from when the environment
+        // has been sampled there, its light is then weighted against that sample
+        vec3 getPathColor(const Ray& r, const Scene& scene, int depth, float scatteringPdf, Random& random, SampleAovs* aovs)
+        {
+            HitRecord rec;
+            bool scatteredByMedium;
+            if (hitScene(r, scene, random, rec, scatteredByMedium))
+            {
+                setHitAovs(rec, aovs);
+
+#ifdef RENDER_NORMAL_MAP
+                // The normal is a unit vector ie its components fall between -1 and +1
+                // map those components between 0 and +1 before returning the value
+                return 0.5f * vec3(rec.normal.x() + 1.f, rec.normal.y() + 1.f, rec.normal.z() + 1.f);
+#elif defined RENDER_NO_MATERIAL
+                // The ray hit a surface, determine a new target to bounce off of it
+                // also check the depth to avoid infinite recursions, it can happen with spheres of negative radius
+                // rays end up being trapped inside and there's no refraction possible since we ignore the material
+                if (depth < RAY_DEPTH_MAX)
+                {
+                    vec3 target = rec.p + rec.normal + getRandomPointInUnitSphere(random);
+
+                    // Apply an attenuation factor to the color found
+                    return 0.5f * getPathColor(Ray(rec.p, target - rec.p, r.time()), scene, depth + 1, 0.f, random, nullptr);
+                }
+                // The maximum depth has been reached, return the black color
+                return vec3(0.f, 0.f, 0.f);
+#else
+                // The surface must have a material
+                assert(rec.matPtr != nullptr);
+
+                // The ray hit a surface, get the attenuation and scattered information from its material
+                if (depth < RAY_DEPTH_MAX)
+                {
+                    Bounce bounce;
+                    bool scattered = sampleBounce(r, scene, rec, scatteredByMedium, random, bounce);
+                    vec3 direct = bounce.hasDirectLight ? bounce.directScattering * bounce.directRadiance : vec3(0.f, 0.f, 0.f);
+                    if (!scattered)
+                    {
+                        return direct;
+                    }
+
+                    // Apply the attenuation factor to the color found by the scattered ray
+                    return bounce.attenuation * getPathColor(bounce.scattered, scene, depth + 1, bounce.scatteringPdf, random, nullptr) + direct;
+                }
+                // The maximum depth has been reached, return the black color
+                return vec3(0.f, 0.f, 0.f);
+#endif // RENDER_NORMAL_MAP, RENDER_NO_MATERIAL
+            }
+            else
+            {
+                // Nothing has been hit, determine the background's color
+                return getMissColor(r, scene, aovs) * getEnvironmentWeight(scene, r.direction(), scatteringPdf);
+            }
+        }
+    }
+
+    vec3 getColor(const Ray& r, const Scene& scene, int depth, Random& random, SampleAovs* aovs)
+    {
+        return getPathColor(r, scene, depth, 0.f, random, aovs);
+    }
+
+    void setEnvironmentSampling(bool enabled)
+    {
+        s_environmentSampling = enabled;
+    }
+
+    bool isEnvironmentSampling()
+    {
+        return s_environmentSampling;
+    }
+
+    namespace
+    {
+        bool s_spectralRendering = false;
+
+        const unsigned int ALL_LANES = (1u << WavelengthSample::LANE_COUNT) - 1;
+
+        // Keep the given lanes scaled by weight and zero the others
+        floatx8 getLaneWeights(unsigned int laneMask, float weight)
+        {
+            float weights[WavelengthSample::LANE_COUNT];
+            for (int lane = 0; lane < WavelengthSample::LANE_COUNT; ++lane)
+            {
+                weights[lane] = ((laneMask & (1u << lane)) != 0) ? weight : 0.f;
+            }
+            return floatx8::load(weights);
+        }
+
+        // The spectral counterpart of getColor, the radiance is only meaningful in the lanes of laneMask
+        floatx8 getSpectralRadiance(const Ray& r, const Scene& scene, int depth, float scatteringPdf, const WavelengthSample& wavelengths,
+            unsigned int laneMask, Random& random, SampleAovs* aovs)
+        {
+            // Check if the ray hits any object, then if it's scattered by a medium before
+            HitRecord rec;
+            bool scatteredByMedium;
+            if (!hitScene(r, scene, random, rec, scatteredByMedium))
+            {
+                // The light of the background is the spectrum of its color
+                vec3 color = getMissColor(r, scene, aovs);
+                return getSpectrumFromRgb(color, wavelengths) * floatx8(getEnvironmentWeight(scene, r.direction(), scatteringPdf));
+            }
+
+            assert(rec.matPtr != nullptr);
+            setHitAovs(rec, aovs);
+
+            if (depth >= RAY_DEPTH_MAX)
+            {
+                return floatx8(0.f);
+            }
+
+            if (isEnvironmentSampled(scene, rec) || !rec.matPtr->isDispersive())
+            {
+                // All the wavelengths are scattered the same way, the bounce of getColor whose RGB attenuation
+                // and direct light are turned into spectra
+                Bounce bounce;
+                bool scattered = sampleBounce(r, scene, rec, scatteredByMedium, random, bounce);
+                floatx8 direct(0.f);
+                if (bounce.hasDirectLight)
+                {
+                    direct = getSpectrumFromRgb(bounce.directScattering, wavelengths) * getSpectrumFromRgb(bounce.directRadiance, wavelengths);
+                }
+                if (!scattered)
+                {
+                    return direct;
+                }
+
+                floatx8 radiance = getSpectralRadiance(bounce.scattered, scene, depth + 1, bounce.scatteringPdf, wavelengths, laneMask, random, nullptr);
+                return getSpectrumFromRgb(bounce.attenuation, wavelengths) * radiance + direct;
+            }
+
+            // A dispersive material scatters each wavelength on its own, with a random number shared by the lanes
+            // the lanes which get the same ray, i.e. the reflected ones, keep following it together
+            // the lanes refracted in directions of their own are split, tracing all of them would multiply the cost of the path
+            // so a single one is followed, picked at random, and weighted by their count, which keeps the estimate of each lane unbiased
+            // a lane which is absorbed carries no light and leaves the others
+            float lambdas[WavelengthSample::LANE_COUNT];
+            wavelengths.wavelengths.store(lambdas);
+            Ray scattered[WavelengthSample::LANE_COUNT];
+            vec3 attenuations[WavelengthSample::LANE_COUNT];
+            float sample = random.get();
+            unsigned int scatteredLanes = 0;
+            for (int lane = 0; lane < WavelengthSample::LANE_COUNT; ++lane)
+            {
+                if ((laneMask & (1u << lane)) != 0 && rec.matPtr->scatterWavelength(r, rec, lambdas[lane], sample, attenuations[lane], scattered[lane]))
+                {
+                    scatteredLanes |= 1u << lane;
+                }
+            }
+
+            floatx8 radiance(0.f);
+            auto followLanes = [&](int lane, unsigned int lanes, float weight)
+            {
+                Ray ray = scattered[lane];
+                ray.setCone(rec.footprint, r.coneSpread());
+                floatx8 laneRadiance = getSpectralRadiance(ray, scene, depth + 1, 0.f, wavelengths, lanes, random, nullptr);
+                radiance += laneRadiance * getSpectrumFromRgb(attenuations[lane], wavelengths) * getLaneWeights(lanes, weight);
+            };
+
+            unsigned int remainingLanes = scatteredLanes;
+            unsigned int splitLanes = 0;
+            int splitCount = 0;
+            for (int lane = 0; lane < WavelengthSample::LANE_COUNT; ++lane)
+            {
+                if ((remainingLanes & (1u << lane)) == 0)
+                {
+                    continue;
+                }
+
+                // Gather the lanes which share the ray of this one
+                const vec3& direction = scattered[lane].direction();
+                unsigned int sharingLanes = 0;
+                for (int other = lane; other < WavelengthSample::LANE_COUNT; ++other)
+                {
+                    const vec3& otherDirection = scattered[other].direction();
+                    if ((remainingLanes & (1u << other)) != 0 && otherDirection.x() == direction.x() && otherDirection.y() == direction.y()
+                        && otherDirection.z() == direction.z())
+                    {
+                        sharingLanes |= 1u << other;
+                    }
+                }
+                remainingLanes &= ~sharingLanes;
+
+                if (sharingLanes != (1u << lane))
+                {
+                    followLanes(lane, sharingLanes, 1.f);
+                }
+                else
+                {
+                    splitLanes |= sharingLanes;
+                    ++splitCount;
+                }
+            }
+
+            if (splitCount > 0)
+            {
+                int pick = std::min(static_cast<int>(random.get() * splitCount), splitCount - 1);
+                for (int lane = 0; lane < WavelengthSample::LANE_COUNT; ++lane)
+                {
+                    if ((splitLanes & (1u << lane)) != 0 && pick-- == 0)
+                    {
+                        followLanes(lane, 1u << lane, static_cast<float>(splitCount));
+                        break;
+                    }
+                }
+            }
+            return radiance;
+        }
+    }
+
+    void setSpectralRendering(bool enabled)
+    {
+        s_spectralRendering = enabled;
+    }
+
+    bool isSpectralRendering()
+    {
+        return s_spectralRendering;
+    }
+
+    vec3 getSpectralColor(const Ray& r, const Scene& scene, Random& random, SampleAovs* aovs)
+    {
+        WavelengthSample wavelengths = sampleWavelengths(random.get());
+        return getRgbFromSpectrum(getSpectralRadiance(r, scene, 0, 0.f, wavelengths, ALL_LANES, random, aovs), wavelengths);
+    }
+
+    namespace
+    {
+        unsigned int s_frameIndex = 0;
+    }
+
+    void setFrameIndex(unsigned int frameIndex)
+    {
+        s_frameIndex = frameIndex;
+    }
+
+    unsigned int getFrameIndex()
+    {
+        return s_frameIndex;
+    }
+
+    namespace
+    {
+        // The color of a camera ray in the current mode
+        vec3 getSampleColor(const Ray& r, const Scene& scene, Random& random, SampleAovs* aovs = nullptr)
+        {
+#if defined RENDER_NORMAL_MAP || defined RENDER_NO_MATERIAL
+            // The debug renders ignore the materials, hence the wavelengths
+            return getColor(r, scene, 0, random, aovs);
+#else
+            return s_spectralRendering ? getSpectralColor(r, scene, random, aovs) : getColor(r, scene, 0, random, aovs);
 #endif // RENDER_NORMAL_MAP, RENDER_NO_MATERIAL
         }
-        else
+
+        bool isFinite(const vec3& color)
+        {
+            return std::isfinite(color.r()) && std::isfinite(color.g()) && std::isfinite(color.b());
+        }
+
+        bool isNan(const vec3& color)
         {
-            // Nothing has been hit, determine the background's color
-            vec3 unitDirection = unitVector(r.direction());     // unitDirection Y is between -1 and +1
-            float t = 0.5f * (unitDirection.y() + 1.f);         // scale unitDirection Y between 0 and +1
+            return std::isnan(color.r()) || std::isnan(color.g()) || std::isnan(color.b());
+        }
 
-            // Blend the background top/bottom colors depending on the ray's direction
-            color = (1.f - t) * WORLD_BACKGROUND_COLOR_BOTTOM + t * WORLD_BACKGROUND_COLOR_TOP;
+        // Add a sample to the sum of its pixel and count it, unless it's NaN or infinite, a single one would spoil the whole pixel
+        // so it's left out of both (see SampleDiagnostics), the final and the progressive renders share this policy
+        // return false if the sample has been left out
+        bool accumulateSample(const vec3& color, vec3& sum, std::uint32_t& sampleCount)
+        {
+            if (!isFinite(color))
+            {
+                return false;
+            }
+            sum += color;
+            ++sampleCount;
             return true;
         }
+
+        // Average the samples of a pixel, a pixel without any valid sample keeps its sum, black unless it's a coarse preview
+        vec3 averageSamples(const vec3& sum, std::uint32_t sampleCount)
+        {
+            return (sampleCount > 0) ? sum / static_cast<float>(sampleCount) : sum;
+        }
     }
 
 #ifdef MULTITHREADING_LOGS
@@ -98,7 +493,8 @@ namespace rts
     static std::mutex ioMutex;
 #endif // MULTITHREADING_LOGS
 
-    void rayTracingSubTask(const Camera& camera, const HitableList& world, ImageData* imageData, int startLine, int endLine, int taskId)
+    void rayTracingSubTask(const Camera& camera, const Scene& scene, int sampleCount, HdrImage* image, AovImages* aovs, SampleDiagnostics* diagnostics,
+        int startLine, int endLine, int taskId)
     {
 #ifdef MULTITHREADING_LOGS
         // Display some debug log
@@ -108,89 +504,123 @@ namespace rts
         }
 #endif // MULTITHREADING_LOGS
 
-        // Initialize a random value generator for this specific sub task
-        // give it a unique seed based on the taskId
-#ifdef MULTITHREADING_ON
-        Random random(taskId);
-#else
+        // Each sample restarts the random value generator on its own stream, so that the image doesn't depend on how the lines are split
+        // among the sub tasks, and each pixel sums its samples in order
         Random random;
-#endif // MULTITHREADING_ON
+
+        float pixelSpreadAngle = camera.getPixelSpreadAngle(image->height);
+        bool markInvalidSamples = diagnostics != nullptr && diagnostics->invalidSamples.width == image->width
+            && diagnostics->invalidSamples.height == image->height;
+        std::uint64_t invalidSampleCount = 0;
 
         // Run the ray tracer on each pixel in the range [startLine, endLine) to determine its color
         // from left to right and bottom to top
         for (int j = startLine; j < endLine; ++j)
         {
-            for (int i = 0; i < IMAGE_WIDTH; ++i)
+            for (int i = 0; i < image->width; ++i)
             {
                 vec3 col(0.f, 0.f, 0.f);    // the accumulated color
-                int sampleCount = 0;        // the number of valid samples
+                std::uint32_t validSampleCount = 0;
+                int nanSampleCount = 0;     // the number of samples left out
+                int infiniteSampleCount = 0;
+                float squaredLuminanceSum = 0.f;
+                SampleAovs pixelAovs = { vec3(0.f, 0.f, 0.f), vec3(0.f, 0.f, 0.f), 0.f };
 
                 // Sample multiple times randomly within the current pixel
-                for (int s = 0; s < RAY_COUNT_PER_PIXEL; ++s)
+                for (int s = 0; s < sampleCount; ++s)
                 {
-                    float u = float(i + random.get()) / float(IMAGE_WIDTH);
-                    float v = float(j + random.get()) / float(IMAGE_HEIGHT);
+                    random.setSampleStream(s_frameIndex, static_cast<std::uint32_t>(i + static_cast<std::size_t>(j) * image->width),
+                        static_cast<std::uint32_t>(s));
+                    float u = float(i + random.get()) / float(image->width);
+                    float v = float(j + random.get()) / float(image->height);
                     Ray r = camera.getRay(u, v, random);
+                    r.setCone(0.f, pixelSpreadAngle);
 
-                    // Accumulate the sample if it's valid, otherwise discard it
-                    vec3 sampleColor;
-                    if (getColor(r, world, 0, sampleColor, random))
+                    // Accumulate the sample, a path which is absorbed brings a black color, unless it's NaN or infinite
+                    // the first hit is accumulated either way since it doesn't depend on the rest of the path
+                    SampleAovs sampleAovs;
+                    vec3 sampleColor = getSampleColor(r, scene, random, (aovs != nullptr) ? &sampleAovs : nullptr);
+                    if (accumulateSample(sampleColor, col, validSampleCount))
+                    {
+                        float luminance = getLuminance(sampleColor);
+                        squaredLuminanceSum += luminance * luminance;
+                    }
+                    else if (isNan(sampleColor))
+                    {
+                        ++nanSampleCount;
+                    }
+                    else
+                    {
+                        ++infiniteSampleCount;
+                    }
+                    if (aovs != nullptr)
                     {
-                        col += sampleColor;
-                        ++sampleCount;
+                        pixelAovs.albedo += sampleAovs.albedo;
+                        pixelAovs.normal += sampleAovs.normal;
+                        pixelAovs.depth += sampleAovs.depth;
                     }
                 }
 
-                // Average the color
-                col /= static_cast<float>(sampleCount);
-
-#ifdef RENDER_GRAYSCALE
-                // Colorimetric conversion to grayscale https://en.wikipedia.org/wiki/Grayscale
-                // apply it before gamma correction
-                float lum = 0.2126f * col[0] + 0.7152f * col[1] + 0.0722f * col[2]; // compute the luminance
+                // Average the color and store the linear radiance, the tonemapping is a separate pass
+                // the samples left out aren't counted, a pixel made of them only is black rather than NaN
+                col = averageSamples(col, validSampleCount);
+                image->at(i, j) = col;
 
-                // Apply a gamma to brighten the color
-                lum = sqrt(lum);
-
-                // Scale the color between 0 and 255
-                int il = int(255.99f * lum);
-
-                auto finalColor = std::make_tuple(il, il, il);
-#else
-                // Apply gamma correction to the color
-                col = vec3(
-                    pow(col[0], 1.f / IMAGE_GAMMA_CORRECTION),
-                    pow(col[1], 1.f / IMAGE_GAMMA_CORRECTION),
-                    pow(col[2], 1.f / IMAGE_GAMMA_CORRECTION));
-
-                // Scale the color between 0 and 255
-                int ir = int(255.99f * col[0]);
-                int ig = int(255.99f * col[1]);
-                int ib = int(255.99f * col[2]);
+                invalidSampleCount += nanSampleCount + infiniteSampleCount;
+                if (markInvalidSamples)
+                {
+                    diagnostics->invalidSamples.at(i, j) = vec3(nanSampleCount, infiniteSampleCount, 0.f) / static_cast<float>(sampleCount);
+                }
 
-                auto finalColor = std::make_tuple(ir, ig, ib);
-#endif // RENDER_GRAYSCALE
+                if (aovs != nullptr)
+                {
+                    float scale = 1.f / static_cast<float>(sampleCount);
+                    aovs->albedo.at(i, j) = pixelAovs.albedo * scale;
+                    aovs->normal.at(i, j) = pixelAovs.normal * scale;
+                    float depth = pixelAovs.depth * scale;
+                    aovs->depth.at(i, j) = vec3(depth, depth, depth);
 
-                // Store the resulting color in the array
-                (*imageData)[i + j * IMAGE_WIDTH] = finalColor;
+                    // The variance of the valid samples divided by their count, the variance of their mean
+                    float luminance = getLuminance(col);
+                    float validCount = static_cast<float>(std::max(validSampleCount, 1u));
+                    float variance = std::max(0.f, squaredLuminanceSum / validCount - luminance * luminance) / validCount;
+                    aovs->variance.at(i, j) = vec3(variance, variance, variance);
+                }
             }
         }
+
+        if (diagnostics != nullptr)
+        {
+            diagnostics->invalidSampleCounts[std::max(taskId, 0)] = invalidSampleCount;
+        }
+    }
+
+    void rayTracingMainTask(const Camera& camera, const Scene& scene, int sampleCount, HdrImage* image, AovImages* aovs, SampleDiagnostics* diagnostics)
+    {
+        rayTracingMainTask(camera, std::vector<const Scene*>(1, &scene), sampleCount, image, aovs, getThreadPool(), diagnostics);
     }
 
-    void rayTracingMainTask(const Camera& camera, const HitableList& world, ImageData* imageData)
+    void rayTracingMainTask(const Camera& camera, const std::vector<const Scene*>& nodeScenes, int sampleCount, HdrImage* image, AovImages* aovs,
+        ThreadPool* pool, SampleDiagnostics* diagnostics)
     {
 #ifdef MULTITHREADING_ON
-        std::vector<std::future<void>> subTaskFutures;
+        // The sub tasks run on the thread pool shared with the acceleration structure builders
+        TaskGroup subTasks(pool);
+        unsigned int nodeCount = (pool != nullptr) ? pool->getNodeCount() : 1;
 
         // The number of lines that each task will take care of
-        int linesPerTask = IMAGE_HEIGHT / MULTITHREADING_SUBTASK_COUNT;
+        int linesPerTask = image->height / MULTITHREADING_SUBTASK_COUNT;
+        if (diagnostics != nullptr)
+        {
+            diagnostics->invalidSampleCounts.assign(MULTITHREADING_SUBTASK_COUNT, 0);
+        }
 
         // Initialize each of the tasks
         for (int taskId = 0; taskId < MULTITHREADING_SUBTASK_COUNT; ++taskId)
         {
             // The last task takes care of whatever is left
             int startLine = taskId * linesPerTask;
-            int endLine = (taskId == MULTITHREADING_SUBTASK_COUNT - 1) ? IMAGE_HEIGHT : startLine + linesPerTask;
+            int endLine = (taskId == MULTITHREADING_SUBTASK_COUNT - 1) ? image->height : startLine + linesPerTask;
 
 #ifdef MULTITHREADING_LOGS
             // Display some debug log
@@ -199,18 +629,123 @@ namespace rts
                 std::cout << "  CREATE | RT sub task ID[" << taskId << "] to update the range [" << startLine << ", " << endLine << ")" << std::endl;
             }
 #endif // MULTITHREADING_LOGS
-            
-            // Create the async sub task
-            auto subTask = std::async(std::launch::async,
-                [&, startLine, endLine, taskId]() { rayTracingSubTask(camera, world, imageData, startLine, endLine, taskId); });
-            
-            // Store it in a vector
-            subTaskFutures.push_back(std::move(subTask));
-        }
-        // Leaving the scope will destroy the vector, which will in turn wait for the sub tasks to complete before destroying those
+
+            // The task is queued on the node of its band, but the workers of another node may steal it once they're done with theirs
+            // so the copy of the scene is picked by the worker which runs it
+            unsigned int node = static_cast<unsigned int>(taskId * nodeCount / MULTITHREADING_SUBTASK_COUNT);
+            subTasks.runOnNode(node, [&, startLine, endLine, taskId]()
+            {
+                std::size_t currentNode = (pool != nullptr) ? pool->getCurrentNode() : 0;
+                const Scene& scene = *nodeScenes[std::min(currentNode, nodeScenes.size() - 1)];
+                rayTracingSubTask(camera, scene, sampleCount, image, aovs, diagnostics, startLine, endLine, taskId);
+            });
+        }
+
+        // Wait for the sub tasks to complete, the calling thread takes part in the work meanwhile
+        subTasks.wait();
 #else
         // Multithreading is disabled, just call the function directly to update the entire image
-        rayTracingSubTask(camera, world, imageData, 0, IMAGE_HEIGHT, -1);
+        RTS_UNUSED(pool);
+        if (diagnostics != nullptr)
+        {
+            diagnostics->invalidSampleCounts.assign(1, 0);
+        }
+        rayTracingSubTask(camera, *nodeScenes.front(), sampleCount, image, aovs, diagnostics, 0, image->height, -1);
+#endif // MULTITHREADING_ON
+    }
+
+    namespace
+    {
+        // Update the rows of blocks in the range [startRow, endRow) of a progressive pass, see rayTracingProgressivePass
+        // return false if the pass has been cancelled before the last row
+        bool rayTracingProgressiveSubTask(const Camera& camera, const Scene& scene, int passIndex, int blockSize, AccumulationImage* accumulation,
+            const std::function<bool()>& isCancelled, int startRow, int endRow)
+        {
+            // The pass traces the sample passIndex of each pixel, on the same stream as rayTracingSubTask, the coarse pass uses the stream
+            // of the first pixel of each block
+            Random random;
+
+            HdrImage& sum = accumulation->sum;
+            float pixelSpreadAngle = camera.getPixelSpreadAngle(sum.height);
+            for (int row = startRow; row < endRow; ++row)
+            {
+                // The cancellation is checked once per row, the latency of a restart stays well below a pass
+                if (isCancelled && isCancelled())
+                {
+                    return false;
+                }
+
+                int startLine = row * blockSize;
+                int endLine = std::min(startLine + blockSize, sum.height);
+                for (int startColumn = 0; startColumn < sum.width; startColumn += blockSize)
+                {
+                    int endColumn = std::min(startColumn + blockSize, sum.width);
+                    random.setSampleStream(s_frameIndex, static_cast<std::uint32_t>(startColumn + static_cast<std::size_t>(startLine) * sum.width),
+                        static_cast<std::uint32_t>(passIndex));
+                    float u = (startColumn + random.get() * (endColumn - startColumn)) / float(sum.width);
+                    float v = (startLine + random.get() * (endLine - startLine)) / float(sum.height);
+                    Ray r = camera.getRay(u, v, random);
+                    r.setCone(0.f, blockSize * pixelSpreadAngle);
+
+                    // A NaN or infinite sample is left out as by the final render (see accumulateSample)
+                    vec3 color = getSampleColor(r, scene, random);
+                    if (blockSize > 1)
+                    {
+                        // The coarse pass isn't counted, the first full pass overwrites it
+                        vec3 blockColor(0.f, 0.f, 0.f);
+                        std::uint32_t blockSampleCount = 0;
+                        accumulateSample(color, blockColor, blockSampleCount);
+                        for (int j = startLine; j < endLine; ++j)
+                        {
+                            for (int i = startColumn; i < endColumn; ++i)
+                            {
+                                sum.at(i, j) = blockColor;
+                                accumulation->sampleCounts[i + static_cast<std::size_t>(j) * sum.width] = 0;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        std::size_t index = startColumn + static_cast<std::size_t>(startLine) * sum.width;
+                        if (passIndex == 0)
+                        {
+                            sum.pixels[index] = vec3(0.f, 0.f, 0.f);
+                            accumulation->sampleCounts[index] = 0;
+                        }
+                        accumulateSample(color, sum.pixels[index], accumulation->sampleCounts[index]);
+                    }
+                }
+            }
+            return true;
+        }
+    }
+
+    bool rayTracingProgressivePass(const Camera& camera, const Scene& scene, int passIndex, int blockSize, AccumulationImage* accumulation,
+        const std::function<bool()>& isCancelled)
+    {
+        int rowCount = (accumulation->sum.height + blockSize - 1) / blockSize;
+
+#ifdef MULTITHREADING_ON
+        // The rows are split between the sub tasks the same way as the lines of rayTracingMainTask
+        TaskGroup subTasks(getThreadPool());
+        std::atomic<bool> completed(true);
+        int rowsPerTask = rowCount / MULTITHREADING_SUBTASK_COUNT;
+        for (int taskId = 0; taskId < MULTITHREADING_SUBTASK_COUNT; ++taskId)
+        {
+            int startRow = taskId * rowsPerTask;
+            int endRow = (taskId == MULTITHREADING_SUBTASK_COUNT - 1) ? rowCount : startRow + rowsPerTask;
+            subTasks.run([&, startRow, endRow]()
+            {
+                if (!rayTracingProgressiveSubTask(camera, scene, passIndex, blockSize, accumulation, isCancelled, startRow, endRow))
+                {
+                    completed = false;
+                }
+            });
+        }
+        subTasks.wait();
+        return completed;
+#else
+        return rayTracingProgressiveSubTask(camera, scene, passIndex, blockSize, accumulation, isCancelled, 0, rowCount);
 #endif // MULTITHREADING_ON
     }
 }
@@ -9,8 +9,8 @@
 
 #pragma once
 
-#include <array>
-#include <tuple>
+#include <functional>
+#include <vector>
 
 #include "config.h"
 #include "vec3.h"
@@ -18,20 +18,71 @@
 namespace rts // for ray tracing series
 {
     class Camera;
-    class HitableList;
+    struct AccumulationImage;
+    struct AovImages;
+    struct HdrImage;
     class Random;
     class Ray;
+    struct SampleDiagnostics;
+    class Scene;
+    class ThreadPool;
 
-    // Find the color for the given ray
-    bool getColor(const Ray& r, const HitableList& world, int depth, vec3& color, Random& random);
+    // What a camera ray hits first, accumulated into the auxiliary images
+    struct SampleAovs
+    {
+        vec3 albedo;
+        vec3 normal;
+        float depth;
+    };
 
-    // Declare aliases for the image data
-    using Color = std::tuple<int, int, int>;
-    using ImageData = std::array<Color, IMAGE_WIDTH * IMAGE_HEIGHT>;
+    // Find the color for the given ray, the first hit is reported to aovs when it isn't null
+    // a ray which is absorbed, e.g. scattered below a fuzzy metal, brings a black color, it's still a sample of its pixel
+    vec3 getColor(const Ray& r, const Scene& scene, int depth, Random& random, SampleAovs* aovs = nullptr);
+
+    // The environment map of a scene lights the surfaces whose material can be evaluated directly (see Material::evaluate), a direction
+    // is sampled from its radiance at each of their hits and weighted against the bounce sampled by the material by multiple importance
+    // sampling, so that a small bright sun doesn't have to be hit by chance
+    // it's enabled by default, disabling it leaves the environment to the bounces, which is only meant to compare both
+    void setEnvironmentSampling(bool enabled);
+    bool isEnvironmentSampling();
+
+    // The spectral mode traces wavelengths of light rather than its RGB components, so that the dispersive dielectrics split white light
+    // each camera ray carries several wavelengths (see WavelengthSample) which follow the same path until a dispersive material refracts them
+    // in different directions, they're split there, the renders use it once it's enabled, it's disabled by default
+    void setSpectralRendering(bool enabled);
+    bool isSpectralRendering();
+
+    // The random numbers of each sample of a pixel come from their own stream, found from the frame, the pixel and the sample index
+    // (see Random::setSampleStream), so the image is the same whatever the number of threads or the split of the lines among the sub tasks
+    // the animations set the index of the frame so that their frames don't share the same noise, it's 0 by default
+    void setFrameIndex(unsigned int frameIndex);
+    unsigned int getFrameIndex();
+
+    // Find the color for the given camera ray in the spectral mode, regardless of whether it's enabled
+    vec3 getSpectralColor(const Ray& r, const Scene& scene, Random& random, SampleAovs* aovs = nullptr);
 
     // The ray tracing sub task which takes care of updating the image lines in the range [startLine, endLine)
-    void rayTracingSubTask(const Camera& camera, const HitableList& world, ImageData* imageData, int startLine, int endLine, int taskId);
+    // its count of invalid samples goes to the entry taskId of the diagnostics, which must exist (the first one without multithreading)
+    void rayTracingSubTask(const Camera& camera, const Scene& scene, int sampleCount, HdrImage* image, AovImages* aovs, SampleDiagnostics* diagnostics,
+        int startLine, int endLine, int taskId);
+
+    // The ray tracing main task which spawns multiple ray tracing sub tasks, each pixel is sampled sampleCount times
+    // the image receives the linear radiance of each pixel, its size must match the aspect ratio of the camera
+    // the auxiliary images are only computed when aovs isn't null, they must have the same size as the image
+    // the samples which aren't finite are left out of their pixel and reported to diagnostics when it isn't null, one count per sub task
+    void rayTracingMainTask(const Camera& camera, const Scene& scene, int sampleCount, HdrImage* image, AovImages* aovs = nullptr,
+        SampleDiagnostics* diagnostics = nullptr);
+
+    // The same with a copy of the scene per NUMA node of the thread pool, each sub task reads the copy of the node it runs on
+    // the lines are split in one band per node, the sub tasks of a band are queued on its node (see ThreadPool)
+    void rayTracingMainTask(const Camera& camera, const std::vector<const Scene*>& nodeScenes, int sampleCount, HdrImage* image, AovImages* aovs,
+        ThreadPool* pool, SampleDiagnostics* diagnostics = nullptr);
 
-    // The ray tracing main task which spawns multiple ray tracing sub tasks
-    void rayTracingMainTask(const Camera& camera, const HitableList& world, ImageData* imageData);
+    // A pass of the progressive rendering which traces a single ray per pixel, the sample passIndex of the pixel
+    // the colors are added to the accumulation and the finite samples counted, the first pass (passIndex 0) overwrites them instead
+    // with a block size greater than 1, a single ray is traced per block of blockSize x blockSize pixels and its color fills the block
+    // without being counted, it's a quick and coarse image to show until the first full pass completes
+    // the pass is abandoned, leaving the accumulation partially updated, once isCancelled returns true, false is then returned
+    bool rayTracingProgressivePass(const Camera& camera, const Scene& scene, int passIndex, int blockSize, AccumulationImage* accumulation,
+        const std::function<bool()>& isCancelled);
 }
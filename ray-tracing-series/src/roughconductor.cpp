@@ -0,0 +1,84 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "roughconductor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "hitable.h"
+#include "microfacet.h"
+#include "random.h"
+#include "ray.h"
+
+namespace rts
+{
+    RoughConductor::RoughConductor(const vec3& albedo, float roughness, const Texture* texture)
+        : m_albedo(albedo)
+        , m_alpha(getGgxAlpha(roughness))
+        , m_texture(texture)
+    {
+    }
+
+    bool RoughConductor::scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const
+    {
+        float pdf;
+        return sample(rIn, rec, attenuation, scattered, pdf, random);
+    }
+
+    bool RoughConductor::evaluate(const Ray& rIn, const HitRecord& rec, const vec3& direction, vec3& value, float& pdf) const
+    {
+        // The surface is lit from the side of the ray
+        SurfaceFrame frame((dot(rIn.direction(), rec.normal) < 0.f) ? rec.normal : -rec.normal);
+        vec3 wo = frame.toLocal(-rIn.direction());
+        vec3 wi = frame.toLocal(direction);
+        if (wo.z() <= 0.f || wi.z() <= 0.f)
+        {
+            return false;
+        }
+
+        vec3 m = unitVector(wo + wi);
+        float distribution = getGgxDistribution(m, m_alpha);
+        pdf = getGgxMasking(wo, m_alpha) * distribution / (4.f * wo.z());
+        value = getFresnel(rec, dot(wo, m)) * (distribution * getGgxMaskingShadowing(wo, wi, m_alpha) / (4.f * wo.z()));
+        return pdf > 0.f;
+    }
+
+    bool RoughConductor::sample(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, float& pdf, Random& random) const
+    {
+        SurfaceFrame frame((dot(rIn.direction(), rec.normal) < 0.f) ? rec.normal : -rec.normal);
+        vec3 wo = frame.toLocal(-rIn.direction());
+        float u1 = random.get();
+        float u2 = random.get();
+        vec3 m = sampleGgxVisibleNormal(wo, m_alpha, u1, u2);
+        float cosine = dot(wo, m);
+        vec3 wi = 2.f * cosine * m - wo;
+        scattered = Ray(rec.p, frame.toWorld(wi), rIn.time());
+
+        // A facet seen from the ray may still reflect it below the surface, it's then absorbed rather than discarded
+        if (wo.z() <= 0.f || wi.z() <= 0.f)
+        {
+            attenuation = vec3(0.f, 0.f, 0.f);
+            pdf = 0.f;
+            return true;
+        }
+
+        // The density of the normal and the distribution cancel out, only the shadowing of the reflection remains
+        pdf = getGgxVisibleNormalPdf(wo, m, m_alpha) / (4.f * cosine);
+        attenuation = getFresnel(rec, cosine) * (getGgxMaskingShadowing(wo, wi, m_alpha) / getGgxMasking(wo, m_alpha));
+        return true;
+    }
+
+    vec3 RoughConductor::getFresnel(const HitRecord& rec, float cosine) const
+    {
+        vec3 reflectance = getAlbedo(rec);
+        float weight = std::pow(1.f - std::min(std::max(cosine, 0.f), 1.f), 5.f);
+        return reflectance + weight * (vec3(1.f, 1.f, 1.f) - reflectance);
+    }
+}
@@ -0,0 +1,42 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include "material.h"
+#include "texture.h"
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // A rough metal made of GGX microfacets (see microfacet.h), the counterpart of Metal whose fuzz may scatter the rays
+    // below the surface and lose them, here a reflection is always sampled and the rare one which goes below the surface
+    // is absorbed, the reflectance at normal incidence is the albedo and it goes to white at grazing angles (Schlick)
+    class RoughConductor final : public Material
+    {
+    public:
+        // The texture, if any, modulates the albedo, the roughness goes from a mirror at 0 to a matte metal at 1
+        RoughConductor(const vec3& albedo, float roughness, const Texture* texture = nullptr);
+
+        virtual bool scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const override;
+        virtual vec3 getAlbedo(const HitRecord& rec) const override { return (m_texture != nullptr) ? m_albedo * m_texture->value(rec) : m_albedo; }
+
+        virtual bool canEvaluate() const override { return true; }
+        virtual bool evaluate(const Ray& rIn, const HitRecord& rec, const vec3& direction, vec3& value, float& pdf) const override;
+        virtual bool sample(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, float& pdf, Random& random) const override;
+
+    private:
+        // The Fresnel reflectance for the cosine between the ray and the facet
+        vec3 getFresnel(const HitRecord& rec, float cosine) const;
+
+        vec3 m_albedo;
+        float m_alpha; // the width of the GGX distribution
+        const Texture* m_texture;
+    };
+}
@@ -0,0 +1,143 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "roughdielectric.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "hitable.h"
+#include "microfacet.h"
+#include "random.h"
+#include "ray.h"
+
+namespace rts
+{
+    namespace
+    {
+        // The frame of the side the ray comes from and the ratio of the refraction indexes across the surface
+        SurfaceFrame getIncidentFrame(const Ray& rIn, const HitRecord& rec, float refIdx, float& eta)
+        {
+            if (dot(rIn.direction(), rec.normal) < 0.f)
+            {
+                eta = refIdx;
+                return SurfaceFrame(rec.normal);
+            }
+            eta = 1.f / refIdx;
+            return SurfaceFrame(-rec.normal);
+        }
+
+        // The change of variables from the normal of a facet to the refracted direction (Walter et al.), the denominator is
+        // positive for the refractions which follow Snell's law
+        float getRefractionJacobian(const vec3& wo, const vec3& wi, const vec3& m, float eta)
+        {
+            float denominator = dot(wo, m) + eta * dot(wi, m);
+            return eta * eta * std::abs(dot(wi, m)) / (denominator * denominator);
+        }
+    }
+
+    RoughDielectric::RoughDielectric(const vec3& albedo, float refIdx, float roughness, const Texture* texture)
+        : m_albedo(albedo)
+        , m_refIdx(refIdx)
+        , m_alpha(getGgxAlpha(roughness))
+        , m_texture(texture)
+    {
+    }
+
+    bool RoughDielectric::scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const
+    {
+        float pdf;
+        return sample(rIn, rec, attenuation, scattered, pdf, random);
+    }
+
+    bool RoughDielectric::evaluate(const Ray& rIn, const HitRecord& rec, const vec3& direction, vec3& value, float& pdf) const
+    {
+        float eta;
+        SurfaceFrame frame = getIncidentFrame(rIn, rec, m_refIdx, eta);
+        vec3 wo = frame.toLocal(-rIn.direction());
+        vec3 wi = frame.toLocal(direction);
+        if (wo.z() <= 0.f || wi.z() == 0.f)
+        {
+            return false;
+        }
+
+        // The normal of the facet which turns wo into wi, by reflection above the surface and by refraction below it
+        bool reflected = wi.z() > 0.f;
+        vec3 m = reflected ? unitVector(wo + wi) : unitVector(wo + eta * wi);
+        if (m.z() < 0.f)
+        {
+            m = -m;
+        }
+        float cosineO = dot(wo, m);
+        float cosineI = dot(wi, m);
+        if (cosineO <= 0.f || (reflected ? cosineI <= 0.f : cosineI >= 0.f))
+        {
+            return false;
+        }
+
+        float fresnel = getDielectricFresnel(cosineO, eta);
+        float distribution = getGgxDistribution(m, m_alpha);
+        float shadowing = getGgxMaskingShadowing(wo, wi, m_alpha);
+        float normalPdf = getGgxVisibleNormalPdf(wo, m, m_alpha);
+        if (reflected)
+        {
+            pdf = fresnel * normalPdf / (4.f * cosineO);
+            value = getAlbedo(rec) * (fresnel * distribution * shadowing / (4.f * wo.z()));
+        }
+        else
+        {
+            float jacobian = getRefractionJacobian(wo, wi, m, eta);
+            pdf = (1.f - fresnel) * normalPdf * jacobian;
+            value = getAlbedo(rec) * ((1.f - fresnel) * distribution * shadowing * cosineO * jacobian / wo.z());
+        }
+        return pdf > 0.f;
+    }
+
+    bool RoughDielectric::sample(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, float& pdf, Random& random) const
+    {
+        float eta;
+        SurfaceFrame frame = getIncidentFrame(rIn, rec, m_refIdx, eta);
+        vec3 wo = frame.toLocal(-rIn.direction());
+        float u1 = random.get();
+        float u2 = random.get();
+        float u3 = random.get();
+        vec3 m = sampleGgxVisibleNormal(wo, m_alpha, u1, u2);
+        float cosineO = dot(wo, m);
+        float fresnel = getDielectricFresnel(cosineO, eta);
+        float normalPdf = getGgxVisibleNormalPdf(wo, m, m_alpha);
+
+        // Reflect or refract through the facet with the probability of its reflectance, which cancels out with the Fresnel term
+        vec3 wi;
+        if (u3 < fresnel)
+        {
+            wi = 2.f * cosineO * m - wo;
+            pdf = fresnel * normalPdf / (4.f * cosineO);
+        }
+        else
+        {
+            // Snell's law through the facet, the total internal reflection has a reflectance of 1 and never gets here
+            float cosineT = std::sqrt(std::max(1.f - (1.f - cosineO * cosineO) / (eta * eta), 0.f));
+            wi = (cosineO / eta - cosineT) * m - wo / eta;
+            pdf = (1.f - fresnel) * normalPdf * getRefractionJacobian(wo, wi, m, eta);
+        }
+        scattered = Ray(rec.p, frame.toWorld(wi), rIn.time());
+
+        // The direction may end on the wrong side of the surface, it's then absorbed rather than discarded
+        bool valid = (u3 < fresnel) ? wi.z() > 0.f : wi.z() < 0.f;
+        if (wo.z() <= 0.f || !valid)
+        {
+            attenuation = vec3(0.f, 0.f, 0.f);
+            pdf = 0.f;
+            return true;
+        }
+
+        attenuation = getAlbedo(rec) * (getGgxMaskingShadowing(wo, wi, m_alpha) / getGgxMasking(wo, m_alpha));
+        return true;
+    }
+}
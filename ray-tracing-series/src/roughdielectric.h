@@ -0,0 +1,39 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include "material.h"
+#include "texture.h"
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // A frosted glass made of GGX microfacets (see microfacet.h), each facet reflects or refracts the ray like Dielectric
+    // with the probability of its exact Fresnel reflectance, the radiance isn't scaled by the change of medium, as in Dielectric
+    class RoughDielectric final : public Material
+    {
+    public:
+        // The texture, if any, modulates the albedo, the roughness goes from a clear glass at 0 to a frosted one at 1
+        RoughDielectric(const vec3& albedo, float refIdx, float roughness, const Texture* texture = nullptr);
+
+        virtual bool scatter(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, Random& random) const override;
+        virtual vec3 getAlbedo(const HitRecord& rec) const override { return (m_texture != nullptr) ? m_albedo * m_texture->value(rec) : m_albedo; }
+
+        virtual bool canEvaluate() const override { return true; }
+        virtual bool evaluate(const Ray& rIn, const HitRecord& rec, const vec3& direction, vec3& value, float& pdf) const override;
+        virtual bool sample(const Ray& rIn, const HitRecord& rec, vec3& attenuation, Ray& scattered, float& pdf, Random& random) const override;
+
+    private:
+        vec3 m_albedo;
+        float m_refIdx; // the refraction index
+        float m_alpha;  // the width of the GGX distribution
+        const Texture* m_texture;
+    };
+}
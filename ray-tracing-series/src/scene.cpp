@@ -0,0 +1,1602 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "scene.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+
+#include "camera.h"
+#include "compressedsphereset.h"
+#include "config.h"
+#include "dielectric.h"
+#include "imagetexture.h"
+#include "instance.h"
+#include "isotropic.h"
+#include "outofcoresphereset.h"
+#include "lambertian.h"
+#include "metal.h"
+#include "plane.h"
+#include "roughconductor.h"
+#include "roughdielectric.h"
+#include "sphere.h"
+#include "threadpool.h"
+#include "trianglemesh.h"
+#include "utils.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif // _WIN32
+
+namespace rts
+{
+    namespace
+    {
+        // The binary scene file starts with this header, followed by the material, the sphere, the group, the instance,
+        // the mesh, the vertex, the index, the moving sphere and the camera keyframe arrays
+        // each array starts at an offset aligned on SCENE_FILE_ALIGNMENT, all the values are little-endian
+        // the sphere array holds the sphereCount spheres of the world followed by the spheres of every group
+        struct SceneFileHeader
+        {
+            char magic[4];
+            std::uint32_t version;
+            std::uint32_t materialCount;
+            std::uint32_t groupCount;
+            std::uint32_t meshCount;
+            std::uint32_t reserved;
+            std::uint64_t sphereCount;
+            std::uint64_t instanceCount;
+            std::uint64_t vertexCount;
+            std::uint64_t indexCount;
+            std::uint64_t movingSphereCount;
+            std::uint64_t cameraKeyframeCount;
+            std::uint64_t planeCount;
+            std::uint64_t materialOffset;
+            std::uint64_t sphereOffset;
+            std::uint64_t groupOffset;
+            std::uint64_t instanceOffset;
+            std::uint64_t meshOffset;
+            std::uint64_t vertexOffset;
+            std::uint64_t indexOffset;
+            std::uint64_t movingSphereOffset;
+            std::uint64_t cameraKeyframeOffset;
+            std::uint64_t planeOffset;
+            CameraRecord camera;
+            BackgroundRecord background;
+        };
+
+        // The range of a group in the sphere array of the file
+        struct SceneFileGroup
+        {
+            std::uint64_t firstSphere;
+            std::uint64_t sphereCount;
+        };
+
+        // The ranges of a mesh in the vertex and the index arrays of the file, its indices are relative to its first vertex
+        struct SceneFileMesh
+        {
+            std::uint64_t firstVertex;
+            std::uint64_t vertexCount;
+            std::uint64_t firstIndex;
+            std::uint64_t triangleCount;
+            std::uint32_t materialIndex;
+            std::uint32_t groupIndex;
+            std::uint32_t hasNormals;
+            std::uint32_t reserved;
+        };
+
+        const char SCENE_FILE_MAGIC[4] = { 'R', 'T', 'S', 'B' };
+        const std::uint32_t SCENE_FILE_VERSION = 7;
+        const std::uint64_t SCENE_FILE_ALIGNMENT = 64;
+
+        // The records are read in place from the memory-mapped file, their layout must not change silently
+        static_assert(sizeof(SphereRecord) == 20, "SphereRecord is part of the binary scene file format");
+        static_assert(sizeof(MaterialRecord) == 24, "MaterialRecord is part of the binary scene file format");
+        static_assert(sizeof(InstanceRecord) == 52, "InstanceRecord is part of the binary scene file format");
+        static_assert(sizeof(MeshVertex) == 24, "MeshVertex is part of the binary scene file format");
+        static_assert(sizeof(MovingSphereRecord) == 40, "MovingSphereRecord is part of the binary scene file format");
+        static_assert(sizeof(CameraKeyframeRecord) == 36, "CameraKeyframeRecord is part of the binary scene file format");
+        static_assert(sizeof(PlaneRecord) == 28, "PlaneRecord is part of the binary scene file format");
+
+        std::uint64_t alignOffset(std::uint64_t offset)
+        {
+            return (offset + SCENE_FILE_ALIGNMENT - 1) / SCENE_FILE_ALIGNMENT * SCENE_FILE_ALIGNMENT;
+        }
+
+        std::unique_ptr<Material> createMaterial(const MaterialRecord& record, const Texture* texture, const DispersionRecord& dispersion)
+        {
+            vec3 albedo(record.albedo[0], record.albedo[1], record.albedo[2]);
+            switch (record.type)
+            {
+            case MaterialType::Metal:
+                return std::make_unique<Metal>(albedo, record.parameter, texture);
+            case MaterialType::Dielectric:
+                return std::make_unique<Dielectric>(albedo, record.parameter, texture, dispersion);
+            case MaterialType::Isotropic:
+                return std::make_unique<Isotropic>(albedo, texture);
+            case MaterialType::RoughConductor:
+                return std::make_unique<RoughConductor>(albedo, record.roughness, texture);
+            case MaterialType::RoughDielectric:
+                return std::make_unique<RoughDielectric>(albedo, record.parameter, record.roughness, texture);
+            case MaterialType::Lambertian:
+            default:
+                return std::make_unique<Lambertian>(albedo, texture);
+            }
+        }
+
+        bool readFloats(std::istream& is, float* values, int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                if (!(is >> values[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Return the directory of the given file path including the trailing separator, or an empty string
+        std::string getDirectory(const std::string& filePath)
+        {
+            auto separatorPos = filePath.find_last_of("/\\");
+            return (separatorPos != std::string::npos) ? filePath.substr(0, separatorPos + 1) : std::string();
+        }
+
+        // Return true if the given path starts from a root, a separator or a drive letter, a colon further in the path is part of a name
+        bool isAbsolutePath(const std::string& path)
+        {
+            bool hasDrive = path.size() >= 2 && std::isalpha(static_cast<unsigned char>(path[0])) && path[1] == ':';
+            return !path.empty() && (path[0] == '/' || path[0] == '\\' || hasDrive);
+        }
+
+        // Return the path of a file referenced by a scene file, the relative paths start from the directory of the scene file
+        std::string resolveScenePath(const std::string& sceneDirectory, const std::string& path)
+        {
+            return isAbsolutePath(path) ? path : sceneDirectory + path;
+        }
+
+        // Return the working directory including the trailing separator, or an empty string
+        std::string getWorkingDirectory()
+        {
+            char buffer[4096];
+#ifdef _WIN32
+            bool found = (_getcwd(buffer, sizeof(buffer)) != nullptr);
+#else
+            bool found = (getcwd(buffer, sizeof(buffer)) != nullptr);
+#endif // _WIN32
+            return found ? std::string(buffer) + "/" : std::string();
+        }
+
+        // Return the path of a file as seen from the given directory rather than from the working directory
+        // the relative paths of a loaded scene are resolved from the working directory, a scene file written elsewhere must not
+        // write them as they are since they're resolved again from its own directory, a path which can't be made relative is made absolute
+        std::string getPathFromDirectory(const std::string& path, const std::string& directory)
+        {
+            if (isAbsolutePath(path) || directory.empty())
+            {
+                return path;
+            }
+            if (path.compare(0, directory.size(), directory) == 0)
+            {
+                return path.substr(directory.size());
+            }
+
+            // Go up from each component of the directory, which only works when none of them goes up itself
+            bool canGoUp = !isAbsolutePath(directory);
+            std::string upPath;
+            std::size_t start = 0;
+            while (canGoUp && start < directory.size())
+            {
+                std::size_t end = std::min(directory.find_first_of("/\\", start), directory.size());
+                std::string component = directory.substr(start, end - start);
+                canGoUp = (component != "..");
+                upPath += (component.empty() || component == ".") ? "" : "../";
+                start = end + 1;
+            }
+            return canGoUp ? upPath + path : getWorkingDirectory() + path;
+        }
+
+        // Return true if the given array fits in the mapped file
+        bool isArrayInFile(std::uint64_t offset, std::uint64_t count, std::size_t elementSize, std::size_t fileSize)
+        {
+            return offset % SCENE_FILE_ALIGNMENT == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+        }
+    }
+
+    std::unique_ptr<Camera> createCameraFromRecord(const CameraRecord& record, float aspectRatio)
+    {
+        vec3 lookFrom(record.lookFrom[0], record.lookFrom[1], record.lookFrom[2]);
+        vec3 lookAt(record.lookAt[0], record.lookAt[1], record.lookAt[2]);
+        vec3 vUp(record.vUp[0], record.vUp[1], record.vUp[2]);
+        float focusDist = (record.focusDist > 0.f) ? record.focusDist : (lookFrom - lookAt).length();
+        return std::make_unique<Camera>(lookFrom, lookAt, vUp, record.vFov, aspectRatio, record.aperture, focusDist,
+            record.shutterOpen, record.shutterClose);
+    }
+
+    // The definitions of the constants, which are bound to references by the containers, e.g. assign() and push_back()
+    const std::uint32_t Scene::NO_TEXTURE;
+    const std::uint32_t Scene::NO_GROUP;
+
+    Scene::Scene()
+        : m_spheres(nullptr)
+        , m_sphereCount(0)
+        , m_movingSpheres(nullptr)
+        , m_movingSphereCount(0)
+        , m_geometryMemoryUsage(0)
+        , m_worldSpheres(nullptr)
+    {
+        m_camera = { { 0.f, 0.f, 0.f }, { 0.f, 0.f, -1.f }, { 0.f, 1.f, 0.f }, CAMERA_FOV, 0.f, 0.f, 0.f, 0.f };
+        m_background = {
+            { WORLD_BACKGROUND_COLOR_TOP.r(), WORLD_BACKGROUND_COLOR_TOP.g(), WORLD_BACKGROUND_COLOR_TOP.b() },
+            { WORLD_BACKGROUND_COLOR_BOTTOM.r(), WORLD_BACKGROUND_COLOR_BOTTOM.g(), WORLD_BACKGROUND_COLOR_BOTTOM.b() } };
+    }
+
+    Scene::~Scene()
+    {
+    }
+
+    std::uint32_t Scene::addTexture(const TextureRecord& texture)
+    {
+        vec3 color0(texture.color0[0], texture.color0[1], texture.color0[2]);
+        vec3 color1(texture.color1[0], texture.color1[1], texture.color1[2]);
+        switch (texture.type)
+        {
+        case TextureType::Checker:
+            m_textures.push_back(std::make_unique<CheckerTexture>(color0, color1, texture.scale));
+            break;
+        case TextureType::Noise:
+            m_textures.push_back(std::make_unique<NoiseTexture>(color0, texture.scale));
+            break;
+        case TextureType::Image:
+        default:
+        {
+            // The textures read in place from their files share the cache, the others are held in memory
+            if (!m_textureCache && endsWith(texture.filePath, ".rtst"))
+            {
+                m_textureCache = std::make_unique<TextureCache>(TEXTURE_CACHE_SIZE);
+            }
+            auto imageTexture = std::make_unique<ImageTexture>();
+            if (!imageTexture->load(texture.filePath, m_textureCache.get()))
+            {
+                return NO_TEXTURE;
+            }
+            m_textures.push_back(std::move(imageTexture));
+            break;
+        }
+        }
+
+        m_textureRecords.push_back(texture);
+        return static_cast<std::uint32_t>(m_textures.size() - 1);
+    }
+
+    bool Scene::setEnvironment(const EnvironmentRecord& environment)
+    {
+        auto environmentMap = std::make_unique<EnvironmentMap>();
+        if (!environmentMap->load(environment.filePath, environment.intensity, environment.rotation))
+        {
+            return false;
+        }
+        m_environment = std::move(environmentMap);
+        m_environmentRecord = environment;
+        return true;
+    }
+
+    std::uint32_t Scene::addMaterial(const MaterialRecord& material, std::uint32_t textureIndex, const DispersionRecord& dispersion)
+    {
+        m_materialRecords.push_back(material);
+        // An unknown texture is ignored
+        if (textureIndex >= m_textures.size())
+        {
+            textureIndex = NO_TEXTURE;
+        }
+        m_materialTextures.push_back(textureIndex);
+        m_materialDispersions.push_back(dispersion);
+        return static_cast<std::uint32_t>(m_materialRecords.size() - 1);
+    }
+
+    void Scene::addSphere(const vec3& center, float radius, std::uint32_t materialIndex)
+    {
+        copyMappedData();
+
+        m_ownedSpheres.push_back({ { center.x(), center.y(), center.z() }, radius, materialIndex });
+        m_spheres = m_ownedSpheres.data();
+        m_sphereCount = m_ownedSpheres.size();
+
+        // Once committed, the sphere is inserted in the hierarchy of the world which is refitted by update()
+        if (m_worldSpheres != nullptr)
+        {
+            m_worldSpheres->addSphere(m_ownedSpheres.back());
+        }
+    }
+
+    void Scene::moveSphere(std::size_t index, const vec3& center, float radius)
+    {
+        copyMappedData();
+
+        SphereRecord& sphere = m_ownedSpheres[index];
+        sphere.center[0] = center.x();
+        sphere.center[1] = center.y();
+        sphere.center[2] = center.z();
+        sphere.radius = radius;
+    }
+
+    void Scene::removeSphere(std::size_t index)
+    {
+        copyMappedData();
+
+        if (m_worldSpheres != nullptr)
+        {
+            m_worldSpheres->removeSphere(static_cast<std::uint32_t>(index));
+        }
+        m_ownedSpheres[index] = m_ownedSpheres.back();
+        m_ownedSpheres.pop_back();
+        m_spheres = m_ownedSpheres.data();
+        m_sphereCount = m_ownedSpheres.size();
+    }
+
+    BvhRefitStats Scene::update()
+    {
+        // Without spheres in the world when it was committed, or once they're compressed, there's no hierarchy to refit
+        if (m_worldSpheres == nullptr)
+        {
+            BvhRefitStats stats = {};
+            if (m_sphereCount > 0)
+            {
+                commit();
+                stats.fullRebuild = true;
+            }
+            return stats;
+        }
+
+        // The spheres are refitted first, then the top level which contains them
+        ThreadPool* pool = getThreadPool();
+        BvhRefitStats stats = m_worldSpheres->update(m_spheres, m_sphereCount, pool);
+        m_world.refit(pool);
+        return stats;
+    }
+
+    void Scene::addMovingSphere(const vec3& center0, const vec3& center1, float time0, float time1, float radius, std::uint32_t materialIndex)
+    {
+        copyMappedData();
+
+        m_ownedMovingSpheres.push_back({ { center0.x(), center0.y(), center0.z() }, { center1.x(), center1.y(), center1.z() },
+            time0, time1, radius, materialIndex });
+        m_movingSpheres = m_ownedMovingSpheres.data();
+        m_movingSphereCount = m_ownedMovingSpheres.size();
+    }
+
+    void Scene::addMedium(const vec3& center, float radius, float density, std::uint32_t materialIndex)
+    {
+        m_mediumRecords.push_back({ { center.x(), center.y(), center.z() }, radius, density, materialIndex });
+    }
+
+    void Scene::addPlane(const vec3& point, const vec3& normal, std::uint32_t materialIndex)
+    {
+        m_planeRecords.push_back({ { point.x(), point.y(), point.z() }, { normal.x(), normal.y(), normal.z() }, materialIndex });
+    }
+
+    std::uint32_t Scene::addGroup()
+    {
+        m_groups.push_back({ {}, nullptr, 0 });
+        return static_cast<std::uint32_t>(m_groups.size() - 1);
+    }
+
+    void Scene::addGroupSphere(std::uint32_t groupIndex, const vec3& center, float radius, std::uint32_t materialIndex)
+    {
+        copyMappedData();
+
+        auto& group = m_groups[groupIndex];
+        group.ownedSpheres.push_back({ { center.x(), center.y(), center.z() }, radius, materialIndex });
+        group.spheres = group.ownedSpheres.data();
+        group.sphereCount = group.ownedSpheres.size();
+    }
+
+    void Scene::addInstance(std::uint32_t groupIndex, const Transform& transform)
+    {
+        InstanceRecord instance;
+        instance.groupIndex = groupIndex;
+        std::copy(transform.values(), transform.values() + 12, instance.transform);
+        m_instances.push_back(instance);
+    }
+
+    void Scene::addCameraKeyframe(const CameraKeyframeRecord& keyframe)
+    {
+        // The keys which share the same time keep their order
+        auto it = std::upper_bound(m_cameraKeyframes.begin(), m_cameraKeyframes.end(), keyframe,
+            [](const CameraKeyframeRecord& k1, const CameraKeyframeRecord& k2) { return k1.time < k2.time; });
+        m_cameraKeyframes.insert(it, keyframe);
+    }
+
+    void Scene::addGroupMesh(std::uint32_t groupIndex, TriangleMeshData&& mesh, std::uint32_t materialIndex)
+    {
+        // Moving a vector keeps its buffer, the pointers remain valid once the entry is moved into the list
+        Mesh entry;
+        entry.ownedVertices = std::move(mesh.vertices);
+        entry.ownedIndices = std::move(mesh.indices);
+        entry.texCoords = std::move(mesh.texCoords);
+        entry.vertices = entry.ownedVertices.data();
+        entry.vertexCount = entry.ownedVertices.size();
+        entry.indices = entry.ownedIndices.data();
+        entry.triangleCount = entry.ownedIndices.size() / 3;
+        entry.hasNormals = mesh.hasNormals;
+        entry.materialIndex = materialIndex;
+        entry.groupIndex = groupIndex;
+        m_meshes.push_back(std::move(entry));
+    }
+
+    void Scene::copyMappedData()
+    {
+        // A memory-mapped scene is read-only, copy its spheres and meshes before modifying them
+        if (!m_mappedFile.isOpen())
+        {
+            return;
+        }
+        bool committed = (m_world.getHitableCount() > 0 || !m_groupHitables.empty());
+
+        m_ownedSpheres.assign(m_spheres, m_spheres + m_sphereCount);
+        m_spheres = m_ownedSpheres.data();
+        m_ownedMovingSpheres.assign(m_movingSpheres, m_movingSpheres + m_movingSphereCount);
+        m_movingSpheres = m_ownedMovingSpheres.data();
+        for (auto& group : m_groups)
+        {
+            group.ownedSpheres.assign(group.spheres, group.spheres + group.sphereCount);
+            group.spheres = group.ownedSpheres.data();
+        }
+        for (auto& mesh : m_meshes)
+        {
+            mesh.ownedVertices.assign(mesh.vertices, mesh.vertices + mesh.vertexCount);
+            mesh.ownedIndices.assign(mesh.indices, mesh.indices + 3 * mesh.triangleCount);
+            mesh.vertices = mesh.ownedVertices.data();
+            mesh.indices = mesh.ownedIndices.data();
+        }
+        m_mappedFile.close();
+
+        // The hitables of a committed scene read the records in place, the sphere sets of the groups, the meshes and the moving spheres
+        // included, they're built again over the copies rather than re-pointed one by one, it only happens at the first edit
+        if (committed)
+        {
+            commit();
+        }
+    }
+
+    void Scene::addGroupHitables(HitableBvh& hitables, const SphereRecord* spheres, std::size_t sphereCount, std::uint32_t groupIndex,
+        BvhBuildMethod buildMethod, ThreadPool* pool)
+    {
+        if (BVH_COMPRESSED && sphereCount > 0 && sphereCount <= CompressedBvh::MAX_PRIMITIVE_COUNT)
+        {
+            // Only the compressed copy is read by the render, the records aren't counted
+            // since the pages of a memory-mapped file can be reclaimed by the system
+            auto compressedSphereSet = std::make_unique<CompressedSphereSet>(spheres, sphereCount, m_materials, buildMethod, pool);
+            m_geometryMemoryUsage += compressedSphereSet->getMemoryUsage();
+            hitables.add(std::move(compressedSphereSet));
+        }
+        else if (sphereCount > 0)
+        {
+            auto sphereSet = std::make_unique<SphereSet>(spheres, sphereCount, m_materials, buildMethod, pool);
+            m_geometryMemoryUsage += sphereCount * sizeof(SphereRecord) + sphereSet->getMemoryUsage();
+            if (groupIndex == NO_GROUP)
+            {
+                m_worldSpheres = sphereSet.get();
+            }
+            hitables.add(std::move(sphereSet));
+        }
+
+        for (const auto& mesh : m_meshes)
+        {
+            if (mesh.groupIndex == groupIndex && mesh.triangleCount > 0)
+            {
+                auto triangleMesh = std::make_unique<TriangleMesh>(mesh.vertices, mesh.indices, mesh.triangleCount, mesh.hasNormals,
+                    mesh.texCoords.empty() ? nullptr : mesh.texCoords.data(), m_materials[mesh.materialIndex].get(), buildMethod, pool);
+                m_geometryMemoryUsage += mesh.vertexCount * sizeof(MeshVertex) + mesh.triangleCount * 3 * sizeof(std::uint32_t)
+                    + mesh.texCoords.size() * sizeof(float) + triangleMesh->getMemoryUsage();
+                hitables.add(std::move(triangleMesh));
+            }
+        }
+    }
+
+    void Scene::commit()
+    {
+        m_materials.clear();
+        m_materials.reserve(m_materialRecords.size());
+        for (std::size_t i = 0; i < m_materialRecords.size(); ++i)
+        {
+            std::uint32_t textureIndex = m_materialTextures[i];
+            m_materials.push_back(createMaterial(m_materialRecords[i], (textureIndex != NO_TEXTURE) ? m_textures[textureIndex].get() : nullptr,
+                m_materialDispersions[i]));
+        }
+
+        // The boundary of a medium has no material, only the medium itself is seen
+        m_media.clear();
+        for (const auto& medium : m_mediumRecords)
+        {
+            auto boundary = std::make_unique<Sphere>(vec3(medium.center[0], medium.center[1], medium.center[2]), medium.radius, nullptr);
+            m_media.push_back(std::make_unique<ConstantMedium>(std::move(boundary), medium.density, m_materials[medium.materialIndex].get()));
+        }
+
+        BvhBuildMethod buildMethod = BVH_FAST_BUILD ? BvhBuildMethod::Lbvh : BvhBuildMethod::BinnedSah;
+        ThreadPool* pool = getThreadPool();
+        m_world.clear();
+        m_worldSpheres = nullptr;
+        m_geometryMemoryUsage = 0;
+
+        // The bottom level, one hierarchy per group no matter how many times it's instanced
+        m_groupHitables.clear();
+        for (std::uint32_t i = 0; i < m_groups.size(); ++i)
+        {
+            auto groupHitables = std::make_shared<HitableBvh>();
+            addGroupHitables(*groupHitables, m_groups[i].spheres, m_groups[i].sphereCount, i, buildMethod, pool);
+            groupHitables->build(buildMethod, pool);
+            m_geometryMemoryUsage += groupHitables->getBvh().getMemoryUsage();
+            m_groupHitables.push_back(groupHitables);
+        }
+
+        // The top level, the spheres of the world are a single hitable along with its meshes and the instances
+        addGroupHitables(m_world, m_spheres, m_sphereCount, NO_GROUP, buildMethod, pool);
+
+        // The spheres streamed from brick files go along with the spheres of the world, only their top level is resident
+        for (const auto& brickFilePath : m_brickFilePaths)
+        {
+            auto bricks = std::make_unique<OutOfCoreSphereSet>(m_materials, OUT_OF_CORE_CACHE_SIZE);
+            if (bricks->open(brickFilePath) && bricks->getBrickCount() > 0)
+            {
+                m_geometryMemoryUsage += bricks->getMemoryUsage();
+                m_world.add(std::move(bricks));
+            }
+        }
+
+        // The moving spheres are bounded over the time range covered by the rays, the shutter interval of every frame
+        // the frames of an animation shift it by their time (see getCameraAt) and the scene is committed once for all of them
+        if (m_movingSphereCount > 0)
+        {
+            auto movingSpheres = std::make_unique<MovingSphereSet>(m_movingSpheres, m_movingSphereCount, m_materials,
+                getAnimationStartTime() + m_camera.shutterOpen, getAnimationEndTime() + m_camera.shutterClose, buildMethod, pool);
+            m_geometryMemoryUsage += m_movingSphereCount * sizeof(MovingSphereRecord) + movingSpheres->getMemoryUsage();
+            m_world.add(std::move(movingSpheres));
+        }
+
+        // The planes are set apart from the hierarchy by the build
+        for (const auto& plane : m_planeRecords)
+        {
+            m_world.add(std::make_unique<Plane>(vec3(plane.point[0], plane.point[1], plane.point[2]),
+                vec3(plane.normal[0], plane.normal[1], plane.normal[2]), m_materials[plane.materialIndex].get()));
+        }
+
+        m_world.reserve(m_world.getHitableCount() + m_instances.size());
+        for (const auto& instance : m_instances)
+        {
+            const auto& groupHitable = m_groupHitables[instance.groupIndex];
+            Aabb groupBounds;
+            if (groupHitable->boundingBox(groupBounds)) // an empty group has nothing to place
+            {
+                m_world.add(std::make_unique<Instance>(groupHitable, Transform(instance.transform)));
+            }
+        }
+        m_world.build(buildMethod, pool);
+
+        m_geometryMemoryUsage += m_instances.size() * (sizeof(InstanceRecord) + sizeof(Instance) + sizeof(std::unique_ptr<const Hitable>))
+            + m_world.getBvh().getMemoryUsage();
+    }
+
+    void Scene::clear()
+    {
+        m_world.clear();
+        m_worldSpheres = nullptr;
+        m_groupHitables.clear();
+        m_media.clear();
+        m_mediumRecords.clear();
+        m_planeRecords.clear();
+        m_materials.clear();
+        m_materialRecords.clear();
+        m_materialTextures.clear();
+        m_materialDispersions.clear();
+        m_textures.clear();
+        m_textureRecords.clear();
+        m_ownedSpheres.clear();
+        m_groups.clear();
+        m_instances.clear();
+        m_meshes.clear();
+        m_mappedFile.close();
+        m_spheres = nullptr;
+        m_sphereCount = 0;
+        m_ownedMovingSpheres.clear();
+        m_movingSpheres = nullptr;
+        m_movingSphereCount = 0;
+        m_cameraKeyframes.clear();
+        m_brickFilePaths.clear();
+        m_environment.reset();
+        m_geometryMemoryUsage = 0;
+    }
+
+    bool Scene::loadTextFile(const std::string& filePath)
+    {
+        std::ifstream file(filePath);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to open the scene file " << filePath << std::endl;
+            return false;
+        }
+
+        clear();
+
+        std::unordered_map<std::string, std::uint32_t> textureIndexes;
+        std::unordered_map<std::string, std::uint32_t> materialIndexes;
+        std::unordered_map<std::string, std::uint32_t> groupIndexes;
+        bool inGroup = false;
+        std::uint32_t currentGroup = 0;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            ++lineNumber;
+
+            // Strip the comments
+            auto commentPos = line.find('#');
+            if (commentPos != std::string::npos)
+            {
+                line.erase(commentPos);
+            }
+
+            std::istringstream is(line);
+            std::string keyword;
+            if (!(is >> keyword))
+            {
+                continue; // empty line
+            }
+
+            bool valid = true;
+            if (keyword == "camera")
+            {
+                valid = readFloats(is, m_camera.lookFrom, 3) && readFloats(is, m_camera.lookAt, 3) && readFloats(is, m_camera.vUp, 3)
+                    && readFloats(is, &m_camera.vFov, 1) && readFloats(is, &m_camera.aperture, 1) && readFloats(is, &m_camera.focusDist, 1);
+
+                // The shutter times are optional, the shutter is instantaneous by default
+                m_camera.shutterOpen = 0.f;
+                m_camera.shutterClose = 0.f;
+                if (valid && (is >> m_camera.shutterOpen))
+                {
+                    valid = readFloats(is, &m_camera.shutterClose, 1);
+                }
+            }
+            else if (keyword == "keyframe")
+            {
+                CameraKeyframeRecord keyframe;
+                valid = readFloats(is, &keyframe.time, 1) && readFloats(is, keyframe.lookFrom, 3) && readFloats(is, keyframe.lookAt, 3)
+                    && readFloats(is, &keyframe.aperture, 1) && readFloats(is, &keyframe.focusDist, 1);
+                if (valid)
+                {
+                    addCameraKeyframe(keyframe);
+                }
+            }
+            else if (keyword == "background")
+            {
+                valid = readFloats(is, m_background.top, 3) && readFloats(is, m_background.bottom, 3);
+            }
+            else if (keyword == "environment")
+            {
+                // The intensity and the rotation are optional
+                std::string path;
+                EnvironmentRecord environment = { std::string(), 1.f, 0.f };
+                valid = static_cast<bool>(is >> path);
+                if (valid && (is >> environment.intensity))
+                {
+                    is >> environment.rotation;
+                }
+
+                if (valid)
+                {
+                    environment.filePath = resolveScenePath(getDirectory(filePath), path);
+                    if (!setEnvironment(environment))
+                    {
+                        return false;
+                    }
+                }
+            }
+            else if (keyword == "texture")
+            {
+                std::string name, type;
+                TextureRecord texture = makeImageTextureRecord(std::string());
+                valid = static_cast<bool>(is >> name >> type);
+                if (valid && type == "checker")
+                {
+                    texture.type = TextureType::Checker;
+                    valid = readFloats(is, texture.color0, 3) && readFloats(is, texture.color1, 3) && readFloats(is, &texture.scale, 1);
+                }
+                else if (valid && type == "noise")
+                {
+                    texture.type = TextureType::Noise;
+                    valid = readFloats(is, texture.color0, 3) && readFloats(is, &texture.scale, 1);
+                }
+                else if (valid && type == "image")
+                {
+                    // The relative paths start from the directory of the scene file
+                    valid = static_cast<bool>(is >> texture.filePath);
+                    texture.filePath = resolveScenePath(getDirectory(filePath), texture.filePath);
+                }
+                else
+                {
+                    valid = false;
+                }
+
+                if (valid)
+                {
+                    std::uint32_t textureIndex = addTexture(texture);
+                    if (textureIndex == NO_TEXTURE)
+                    {
+                        return false;
+                    }
+                    textureIndexes[name] = textureIndex;
+                }
+            }
+            else if (keyword == "material")
+            {
+                std::string name, type;
+                MaterialRecord material = { MaterialType::Lambertian, { 0.f, 0.f, 0.f }, 0.f, 0.f };
+                valid = (is >> name >> type) && readFloats(is, material.albedo, 3);
+                if (valid && type == "metal")
+                {
+                    material.type = MaterialType::Metal;
+                    valid = readFloats(is, &material.parameter, 1);
+                }
+                else if (valid && type == "dielectric")
+                {
+                    material.type = MaterialType::Dielectric;
+                    valid = readFloats(is, &material.parameter, 1);
+                }
+                else if (valid && type == "isotropic")
+                {
+                    material.type = MaterialType::Isotropic;
+                }
+                else if (valid && type == "rough_conductor")
+                {
+                    material.type = MaterialType::RoughConductor;
+                    valid = readFloats(is, &material.roughness, 1);
+                }
+                else if (valid && type == "rough_dielectric")
+                {
+                    material.type = MaterialType::RoughDielectric;
+                    valid = readFloats(is, &material.parameter, 1) && readFloats(is, &material.roughness, 1);
+                }
+                else if (type != "lambertian")
+                {
+                    valid = false;
+                }
+
+                // The dispersion of a dielectric and the texture are optional
+                std::string textureKeyword, textureName;
+                DispersionRecord dispersion = makeNoDispersionRecord();
+                bool hasKeyword = valid && (is >> textureKeyword);
+                if (hasKeyword && material.type == MaterialType::Dielectric && textureKeyword == "cauchy")
+                {
+                    dispersion.model = DispersionModel::Cauchy;
+                    valid = readFloats(is, dispersion.coefficients, 1);
+                    hasKeyword = valid && (is >> textureKeyword);
+                }
+                else if (hasKeyword && material.type == MaterialType::Dielectric && textureKeyword == "sellmeier")
+                {
+                    dispersion.model = DispersionModel::Sellmeier;
+                    valid = readFloats(is, dispersion.coefficients, 6);
+                    hasKeyword = valid && (is >> textureKeyword);
+                }
+
+                std::uint32_t textureIndex = NO_TEXTURE;
+                if (hasKeyword)
+                {
+                    valid = textureKeyword == "texture" && (is >> textureName);
+                    auto it = textureIndexes.find(textureName);
+                    if (valid && it == textureIndexes.end())
+                    {
+                        std::cerr << "Scene file " << filePath << " line " << lineNumber << ": unknown texture " << textureName << std::endl;
+                        return false;
+                    }
+                    if (valid)
+                    {
+                        textureIndex = it->second;
+                    }
+                }
+
+                if (valid)
+                {
+                    materialIndexes[name] = addMaterial(material, textureIndex, dispersion);
+                }
+            }
+            else if (keyword == "sphere")
+            {
+                float center[3];
+                float radius;
+                std::string materialName;
+                valid = readFloats(is, center, 3) && readFloats(is, &radius, 1) && (is >> materialName);
+
+                auto it = materialIndexes.find(materialName);
+                if (valid && it == materialIndexes.end())
+                {
+                    std::cerr << "Scene file " << filePath << " line " << lineNumber << ": unknown material " << materialName << std::endl;
+                    return false;
+                }
+
+                if (valid && inGroup)
+                {
+                    addGroupSphere(currentGroup, vec3(center[0], center[1], center[2]), radius, it->second);
+                }
+                else if (valid)
+                {
+                    addSphere(vec3(center[0], center[1], center[2]), radius, it->second);
+                }
+            }
+            else if (keyword == "moving_sphere")
+            {
+                float center0[3], center1[3];
+                float times[2];
+                float radius;
+                std::string materialName;
+                valid = !inGroup && readFloats(is, center0, 3) && readFloats(is, center1, 3) && readFloats(is, times, 2)
+                    && readFloats(is, &radius, 1) && (is >> materialName);
+
+                auto it = materialIndexes.find(materialName);
+                if (valid && it == materialIndexes.end())
+                {
+                    std::cerr << "Scene file " << filePath << " line " << lineNumber << ": unknown material " << materialName << std::endl;
+                    return false;
+                }
+
+                if (valid)
+                {
+                    addMovingSphere(vec3(center0[0], center0[1], center0[2]), vec3(center1[0], center1[1], center1[2]), times[0], times[1], radius, it->second);
+                }
+            }
+            else if (keyword == "medium")
+            {
+                float center[3];
+                float radius, density;
+                std::string materialName;
+                valid = !inGroup && readFloats(is, center, 3) && readFloats(is, &radius, 1) && readFloats(is, &density, 1) && (is >> materialName)
+                    && density > 0.f;
+
+                auto it = materialIndexes.find(materialName);
+                if (valid && it == materialIndexes.end())
+                {
+                    std::cerr << "Scene file " << filePath << " line " << lineNumber << ": unknown material " << materialName << std::endl;
+                    return false;
+                }
+
+                if (valid)
+                {
+                    addMedium(vec3(center[0], center[1], center[2]), radius, density, it->second);
+                }
+            }
+            else if (keyword == "plane")
+            {
+                float point[3], normal[3];
+                std::string materialName;
+                valid = !inGroup && readFloats(is, point, 3) && readFloats(is, normal, 3) && (is >> materialName)
+                    && dot(vec3(normal[0], normal[1], normal[2]), vec3(normal[0], normal[1], normal[2])) > 0.f;
+
+                auto it = materialIndexes.find(materialName);
+                if (valid && it == materialIndexes.end())
+                {
+                    std::cerr << "Scene file " << filePath << " line " << lineNumber << ": unknown material " << materialName << std::endl;
+                    return false;
+                }
+
+                if (valid)
+                {
+                    addPlane(vec3(point[0], point[1], point[2]), vec3(normal[0], normal[1], normal[2]), it->second);
+                }
+            }
+            else if (keyword == "mesh")
+            {
+                std::string meshPath, materialName;
+                valid = static_cast<bool>(is >> meshPath >> materialName);
+
+                auto it = materialIndexes.find(materialName);
+                if (valid && it == materialIndexes.end())
+                {
+                    std::cerr << "Scene file " << filePath << " line " << lineNumber << ": unknown material " << materialName << std::endl;
+                    return false;
+                }
+
+                // The relative paths start from the directory of the scene file
+                TriangleMeshData mesh;
+                if (valid && !loadMeshFile(resolveScenePath(getDirectory(filePath), meshPath), mesh))
+                {
+                    return false;
+                }
+
+                if (valid)
+                {
+                    addGroupMesh(inGroup ? currentGroup : NO_GROUP, std::move(mesh), it->second);
+                }
+            }
+            else if (keyword == "group")
+            {
+                std::string name;
+                valid = !inGroup && (is >> name) && groupIndexes.find(name) == groupIndexes.end();
+                if (valid)
+                {
+                    currentGroup = addGroup();
+                    groupIndexes[name] = currentGroup;
+                    inGroup = true;
+                }
+            }
+            else if (keyword == "end")
+            {
+                valid = inGroup;
+                inGroup = false;
+            }
+            else if (keyword == "instance")
+            {
+                std::string groupName;
+                valid = !inGroup && (is >> groupName);
+
+                auto it = groupIndexes.find(groupName);
+                if (valid && it == groupIndexes.end())
+                {
+                    std::cerr << "Scene file " << filePath << " line " << lineNumber << ": unknown group " << groupName << std::endl;
+                    return false;
+                }
+
+                // Either a translation, a rotation around Y and a uniform scale, or a full matrix
+                float values[12];
+                int valueCount = 0;
+                while (valid && valueCount < 12 && (is >> values[valueCount]))
+                {
+                    ++valueCount;
+                }
+
+                if (valid && valueCount == 5)
+                {
+                    addInstance(it->second, Transform::translation(vec3(values[0], values[1], values[2]))
+                        * Transform::rotationY(values[3]) * Transform::scale(values[4]));
+                }
+                else if (valid && valueCount == 12)
+                {
+                    addInstance(it->second, Transform(values));
+                }
+                else
+                {
+                    valid = false;
+                }
+            }
+            else if (keyword == "bricks")
+            {
+                std::string brickPath;
+                valid = !inGroup && (is >> brickPath);
+
+                // The brick file is only checked here, it's opened again by commit(), its spheres refer to the materials by index
+                brickPath = resolveScenePath(getDirectory(filePath), brickPath);
+                OutOfCoreSphereSet bricks(m_materials, 0);
+                if (valid && !bricks.open(brickPath))
+                {
+                    return false;
+                }
+                if (valid && bricks.getMaterialCount() > m_materialRecords.size())
+                {
+                    std::cerr << "Scene file " << filePath << " line " << lineNumber << ": the bricks reference " << bricks.getMaterialCount()
+                        << " materials, only " << m_materialRecords.size() << " are declared" << std::endl;
+                    return false;
+                }
+
+                if (valid)
+                {
+                    m_brickFilePaths.push_back(brickPath);
+                }
+            }
+            else
+            {
+                valid = false;
+            }
+
+            if (!valid)
+            {
+                std::cerr << "Scene file " << filePath << " line " << lineNumber << ": invalid statement" << std::endl;
+                return false;
+            }
+        }
+
+        if (inGroup)
+        {
+            std::cerr << "Scene file " << filePath << ": missing end of group" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Scene::saveTextFile(const std::string& filePath, bool saveSpheresAsBricks) const
+    {
+        std::ofstream file(filePath);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to create the scene file " << filePath << std::endl;
+            return false;
+        }
+
+        // Enough digits for every float to be read back exactly
+        file.precision(std::numeric_limits<float>::max_digits10);
+
+        const auto& c = m_camera;
+        file << "camera " << c.lookFrom[0] << " " << c.lookFrom[1] << " " << c.lookFrom[2] << " "
+            << c.lookAt[0] << " " << c.lookAt[1] << " " << c.lookAt[2] << " "
+            << c.vUp[0] << " " << c.vUp[1] << " " << c.vUp[2] << " "
+            << c.vFov << " " << c.aperture << " " << c.focusDist << " " << c.shutterOpen << " " << c.shutterClose << "\n";
+        for (const auto& k : m_cameraKeyframes)
+        {
+            file << "keyframe " << k.time << " " << k.lookFrom[0] << " " << k.lookFrom[1] << " " << k.lookFrom[2] << " "
+                << k.lookAt[0] << " " << k.lookAt[1] << " " << k.lookAt[2] << " " << k.aperture << " " << k.focusDist << "\n";
+        }
+
+        const auto& b = m_background;
+        file << "background " << b.top[0] << " " << b.top[1] << " " << b.top[2] << " "
+            << b.bottom[0] << " " << b.bottom[1] << " " << b.bottom[2] << "\n";
+        if (m_environment)
+        {
+            const auto& e = m_environmentRecord;
+            file << "environment " << getPathFromDirectory(e.filePath, getDirectory(filePath)) << " " << e.intensity << " " << e.rotation << "\n";
+        }
+
+        // The textures and the materials are anonymous once loaded, name them after their index
+        for (std::size_t i = 0; i < m_textureRecords.size(); ++i)
+        {
+            const auto& t = m_textureRecords[i];
+            file << "texture t" << i;
+            if (t.type == TextureType::Checker)
+            {
+                file << " checker " << t.color0[0] << " " << t.color0[1] << " " << t.color0[2] << " "
+                    << t.color1[0] << " " << t.color1[1] << " " << t.color1[2] << " " << t.scale << "\n";
+            }
+            else if (t.type == TextureType::Noise)
+            {
+                file << " noise " << t.color0[0] << " " << t.color0[1] << " " << t.color0[2] << " " << t.scale << "\n";
+            }
+            else
+            {
+                file << " image " << getPathFromDirectory(t.filePath, getDirectory(filePath)) << "\n";
+            }
+        }
+
+        const char* typeNames[] = { "lambertian", "metal", "dielectric", "isotropic", "rough_conductor", "rough_dielectric" };
+        for (std::size_t i = 0; i < m_materialRecords.size(); ++i)
+        {
+            const auto& m = m_materialRecords[i];
+            file << "material m" << i << " " << typeNames[static_cast<std::uint32_t>(m.type)] << " "
+                << m.albedo[0] << " " << m.albedo[1] << " " << m.albedo[2];
+            if (m.type == MaterialType::Metal || m.type == MaterialType::Dielectric || m.type == MaterialType::RoughDielectric)
+            {
+                file << " " << m.parameter;
+            }
+            if (m.type == MaterialType::RoughConductor || m.type == MaterialType::RoughDielectric)
+            {
+                file << " " << m.roughness;
+            }
+            const DispersionRecord& d = m_materialDispersions[i];
+            if (d.model == DispersionModel::Cauchy)
+            {
+                file << " cauchy " << d.coefficients[0];
+            }
+            else if (d.model == DispersionModel::Sellmeier)
+            {
+                file << " sellmeier";
+                for (float coefficient : d.coefficients)
+                {
+                    file << " " << coefficient;
+                }
+            }
+            if (m_materialTextures[i] != NO_TEXTURE)
+            {
+                file << " texture t" << m_materialTextures[i];
+            }
+            file << "\n";
+        }
+
+        auto writeSpheres = [&file](const SphereRecord* spheres, std::size_t sphereCount)
+        {
+            for (std::size_t i = 0; i < sphereCount; ++i)
+            {
+                const auto& sphere = spheres[i];
+                file << "sphere " << sphere.center[0] << " " << sphere.center[1] << " " << sphere.center[2] << " "
+                    << sphere.radius << " m" << sphere.materialIndex << "\n";
+            }
+        };
+
+        // The meshes are written to OBJ files next to the scene file
+        std::string baseName = filePath.substr(getDirectory(filePath).size());
+        baseName = baseName.substr(0, baseName.find_last_of('.'));
+        bool meshesSaved = true;
+        auto writeMeshes = [&](std::uint32_t groupIndex)
+        {
+            for (std::size_t i = 0; i < m_meshes.size(); ++i)
+            {
+                const auto& mesh = m_meshes[i];
+                if (mesh.groupIndex == groupIndex)
+                {
+                    std::string meshFileName = baseName + "_mesh" + std::to_string(i) + ".obj";
+                    meshesSaved = meshesSaved && saveObjFile(getDirectory(filePath) + meshFileName, mesh.vertices, mesh.vertexCount,
+                        mesh.indices, mesh.triangleCount, mesh.hasNormals, mesh.texCoords.empty() ? nullptr : mesh.texCoords.data());
+                    file << "mesh " << meshFileName << " m" << mesh.materialIndex << "\n";
+                }
+            }
+        };
+
+        // The spheres of the world can be written to a brick file next to the scene file as well, for out-of-core rendering
+        bool bricksSaved = true;
+        if (saveSpheresAsBricks && m_sphereCount > 0)
+        {
+            std::string brickFileName = baseName + "_bricks.rtsk";
+            bricksSaved = saveSphereBricks(getDirectory(filePath) + brickFileName, m_spheres, m_sphereCount, OUT_OF_CORE_BRICK_SPHERE_COUNT, getThreadPool());
+            file << "bricks " << brickFileName << "\n";
+        }
+        else
+        {
+            writeSpheres(m_spheres, m_sphereCount);
+        }
+        for (const auto& brickFilePath : m_brickFilePaths)
+        {
+            file << "bricks " << getPathFromDirectory(brickFilePath, getDirectory(filePath)) << "\n";
+        }
+        writeMeshes(NO_GROUP);
+
+        for (std::size_t i = 0; i < m_movingSphereCount; ++i)
+        {
+            const auto& sphere = m_movingSpheres[i];
+            file << "moving_sphere " << sphere.center0[0] << " " << sphere.center0[1] << " " << sphere.center0[2] << " "
+                << sphere.center1[0] << " " << sphere.center1[1] << " " << sphere.center1[2] << " "
+                << sphere.time0 << " " << sphere.time1 << " " << sphere.radius << " m" << sphere.materialIndex << "\n";
+        }
+
+        for (const auto& plane : m_planeRecords)
+        {
+            file << "plane " << plane.point[0] << " " << plane.point[1] << " " << plane.point[2] << " "
+                << plane.normal[0] << " " << plane.normal[1] << " " << plane.normal[2] << " m" << plane.materialIndex << "\n";
+        }
+
+        for (const auto& medium : m_mediumRecords)
+        {
+            file << "medium " << medium.center[0] << " " << medium.center[1] << " " << medium.center[2] << " "
+                << medium.radius << " " << medium.density << " m" << medium.materialIndex << "\n";
+        }
+
+        // The groups are named after their index as well, the instances are written with their full matrix
+        for (std::uint32_t i = 0; i < m_groups.size(); ++i)
+        {
+            file << "group g" << i << "\n";
+            writeSpheres(m_groups[i].spheres, m_groups[i].sphereCount);
+            writeMeshes(i);
+            file << "end\n";
+        }
+
+        for (const auto& instance : m_instances)
+        {
+            file << "instance g" << instance.groupIndex;
+            for (float value : instance.transform)
+            {
+                file << " " << value;
+            }
+            file << "\n";
+        }
+
+        return meshesSaved && bricksSaved && file.good();
+    }
+
+    bool Scene::loadBinaryFile(const std::string& filePath)
+    {
+        clear();
+
+        if (!m_mappedFile.open(filePath))
+        {
+            std::cerr << "Unable to map the scene file " << filePath << std::endl;
+            return false;
+        }
+
+        // Validate the header and the size of the arrays against the size of the file
+        SceneFileHeader header;
+        std::size_t fileSize = m_mappedFile.size();
+        bool valid = fileSize >= sizeof(header);
+        if (valid)
+        {
+            std::memcpy(&header, m_mappedFile.data(), sizeof(header));
+            valid = std::memcmp(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) == 0
+                && header.version == SCENE_FILE_VERSION
+                && isArrayInFile(header.materialOffset, header.materialCount, sizeof(MaterialRecord), fileSize)
+                && isArrayInFile(header.sphereOffset, header.sphereCount, sizeof(SphereRecord), fileSize)
+                && isArrayInFile(header.groupOffset, header.groupCount, sizeof(SceneFileGroup), fileSize)
+                && isArrayInFile(header.instanceOffset, header.instanceCount, sizeof(InstanceRecord), fileSize)
+                && isArrayInFile(header.meshOffset, header.meshCount, sizeof(SceneFileMesh), fileSize)
+                && isArrayInFile(header.vertexOffset, header.vertexCount, sizeof(MeshVertex), fileSize)
+                && isArrayInFile(header.indexOffset, header.indexCount, sizeof(std::uint32_t), fileSize)
+                && isArrayInFile(header.movingSphereOffset, header.movingSphereCount, sizeof(MovingSphereRecord), fileSize)
+                && isArrayInFile(header.cameraKeyframeOffset, header.cameraKeyframeCount, sizeof(CameraKeyframeRecord), fileSize)
+                && isArrayInFile(header.planeOffset, header.planeCount, sizeof(PlaneRecord), fileSize);
+        }
+
+        // The groups are ranges of the sphere array, the instances are small and copied like the materials
+        const auto* spheres = reinterpret_cast<const SphereRecord*>(m_mappedFile.data() + (valid ? header.sphereOffset : 0));
+        std::uint64_t sphereArraySize = valid ? (fileSize - header.sphereOffset) / sizeof(SphereRecord) : 0;
+        for (std::uint32_t i = 0; valid && i < header.groupCount; ++i)
+        {
+            SceneFileGroup group;
+            std::memcpy(&group, m_mappedFile.data() + header.groupOffset + i * sizeof(SceneFileGroup), sizeof(group));
+            valid = group.firstSphere <= sphereArraySize && group.sphereCount <= sphereArraySize - group.firstSphere;
+            if (valid)
+            {
+                m_groups.push_back({ {}, spheres + group.firstSphere, static_cast<std::size_t>(group.sphereCount) });
+            }
+        }
+
+        if (valid)
+        {
+            const auto* instances = reinterpret_cast<const InstanceRecord*>(m_mappedFile.data() + header.instanceOffset);
+            m_instances.assign(instances, instances + header.instanceCount);
+            for (const auto& instance : m_instances)
+            {
+                valid = valid && instance.groupIndex < header.groupCount;
+            }
+        }
+
+        // The vertices and the indices of the meshes are used in place as well
+        for (std::uint32_t i = 0; valid && i < header.meshCount; ++i)
+        {
+            SceneFileMesh mesh;
+            std::memcpy(&mesh, m_mappedFile.data() + header.meshOffset + i * sizeof(SceneFileMesh), sizeof(mesh));
+            valid = mesh.firstVertex <= header.vertexCount && mesh.vertexCount <= header.vertexCount - mesh.firstVertex
+                && mesh.firstIndex <= header.indexCount && mesh.triangleCount <= (header.indexCount - mesh.firstIndex) / 3
+                && mesh.materialIndex < header.materialCount
+                && (mesh.groupIndex < header.groupCount || mesh.groupIndex == NO_GROUP);
+            if (valid)
+            {
+                Mesh entry;
+                entry.vertices = reinterpret_cast<const MeshVertex*>(m_mappedFile.data() + header.vertexOffset) + mesh.firstVertex;
+                entry.vertexCount = static_cast<std::size_t>(mesh.vertexCount);
+                entry.indices = reinterpret_cast<const std::uint32_t*>(m_mappedFile.data() + header.indexOffset) + mesh.firstIndex;
+                entry.triangleCount = static_cast<std::size_t>(mesh.triangleCount);
+                entry.hasNormals = mesh.hasNormals != 0;
+                entry.materialIndex = mesh.materialIndex;
+                entry.groupIndex = mesh.groupIndex;
+                m_meshes.push_back(std::move(entry));
+            }
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Invalid binary scene file " << filePath << std::endl;
+            clear();
+            return false;
+        }
+
+        m_camera = header.camera;
+        m_background = header.background;
+
+        // The keyframes are few and copied as well, they're sorted when the file is saved
+        const auto* keyframes = reinterpret_cast<const CameraKeyframeRecord*>(m_mappedFile.data() + header.cameraKeyframeOffset);
+        m_cameraKeyframes.assign(keyframes, keyframes + header.cameraKeyframeCount);
+
+        // The same goes for the planes
+        const auto* planes = reinterpret_cast<const PlaneRecord*>(m_mappedFile.data() + header.planeOffset);
+        m_planeRecords.assign(planes, planes + header.planeCount);
+
+        // The materials are few, copy them since they're used to create the Material objects
+        const auto* materials = reinterpret_cast<const MaterialRecord*>(m_mappedFile.data() + header.materialOffset);
+        m_materialRecords.assign(materials, materials + header.materialCount);
+        m_materialTextures.assign(header.materialCount, NO_TEXTURE);
+        m_materialDispersions.assign(header.materialCount, makeNoDispersionRecord());
+
+        // The spheres are used in place, no copy is involved
+        m_spheres = spheres;
+        m_sphereCount = static_cast<std::size_t>(header.sphereCount);
+        m_movingSpheres = reinterpret_cast<const MovingSphereRecord*>(m_mappedFile.data() + header.movingSphereOffset);
+        m_movingSphereCount = static_cast<std::size_t>(header.movingSphereCount);
+
+        // Make sure that every material index is valid, it's a single sequential pass over the mapped pages
+        bool validMaterials = true;
+        auto checkMaterials = [&validMaterials, &header](const SphereRecord* groupSpheres, std::size_t sphereCount)
+        {
+            std::uint32_t maxMaterialIndex = 0;
+            for (std::size_t i = 0; i < sphereCount; ++i)
+            {
+                maxMaterialIndex = std::max(maxMaterialIndex, groupSpheres[i].materialIndex);
+            }
+            validMaterials = validMaterials && (sphereCount == 0 || maxMaterialIndex < header.materialCount);
+        };
+
+        checkMaterials(m_spheres, m_sphereCount);
+        for (const auto& group : m_groups)
+        {
+            checkMaterials(group.spheres, group.sphereCount);
+        }
+        for (std::size_t i = 0; i < m_movingSphereCount; ++i)
+        {
+            validMaterials = validMaterials && m_movingSpheres[i].materialIndex < header.materialCount;
+        }
+        for (const auto& plane : m_planeRecords)
+        {
+            validMaterials = validMaterials && plane.materialIndex < header.materialCount;
+        }
+
+        if (!validMaterials)
+        {
+            std::cerr << "Invalid material index in the binary scene file " << filePath << std::endl;
+            clear();
+            return false;
+        }
+
+        // The same goes for the vertex indices of the meshes
+        for (const auto& mesh : m_meshes)
+        {
+            std::uint32_t maxVertexIndex = 0;
+            for (std::size_t i = 0; i < 3 * mesh.triangleCount; ++i)
+            {
+                maxVertexIndex = std::max(maxVertexIndex, mesh.indices[i]);
+            }
+            if (mesh.triangleCount > 0 && maxVertexIndex >= mesh.vertexCount)
+            {
+                std::cerr << "Invalid vertex index in the binary scene file " << filePath << std::endl;
+                clear();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Scene::saveBinaryFile(const std::string& filePath) const
+    {
+        if (!m_brickFilePaths.empty())
+        {
+            std::cerr << "Unable to save the scene file " << filePath << ", the binary format can't reference brick files" << std::endl;
+            return false;
+        }
+
+        // Nor textures, the texture coordinates of the meshes aren't saved either since they're only read by the textures
+        if (!m_textures.empty())
+        {
+            std::cerr << "Unable to save the scene file " << filePath << ", the binary format can't reference textures" << std::endl;
+            return false;
+        }
+
+        // Nor an environment map
+        if (m_environment)
+        {
+            std::cerr << "Unable to save the scene file " << filePath << ", the binary format can't reference an environment map" << std::endl;
+            return false;
+        }
+
+        // Nor media, they're only meant for the text format
+        if (!m_mediumRecords.empty())
+        {
+            std::cerr << "Unable to save the scene file " << filePath << ", the binary format can't hold media" << std::endl;
+            return false;
+        }
+
+        // Nor the dispersion of the dielectrics, the material records would lose it
+        for (const auto& dispersion : m_materialDispersions)
+        {
+            if (dispersion.model != DispersionModel::None)
+            {
+                std::cerr << "Unable to save the scene file " << filePath << ", the binary format can't hold dispersive materials" << std::endl;
+                return false;
+            }
+        }
+
+        std::ofstream file(filePath, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to create the scene file " << filePath << std::endl;
+            return false;
+        }
+
+        // The spheres of the groups follow the spheres of the world
+        std::vector<SceneFileGroup> groups;
+        std::uint64_t totalSphereCount = m_sphereCount;
+        for (const auto& group : m_groups)
+        {
+            groups.push_back({ totalSphereCount, group.sphereCount });
+            totalSphereCount += group.sphereCount;
+        }
+
+        // The vertices and the indices of the meshes are concatenated
+        std::vector<SceneFileMesh> meshes;
+        std::uint64_t totalVertexCount = 0;
+        std::uint64_t totalIndexCount = 0;
+        for (const auto& mesh : m_meshes)
+        {
+            meshes.push_back({ totalVertexCount, mesh.vertexCount, totalIndexCount, mesh.triangleCount,
+                mesh.materialIndex, mesh.groupIndex, mesh.hasNormals ? 1u : 0u, 0u });
+            totalVertexCount += mesh.vertexCount;
+            totalIndexCount += 3 * mesh.triangleCount;
+        }
+
+        SceneFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC));
+        header.version = SCENE_FILE_VERSION;
+        header.materialCount = static_cast<std::uint32_t>(m_materialRecords.size());
+        header.groupCount = static_cast<std::uint32_t>(groups.size());
+        header.sphereCount = m_sphereCount;
+        header.instanceCount = m_instances.size();
+        header.meshCount = static_cast<std::uint32_t>(meshes.size());
+        header.vertexCount = totalVertexCount;
+        header.indexCount = totalIndexCount;
+        header.movingSphereCount = m_movingSphereCount;
+        header.materialOffset = alignOffset(sizeof(header));
+        header.sphereOffset = alignOffset(header.materialOffset + header.materialCount * sizeof(MaterialRecord));
+        header.groupOffset = alignOffset(header.sphereOffset + totalSphereCount * sizeof(SphereRecord));
+        header.instanceOffset = alignOffset(header.groupOffset + header.groupCount * sizeof(SceneFileGroup));
+        header.meshOffset = alignOffset(header.instanceOffset + header.instanceCount * sizeof(InstanceRecord));
+        header.vertexOffset = alignOffset(header.meshOffset + header.meshCount * sizeof(SceneFileMesh));
+        header.indexOffset = alignOffset(header.vertexOffset + totalVertexCount * sizeof(MeshVertex));
+        header.movingSphereOffset = alignOffset(header.indexOffset + totalIndexCount * sizeof(std::uint32_t));
+        header.cameraKeyframeCount = m_cameraKeyframes.size();
+        header.cameraKeyframeOffset = alignOffset(header.movingSphereOffset + m_movingSphereCount * sizeof(MovingSphereRecord));
+        header.planeCount = m_planeRecords.size();
+        header.planeOffset = alignOffset(header.cameraKeyframeOffset + header.cameraKeyframeCount * sizeof(CameraKeyframeRecord));
+        header.camera = m_camera;
+        header.background = m_background;
+
+        const char padding[SCENE_FILE_ALIGNMENT] = {};
+        std::uint64_t position = 0;
+        auto writeArray = [&file, &padding, &position](std::uint64_t offset, const void* data, std::uint64_t size)
+        {
+            file.write(padding, offset - position);
+            file.write(static_cast<const char*>(data), size);
+            position = offset + size;
+        };
+
+        writeArray(0, &header, sizeof(header));
+        writeArray(header.materialOffset, m_materialRecords.data(), header.materialCount * sizeof(MaterialRecord));
+        writeArray(header.sphereOffset, m_spheres, m_sphereCount * sizeof(SphereRecord));
+        for (const auto& group : m_groups)
+        {
+            writeArray(position, group.spheres, group.sphereCount * sizeof(SphereRecord));
+        }
+        writeArray(header.groupOffset, groups.data(), groups.size() * sizeof(SceneFileGroup));
+        writeArray(header.instanceOffset, m_instances.data(), m_instances.size() * sizeof(InstanceRecord));
+        writeArray(header.meshOffset, meshes.data(), meshes.size() * sizeof(SceneFileMesh));
+
+        // The vertex and the index arrays are written one mesh at a time
+        writeArray(header.vertexOffset, nullptr, 0);
+        for (const auto& mesh : m_meshes)
+        {
+            writeArray(position, mesh.vertices, mesh.vertexCount * sizeof(MeshVertex));
+        }
+        writeArray(header.indexOffset, nullptr, 0);
+        for (const auto& mesh : m_meshes)
+        {
+            writeArray(position, mesh.indices, 3 * mesh.triangleCount * sizeof(std::uint32_t));
+        }
+        writeArray(header.movingSphereOffset, m_movingSpheres, m_movingSphereCount * sizeof(MovingSphereRecord));
+        writeArray(header.cameraKeyframeOffset, m_cameraKeyframes.data(), m_cameraKeyframes.size() * sizeof(CameraKeyframeRecord));
+        writeArray(header.planeOffset, m_planeRecords.data(), m_planeRecords.size() * sizeof(PlaneRecord));
+
+        return file.good();
+    }
+
+    bool Scene::loadFile(const std::string& filePath)
+    {
+        return endsWith(filePath, ".rtsb") ? loadBinaryFile(filePath) : loadTextFile(filePath);
+    }
+
+    std::unique_ptr<Camera> Scene::createCamera(float aspectRatio) const
+    {
+        return createCameraFromRecord(m_camera, aspectRatio);
+    }
+
+    CameraRecord Scene::getCameraAt(float time) const
+    {
+        CameraRecord camera = m_camera;
+        camera.shutterOpen += time;
+        camera.shutterClose += time;
+        if (m_cameraKeyframes.empty())
+        {
+            return camera;
+        }
+
+        // Find the keys around the time, the camera stays on the first and the last keys outside of the animation
+        auto next = std::upper_bound(m_cameraKeyframes.begin(), m_cameraKeyframes.end(), time,
+            [](float t, const CameraKeyframeRecord& k) { return t < k.time; });
+        std::size_t i1 = static_cast<std::size_t>(next - m_cameraKeyframes.begin());
+        std::size_t last = m_cameraKeyframes.size() - 1;
+        std::size_t i0 = (i1 > 0) ? i1 - 1 : 0;
+        i1 = std::min(i1, last);
+        const CameraKeyframeRecord& k0 = m_cameraKeyframes[i0];
+        const CameraKeyframeRecord& k1 = m_cameraKeyframes[i1];
+        float duration = k1.time - k0.time;
+        float t = (duration > 0.f) ? std::min(std::max((time - k0.time) / duration, 0.f), 1.f) : 0.f;
+
+        // The positions follow a Catmull-Rom spline through the keys, the end keys are repeated to close it
+        const CameraKeyframeRecord& kBefore = m_cameraKeyframes[(i0 > 0) ? i0 - 1 : 0];
+        const CameraKeyframeRecord& kAfter = m_cameraKeyframes[std::min(i1 + 1, last)];
+        auto interpolate = [t](float p0, float p1, float p2, float p3)
+        {
+            return 0.5f * ((2.f * p1) + (p2 - p0) * t + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t * t + (3.f * p1 - p0 - 3.f * p2 + p3) * t * t * t);
+        };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            camera.lookFrom[axis] = interpolate(kBefore.lookFrom[axis], k0.lookFrom[axis], k1.lookFrom[axis], kAfter.lookFrom[axis]);
+            camera.lookAt[axis] = interpolate(kBefore.lookAt[axis], k0.lookAt[axis], k1.lookAt[axis], kAfter.lookAt[axis]);
+        }
+
+        // The lens parameters are simply blended
+        camera.aperture = k0.aperture + t * (k1.aperture - k0.aperture);
+        camera.focusDist = k0.focusDist + t * (k1.focusDist - k0.focusDist);
+        return camera;
+    }
+
+    std::unique_ptr<Camera> Scene::createCamera(float aspectRatio, float time) const
+    {
+        return createCameraFromRecord(getCameraAt(time), aspectRatio);
+    }
+
+    vec3 Scene::getBackgroundColor(const vec3& unitDirection) const
+    {
+        if (m_environment)
+        {
+            return m_environment->getRadiance(unitDirection);
+        }
+
+        float t = 0.5f * (unitDirection.y() + 1.f); // scale unitDirection Y between 0 and +1
+
+        // Blend the background top/bottom colors depending on the ray's direction
+        vec3 top(m_background.top[0], m_background.top[1], m_background.top[2]);
+        vec3 bottom(m_background.bottom[0], m_background.bottom[1], m_background.bottom[2]);
+        return (1.f - t) * bottom + t * top;
+    }
+
+    // Text scene file format
+    // Each line holds a single statement, everything following a # is a comment
+    //      camera <lookFrom x y z> <lookAt x y z> <vUp x y z> <vFov> <aperture> <focusDist> [<shutter open> <shutter close>]
+    //      keyframe <time> <lookFrom x y z> <lookAt x y z> <aperture> <focusDist>
+    //      background <top r g b> <bottom r g b>
+    //      environment <PFM file path> [<intensity> [<rotation around y in degrees>]]
+    //      texture <name> checker <odd r g b> <even r g b> <frequency>
+    //      texture <name> noise <color r g b> <scale>
+    //      texture <name> image <PPM, PFM or tiled texture file path>
+    //      material <name> lambertian <albedo r g b> [texture <texture name>]
+    //      material <name> metal <albedo r g b> <fuzz> [texture <texture name>]
+    //      material <name> dielectric <albedo r g b> <refIdx> [cauchy <B> | sellmeier <B1 B2 B3 C1 C2 C3>] [texture <texture name>]
+    //      material <name> isotropic <albedo r g b> [texture <texture name>]
+    //      material <name> rough_conductor <albedo r g b> <roughness> [texture <texture name>]
+    //      material <name> rough_dielectric <albedo r g b> <refIdx> <roughness> [texture <texture name>]
+    //      sphere <center x y z> <radius> <material name>
+    //      moving_sphere <center0 x y z> <center1 x y z> <time0> <time1> <radius> <material name>
+    //      group <name>
+    //      end
+    //      instance <group name> <translation x y z> <rotation around y in degrees> <scale>
+    //      instance <group name> <row-major 3x4 matrix>
+    //      mesh <OBJ or PLY file path> <material name>
+    //      medium <center x y z> <radius> <density> <material name>
+    //      plane <point x y z> <normal x y z> <material name>
+    //      bricks <brick file path>
+    // a material must be declared before being referenced by a sphere, and a texture before being referenced by a material
+    // the texture modulates the albedo of the material, the spheres and the meshes map an image with their texture coordinates
+    // while the checker and the noise are defined over the world space
+    // a tiled texture file (.rtst) is read in place through the texture cache, a scene may then hold more texels than the memory
+    // (see ImageTexture), an image is converted with --save-texture
+    // the spheres and meshes declared between group and end belong to the group, they're only placed in the world by instances
+    // a relative mesh, brick or texture file path starts from the directory of the scene file
+    // a brick file holds spheres of the world streamed from the disk (see OutOfCoreSphereSet), they refer to the materials
+    // by their index in the order of declaration, a scene is converted with saveTextFile(filePath, true) or --save-bricks
+    // a focusDist of 0 means that the distance between lookFrom and lookAt is used
+    // a moving sphere goes from center0 at time0 to center1 at time1, it's blurred when the shutter interval overlaps its motion
+    // the moving spheres can't be placed in groups
+    // a medium of constant density fills a sphere (see ConstantMedium), its material is usually an isotropic one, it can't be placed
+    // in groups either, a low density over a large sphere around the camera gives fog
+    // a plane is infinite, it's an exact ground where a huge sphere would lose precision (see Plane), it can't be placed in groups
+    // an environment map replaces the background and lights the scene, it's a latitude-longitude image (see EnvironmentMap)
+    // the dispersion of a dielectric makes its refraction index vary with the wavelength in the spectral mode (see DispersionModel)
+    // the RGB mode keeps refIdx, the dispersive materials can't be saved to the binary format
+    // the roughness of the rough materials goes from 0, a mirror or a clear glass, to 1 (see microfacet.h)
+    // the keyframes animate the camera given by the camera statement, from the earliest to the latest one (see Scene::getCameraAt)
+}
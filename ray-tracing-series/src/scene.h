@@ -0,0 +1,354 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "constantmedium.h"
+#include "dielectric.h"
+#include "environmentmap.h"
+#include "hitablebvh.h"
+#include "mappedfile.h"
+#include "meshloader.h"
+#include "movingsphereset.h"
+#include "sphereset.h"
+#include "texture.h"
+#include "texturecache.h"
+#include "transform.h"
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    class Camera;
+
+    enum class MaterialType : std::uint32_t
+    {
+        Lambertian = 0,
+        Metal = 1,
+        Dielectric = 2,
+        Isotropic = 3,
+        RoughConductor = 4,
+        RoughDielectric = 5
+    };
+
+    // The description of a material, the parameter is the fuzz factor of a metal or the refraction index of a dielectric
+    // an isotropic material is the phase function of a medium, it has no parameter
+    // the roughness is the one of the microfacets of the rough conductors and dielectrics, the other materials ignore it
+    struct MaterialRecord
+    {
+        MaterialType type;
+        float albedo[3];
+        float parameter;
+        float roughness;
+    };
+
+    inline MaterialRecord makeLambertianRecord(const vec3& albedo)
+    {
+        return { MaterialType::Lambertian, { albedo.r(), albedo.g(), albedo.b() }, 0.f, 0.f };
+    }
+
+    inline MaterialRecord makeMetalRecord(const vec3& albedo, float fuzz)
+    {
+        return { MaterialType::Metal, { albedo.r(), albedo.g(), albedo.b() }, fuzz, 0.f };
+    }
+
+    inline MaterialRecord makeDielectricRecord(const vec3& albedo, float refIdx)
+    {
+        return { MaterialType::Dielectric, { albedo.r(), albedo.g(), albedo.b() }, refIdx, 0.f };
+    }
+
+    inline MaterialRecord makeRoughConductorRecord(const vec3& albedo, float roughness)
+    {
+        return { MaterialType::RoughConductor, { albedo.r(), albedo.g(), albedo.b() }, 0.f, roughness };
+    }
+
+    inline MaterialRecord makeRoughDielectricRecord(const vec3& albedo, float refIdx, float roughness)
+    {
+        return { MaterialType::RoughDielectric, { albedo.r(), albedo.g(), albedo.b() }, refIdx, roughness };
+    }
+
+    inline MaterialRecord makeIsotropicRecord(const vec3& albedo)
+    {
+        return { MaterialType::Isotropic, { albedo.r(), albedo.g(), albedo.b() }, 0.f, 0.f };
+    }
+
+    enum class TextureType : std::uint32_t
+    {
+        Checker = 0,
+        Noise = 1,
+        Image = 2
+    };
+
+    // The description of a texture, a checker alternates between color0 and color1 at the frequency given by scale,
+    // a noise modulates color0 at the given scale and an image is loaded from the file (see ImageTexture::load)
+    struct TextureRecord
+    {
+        TextureType type;
+        float color0[3];
+        float color1[3];
+        float scale;
+        std::string filePath;
+    };
+
+    inline TextureRecord makeCheckerTextureRecord(const vec3& odd, const vec3& even, float frequency)
+    {
+        return { TextureType::Checker, { odd.r(), odd.g(), odd.b() }, { even.r(), even.g(), even.b() }, frequency, std::string() };
+    }
+
+    inline TextureRecord makeNoiseTextureRecord(const vec3& color, float scale)
+    {
+        return { TextureType::Noise, { color.r(), color.g(), color.b() }, { 0.f, 0.f, 0.f }, scale, std::string() };
+    }
+
+    inline TextureRecord makeImageTextureRecord(const std::string& filePath)
+    {
+        return { TextureType::Image, { 1.f, 1.f, 1.f }, { 0.f, 0.f, 0.f }, 0.f, filePath };
+    }
+
+    struct CameraRecord
+    {
+        float lookFrom[3];
+        float lookAt[3];
+        float vUp[3];
+        float vFov;         // in degrees
+        float aperture;
+        float focusDist;    // when it's not strictly positive the distance between lookFrom and lookAt is used
+        float shutterOpen;  // the rays are traced at random times between the shutter open and close times
+        float shutterClose;
+    };
+
+    // A key of the camera animation, the camera goes smoothly through the keys in the order of their times
+    // the other parameters of the camera (vUp, vFov and the shutter) are the ones of the CameraRecord
+    struct CameraKeyframeRecord
+    {
+        float time;         // in seconds
+        float lookFrom[3];
+        float lookAt[3];
+        float aperture;
+        float focusDist;
+    };
+
+    // Create the camera described by the record, its focus distance defaults to the distance between lookFrom and lookAt
+    std::unique_ptr<Camera> createCameraFromRecord(const CameraRecord& record, float aspectRatio);
+
+    struct BackgroundRecord
+    {
+        float top[3];
+        float bottom[3];
+    };
+
+    // A latitude-longitude image which replaces the background gradient and lights the scene (see EnvironmentMap)
+    struct EnvironmentRecord
+    {
+        std::string filePath;   // a PFM image
+        float intensity;        // the scale of its radiance
+        float rotation;         // in degrees around the vertical axis
+    };
+
+    // A medium of constant density bounded by a sphere, its material is the phase function (see ConstantMedium)
+    struct MediumRecord
+    {
+        float center[3];
+        float radius;
+        float density;
+        std::uint32_t materialIndex;
+    };
+
+    // An infinite plane through the point, the normal goes to the side seen by the hits (see Plane)
+    struct PlaneRecord
+    {
+        float point[3];
+        float normal[3];
+        std::uint32_t materialIndex;
+    };
+
+    // The placement of a group of spheres, the transform is a row-major 3x4 matrix from the group to the world
+    struct InstanceRecord
+    {
+        std::uint32_t groupIndex;
+        float transform[12];
+    };
+
+    // The scene holds the world to render along with its camera and background
+    // the spheres are stored in flat arrays which can either be owned or memory-mapped from a binary scene file
+    // the spheres which are repeated throughout the scene are put in groups, a group is stored and built
+    // only once no matter how many instances of it are placed in the world
+    // the triangle meshes are stored in the same way, either placed in the world or in a group
+    // the textures are created as soon as they're added, the image textures read from tiled texture files share a cache
+    // of a fixed budget (see TEXTURE_CACHE_SIZE)
+    // the participating media are kept apart from the world, the ray tracer samples them between the surfaces
+    // the planes are placed in the world but left out of its hierarchy since they have no bounds
+    class Scene final
+    {
+    public:
+        Scene();
+        ~Scene();
+
+        Scene(const Scene&) = delete;
+        Scene& operator=(const Scene&) = delete;
+
+        static const std::uint32_t NO_TEXTURE = 0xFFFFFFFF;
+
+        // Build the scene programmatically or load it from a file, commit() must be called once it's complete
+        // addTexture() returns NO_TEXTURE when the image of the texture can't be loaded
+        // the dispersion is only used by the dielectrics, in the spectral mode
+        std::uint32_t addTexture(const TextureRecord& texture);
+        std::uint32_t addMaterial(const MaterialRecord& material, std::uint32_t textureIndex = NO_TEXTURE,
+            const DispersionRecord& dispersion = makeNoDispersionRecord());
+        void addSphere(const vec3& center, float radius, std::uint32_t materialIndex);
+        void addMovingSphere(const vec3& center0, const vec3& center1, float time0, float time1, float radius, std::uint32_t materialIndex);
+        void addMedium(const vec3& center, float radius, float density, std::uint32_t materialIndex);
+        void addPlane(const vec3& point, const vec3& normal, std::uint32_t materialIndex);
+        std::uint32_t addGroup();
+        void addGroupSphere(std::uint32_t groupIndex, const vec3& center, float radius, std::uint32_t materialIndex);
+        void addInstance(std::uint32_t groupIndex, const Transform& transform);
+        void addMesh(TriangleMeshData&& mesh, std::uint32_t materialIndex) { addGroupMesh(NO_GROUP, std::move(mesh), materialIndex); }
+        void addGroupMesh(std::uint32_t groupIndex, TriangleMeshData&& mesh, std::uint32_t materialIndex);
+        void setCamera(const CameraRecord& camera) { m_camera = camera; }
+        void addCameraKeyframe(const CameraKeyframeRecord& keyframe);
+        void setBackground(const BackgroundRecord& background) { m_background = background; }
+
+        // Return false when the image can't be loaded, the scene keeps its background then
+        bool setEnvironment(const EnvironmentRecord& environment);
+
+        // Create the materials and the hitables from the scene records
+        void commit();
+
+        // Edit the spheres of the world once the scene is committed, the spheres can be added with addSphere() as well
+        // update() then refits the hierarchies rather than building them again (see Bvh::refit), which suits an animation
+        // or an interactive edit where only a few spheres change, the scene can't be rendered in between
+        // a removed sphere is replaced by the last one
+        void moveSphere(std::size_t index, const vec3& center, float radius);
+        void removeSphere(std::size_t index);
+        BvhRefitStats update();
+
+        // Load a scene file in the text format, see the comments at the end of scene.cpp for the syntax
+        bool loadTextFile(const std::string& filePath);
+        // the spheres of the world are written to a brick file next to the scene file when saveSpheresAsBricks is set
+        bool saveTextFile(const std::string& filePath, bool saveSpheresAsBricks = false) const;
+
+        // Load a scene file in the binary format, the spheres are used in place from the memory-mapped file
+        bool loadBinaryFile(const std::string& filePath);
+        bool saveBinaryFile(const std::string& filePath) const;
+
+        // Load a scene file, the format is deduced from the extension (.rtsb for binary, text otherwise)
+        bool loadFile(const std::string& filePath);
+
+        // Copy the spheres and the meshes of a memory-mapped scene file into the scene and unmap the file, it's called before commit()
+        // to allocate the geometry where the calling thread runs, e.g. for a copy of the scene on each NUMA node
+        // the edits call it as well, a scene which is already committed is then committed again over the copies
+        void copyMappedData();
+
+        std::unique_ptr<Camera> createCamera(float aspectRatio) const;
+
+        // The scene is animated when it has camera keyframes, the camera at a given time interpolates them
+        // its shutter interval is relative to that time, so that the moving spheres keep on moving from frame to frame
+        bool isAnimated() const { return !m_cameraKeyframes.empty(); }
+        float getAnimationStartTime() const { return isAnimated() ? m_cameraKeyframes.front().time : 0.f; }
+        float getAnimationEndTime() const { return isAnimated() ? m_cameraKeyframes.back().time : 0.f; }
+        CameraRecord getCameraAt(float time) const;
+        std::unique_ptr<Camera> createCamera(float aspectRatio, float time) const;
+
+        const Hitable& getWorld() const { return m_world; }
+        const std::vector<std::unique_ptr<ConstantMedium>>& getMedia() const { return m_media; }
+        vec3 getBackgroundColor(const vec3& unitDirection) const;
+        const EnvironmentMap* getEnvironment() const { return m_environment.get(); }
+
+        std::size_t getSphereCount() const { return m_sphereCount; }
+        std::size_t getMovingSphereCount() const { return m_movingSphereCount; }
+        const MovingSphereRecord* getMovingSpheres() const { return m_movingSpheres; }
+        const SphereRecord* getSpheres() const { return m_spheres; }
+        std::size_t getMaterialCount() const { return m_materialRecords.size(); }
+        std::size_t getTextureCount() const { return m_textures.size(); }
+        const std::vector<std::unique_ptr<Material>>& getMaterials() const { return m_materials; }
+        std::size_t getGroupCount() const { return m_groups.size(); }
+        std::size_t getInstanceCount() const { return m_instances.size(); }
+        std::size_t getMeshCount() const { return m_meshes.size(); }
+        std::size_t getMediumCount() const { return m_mediumRecords.size(); }
+        std::size_t getPlaneCount() const { return m_planeRecords.size(); }
+
+        // The memory used by the committed geometry, i.e. the sphere records, the instances and the hierarchies
+        // the records of the compressed spheres are left out (see BVH_COMPRESSED)
+        std::size_t getGeometryMemoryUsage() const { return m_geometryMemoryUsage; }
+
+    private:
+        struct SphereGroup
+        {
+            std::vector<SphereRecord> ownedSpheres;
+            const SphereRecord* spheres;
+            std::size_t sphereCount;
+        };
+
+        // The buffers of a mesh point either to the owned vectors or to the memory-mapped file
+        struct Mesh
+        {
+            std::vector<MeshVertex> ownedVertices;
+            std::vector<std::uint32_t> ownedIndices;
+            std::vector<float> texCoords;   // 2 per vertex, empty when the mesh has none
+            const MeshVertex* vertices;
+            std::size_t vertexCount;
+            const std::uint32_t* indices;
+            std::size_t triangleCount;
+            bool hasNormals;
+            std::uint32_t materialIndex;
+            std::uint32_t groupIndex; // NO_GROUP when the mesh is directly placed in the world
+        };
+
+        static const std::uint32_t NO_GROUP = 0xFFFFFFFF;
+
+        void clear();
+
+        // Add the hitables made of the given spheres and of the meshes of the given group to the list
+        void addGroupHitables(HitableBvh& hitables, const SphereRecord* spheres, std::size_t sphereCount, std::uint32_t groupIndex,
+            BvhBuildMethod buildMethod, ThreadPool* pool);
+
+        std::vector<MaterialRecord> m_materialRecords;
+        std::vector<std::uint32_t> m_materialTextures;  // the texture of each material, NO_TEXTURE for none
+        std::vector<DispersionRecord> m_materialDispersions;
+        std::vector<TextureRecord> m_textureRecords;
+        std::unique_ptr<TextureCache> m_textureCache;   // created along with the first texture read in place from a file
+        std::vector<std::unique_ptr<Texture>> m_textures;
+        std::vector<SphereRecord> m_ownedSpheres;
+        MappedFile m_mappedFile;
+
+        // The spheres, they point either to the owned spheres or to the memory-mapped file
+        const SphereRecord* m_spheres;
+        std::size_t m_sphereCount;
+
+        // The same goes for the moving spheres which can only be placed in the world
+        std::vector<MovingSphereRecord> m_ownedMovingSpheres;
+        const MovingSphereRecord* m_movingSpheres;
+        std::size_t m_movingSphereCount;
+
+        std::vector<SphereGroup> m_groups;
+        std::vector<InstanceRecord> m_instances;
+        std::vector<Mesh> m_meshes;
+        std::vector<MediumRecord> m_mediumRecords;
+        std::vector<PlaneRecord> m_planeRecords;
+
+        CameraRecord m_camera;
+        std::vector<CameraKeyframeRecord> m_cameraKeyframes;    // sorted by time
+        std::vector<std::string> m_brickFilePaths;             // the spheres streamed from the disk, they're placed in the world
+        BackgroundRecord m_background;
+        EnvironmentRecord m_environmentRecord;
+        std::unique_ptr<EnvironmentMap> m_environment;  // the background gradient is used without it
+
+        std::vector<std::unique_ptr<Material>> m_materials;
+        std::vector<std::unique_ptr<ConstantMedium>> m_media;
+        std::vector<std::shared_ptr<const Hitable>> m_groupHitables;
+        std::size_t m_geometryMemoryUsage;
+        HitableBvh m_world;
+        SphereSet* m_worldSpheres;  // the spheres placed in the world, they're owned by m_world
+    };
+}
@@ -0,0 +1,206 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "spectrum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "config.h"
+
+namespace rts
+{
+    namespace
+    {
+        // Smits' basis spectra in 10 bins of 34 nm from 380 to 720 nm
+        const int SMITS_BIN_COUNT = 10;
+        const float SMITS_WAVELENGTH_MIN = 380.f;
+        const float SMITS_BIN_WIDTH = 34.f;
+        const float SMITS_BASIS[7][SMITS_BIN_COUNT] = {
+            { 1.0000f, 1.0000f, 0.9999f, 0.9993f, 0.9992f, 0.9998f, 1.0000f, 1.0000f, 1.0000f, 1.0000f },   // white
+            { 0.9710f, 0.9426f, 1.0007f, 1.0007f, 1.0007f, 1.0007f, 0.1564f, 0.0000f, 0.0000f, 0.0000f },   // cyan
+            { 1.0000f, 1.0000f, 0.9685f, 0.2229f, 0.0000f, 0.0458f, 0.8369f, 1.0000f, 1.0000f, 0.9959f },   // magenta
+            { 0.0001f, 0.0000f, 0.1088f, 0.6651f, 1.0000f, 1.0000f, 0.9996f, 0.9586f, 0.9685f, 0.9840f },   // yellow
+            { 0.1012f, 0.0515f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.8325f, 1.0149f, 1.0149f, 1.0149f },   // red
+            { 0.0000f, 0.0000f, 0.0273f, 0.7937f, 1.0000f, 0.9418f, 0.1719f, 0.0000f, 0.0000f, 0.0025f },   // green
+            { 1.0000f, 1.0000f, 0.8916f, 0.3323f, 0.0000f, 0.0000f, 0.0003f, 0.0369f, 0.0483f, 0.0496f } }; // blue
+
+        enum Basis { WHITE, CYAN, MAGENTA, YELLOW, RED, GREEN, BLUE };
+
+        // The bins are interpolated linearly between their centers
+        float getSmitsBasis(int basis, float wavelength)
+        {
+            float position = (wavelength - SMITS_WAVELENGTH_MIN) / SMITS_BIN_WIDTH - 0.5f;
+            int bin = static_cast<int>(std::floor(position));
+            float weight = position - bin;
+            int bin0 = std::min(std::max(bin, 0), SMITS_BIN_COUNT - 1);
+            int bin1 = std::min(std::max(bin + 1, 0), SMITS_BIN_COUNT - 1);
+            return (1.f - weight) * SMITS_BASIS[basis][bin0] + weight * SMITS_BASIS[basis][bin1];
+        }
+
+        // The CIE 1931 color matching functions as fitted by Wyman et al., Simple Analytic Approximations to the CIE XYZ
+        // Color Matching Functions, a sum of Gaussians whose width differs on both sides of their peak
+        float getPiecewiseGaussian(float x, float mean, float sigmaLow, float sigmaHigh)
+        {
+            float t = (x - mean) / ((x < mean) ? sigmaLow : sigmaHigh);
+            return std::exp(-0.5f * t * t);
+        }
+
+        vec3 getColorMatchingFunctions(float wavelength)
+        {
+            float x = 1.056f * getPiecewiseGaussian(wavelength, 599.8f, 37.9f, 31.0f) + 0.362f * getPiecewiseGaussian(wavelength, 442.0f, 16.0f, 26.7f)
+                - 0.065f * getPiecewiseGaussian(wavelength, 501.1f, 20.4f, 26.2f);
+            float y = 0.821f * getPiecewiseGaussian(wavelength, 568.8f, 46.9f, 40.5f) + 0.286f * getPiecewiseGaussian(wavelength, 530.9f, 16.3f, 31.1f);
+            float z = 1.217f * getPiecewiseGaussian(wavelength, 437.0f, 11.8f, 36.0f) + 0.681f * getPiecewiseGaussian(wavelength, 459.0f, 26.0f, 13.8f);
+            return vec3(x, y, z);
+        }
+
+        vec3 getLinearSrgbFromXyz(const vec3& xyz)
+        {
+            return vec3(3.2404542f * xyz[0] - 1.5371385f * xyz[1] - 0.4985314f * xyz[2],
+                -0.9692660f * xyz[0] + 1.8760108f * xyz[1] + 0.0415560f * xyz[2],
+                0.0556434f * xyz[0] - 0.2040259f * xyz[1] + 1.0572252f * xyz[2]);
+        }
+
+        // The basis spectra and the color matching functions at each nanometer of the sampled range, looked up by the paths
+        // along with the normalization of the color matching functions and the RGB color of the white spectrum
+        struct SpectralTables
+        {
+            std::vector<float> basis[7];
+            std::vector<vec3> colorMatching;
+            float xyzScale;
+            vec3 whiteRgb;
+
+            SpectralTables()
+            {
+                int count = static_cast<int>(SPECTRAL_WAVELENGTH_MAX - SPECTRAL_WAVELENGTH_MIN) + 1;
+                for (auto& table : basis)
+                {
+                    table.resize(count);
+                }
+                colorMatching.resize(count);
+
+                float yIntegral = 0.f;
+                vec3 whiteXyz(0.f, 0.f, 0.f);
+                for (int i = 0; i < count; ++i)
+                {
+                    float wavelength = SPECTRAL_WAVELENGTH_MIN + i;
+                    for (int b = 0; b < 7; ++b)
+                    {
+                        basis[b][i] = getSmitsBasis(b, wavelength);
+                    }
+                    colorMatching[i] = getColorMatchingFunctions(wavelength);
+                    yIntegral += colorMatching[i].y();
+                    whiteXyz += basis[WHITE][i] * colorMatching[i];
+                }
+
+                // A wavelength is sampled with a probability of 1 / range, each of the lanes estimates the integral
+                // over the range, their average is normalized so that a flat spectrum of 1 has a luminance of 1
+                float range = SPECTRAL_WAVELENGTH_MAX - SPECTRAL_WAVELENGTH_MIN;
+                xyzScale = range / (WavelengthSample::LANE_COUNT * yIntegral);
+                whiteRgb = getLinearSrgbFromXyz(whiteXyz / yIntegral);
+            }
+        };
+
+        const SpectralTables& getSpectralTables()
+        {
+            static const SpectralTables tables;
+            return tables;
+        }
+    }
+
+    WavelengthSample sampleWavelengths(float u)
+    {
+        const SpectralTables& tables = getSpectralTables();
+        const int laneCount = WavelengthSample::LANE_COUNT;
+        const float range = SPECTRAL_WAVELENGTH_MAX - SPECTRAL_WAVELENGTH_MIN;
+        const int lastIndex = static_cast<int>(tables.colorMatching.size()) - 1;
+
+        float wavelengths[laneCount];
+        float basis[7][laneCount];
+        float xyzWeights[3][laneCount];
+        for (int lane = 0; lane < laneCount; ++lane)
+        {
+            float offset = u + static_cast<float>(lane) / laneCount;
+            offset -= std::floor(offset);
+            wavelengths[lane] = SPECTRAL_WAVELENGTH_MIN + offset * range;
+
+            // The tables are interpolated between their nanometers
+            float position = offset * range;
+            int index = std::min(static_cast<int>(position), lastIndex - 1);
+            float weight = position - index;
+            for (int b = 0; b < 7; ++b)
+            {
+                basis[b][lane] = (1.f - weight) * tables.basis[b][index] + weight * tables.basis[b][index + 1];
+            }
+            vec3 colorMatching = (1.f - weight) * tables.colorMatching[index] + weight * tables.colorMatching[index + 1];
+            for (int c = 0; c < 3; ++c)
+            {
+                xyzWeights[c][lane] = tables.xyzScale * colorMatching[c];
+            }
+        }
+
+        WavelengthSample sample;
+        sample.wavelengths = floatx8::load(wavelengths);
+        for (int b = 0; b < 7; ++b)
+        {
+            sample.basis[b] = floatx8::load(basis[b]);
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            sample.xyzWeights[c] = floatx8::load(xyzWeights[c]);
+        }
+        return sample;
+    }
+
+    floatx8 getSpectrumFromRgb(const vec3& rgb, const WavelengthSample& sample)
+    {
+        // The smallest component gives the amount of white, the next one the amount of the secondary color
+        // made of the 2 largest components and the rest is the primary color of the largest component
+        float r = rgb.r(), g = rgb.g(), b = rgb.b();
+        const floatx8* basis = sample.basis;
+        if (r <= g && r <= b)
+        {
+            return (g <= b) ? floatx8(r) * basis[WHITE] + floatx8(g - r) * basis[CYAN] + floatx8(b - g) * basis[BLUE]
+                : floatx8(r) * basis[WHITE] + floatx8(b - r) * basis[CYAN] + floatx8(g - b) * basis[GREEN];
+        }
+        if (g <= r && g <= b)
+        {
+            return (r <= b) ? floatx8(g) * basis[WHITE] + floatx8(r - g) * basis[MAGENTA] + floatx8(b - r) * basis[BLUE]
+                : floatx8(g) * basis[WHITE] + floatx8(b - g) * basis[MAGENTA] + floatx8(r - b) * basis[RED];
+        }
+        return (r <= g) ? floatx8(b) * basis[WHITE] + floatx8(r - b) * basis[YELLOW] + floatx8(g - r) * basis[GREEN]
+            : floatx8(b) * basis[WHITE] + floatx8(g - b) * basis[YELLOW] + floatx8(r - g) * basis[RED];
+    }
+
+    vec3 getRgbFromSpectrum(const floatx8& radiance, const WavelengthSample& sample)
+    {
+        vec3 xyz;
+        for (int c = 0; c < 3; ++c)
+        {
+            float values[WavelengthSample::LANE_COUNT];
+            (radiance * sample.xyzWeights[c]).store(values);
+            float sum = 0.f;
+            for (float value : values)
+            {
+                sum += value;
+            }
+            xyz[c] = sum;
+        }
+        return getLinearSrgbFromXyz(xyz) / getSpectralTables().whiteRgb;
+    }
+
+    float getLane(const floatx8& f, int lane)
+    {
+        float values[WavelengthSample::LANE_COUNT];
+        f.store(values);
+        return values[lane];
+    }
+}
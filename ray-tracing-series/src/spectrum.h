@@ -0,0 +1,44 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include "vec3.h"
+#include "vec3x8.h"
+
+namespace rts // for ray tracing series
+{
+    // The wavelengths carried by a path of the spectral mode, one per lane of a floatx8 (hero wavelength sampling)
+    // the first lane, the hero, is uniformly distributed in [SPECTRAL_WAVELENGTH_MIN, SPECTRAL_WAVELENGTH_MAX] and the others
+    // are evenly spaced after it, wrapping around the range, so that each lane is uniformly distributed as well and a path
+    // estimates the whole spectrum for the cost of a single one, as long as its wavelengths follow the same rays
+    // the basis spectra of the RGB conversion and the color matching functions are looked up once for the wavelengths of the path
+    struct WavelengthSample
+    {
+        static const int LANE_COUNT = 8;
+
+        floatx8 wavelengths;    // in nanometers
+        floatx8 basis[7];       // the spectra of white, cyan, magenta, yellow, red, green and blue
+        floatx8 xyzWeights[3];  // the color matching functions weighted by the probability of the wavelengths
+    };
+
+    // Sample the wavelengths of a path from a random number in [0, 1)
+    WavelengthSample sampleWavelengths(float u);
+
+    // The smooth reflectance spectrum of an RGB color at the wavelengths of the path (Smits, An RGB to Spectrum Conversion for Reflectances)
+    // it's used for the albedos as well as for the background, whose light is hence treated as a reflected white
+    floatx8 getSpectrumFromRgb(const vec3& rgb, const WavelengthSample& sample);
+
+    // The linear RGB color of the radiance carried at the wavelengths of the path, the CIE XYZ color is converted to linear sRGB
+    // and white balanced so that a white reflectance under a white light gives a white color, as in the RGB mode
+    vec3 getRgbFromSpectrum(const floatx8& radiance, const WavelengthSample& sample);
+
+    // The value of a single lane
+    float getLane(const floatx8& f, int lane);
+}
@@ -9,41 +9,75 @@
 
 #include "sphere.h"
 
+#include <algorithm>
 #include <cmath>
+#include <utility>
 
+#include "aabb.h"
+#include "defines.h"
 #include "ray.h"
 
 namespace rts
 {
     bool Sphere::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
     {
-        // Compute the discriminant as described in the comments at the end of this file
+        float t;
+        if (intersect(m_center, m_radiusSquared, r, tMin, tMax, t))
+        {
+            setHitRecord(rec, t, r, m_material.get());
+            return true;
+        }
+        return false;
+    }
+
+    bool Sphere::boundingBox(Aabb& box) const
+    {
+        // A negative radius is used for hollow spheres, the bounds rely on its absolute value
+        float radius = std::fabs(m_radius);
+        box = Aabb(m_center - vec3(radius, radius, radius), m_center + vec3(radius, radius, radius));
+        return true;
+    }
+
+    bool Sphere::intersect(const vec3& center, float radiusSquared, const Ray& r, float tMin, float tMax, float& t)
+    {
+        // Solve the quadratic equation described in the comments at the end of this file
         // Note that a bunch of redundant "times 2" factors have been removed
-        vec3 oc = r.origin() - m_center;
-        float a = dot(r.direction(), r.direction());
+        // and since the ray direction is a unit vector, a = dot(direction, direction) is 1 and has been dropped
+        vec3 oc = r.origin() - center;
         float b = dot(oc, r.direction());
-        float c = dot(oc, oc) - m_radius * m_radius;
-        float discriminant = b * b - a * c;
+
+        // b * b - c subtracts two values close to the squared distance to the center when the ray passes far from a small sphere
+        // or near the edge of a large one, most of their digits cancel out, the discriminant is rather found from the distance
+        // between the center and the line of the ray (see Haines et al., Precision Improvements for Ray/Sphere Intersection)
+        vec3 closestOffset = oc - b * r.direction();
+        float discriminant = radiusSquared - dot(closestOffset, closestOffset);
 
         // There's 2 real solutions to the quadratic equation
         if (discriminant > 0.f)
         {
-            float discriminantSqrt = sqrt(discriminant);
+            // One of -b - sqrt and -b + sqrt cancels out as well when the ray starts close to the sphere, only the other one is
+            // computed, the first one follows from their product c
+            float c = dot(oc, oc) - radiusSquared;
+            float q = -b - std::copysign(std::sqrt(discriminant), b);
+            float t0 = c / q;
+            float t1 = q;
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
 
             // First solution with the smallest t
             // the closest one to the camera if it's not behind it
-            float t = (-b - discriminantSqrt) / a;
+            t = t0;
             if (tMin < t && t < tMax)
             {
-                setHitRecord(rec, t, r, m_material.get());
                 return true;
             }
 
             // Second solution
-            t = (-b + discriminantSqrt) / a;
+            t = t1;
             if (tMin < t && t < tMax)
             {
-                setHitRecord(rec, t, r, m_material.get());
                 return true;
             }
         }
@@ -55,8 +89,22 @@ namespace rts
     {
         rec.t = t;
         rec.p = r.pointAtParameter(rec.t);
-        rec.normal = (rec.p - m_center) / m_radius;
+        rec.normal = (rec.p - m_center) * m_inverseRadius;
         rec.matPtr = material;
+        setTextureCoordinates(rec, m_radius);
+    }
+
+    void Sphere::setTextureCoordinates(HitRecord& rec, float radius)
+    {
+        // The normal of a hollow sphere points inwards, the coordinates rely on the outward one
+        vec3 outward = (radius < 0.f) ? -rec.normal : rec.normal;
+        float phi = atan2(outward.z(), outward.x());
+        float theta = asin(std::min(std::max(outward.y(), -1.f), 1.f));
+        rec.u = 1.f - (phi + static_cast<float>(M_PI)) / (2.f * static_cast<float>(M_PI));
+        rec.v = (theta + static_cast<float>(M_PI) / 2.f) / static_cast<float>(M_PI);
+
+        // v covers half a great circle, the density of u is higher away from the equator but it's left aside
+        rec.uvDensity = 1.f / (static_cast<float>(M_PI) * std::fabs(radius));
     }
 
     // Previous hitSphere function which has been replaced by the Sphere::hit method (see above)
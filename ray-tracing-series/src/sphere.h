@@ -15,24 +15,50 @@
 
 namespace rts // for ray tracing series
 {
+    // The terms of a sphere which only depend on its radius, they're precomputed rather than derived at each test
+    // the sets of spheres keep them in an array of their own next to their records, which only hold the radius
+    // since they're the layout of the scene and the brick files (see SphereSet)
+    struct SphereRadiusTerms
+    {
+        float radiusSquared;    // for the intersection
+        float inverseRadius;    // for the normal, negative as well for a hollow sphere
+    };
+
+    inline SphereRadiusTerms makeSphereRadiusTerms(float radius)
+    {
+        return { radius * radius, 1.f / radius };
+    }
+
     class Sphere final : public Hitable
     {
     public:
-        Sphere() : m_center(vec3()), m_radius(0.f) {}
+        Sphere() : m_center(vec3()), m_radius(0.f), m_radiusSquared(0.f), m_inverseRadius(0.f) {}
         Sphere(vec3 center, float radius, std::shared_ptr<Material> material)
             : m_center(center)
             , m_radius(radius)
+            , m_radiusSquared(radius * radius)
+            , m_inverseRadius(1.f / radius)
             , m_material(material)
         {
         }
 
         virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
+
+        // Find the closest intersection in (tMin, tMax) between the ray and the sphere of the given center and squared radius
+        // it's shared with the hitables which store their spheres in a compact form (see SphereSet)
+        static bool intersect(const vec3& center, float radiusSquared, const Ray& r, float tMin, float tMax, float& t);
+
+        // Set the texture coordinates of the hit record from its normal, u goes around the Y axis and v from the bottom pole to the top one
+        static void setTextureCoordinates(HitRecord& rec, float radius);
 
     private:
         inline void setHitRecord(HitRecord& rec, float t, const Ray& r, const Material* material) const;
 
         vec3 m_center;
         float m_radius;
+        float m_radiusSquared;  // for the intersection
+        float m_inverseRadius;  // for the normal, negative as well for a hollow sphere
         std::shared_ptr<Material> m_material; // a material may be shared by multiple spheres
     };
 }
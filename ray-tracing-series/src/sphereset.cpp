@@ -0,0 +1,118 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "sphereset.h"
+
+#include <cmath>
+
+#include "config.h"
+#include "material.h"
+#include "ray.h"
+#include "sphere.h"
+
+namespace rts
+{
+    namespace
+    {
+        // A negative radius is used for hollow spheres, the bounds rely on its absolute value
+        Aabb getSphereBounds(const SphereRecord& sphere)
+        {
+            vec3 center(sphere.center[0], sphere.center[1], sphere.center[2]);
+            float radius = std::fabs(sphere.radius);
+            return Aabb(center - vec3(radius, radius, radius), center + vec3(radius, radius, radius));
+        }
+    }
+
+    SphereSet::SphereSet(const SphereRecord* spheres, std::size_t sphereCount, const std::vector<std::unique_ptr<Material>>& materials,
+        BvhBuildMethod buildMethod, ThreadPool* pool)
+        : m_spheres(spheres)
+        , m_sphereCount(sphereCount)
+        , m_materials(materials)
+    {
+        std::vector<Aabb> bounds(sphereCount);
+        m_radiusTerms.resize(sphereCount);
+        for (std::size_t i = 0; i < sphereCount; ++i)
+        {
+            bounds[i] = getSphereBounds(spheres[i]);
+            m_radiusTerms[i] = makeSphereRadiusTerms(spheres[i].radius);
+        }
+        m_bvh.build(bounds, buildMethod, pool);
+    }
+
+    void SphereSet::addSphere(const SphereRecord& sphere)
+    {
+        m_bvh.insertPrimitive(static_cast<std::uint32_t>(m_sphereCount++), getSphereBounds(sphere));
+    }
+
+    void SphereSet::removeSphere(std::uint32_t index)
+    {
+        auto lastIndex = static_cast<std::uint32_t>(--m_sphereCount);
+        m_bvh.removePrimitive(index);
+        if (index != lastIndex)
+        {
+            m_bvh.renamePrimitive(lastIndex, index);
+        }
+    }
+
+    BvhRefitStats SphereSet::update(const SphereRecord* spheres, std::size_t sphereCount, ThreadPool* pool)
+    {
+        // The records may have been reallocated by the edits, the terms of their radius are computed again along with their bounds
+        m_spheres = spheres;
+        m_sphereCount = sphereCount;
+
+        std::vector<Aabb> bounds(sphereCount);
+        m_radiusTerms.resize(sphereCount);
+        for (std::size_t i = 0; i < sphereCount; ++i)
+        {
+            bounds[i] = getSphereBounds(spheres[i]);
+            m_radiusTerms[i] = makeSphereRadiusTerms(spheres[i].radius);
+        }
+        return m_bvh.refit(bounds, BVH_REFIT_REBUILD_THRESHOLD, pool);
+    }
+
+    bool SphereSet::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        const SphereRecord* closest = nullptr;
+        std::uint32_t closestIndex = 0;
+        float closestSoFar = tMax;
+
+        // Only keep track of the closest sphere, the hit record is filled once at the end
+        m_bvh.intersect(r, tMin, closestSoFar, [&](std::uint32_t index, float tMinPrimitive, float tMaxPrimitive, float& t)
+        {
+            const SphereRecord& sphere = m_spheres[index];
+            if (Sphere::intersect(vec3(sphere.center[0], sphere.center[1], sphere.center[2]), m_radiusTerms[index].radiusSquared, r,
+                tMinPrimitive, tMaxPrimitive, t))
+            {
+                closest = &sphere;
+                closestIndex = index;
+                return true;
+            }
+            return false;
+        });
+
+        if (closest == nullptr)
+        {
+            return false;
+        }
+
+        vec3 center(closest->center[0], closest->center[1], closest->center[2]);
+        rec.t = closestSoFar;
+        rec.p = r.pointAtParameter(rec.t);
+        rec.normal = (rec.p - center) * m_radiusTerms[closestIndex].inverseRadius;
+        rec.matPtr = m_materials[closest->materialIndex].get();
+        Sphere::setTextureCoordinates(rec, closest->radius);
+        return true;
+    }
+
+    bool SphereSet::boundingBox(Aabb& box) const
+    {
+        box = m_bvh.getBounds();
+        return !box.isEmpty();
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bvh.h"
+#include "hitable.h"
+#include "sphere.h"
+
+namespace rts // for ray tracing series
+{
+    // The compact description of a sphere, it's also the layout used by the binary scene files
+    // which is why it only relies on plain types (see Scene::loadBinaryFile)
+    struct SphereRecord
+    {
+        float center[3];
+        float radius;
+        std::uint32_t materialIndex; // an index in the scene's material array
+    };
+
+    // A set of spheres stored contiguously, the records aren't owned by the set
+    // they can be located in a vector as well as in a memory-mapped file
+    // the spheres are intersected through a BVH which only references them by index, the set keeps the terms of their radius
+    class SphereSet final : public Hitable
+    {
+    public:
+        SphereSet(const SphereRecord* spheres, std::size_t sphereCount, const std::vector<std::unique_ptr<Material>>& materials,
+            BvhBuildMethod buildMethod, ThreadPool* pool);
+
+        // The spheres can be edited once the set is built, the moved spheres need nothing more than update() which refits
+        // the hierarchy rather than building it again (see Bvh::refit), the added and removed ones must be declared first
+        // a removed sphere is replaced by the last one, the owner of the records is expected to do the same
+        void addSphere(const SphereRecord& sphere);
+        void removeSphere(std::uint32_t index);
+        BvhRefitStats update(const SphereRecord* spheres, std::size_t sphereCount, ThreadPool* pool);
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
+
+        const Bvh& getBvh() const { return m_bvh; }
+        std::size_t getMemoryUsage() const { return m_radiusTerms.size() * sizeof(SphereRadiusTerms) + m_bvh.getMemoryUsage(); }
+
+    private:
+        const SphereRecord* m_spheres;
+        std::size_t m_sphereCount;
+        std::vector<SphereRadiusTerms> m_radiusTerms;   // in the order of the records
+        const std::vector<std::unique_ptr<Material>>& m_materials;
+        Bvh m_bvh;
+    };
+}
@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "texture.h"
+
+#include <cmath>
+#include <random>
+#include <utility>
+
+#include "hitable.h"
+
+namespace rts
+{
+    vec3 CheckerTexture::value(const HitRecord& rec) const
+    {
+        float sines = sin(m_frequency * rec.p.x()) * sin(m_frequency * rec.p.y()) * sin(m_frequency * rec.p.z());
+        return (sines < 0.f) ? m_odd : m_even;
+    }
+
+    NoiseTexture::NoiseTexture(const vec3& color, float scale)
+        : m_color(color)
+        , m_scale(scale)
+    {
+        // A generator of its own with a constant seed, the random generator of the ray tracer may not be deterministic
+        std::mt19937 generator(std::mt19937::default_seed);
+        std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+        for (auto& gradient : m_gradients)
+        {
+            gradient = unitVector(vec3(distribution(generator), distribution(generator), distribution(generator)));
+        }
+
+        for (auto& permutation : m_permutations)
+        {
+            for (int i = 0; i < POINT_COUNT; ++i)
+            {
+                permutation[i] = i;
+            }
+            for (int i = POINT_COUNT - 1; i > 0; --i)
+            {
+                std::swap(permutation[i], permutation[std::uniform_int_distribution<int>(0, i)(generator)]);
+            }
+        }
+    }
+
+    vec3 NoiseTexture::value(const HitRecord& rec) const
+    {
+        return m_color * 0.5f * (1.f + sin(m_scale * rec.p.z() + 10.f * turbulence(m_scale * rec.p)));
+    }
+
+    float NoiseTexture::noise(const vec3& p) const
+    {
+        float fx = floor(p.x());
+        float fy = floor(p.y());
+        float fz = floor(p.z());
+        float u = p.x() - fx;
+        float v = p.y() - fy;
+        float w = p.z() - fz;
+        int i = static_cast<int>(fx);
+        int j = static_cast<int>(fy);
+        int k = static_cast<int>(fz);
+
+        // Interpolate the dot products between the gradients of the cell corners and the offsets to them with a Hermite cubic
+        float uu = u * u * (3.f - 2.f * u);
+        float vv = v * v * (3.f - 2.f * v);
+        float ww = w * w * (3.f - 2.f * w);
+        float sum = 0.f;
+        for (int di = 0; di < 2; ++di)
+        {
+            for (int dj = 0; dj < 2; ++dj)
+            {
+                for (int dk = 0; dk < 2; ++dk)
+                {
+                    const vec3& gradient = m_gradients[m_permutations[0][(i + di) & (POINT_COUNT - 1)]
+                        ^ m_permutations[1][(j + dj) & (POINT_COUNT - 1)] ^ m_permutations[2][(k + dk) & (POINT_COUNT - 1)]];
+                    vec3 offset(u - di, v - dj, w - dk);
+                    sum += (di * uu + (1 - di) * (1.f - uu)) * (dj * vv + (1 - dj) * (1.f - vv)) * (dk * ww + (1 - dk) * (1.f - ww))
+                        * dot(gradient, offset);
+                }
+            }
+        }
+        return sum;
+    }
+
+    float NoiseTexture::turbulence(const vec3& p) const
+    {
+        float sum = 0.f;
+        vec3 octave = p;
+        float weight = 1.f;
+        for (int i = 0; i < 7; ++i)
+        {
+            sum += weight * noise(octave);
+            weight *= 0.5f;
+            octave *= 2.f;
+        }
+        return std::fabs(sum);
+    }
+}
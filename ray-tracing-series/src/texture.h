@@ -0,0 +1,63 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    struct HitRecord;
+
+    // A color which varies over the surfaces, it modulates the albedo of the materials (see Lambertian)
+    class Texture
+    {
+    public:
+        virtual ~Texture() {}
+
+        // The linear color at the hit point
+        virtual vec3 value(const HitRecord& rec) const = 0;
+    };
+
+    // A 3D checkerboard made of the sign of sin(frequency * x) * sin(frequency * y) * sin(frequency * z) at the hit point
+    class CheckerTexture final : public Texture
+    {
+    public:
+        CheckerTexture(const vec3& odd, const vec3& even, float frequency) : m_odd(odd), m_even(even), m_frequency(frequency) {}
+
+        virtual vec3 value(const HitRecord& rec) const override;
+
+    private:
+        vec3 m_odd;
+        vec3 m_even;
+        float m_frequency;
+    };
+
+    // A marble-like pattern made of Perlin noise, the color is modulated by sin(scale * z + 10 * turbulence(scale * p))
+    // the noise is seeded with a constant, every copy of a scene gets the same pattern
+    class NoiseTexture final : public Texture
+    {
+    public:
+        NoiseTexture(const vec3& color, float scale);
+
+        virtual vec3 value(const HitRecord& rec) const override;
+
+        // The Perlin noise in [-1, 1] and the absolute value of its sum over 7 octaves of halving weights
+        float noise(const vec3& p) const;
+        float turbulence(const vec3& p) const;
+
+    private:
+        static const int POINT_COUNT = 256;
+
+        vec3 m_color;
+        float m_scale;
+        vec3 m_gradients[POINT_COUNT];   // random unit vectors
+        int m_permutations[3][POINT_COUNT];
+    };
+}
@@ -0,0 +1,100 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "texturecache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mappedfile.h"
+
+namespace rts
+{
+    TextureCache::TextureCache(std::size_t budget)
+        : m_pagesPerShard(std::max<std::size_t>(budget / PAGE_SIZE / SHARD_COUNT, 1))
+        , m_shards(new Shard[SHARD_COUNT])
+        , m_nextTextureId(0)
+    {
+        for (int i = 0; i < SHARD_COUNT; ++i)
+        {
+            Shard& shard = m_shards[i];
+            shard.keys.resize(m_pagesPerShard);
+            shard.referenced.assign(m_pagesPerShard, 0);
+            shard.pages.resize(m_pagesPerShard);
+            shard.slotIndexes.reserve(m_pagesPerShard);
+        }
+    }
+
+    void TextureCache::readTexels(std::uint32_t textureId, const MappedFile& file, std::uint64_t pageOffset,
+        const std::uint32_t* texelOffsets, int texelCount, std::uint32_t* texels)
+    {
+        // A file of up to 2^40 pages for each of the 2^24 textures
+        std::uint64_t key = (static_cast<std::uint64_t>(textureId) << 40) | (pageOffset / PAGE_SIZE);
+        std::uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+        Shard& shard = m_shards[(hash >> 60) % SHARD_COUNT];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::uint32_t slot;
+        auto it = shard.slotIndexes.find(key);
+        if (it != shard.slotIndexes.end())
+        {
+            slot = it->second;
+            ++shard.hitCount;
+        }
+        else
+        {
+            // Take a free slot, otherwise sweep the clock hand until a slot which hasn't been read since the last sweep
+            if (shard.usedCount < m_pagesPerShard)
+            {
+                slot = shard.usedCount++;
+                shard.pages[slot].reset(new std::uint8_t[PAGE_SIZE]);
+            }
+            else
+            {
+                while (shard.referenced[shard.hand] != 0)
+                {
+                    shard.referenced[shard.hand] = 0;
+                    shard.hand = static_cast<std::uint32_t>((shard.hand + 1) % m_pagesPerShard);
+                }
+                slot = shard.hand;
+                shard.hand = static_cast<std::uint32_t>((shard.hand + 1) % m_pagesPerShard);
+                shard.slotIndexes.erase(shard.keys[slot]);
+                ++shard.evictionCount;
+            }
+
+            std::memcpy(shard.pages[slot].get(), file.data() + pageOffset, PAGE_SIZE);
+            file.release(static_cast<std::size_t>(pageOffset), PAGE_SIZE);
+            shard.keys[slot] = key;
+            shard.slotIndexes.emplace(key, slot);
+            ++shard.missCount;
+        }
+
+        shard.referenced[slot] = 1;
+        const std::uint8_t* page = shard.pages[slot].get();
+        for (int i = 0; i < texelCount; ++i)
+        {
+            std::memcpy(&texels[i], page + texelOffsets[i], sizeof(std::uint32_t));
+        }
+    }
+
+    TextureCacheStats TextureCache::getStats() const
+    {
+        TextureCacheStats stats = { 0, 0, 0, 0 };
+        for (int i = 0; i < SHARD_COUNT; ++i)
+        {
+            Shard& shard = m_shards[i];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            stats.hitCount += shard.hitCount;
+            stats.missCount += shard.missCount;
+            stats.evictionCount += shard.evictionCount;
+            stats.residentSize += shard.usedCount * PAGE_SIZE;
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace rts // for ray tracing series
+{
+    class MappedFile;
+
+    // The cumulative statistics of a texture cache
+    struct TextureCacheStats
+    {
+        std::uint64_t hitCount;
+        std::uint64_t missCount;
+        std::uint64_t evictionCount;
+        std::size_t residentSize;   // the memory of the pages in the cache
+    };
+
+    // A cache of texture pages with a fixed memory budget shared by all the image textures of a scene read from tiled texture files
+    // (see ImageTexture), the textures can hence hold more texels than the memory, a page is copied from the memory-mapped file
+    // the first time it's read and its pages of the mapping are released right away, the pages in the cache are replaced
+    // with the CLOCK algorithm, an approximation of LRU which only sets a flag when a page is read
+    // the cache is split in shards with a lock each so that the threads reading different pages seldom wait for each other
+    class TextureCache final
+    {
+    public:
+        static const std::size_t PAGE_SIZE = 4096;
+
+        explicit TextureCache(std::size_t budget);
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        // A unique identifier for each texture which reads its pages through the cache, they're never reused
+        std::uint32_t registerTexture() { return m_nextTextureId++; }
+
+        // Copy the texels at the given byte offsets of a page to texels, the page is at pageOffset in the file
+        // it's loaded in the cache on a miss, the texels are copied while the shard is locked since the page may be evicted afterwards
+        void readTexels(std::uint32_t textureId, const MappedFile& file, std::uint64_t pageOffset,
+            const std::uint32_t* texelOffsets, int texelCount, std::uint32_t* texels);
+
+        std::size_t getBudget() const { return SHARD_COUNT * m_pagesPerShard * PAGE_SIZE; }
+        TextureCacheStats getStats() const;
+
+    private:
+        static const int SHARD_COUNT = 16;
+
+        // The pages are allocated the first time their slot is used, the slots which are seldom read are the first ones evicted
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<std::uint64_t, std::uint32_t> slotIndexes;   // by key
+            std::vector<std::uint64_t> keys;                                // by slot, the unused slots are past usedCount
+            std::vector<std::uint8_t> referenced;                           // the CLOCK flags
+            std::vector<std::unique_ptr<std::uint8_t[]>> pages;
+            std::uint32_t hand = 0;
+            std::uint32_t usedCount = 0;
+            std::uint64_t hitCount = 0;
+            std::uint64_t missCount = 0;
+            std::uint64_t evictionCount = 0;
+        };
+
+        std::size_t m_pagesPerShard;
+        std::unique_ptr<Shard[]> m_shards;
+        std::atomic<std::uint32_t> m_nextTextureId;
+    };
+}
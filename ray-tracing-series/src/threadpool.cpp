@@ -0,0 +1,273 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "threadpool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "numa.h"
+
+namespace rts
+{
+    namespace
+    {
+        // The pool and the node of the calling worker, and whether it's running a task bound to its node
+        thread_local const ThreadPool* currentPool = nullptr;
+        thread_local unsigned int currentNode = 0;
+        thread_local bool runningBoundTask = false;
+    }
+
+    ThreadPool::ThreadPool(unsigned int threadCount)
+        : m_stopping(false)
+    {
+        threadCount = std::max(threadCount, 1u);
+
+        // Fill the nodes one after the other, the threads beyond the CPU count go to the nodes in turn
+        const std::vector<NumaNode>& numaNodes = getNumaNodes();
+        std::vector<unsigned int> nodeThreadCounts(numaNodes.size(), 0);
+        unsigned int remainingCount = threadCount;
+        for (std::size_t i = 0; i < numaNodes.size(); ++i)
+        {
+            nodeThreadCounts[i] = std::min(remainingCount, static_cast<unsigned int>(numaNodes[i].cpus.size()));
+            remainingCount -= nodeThreadCounts[i];
+        }
+        for (std::size_t i = 0; remainingCount > 0; i = (i + 1) % numaNodes.size(), --remainingCount)
+        {
+            ++nodeThreadCounts[i];
+        }
+
+        // The nodes are all created before the workers start since the workers look into the queues of the other nodes
+        std::vector<std::pair<const NumaNode*, unsigned int>> poolNodes;
+        for (std::size_t i = 0; i < numaNodes.size(); ++i)
+        {
+            if (nodeThreadCounts[i] > 0)
+            {
+                m_nodes.push_back(std::make_unique<Node>());
+                poolNodes.emplace_back(&numaNodes[i], nodeThreadCounts[i]);
+            }
+        }
+
+        // The workers are only pinned when there's more than one node, the OS is free to place them otherwise
+        bool pinning = numaNodes.size() > 1;
+        m_workers.reserve(threadCount);
+        for (unsigned int node = 0; node < poolNodes.size(); ++node)
+        {
+            const NumaNode* numaNode = poolNodes[node].first;
+            for (unsigned int i = 0; i < poolNodes[node].second; ++i)
+            {
+                m_workers.emplace_back([this, node, numaNode, pinning]()
+                {
+                    if (pinning)
+                    {
+                        pinThreadToNumaNode(*numaNode);
+                    }
+                    currentPool = this;
+                    currentNode = node;
+                    workerLoop(node);
+                });
+            }
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        for (auto& node : m_nodes)
+        {
+            node->condition.notify_all();
+        }
+
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::submit(std::function<void()> task, unsigned int node, bool stealable)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_nodes[node]->tasks.push_back({ std::move(task), stealable });
+        }
+
+        // A stealable task wakes up a worker of each node, the first one to get to it runs it
+        // the threads waiting for a task group are woken up as well, they may be able to run it
+        m_waitCondition.notify_all();
+        if (stealable)
+        {
+            for (auto& poolNode : m_nodes)
+            {
+                poolNode->condition.notify_one();
+            }
+        }
+        else
+        {
+            m_nodes[node]->condition.notify_one();
+        }
+    }
+
+    bool ThreadPool::popTask(int node, Task& task)
+    {
+        if (node >= 0 && !m_nodes[node]->tasks.empty())
+        {
+            task = std::move(m_nodes[node]->tasks.front());
+            m_nodes[node]->tasks.pop_front();
+            return true;
+        }
+
+        // Steal from the other nodes, starting with the next one so that the nodes aren't all stolen from in the same order
+        std::size_t nodeCount = m_nodes.size();
+        std::size_t firstNode = (node >= 0) ? static_cast<std::size_t>(node) + 1 : 0;
+        for (std::size_t n = 0; n < nodeCount; ++n)
+        {
+            std::deque<Task>& tasks = m_nodes[(firstNode + n) % nodeCount]->tasks;
+            auto it = std::find_if(tasks.begin(), tasks.end(), [](const Task& t) { return t.stealable; });
+            if (it != tasks.end())
+            {
+                task = std::move(*it);
+                tasks.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::runTask(Task& task)
+    {
+        bool wasRunningBoundTask = runningBoundTask;
+        runningBoundTask = !task.stealable;
+        task.function();
+        runningBoundTask = wasRunningBoundTask;
+    }
+
+    void ThreadPool::runPendingTask(const std::function<bool()>& isDone)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            bool hasTask = false;
+            int node = (currentPool == this) ? static_cast<int>(currentNode) : -1;
+            m_waitCondition.wait(lock, [&]() { return (hasTask = popTask(node, task)) || isDone(); });
+            if (!hasTask)
+            {
+                return;
+            }
+        }
+
+        runTask(task);
+    }
+
+    void ThreadPool::notifyWaiters()
+    {
+        // Taking the lock orders the notification after the check of a thread about to block, which would miss it otherwise
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_waitCondition.notify_all();
+    }
+
+    unsigned int ThreadPool::getCurrentNode() const
+    {
+        return (currentPool == this) ? currentNode : 0;
+    }
+
+    bool ThreadPool::isRunningBoundTask() const
+    {
+        return currentPool == this && runningBoundTask;
+    }
+
+    void ThreadPool::workerLoop(unsigned int node)
+    {
+        for (;;)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                bool hasTask = false;
+                m_nodes[node]->condition.wait(lock, [&]() { return (hasTask = popTask(static_cast<int>(node), task)) || m_stopping; });
+                if (!hasTask)
+                {
+                    return; // stopping and nothing left to do
+                }
+            }
+
+            runTask(task);
+        }
+    }
+
+    void TaskGroup::run(std::function<void()> task)
+    {
+        if (m_pool == nullptr)
+        {
+            task();
+            return;
+        }
+        runOnNode(m_pool->getCurrentNode(), std::move(task), m_pool->isRunningBoundTask());
+    }
+
+    void TaskGroup::runOnNode(unsigned int node, std::function<void()> task, bool bound)
+    {
+        if (m_pool == nullptr)
+        {
+            task();
+            return;
+        }
+
+        // The group may be destroyed by its waiting thread as soon as the count drops to 0, only the pool is used from then on
+        ++m_pendingCount;
+        ThreadPool* pool = m_pool;
+        m_pool->submit([this, pool, task]()
+        {
+            task();
+            if (--m_pendingCount == 0)
+            {
+                pool->notifyWaiters();
+            }
+        }, node, !bound);
+    }
+
+    void TaskGroup::wait()
+    {
+        // Help the workers instead of only blocking, it also prevents a deadlock when a task waits for its sub tasks
+        while (m_pendingCount.load() > 0)
+        {
+            m_pool->runPendingTask([this]() { return m_pendingCount.load() == 0; });
+        }
+    }
+
+    void runOnEachNode(ThreadPool* pool, const std::function<void(unsigned int)>& task)
+    {
+        if (pool == nullptr)
+        {
+            task(0);
+            return;
+        }
+
+        TaskGroup group(pool);
+        for (unsigned int node = 0; node < pool->getNodeCount(); ++node)
+        {
+            group.runOnNode(node, [&task, node]() { task(node); }, true);
+        }
+        group.wait();
+    }
+
+    ThreadPool* getThreadPool()
+    {
+#ifdef MULTITHREADING_ON
+        static ThreadPool pool(std::thread::hardware_concurrency());
+        return &pool;
+#else
+        return nullptr;
+#endif // MULTITHREADING_ON
+    }
+}
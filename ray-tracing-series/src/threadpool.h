@@ -0,0 +1,114 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rts // for ray tracing series
+{
+    // A fixed set of worker threads consuming task queues, the tasks are submitted through a TaskGroup which allows waiting for their completion
+    // the workers are spread over the NUMA nodes in the order of their CPUs, a node is filled before the next one is used
+    // on a machine with several nodes, each worker is pinned to the CPUs of its node and each node has its own queue
+    // a worker runs the tasks of its node first, then steals the stealable tasks of the other nodes when it runs out of them
+    class ThreadPool final
+    {
+    public:
+        explicit ThreadPool(unsigned int threadCount);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        unsigned int getThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+        // The number of NUMA nodes which have workers, they're numbered from 0 in the order of getNumaNodes()
+        unsigned int getNodeCount() const { return static_cast<unsigned int>(m_nodes.size()); }
+
+        // Queue a task on a node, a task which isn't stealable only runs on the workers of its node
+        // so that the memory it touches first is allocated on the node, the tasks it spawns are bound to the node as well
+        void submit(std::function<void()> task, unsigned int node = 0, bool stealable = true);
+
+        // Run one of the queued tasks in the calling thread, it blocks until there's one it can run unless isDone returns true first
+        // the threads outside of the pool only run the stealable tasks
+        // isDone is checked with the queues locked, whatever makes it true must then call notifyWaiters() to wake the thread up
+        void runPendingTask(const std::function<bool()>& isDone);
+        void notifyWaiters();
+
+        // The node of the calling worker, 0 for the threads outside of the pool
+        unsigned int getCurrentNode() const;
+
+        // Return true if the calling thread runs a task bound to its node
+        bool isRunningBoundTask() const;
+
+    private:
+        struct Task
+        {
+            std::function<void()> function;
+            bool stealable;
+        };
+
+        struct Node
+        {
+            std::deque<Task> tasks;
+            std::condition_variable condition;
+        };
+
+        // Take a task for a worker of the given node, or a stealable one when the node is negative, the mutex must be locked
+        bool popTask(int node, Task& task);
+        void runTask(Task& task);
+        void workerLoop(unsigned int node);
+
+        std::vector<std::unique_ptr<Node>> m_nodes;
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_waitCondition; // the threads blocked in runPendingTask(), woken up by each queued task
+        bool m_stopping;
+    };
+
+    // A set of tasks which can be waited for, when no pool is given the tasks are run immediately
+    // a thread waiting for a group keeps on running queued tasks so tasks can safely spawn and wait for sub tasks
+    // it sleeps when there's none it can run, until one is queued or the last task of the group completes
+    // the tasks are queued on the node of the calling thread, and bound to it when the calling thread runs a bound task
+    class TaskGroup final
+    {
+    public:
+        explicit TaskGroup(ThreadPool* pool) : m_pool(pool), m_pendingCount(0) {}
+        ~TaskGroup() { wait(); }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void run(std::function<void()> task);
+
+        // Queue the task on the given node of the pool instead, see ThreadPool::submit
+        void runOnNode(unsigned int node, std::function<void()> task, bool bound = false);
+
+        void wait();
+
+    private:
+        ThreadPool* m_pool;
+        std::atomic<int> m_pendingCount;
+    };
+
+    // Run the task once on each node of the pool and wait for all of them, each task is bound to its node and receives its index
+    // without a pool, the task is run once for node 0
+    void runOnEachNode(ThreadPool* pool, const std::function<void(unsigned int)>& task);
+
+    // Return the thread pool shared by the ray tracer and the acceleration structure builders
+    // it's null when the multithreading support isn't activated
+    ThreadPool* getThreadPool();
+}
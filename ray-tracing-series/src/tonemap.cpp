@@ -0,0 +1,201 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "tonemap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "config.h"
+#include "fastmath.h"
+#include "hdrimage.h"
+#include "utils.h"
+#include "vec3x8.h"
+
+namespace rts
+{
+    namespace
+    {
+        floatx8 applyOperator(const floatx8& x, ToneMapOperator toneMapOperator)
+        {
+            switch (toneMapOperator)
+            {
+            case ToneMapOperator::Reinhard:
+                return x / (floatx8(1.f) + x);
+            case ToneMapOperator::Aces:
+                // (x (2.51 x + 0.03)) / (x (2.43 x + 0.59) + 0.14)
+                return x * (floatx8(2.51f) * x + floatx8(0.03f)) / (x * (floatx8(2.43f) * x + floatx8(0.59f)) + floatx8(0.14f));
+            default:
+                return x;
+            }
+        }
+    }
+
+    ToneMapSettings getDefaultToneMapSettings()
+    {
+        ToneMapSettings settings;
+        settings.exposure = IMAGE_EXPOSURE;
+        settings.toneMapOperator = ToneMapOperator::Clamp;
+        settings.gamma = IMAGE_GAMMA_CORRECTION;
+#ifdef RENDER_GRAYSCALE
+        settings.grayscale = true;
+#else
+        settings.grayscale = false;
+#endif // RENDER_GRAYSCALE
+        return settings;
+    }
+
+    bool parseToneMapOperator(const std::string& name, ToneMapOperator& toneMapOperator)
+    {
+        if (name == "clamp")
+        {
+            toneMapOperator = ToneMapOperator::Clamp;
+        }
+        else if (name == "reinhard")
+        {
+            toneMapOperator = ToneMapOperator::Reinhard;
+        }
+        else if (name == "aces")
+        {
+            toneMapOperator = ToneMapOperator::Aces;
+        }
+        else
+        {
+            std::cerr << "Unknown tonemapping operator " << name << ", expected clamp, reinhard or aces" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void toneMap(const HdrImage& image, const ToneMapSettings& settings, std::vector<std::uint8_t>& rgb)
+    {
+        // The components are processed as a flat array of floats, padded to a multiple of 8
+        std::size_t pixelCount = image.pixels.size();
+        std::vector<float> values((3 * pixelCount + 7) & ~static_cast<std::size_t>(7), 0.f);
+        for (std::size_t i = 0; i < pixelCount; ++i)
+        {
+            const vec3& pixel = image.pixels[i];
+            if (settings.grayscale)
+            {
+                float lum = getLuminance(pixel);
+                values[3 * i] = values[3 * i + 1] = values[3 * i + 2] = lum;
+            }
+            else
+            {
+                values[3 * i] = pixel[0];
+                values[3 * i + 1] = pixel[1];
+                values[3 * i + 2] = pixel[2];
+            }
+        }
+
+        floatx8 scale(std::exp2(settings.exposure));
+        for (std::size_t i = 0; i < values.size(); i += 8)
+        {
+            applyOperator(floatx8::load(&values[i]) * scale, settings.toneMapOperator).store(&values[i]);
+        }
+
+        // The gamma correction clamps the values to [0, 1] before quantizing them
+        rgb.resize(3 * pixelCount);
+        for (std::size_t i = 0; i < pixelCount; ++i)
+        {
+            int levels[3];
+            convertToRgb8(vec3(values[3 * i], values[3 * i + 1], values[3 * i + 2]), settings.gamma, levels);
+            for (int c = 0; c < 3; ++c)
+            {
+                rgb[3 * i + c] = static_cast<std::uint8_t>(levels[c]);
+            }
+        }
+    }
+
+    bool savePpmFile(const std::string& filePath, int width, int height, const std::vector<std::uint8_t>& rgb)
+    {
+        std::ofstream imageFile(filePath);
+        if (!imageFile.is_open())
+        {
+            std::cerr << "Unable to create the image file " << filePath << std::endl;
+            return false;
+        }
+
+        // Write the image file header
+        imageFile << "P3" << std::endl;
+        imageFile << width << " " << height << std::endl;
+        imageFile << "255" << std::endl;
+
+        // The rows are stored from bottom to top
+        for (int j = height - 1; j >= 0; --j)
+        {
+            for (int i = 0; i < width; ++i)
+            {
+                const std::uint8_t* col = &rgb[3 * (i + static_cast<std::size_t>(j) * width)];
+                imageFile << static_cast<int>(col[0]) << " " << static_cast<int>(col[1]) << " " << static_cast<int>(col[2]) << std::endl;
+            }
+        }
+
+        return imageFile.good();
+    }
+
+    bool loadPpmFile(const std::string& filePath, int& width, int& height, std::vector<std::uint8_t>& rgb)
+    {
+        std::ifstream imageFile(filePath, std::ios::binary);
+        if (!imageFile.is_open())
+        {
+            std::cerr << "Unable to open the image file " << filePath << std::endl;
+            return false;
+        }
+
+        // The header is made of the format, the size and the maximum value, separated by whitespaces and comments
+        std::string header[4];
+        for (int i = 0; i < 4 && imageFile; ++i)
+        {
+            while (imageFile >> std::ws && imageFile.peek() == '#')
+            {
+                imageFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+            imageFile >> header[i];
+        }
+        bool binary = (header[0] == "P6");
+        width = std::atoi(header[1].c_str());
+        height = std::atoi(header[2].c_str());
+        if (!imageFile || (!binary && header[0] != "P3") || width <= 0 || height <= 0 || header[3] != "255")
+        {
+            std::cerr << "Invalid image file " << filePath << ", only the 8-bit P3 and P6 PPM files are supported" << std::endl;
+            return false;
+        }
+        imageFile.get(); // the single whitespace before the binary pixels
+
+        std::size_t rowSize = 3 * static_cast<std::size_t>(width);
+        rgb.assign(rowSize * height, 0);
+        for (int j = height - 1; j >= 0 && imageFile; --j)
+        {
+            std::uint8_t* row = &rgb[rowSize * j];
+            if (binary)
+            {
+                imageFile.read(reinterpret_cast<char*>(row), rowSize);
+                continue;
+            }
+            for (std::size_t i = 0; i < rowSize; ++i)
+            {
+                int value = 0;
+                imageFile >> value;
+                row[i] = static_cast<std::uint8_t>(std::min(std::max(value, 0), 255));
+            }
+        }
+
+        if (!imageFile)
+        {
+            std::cerr << "Invalid image file " << filePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
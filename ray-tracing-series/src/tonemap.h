@@ -0,0 +1,52 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rts // for ray tracing series
+{
+    struct HdrImage;
+
+    // The curve which maps the radiance to [0, 1], it's applied before the gamma correction
+    enum class ToneMapOperator
+    {
+        Clamp,      // the values above 1 are clipped, this is how the images were always rendered
+        Reinhard,   // x / (1 + x)
+        Aces        // Krzysztof Narkowicz's fit of the ACES filmic curve
+    };
+
+    struct ToneMapSettings
+    {
+        float exposure;             // in stops, the radiance is multiplied by 2^exposure
+        ToneMapOperator toneMapOperator;
+        float gamma;
+        bool grayscale;             // convert the radiance to its luminance first
+    };
+
+    // The settings from config.h, they reproduce the images rendered before the tonemapping became a separate pass
+    ToneMapSettings getDefaultToneMapSettings();
+
+    // Parse the name of an operator (clamp, reinhard or aces)
+    bool parseToneMapOperator(const std::string& name, ToneMapOperator& toneMapOperator);
+
+    // Convert the linear image to 8-bit RGB, the exposure and the operator are applied 8 values at a time
+    // the gamma correction and the quantization rely on the fast-math layer (see convertToRgb8)
+    // the output has 3 bytes per pixel and keeps the rows from bottom to top
+    void toneMap(const HdrImage& image, const ToneMapSettings& settings, std::vector<std::uint8_t>& rgb);
+
+    // Save the 8-bit image as an ASCII PPM file, the rows are written from top to bottom
+    bool savePpmFile(const std::string& filePath, int width, int height, const std::vector<std::uint8_t>& rgb);
+
+    // Load an 8-bit PPM file, either ASCII (P3) or binary (P6), the rows are returned from bottom to top like savePpmFile expects them
+    bool loadPpmFile(const std::string& filePath, int& width, int& height, std::vector<std::uint8_t>& rgb);
+}
@@ -0,0 +1,171 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cmath>
+
+#include "aabb.h"
+#include "defines.h"
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // An affine transform stored as a 3x4 matrix, the last column being the translation
+    class Transform final
+    {
+    public:
+        Transform()
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    m[i][j] = (i == j) ? 1.f : 0.f;
+                }
+            }
+        }
+
+        // Create a transform from a row-major 3x4 matrix
+        explicit Transform(const float values[12])
+        {
+            for (int i = 0; i < 12; ++i)
+            {
+                m[i / 4][i % 4] = values[i];
+            }
+        }
+
+        static inline Transform translation(const vec3& t);
+        static inline Transform scale(float s);
+        static inline Transform rotationY(float degrees);
+
+        inline vec3 transformPoint(const vec3& p) const;
+        inline vec3 transformVector(const vec3& v) const;
+
+        // Transform a normal with the transpose of this matrix, this must be called on the inverse transform
+        inline vec3 transformNormalTransposed(const vec3& n) const;
+
+        inline Aabb transformBox(const Aabb& box) const;
+        inline Transform inverse() const;
+
+        const float* values() const { return &m[0][0]; }
+
+    private:
+        float m[3][4];
+
+        friend inline Transform operator*(const Transform& t1, const Transform& t2);
+    };
+
+    inline Transform Transform::translation(const vec3& t)
+    {
+        Transform result;
+        result.m[0][3] = t.x();
+        result.m[1][3] = t.y();
+        result.m[2][3] = t.z();
+        return result;
+    }
+
+    inline Transform Transform::scale(float s)
+    {
+        Transform result;
+        result.m[0][0] = result.m[1][1] = result.m[2][2] = s;
+        return result;
+    }
+
+    inline Transform Transform::rotationY(float degrees)
+    {
+        float theta = degrees * static_cast<float>(M_PI) / 180.f;
+        Transform result;
+        result.m[0][0] = cos(theta);
+        result.m[0][2] = sin(theta);
+        result.m[2][0] = -sin(theta);
+        result.m[2][2] = cos(theta);
+        return result;
+    }
+
+    inline vec3 Transform::transformPoint(const vec3& p) const
+    {
+        return vec3(
+            m[0][0] * p.x() + m[0][1] * p.y() + m[0][2] * p.z() + m[0][3],
+            m[1][0] * p.x() + m[1][1] * p.y() + m[1][2] * p.z() + m[1][3],
+            m[2][0] * p.x() + m[2][1] * p.y() + m[2][2] * p.z() + m[2][3]);
+    }
+
+    inline vec3 Transform::transformVector(const vec3& v) const
+    {
+        return vec3(
+            m[0][0] * v.x() + m[0][1] * v.y() + m[0][2] * v.z(),
+            m[1][0] * v.x() + m[1][1] * v.y() + m[1][2] * v.z(),
+            m[2][0] * v.x() + m[2][1] * v.y() + m[2][2] * v.z());
+    }
+
+    inline vec3 Transform::transformNormalTransposed(const vec3& n) const
+    {
+        return vec3(
+            m[0][0] * n.x() + m[1][0] * n.y() + m[2][0] * n.z(),
+            m[0][1] * n.x() + m[1][1] * n.y() + m[2][1] * n.z(),
+            m[0][2] * n.x() + m[1][2] * n.y() + m[2][2] * n.z());
+    }
+
+    inline Aabb Transform::transformBox(const Aabb& box) const
+    {
+        // Transform the 8 corners of the box
+        Aabb result;
+        if (box.isEmpty())
+        {
+            return result;
+        }
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            vec3 p((corner & 1) ? box.max().x() : box.min().x(), (corner & 2) ? box.max().y() : box.min().y(), (corner & 4) ? box.max().z() : box.min().z());
+            result.expand(transformPoint(p));
+        }
+        return result;
+    }
+
+    inline Transform Transform::inverse() const
+    {
+        // Invert the 3x3 linear part with its cofactors, then apply it to the negated translation
+        float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        float invDet = 1.f / (m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02);
+
+        Transform result;
+        result.m[0][0] = c00 * invDet;
+        result.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+        result.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+        result.m[1][0] = c01 * invDet;
+        result.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+        result.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+        result.m[2][0] = c02 * invDet;
+        result.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+        result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+
+        vec3 t = result.transformVector(vec3(m[0][3], m[1][3], m[2][3]));
+        result.m[0][3] = -t.x();
+        result.m[1][3] = -t.y();
+        result.m[2][3] = -t.z();
+        return result;
+    }
+
+    // Compose two transforms, t2 is applied first
+    inline Transform operator*(const Transform& t1, const Transform& t2)
+    {
+        Transform result;
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 4; ++j)
+            {
+                result.m[i][j] = t1.m[i][0] * t2.m[0][j] + t1.m[i][1] * t2.m[1][j] + t1.m[i][2] * t2.m[2][j] + ((j == 3) ? t1.m[i][3] : 0.f);
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,243 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "trianglemesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+#include <limits>
+#include <utility>
+
+#include "ray.h"
+
+namespace rts
+{
+    namespace
+    {
+        // The ray broadcast on the 4 lanes of SSE registers
+        struct RayPacket
+        {
+            __m128 origin[3];
+            __m128 direction[3];
+        };
+
+        vec3 getVertexPosition(const MeshVertex& vertex)
+        {
+            return vec3(vertex.position[0], vertex.position[1], vertex.position[2]);
+        }
+    }
+
+    TriangleMesh::TriangleMesh(const MeshVertex* vertices, const std::uint32_t* indices, std::size_t triangleCount, bool hasNormals,
+        const float* texCoords, const Material* material, BvhBuildMethod buildMethod, ThreadPool* pool)
+        : m_vertices(vertices)
+        , m_indices(indices)
+        , m_triangleCount(triangleCount)
+        , m_hasNormals(hasNormals)
+        , m_texCoords(texCoords)
+        , m_material(material)
+    {
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // Sort the triangles along a Morton curve so that the consecutive ones which end up in a packet are close to each other
+        Aabb centroidBounds;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> sortedTriangles(triangleCount);
+        std::vector<vec3> centroids(triangleCount);
+        for (std::size_t i = 0; i < triangleCount; ++i)
+        {
+            const std::uint32_t* triangle = indices + 3 * i;
+            centroids[i] = (getVertexPosition(vertices[triangle[0]]) + getVertexPosition(vertices[triangle[1]]) + getVertexPosition(vertices[triangle[2]])) / 3.f;
+            centroidBounds.expand(centroids[i]);
+        }
+
+        vec3 extent = centroidBounds.max() - centroidBounds.min();
+        vec3 scale(extent.x() > 0.f ? 1.f / extent.x() : 0.f, extent.y() > 0.f ? 1.f / extent.y() : 0.f, extent.z() > 0.f ? 1.f / extent.z() : 0.f);
+        for (std::size_t i = 0; i < triangleCount; ++i)
+        {
+            sortedTriangles[i] = std::make_pair(getMortonCode((centroids[i] - centroidBounds.min()) * scale), static_cast<std::uint32_t>(i));
+        }
+        std::sort(sortedTriangles.begin(), sortedTriangles.end());
+
+        // The last packet is padded with degenerate triangles, they're rejected by the intersection test since their determinant is 0
+        std::size_t packetCount = (triangleCount + PACKET_SIZE - 1) / PACKET_SIZE;
+        m_packets.resize(packetCount);
+        std::vector<Aabb> packetBounds(packetCount);
+        for (std::size_t p = 0; p < packetCount; ++p)
+        {
+            TrianglePacket& packet = m_packets[p];
+            for (int lane = 0; lane < PACKET_SIZE; ++lane)
+            {
+                std::size_t sortedIndex = p * PACKET_SIZE + lane;
+                std::uint32_t triangleIndex = sortedTriangles[std::min(sortedIndex, triangleCount - 1)].second;
+                const std::uint32_t* triangle = indices + 3 * triangleIndex;
+                vec3 v0 = getVertexPosition(vertices[triangle[0]]);
+                vec3 v1 = getVertexPosition(vertices[triangle[1]]);
+                vec3 v2 = getVertexPosition(vertices[triangle[2]]);
+                if (sortedIndex >= triangleCount)
+                {
+                    v1 = v0;
+                    v2 = v0;
+                }
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    packet.v0[axis][lane] = v0[axis];
+                    packet.edge1[axis][lane] = v1[axis] - v0[axis];
+                    packet.edge2[axis][lane] = v2[axis] - v0[axis];
+                }
+                packet.triangleIndex[lane] = triangleIndex;
+
+                packetBounds[p].expand(v0);
+                packetBounds[p].expand(v1);
+                packetBounds[p].expand(v2);
+            }
+        }
+
+        m_bvh.build(packetBounds, buildMethod, pool);
+    }
+
+    bool TriangleMesh::hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const
+    {
+        RayPacket ray;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            ray.origin[axis] = _mm_set1_ps(r.origin()[axis]);
+            ray.direction[axis] = _mm_set1_ps(r.direction()[axis]);
+        }
+
+        const TrianglePacket* closestPacket = nullptr;
+        int closestLane = 0;
+        float closestU = 0.f;
+        float closestV = 0.f;
+        float closestSoFar = tMax;
+
+        m_bvh.intersect(r, tMin, closestSoFar, [&](std::uint32_t index, float tMinPacket, float tMaxPacket, float& t)
+        {
+            const TrianglePacket& packet = m_packets[index];
+            __m128 e1x = _mm_loadu_ps(packet.edge1[0]), e1y = _mm_loadu_ps(packet.edge1[1]), e1z = _mm_loadu_ps(packet.edge1[2]);
+            __m128 e2x = _mm_loadu_ps(packet.edge2[0]), e2y = _mm_loadu_ps(packet.edge2[1]), e2z = _mm_loadu_ps(packet.edge2[2]);
+            const __m128* d = ray.direction;
+
+            // Moller-Trumbore, the barycentric coordinates and the distance are computed with Cramer's rule
+            // pvec = cross(direction, edge2), det = dot(edge1, pvec)
+            __m128 px = _mm_sub_ps(_mm_mul_ps(d[1], e2z), _mm_mul_ps(d[2], e2y));
+            __m128 py = _mm_sub_ps(_mm_mul_ps(d[2], e2x), _mm_mul_ps(d[0], e2z));
+            __m128 pz = _mm_sub_ps(_mm_mul_ps(d[0], e2y), _mm_mul_ps(d[1], e2x));
+            __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+            __m128 invDet = _mm_div_ps(_mm_set1_ps(1.f), det);
+
+            // tvec = origin - v0, u = dot(tvec, pvec) / det
+            __m128 tx = _mm_sub_ps(ray.origin[0], _mm_loadu_ps(packet.v0[0]));
+            __m128 ty = _mm_sub_ps(ray.origin[1], _mm_loadu_ps(packet.v0[1]));
+            __m128 tz = _mm_sub_ps(ray.origin[2], _mm_loadu_ps(packet.v0[2]));
+            __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+
+            // qvec = cross(tvec, edge1), v = dot(direction, qvec) / det, t = dot(edge2, qvec) / det
+            __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+            __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+            __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+            __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], qx), _mm_mul_ps(d[1], qy)), _mm_mul_ps(d[2], qz)), invDet);
+            __m128 tLanes = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+            // The comparisons fail on NaNs, which covers the rays parallel to a triangle
+            __m128 zero = _mm_setzero_ps();
+            __m128 mask = _mm_cmpneq_ps(det, zero);
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+            mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f)));
+            mask = _mm_and_ps(mask, _mm_cmpgt_ps(tLanes, _mm_set1_ps(tMinPacket)));
+            mask = _mm_and_ps(mask, _mm_cmplt_ps(tLanes, _mm_set1_ps(tMaxPacket)));
+
+            int hitLanes = _mm_movemask_ps(mask);
+            if (hitLanes == 0)
+            {
+                return false;
+            }
+
+            // Keep the closest of the lanes which have been hit
+            float tValues[PACKET_SIZE], uValues[PACKET_SIZE], vValues[PACKET_SIZE];
+            _mm_storeu_ps(tValues, tLanes);
+            _mm_storeu_ps(uValues, u);
+            _mm_storeu_ps(vValues, v);
+            t = std::numeric_limits<float>::max();
+            for (int lane = 0; lane < PACKET_SIZE; ++lane)
+            {
+                if ((hitLanes & (1 << lane)) != 0 && tValues[lane] < t)
+                {
+                    t = tValues[lane];
+                    closestPacket = &packet;
+                    closestLane = lane;
+                    closestU = uValues[lane];
+                    closestV = vValues[lane];
+                }
+            }
+            return true;
+        });
+
+        if (closestPacket == nullptr)
+        {
+            return false;
+        }
+
+        rec.t = closestSoFar;
+        rec.p = r.pointAtParameter(rec.t);
+        rec.matPtr = m_material;
+
+        // Interpolate the texture coordinates if any, their density is the ratio between the areas of the triangle in both spaces
+        const std::uint32_t* triangle = m_indices + 3 * closestPacket->triangleIndex[closestLane];
+        vec3 edge1(closestPacket->edge1[0][closestLane], closestPacket->edge1[1][closestLane], closestPacket->edge1[2][closestLane]);
+        vec3 edge2(closestPacket->edge2[0][closestLane], closestPacket->edge2[1][closestLane], closestPacket->edge2[2][closestLane]);
+        vec3 faceNormal = cross(edge1, edge2);
+        float uvArea = 1.f; // twice the area of the barycentric triangle
+        if (m_texCoords != nullptr)
+        {
+            const float* uv0 = m_texCoords + 2 * triangle[0];
+            const float* uv1 = m_texCoords + 2 * triangle[1];
+            const float* uv2 = m_texCoords + 2 * triangle[2];
+            float w = 1.f - closestU - closestV;
+            rec.u = w * uv0[0] + closestU * uv1[0] + closestV * uv2[0];
+            rec.v = w * uv0[1] + closestU * uv1[1] + closestV * uv2[1];
+            uvArea = std::fabs((uv1[0] - uv0[0]) * (uv2[1] - uv0[1]) - (uv2[0] - uv0[0]) * (uv1[1] - uv0[1]));
+        }
+        else
+        {
+            rec.u = closestU;
+            rec.v = closestV;
+        }
+        float worldArea = faceNormal.length();
+        rec.uvDensity = (worldArea > 0.f) ? std::sqrt(uvArea / worldArea) : 0.f;
+
+        // Interpolate the vertex normals if any, otherwise use the face normal given by the winding order
+        if (m_hasNormals)
+        {
+            const float* n0 = m_vertices[triangle[0]].normal;
+            const float* n1 = m_vertices[triangle[1]].normal;
+            const float* n2 = m_vertices[triangle[2]].normal;
+            float w = 1.f - closestU - closestV;
+            rec.normal = unitVector(vec3(
+                w * n0[0] + closestU * n1[0] + closestV * n2[0],
+                w * n0[1] + closestU * n1[1] + closestV * n2[1],
+                w * n0[2] + closestU * n1[2] + closestV * n2[2]));
+        }
+        else
+        {
+            rec.normal = unitVector(faceNormal);
+        }
+        return true;
+    }
+
+    bool TriangleMesh::boundingBox(Aabb& box) const
+    {
+        box = m_bvh.getBounds();
+        return !box.isEmpty();
+    }
+}
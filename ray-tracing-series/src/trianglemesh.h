@@ -0,0 +1,68 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bvh.h"
+#include "hitable.h"
+
+namespace rts // for ray tracing series
+{
+    // A vertex of a triangle mesh, it's also the layout used by the binary scene files (see Scene::loadBinaryFile)
+    // the normal is only meaningful when the mesh has per-vertex normals, otherwise the faces are flat
+    struct MeshVertex
+    {
+        float position[3];
+        float normal[3];
+    };
+
+    // A set of triangles stored in indexed vertex buffers, the buffers aren't owned by the mesh
+    // the texture coordinates are optional, 2 floats per vertex, the barycentric coordinates are used instead when they're null
+    // the triangles are grouped by 4 in packets storing their first vertex and precomputed edges in SoA form
+    // so that a single Moller-Trumbore test on SSE registers checks the 4 of them at once
+    // the BVH is built over the packets which are gathered along a Morton curve to keep them compact
+    class TriangleMesh final : public Hitable
+    {
+    public:
+        TriangleMesh(const MeshVertex* vertices, const std::uint32_t* indices, std::size_t triangleCount, bool hasNormals,
+            const float* texCoords, const Material* material, BvhBuildMethod buildMethod, ThreadPool* pool);
+
+        virtual bool hit(const Ray& r, float tMin, float tMax, HitRecord& rec) const override;
+        virtual bool boundingBox(Aabb& box) const override;
+
+        const Bvh& getBvh() const { return m_bvh; }
+        std::size_t getTriangleCount() const { return m_triangleCount; }
+        std::size_t getMemoryUsage() const { return m_packets.size() * sizeof(TrianglePacket) + m_bvh.getMemoryUsage(); }
+
+        static const int PACKET_SIZE = 4;
+
+    private:
+        struct TrianglePacket
+        {
+            float v0[3][PACKET_SIZE];       // the x, y and z coordinates of the first vertex of each triangle
+            float edge1[3][PACKET_SIZE];    // v1 - v0
+            float edge2[3][PACKET_SIZE];    // v2 - v0
+            std::uint32_t triangleIndex[PACKET_SIZE];
+        };
+
+        const MeshVertex* m_vertices;
+        const std::uint32_t* m_indices;
+        std::size_t m_triangleCount;
+        bool m_hasNormals;
+        const float* m_texCoords;
+        const Material* m_material;
+
+        std::vector<TrianglePacket> m_packets;
+        Bvh m_bvh;
+    };
+}
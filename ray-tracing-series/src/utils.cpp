@@ -11,6 +11,7 @@
 
 #include <cmath>
 
+#include "fastmath.h"
 #include "random.h"
 
 namespace rts
@@ -26,6 +27,14 @@ namespace rts
         return p;
     }
 
+    vec3 getCosineWeightedDirection(const vec3& normal, Random& random)
+    {
+        // A point on the unit sphere tangent to the surface, the direction towards it follows the cosine
+        vec3 direction = normal + unitVector(getRandomPointInUnitSphere(random));
+        float length = direction.length();
+        return (length > 1e-6f) ? direction / length : normal;
+    }
+
     vec3 getRandomPointInUnitSphere(Random& random)
     {
         vec3 p;
@@ -76,7 +85,18 @@ namespace rts
 
     float getSchlickApproximation(float cosine, float refIdx)
     {
+        if (FastMath::isEnabled(FAST_MATH_INTEGER_POW))
+        {
+            float r0 = powInt((1.f - refIdx) / (1.f + refIdx), 2);
+            return r0 + (1.f - r0) * powInt(1.f - cosine, 5);
+        }
+
         float r0 = pow((1.f - refIdx) / (1.f + refIdx), 2);
         return r0 + (1.f - r0) * pow(1.f - cosine, 5);
     }
+
+    bool endsWith(const std::string& value, const std::string& suffix)
+    {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
 }
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <string>
+
 #include "vec3.h"
 
 namespace rts // for ray tracing series
@@ -21,6 +23,9 @@ namespace rts // for ray tracing series
     // Generate a random point in a unit sphere
     vec3 getRandomPointInUnitSphere(Random& random);
 
+    // Generate a random unit vector around the normal with a density of cosine / pi, the distribution of the light scattered by a Lambertian surface
+    vec3 getCosineWeightedDirection(const vec3& normal, Random& random);
+
     // Compute the reflected vector for the given vector and normal
     vec3 getReflectedVector(const vec3& v, const vec3& n);
 
@@ -29,4 +34,10 @@ namespace rts // for ray tracing series
 
     // Compute Schlick's approximation for the given values
     float getSchlickApproximation(float cosine, float refIdx);
+
+    // Colorimetric conversion to grayscale https://en.wikipedia.org/wiki/Grayscale
+    inline float getLuminance(const vec3& color) { return 0.2126f * color[0] + 0.7152f * color[1] + 0.0722f * color[2]; }
+
+    // Return true if the string ends with the given suffix, e.g. to check a file extension
+    bool endsWith(const std::string& value, const std::string& suffix);
 }
@@ -0,0 +1,169 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <emmintrin.h>
+#include <iostream>
+
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // A vec3 held in an SSE register, the fourth lane is padding and its value is never read
+    // it offers the same operators as vec3 so that the code can move over incrementally, vec3 remains the storage type
+    // (12 bytes in the records and the arrays) while vec3a is meant for the local computations
+    class vec3a final
+    {
+    public:
+        vec3a() : m_v(_mm_setzero_ps()) {}
+        vec3a(float e0, float e1, float e2) : m_v(_mm_set_ps(0.f, e2, e1, e0)) {}
+        vec3a(const vec3& v) : m_v(_mm_set_ps(0.f, v.z(), v.y(), v.x())) {}
+        explicit vec3a(__m128 v) : m_v(v) {}
+
+        // X, Y, Z accessors
+        inline float x() const { return _mm_cvtss_f32(m_v); }
+        inline float y() const { return _mm_cvtss_f32(_mm_shuffle_ps(m_v, m_v, _MM_SHUFFLE(1, 1, 1, 1))); }
+        inline float z() const { return _mm_cvtss_f32(_mm_shuffle_ps(m_v, m_v, _MM_SHUFFLE(2, 2, 2, 2))); }
+
+        // R, G, B accessors
+        inline float r() const { return x(); }
+        inline float g() const { return y(); }
+        inline float b() const { return z(); }
+
+        inline const vec3a& operator+() const { return *this; }
+        inline vec3a operator-() const { return vec3a(_mm_sub_ps(_mm_setzero_ps(), m_v)); }
+        inline float operator[](int i) const { return reinterpret_cast<const float*>(&m_v)[i]; }
+        inline float& operator[](int i) { return reinterpret_cast<float*>(&m_v)[i]; }
+
+        inline vec3a& operator+=(const vec3a& v) { m_v = _mm_add_ps(m_v, v.m_v); return *this; }
+        inline vec3a& operator-=(const vec3a& v) { m_v = _mm_sub_ps(m_v, v.m_v); return *this; }
+        inline vec3a& operator*=(const vec3a& v) { m_v = _mm_mul_ps(m_v, v.m_v); return *this; }
+        inline vec3a& operator/=(const vec3a& v) { m_v = _mm_div_ps(m_v, v.m_v); return *this; }
+        inline vec3a& operator*=(const float t) { m_v = _mm_mul_ps(m_v, _mm_set1_ps(t)); return *this; }
+        inline vec3a& operator/=(const float t) { m_v = _mm_div_ps(m_v, _mm_set1_ps(t)); return *this; }
+
+        inline float squaredLength() const;
+        inline float length() const;
+        inline void makeUnitVector();
+
+        inline vec3 toVec3() const { return vec3(x(), y(), z()); }
+        inline __m128 get() const { return m_v; }
+
+    private:
+        __m128 m_v;
+
+        // Additional non-member functions declaration
+        friend inline vec3a operator+(const vec3a& v1, const vec3a& v2);
+        friend inline vec3a operator-(const vec3a& v1, const vec3a& v2);
+        friend inline vec3a operator*(const vec3a& v1, const vec3a& v2);
+        friend inline vec3a operator/(const vec3a& v1, const vec3a& v2);
+        friend inline vec3a operator*(const vec3a& v, float t);
+        friend inline vec3a operator/(const vec3a& v, float t);
+        friend inline vec3a operator*(float t, const vec3a& v);
+
+        friend inline float dot(const vec3a& v1, const vec3a& v2);
+        friend inline vec3a cross(const vec3a& v1, const vec3a& v2);
+    };
+
+    // The sum of the first three lanes, broadcast to all of them
+    inline __m128 sumXyz(__m128 v)
+    {
+        __m128 y = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+        __m128 z = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+        __m128 x = _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+        return _mm_add_ps(_mm_add_ps(x, y), z);
+    }
+
+    // Member functions definition
+    inline float vec3a::squaredLength() const
+    {
+        return _mm_cvtss_f32(sumXyz(_mm_mul_ps(m_v, m_v)));
+    }
+
+    inline float vec3a::length() const
+    {
+        return _mm_cvtss_f32(_mm_sqrt_ss(sumXyz(_mm_mul_ps(m_v, m_v))));
+    }
+
+    inline void vec3a::makeUnitVector()
+    {
+        m_v = _mm_div_ps(m_v, _mm_sqrt_ps(sumXyz(_mm_mul_ps(m_v, m_v))));
+    }
+
+    // Additional non-member functions definition
+    inline vec3a operator+(const vec3a& v1, const vec3a& v2)
+    {
+        return vec3a(_mm_add_ps(v1.m_v, v2.m_v));
+    }
+
+    inline vec3a operator-(const vec3a& v1, const vec3a& v2)
+    {
+        return vec3a(_mm_sub_ps(v1.m_v, v2.m_v));
+    }
+
+    inline vec3a operator*(const vec3a& v1, const vec3a& v2)
+    {
+        return vec3a(_mm_mul_ps(v1.m_v, v2.m_v));
+    }
+
+    inline vec3a operator/(const vec3a& v1, const vec3a& v2)
+    {
+        return vec3a(_mm_div_ps(v1.m_v, v2.m_v));
+    }
+
+    inline vec3a operator*(const vec3a& v, float t)
+    {
+        return vec3a(_mm_mul_ps(v.m_v, _mm_set1_ps(t)));
+    }
+
+    inline vec3a operator/(const vec3a& v, float t)
+    {
+        return vec3a(_mm_div_ps(v.m_v, _mm_set1_ps(t)));
+    }
+
+    inline vec3a operator*(float t, const vec3a& v)
+    {
+        return vec3a(_mm_mul_ps(v.m_v, _mm_set1_ps(t)));
+    }
+
+    inline float dot(const vec3a& v1, const vec3a& v2)
+    {
+        return _mm_cvtss_f32(sumXyz(_mm_mul_ps(v1.m_v, v2.m_v)));
+    }
+
+    inline vec3a cross(const vec3a& v1, const vec3a& v2)
+    {
+        // (y1 z2 - z1 y2, z1 x2 - x1 z2, x1 y2 - y1 x2) computed with two shuffles of each operand
+        __m128 v1Yzx = _mm_shuffle_ps(v1.m_v, v1.m_v, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 v2Yzx = _mm_shuffle_ps(v2.m_v, v2.m_v, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 v1Zxy = _mm_shuffle_ps(v1.m_v, v1.m_v, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 v2Zxy = _mm_shuffle_ps(v2.m_v, v2.m_v, _MM_SHUFFLE(3, 1, 0, 2));
+        return vec3a(_mm_sub_ps(_mm_mul_ps(v1Yzx, v2Zxy), _mm_mul_ps(v1Zxy, v2Yzx)));
+    }
+
+    inline std::istream& operator>>(std::istream& is, vec3a& t)
+    {
+        vec3 v;
+        is >> v;
+        t = vec3a(v);
+        return is;
+    }
+
+    inline std::ostream& operator<<(std::ostream& os, const vec3a& t)
+    {
+        os << t.toVec3();
+        return os;
+    }
+
+    inline vec3a unitVector(const vec3a& v)
+    {
+        return v / v.length();
+    }
+}
@@ -0,0 +1,209 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+#include "vec3.h"
+
+namespace rts // for ray tracing series
+{
+    // 8 floats processed together, held in an AVX register when the code is compiled for AVX (/arch:AVX or -mavx)
+    // and in two SSE registers otherwise, the comparisons return a mask with all the bits of the matching lanes set
+    class floatx8 final
+    {
+    public:
+        floatx8() {}
+#if defined(__AVX__)
+        floatx8(float f) : m_v(_mm256_set1_ps(f)) {}
+        explicit floatx8(__m256 v) : m_v(v) {}
+
+        static floatx8 load(const float* p) { return floatx8(_mm256_loadu_ps(p)); }
+        void store(float* p) const { _mm256_storeu_ps(p, m_v); }
+
+        // A bit per lane, set for the lanes whose mask is set
+        int getMask() const { return _mm256_movemask_ps(m_v); }
+#else
+        floatx8(float f) : m_lo(_mm_set1_ps(f)), m_hi(_mm_set1_ps(f)) {}
+        floatx8(__m128 lo, __m128 hi) : m_lo(lo), m_hi(hi) {}
+
+        static floatx8 load(const float* p) { return floatx8(_mm_loadu_ps(p), _mm_loadu_ps(p + 4)); }
+        void store(float* p) const { _mm_storeu_ps(p, m_lo); _mm_storeu_ps(p + 4, m_hi); }
+
+        int getMask() const { return _mm_movemask_ps(m_lo) | (_mm_movemask_ps(m_hi) << 4); }
+#endif
+
+        inline floatx8& operator+=(const floatx8& f) { return *this = *this + f; }
+        inline floatx8& operator-=(const floatx8& f) { return *this = *this - f; }
+        inline floatx8& operator*=(const floatx8& f) { return *this = *this * f; }
+        inline floatx8& operator/=(const floatx8& f) { return *this = *this / f; }
+
+    private:
+#if defined(__AVX__)
+        __m256 m_v;
+#else
+        __m128 m_lo;
+        __m128 m_hi;
+#endif
+
+        friend inline floatx8 operator+(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 operator-(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 operator*(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 operator/(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 operator<(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 operator>(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 operator&(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 operator|(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 sqrtx8(const floatx8& f);
+        friend inline floatx8 minx8(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 maxx8(const floatx8& f1, const floatx8& f2);
+        friend inline floatx8 select(const floatx8& mask, const floatx8& f1, const floatx8& f2);
+    };
+
+#if defined(__AVX__)
+    inline floatx8 operator+(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_add_ps(f1.m_v, f2.m_v)); }
+    inline floatx8 operator-(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_sub_ps(f1.m_v, f2.m_v)); }
+    inline floatx8 operator*(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_mul_ps(f1.m_v, f2.m_v)); }
+    inline floatx8 operator/(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_div_ps(f1.m_v, f2.m_v)); }
+    inline floatx8 operator<(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_cmp_ps(f1.m_v, f2.m_v, _CMP_LT_OQ)); }
+    inline floatx8 operator>(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_cmp_ps(f1.m_v, f2.m_v, _CMP_GT_OQ)); }
+    inline floatx8 operator&(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_and_ps(f1.m_v, f2.m_v)); }
+    inline floatx8 operator|(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_or_ps(f1.m_v, f2.m_v)); }
+    inline floatx8 sqrtx8(const floatx8& f) { return floatx8(_mm256_sqrt_ps(f.m_v)); }
+    inline floatx8 minx8(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_min_ps(f1.m_v, f2.m_v)); }
+    inline floatx8 maxx8(const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_max_ps(f1.m_v, f2.m_v)); }
+
+    // Pick the lanes of f1 where the mask is set and the ones of f2 elsewhere
+    inline floatx8 select(const floatx8& mask, const floatx8& f1, const floatx8& f2) { return floatx8(_mm256_blendv_ps(f2.m_v, f1.m_v, mask.m_v)); }
+#else
+    inline floatx8 operator+(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_add_ps(f1.m_lo, f2.m_lo), _mm_add_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 operator-(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_sub_ps(f1.m_lo, f2.m_lo), _mm_sub_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 operator*(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_mul_ps(f1.m_lo, f2.m_lo), _mm_mul_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 operator/(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_div_ps(f1.m_lo, f2.m_lo), _mm_div_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 operator<(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_cmplt_ps(f1.m_lo, f2.m_lo), _mm_cmplt_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 operator>(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_cmpgt_ps(f1.m_lo, f2.m_lo), _mm_cmpgt_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 operator&(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_and_ps(f1.m_lo, f2.m_lo), _mm_and_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 operator|(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_or_ps(f1.m_lo, f2.m_lo), _mm_or_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 sqrtx8(const floatx8& f) { return floatx8(_mm_sqrt_ps(f.m_lo), _mm_sqrt_ps(f.m_hi)); }
+    inline floatx8 minx8(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_min_ps(f1.m_lo, f2.m_lo), _mm_min_ps(f1.m_hi, f2.m_hi)); }
+    inline floatx8 maxx8(const floatx8& f1, const floatx8& f2) { return floatx8(_mm_max_ps(f1.m_lo, f2.m_lo), _mm_max_ps(f1.m_hi, f2.m_hi)); }
+
+    // SSE2 has no blend instruction, the lanes are combined with the mask
+    inline floatx8 select(const floatx8& mask, const floatx8& f1, const floatx8& f2)
+    {
+        return floatx8(_mm_or_ps(_mm_and_ps(mask.m_lo, f1.m_lo), _mm_andnot_ps(mask.m_lo, f2.m_lo)),
+            _mm_or_ps(_mm_and_ps(mask.m_hi, f1.m_hi), _mm_andnot_ps(mask.m_hi, f2.m_hi)));
+    }
+#endif
+
+    inline floatx8 operator-(const floatx8& f) { return floatx8(0.f) - f; }
+
+    // 8 vectors stored as a structure of arrays, one register per component, for the kernels which process rays or primitives in batches
+    // it offers the same operators as vec3, the lanes are loaded from and stored to separate x, y and z arrays
+    class vec3x8 final
+    {
+    public:
+        vec3x8() : m_x(0.f), m_y(0.f), m_z(0.f) {}
+        vec3x8(const floatx8& x, const floatx8& y, const floatx8& z) : m_x(x), m_y(y), m_z(z) {}
+
+        // The same vector in all the lanes
+        vec3x8(const vec3& v) : m_x(v.x()), m_y(v.y()), m_z(v.z()) {}
+
+        static vec3x8 load(const float* x, const float* y, const float* z) { return vec3x8(floatx8::load(x), floatx8::load(y), floatx8::load(z)); }
+        void store(float* x, float* y, float* z) const { m_x.store(x); m_y.store(y); m_z.store(z); }
+
+        // X, Y, Z accessors
+        inline const floatx8& x() const { return m_x; }
+        inline const floatx8& y() const { return m_y; }
+        inline const floatx8& z() const { return m_z; }
+
+        inline const vec3x8& operator+() const { return *this; }
+        inline vec3x8 operator-() const { return vec3x8(-m_x, -m_y, -m_z); }
+
+        inline vec3x8& operator+=(const vec3x8& v) { m_x += v.m_x; m_y += v.m_y; m_z += v.m_z; return *this; }
+        inline vec3x8& operator-=(const vec3x8& v) { m_x -= v.m_x; m_y -= v.m_y; m_z -= v.m_z; return *this; }
+        inline vec3x8& operator*=(const vec3x8& v) { m_x *= v.m_x; m_y *= v.m_y; m_z *= v.m_z; return *this; }
+        inline vec3x8& operator/=(const vec3x8& v) { m_x /= v.m_x; m_y /= v.m_y; m_z /= v.m_z; return *this; }
+        inline vec3x8& operator*=(const floatx8& t) { m_x *= t; m_y *= t; m_z *= t; return *this; }
+        inline vec3x8& operator/=(const floatx8& t) { return *this *= floatx8(1.f) / t; }
+
+        inline floatx8 squaredLength() const { return m_x * m_x + m_y * m_y + m_z * m_z; }
+        inline floatx8 length() const { return sqrtx8(squaredLength()); }
+        inline void makeUnitVector() { *this /= length(); }
+
+    private:
+        floatx8 m_x;
+        floatx8 m_y;
+        floatx8 m_z;
+    };
+
+    inline vec3x8 operator+(const vec3x8& v1, const vec3x8& v2)
+    {
+        return vec3x8(v1.x() + v2.x(), v1.y() + v2.y(), v1.z() + v2.z());
+    }
+
+    inline vec3x8 operator-(const vec3x8& v1, const vec3x8& v2)
+    {
+        return vec3x8(v1.x() - v2.x(), v1.y() - v2.y(), v1.z() - v2.z());
+    }
+
+    inline vec3x8 operator*(const vec3x8& v1, const vec3x8& v2)
+    {
+        return vec3x8(v1.x() * v2.x(), v1.y() * v2.y(), v1.z() * v2.z());
+    }
+
+    inline vec3x8 operator/(const vec3x8& v1, const vec3x8& v2)
+    {
+        return vec3x8(v1.x() / v2.x(), v1.y() / v2.y(), v1.z() / v2.z());
+    }
+
+    inline vec3x8 operator*(const vec3x8& v, const floatx8& t)
+    {
+        return vec3x8(v.x() * t, v.y() * t, v.z() * t);
+    }
+
+    inline vec3x8 operator/(const vec3x8& v, const floatx8& t)
+    {
+        return v * (floatx8(1.f) / t);
+    }
+
+    inline vec3x8 operator*(const floatx8& t, const vec3x8& v)
+    {
+        return vec3x8(v.x() * t, v.y() * t, v.z() * t);
+    }
+
+    inline floatx8 dot(const vec3x8& v1, const vec3x8& v2)
+    {
+        return v1.x() * v2.x() + v1.y() * v2.y() + v1.z() * v2.z();
+    }
+
+    inline vec3x8 cross(const vec3x8& v1, const vec3x8& v2)
+    {
+        return vec3x8(
+            v1.y() * v2.z() - v1.z() * v2.y(),
+            v1.z() * v2.x() - v1.x() * v2.z(),
+            v1.x() * v2.y() - v1.y() * v2.x());
+    }
+
+    inline vec3x8 unitVector(const vec3x8& v)
+    {
+        return v / v.length();
+    }
+
+    // Pick the vectors of v1 in the lanes where the mask is set and the ones of v2 elsewhere
+    inline vec3x8 select(const floatx8& mask, const vec3x8& v1, const vec3x8& v2)
+    {
+        return vec3x8(select(mask, v1.x(), v2.x()), select(mask, v1.y(), v2.y()), select(mask, v1.z(), v2.z()));
+    }
+}
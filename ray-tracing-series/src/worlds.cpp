@@ -0,0 +1,93 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include "worlds.h"
+
+#include <cmath>
+
+#include "config.h"
+#include "defines.h"
+#include "random.h"
+#include "scene.h"
+#include "vec3.h"
+
+namespace rts
+{
+    void generateCustomWorld(Scene& scene)
+    {
+        auto lambertianMat1 = scene.addMaterial(makeLambertianRecord(vec3(0.1f, 0.2f, 0.5f)));
+        auto lambertianMat2 = scene.addMaterial(makeLambertianRecord(vec3(0.8f, 0.8f, 0.f)));
+        auto metallicMat = scene.addMaterial(makeMetalRecord(vec3(0.8f, 0.6f, 0.2f), 0.3f));
+        auto dielectricMat = scene.addMaterial(makeDielectricRecord(vec3(1.f, 1.f, 1.f), 1.5f));
+
+        scene.addSphere(vec3(0.f, 0.f, -1.f), 0.5f, lambertianMat1);        // diffuse sphere at the center of the screen
+        scene.addSphere(vec3(0.f, -100.5f, -1.f), 100.f, lambertianMat2);   // diffuse sphere representing the ground
+        scene.addSphere(vec3(1.f, 0.f, -1.f), 0.5f, metallicMat);           // metallic sphere on the right side of the diffuse one
+        scene.addSphere(vec3(-1.f, 0.f, -1.f), 0.5f, dielectricMat);        // glass sphere on the left side of the diffuse one
+        scene.addSphere(vec3(-1.f, 0.f, -1.f), -0.45f, dielectricMat);      // activate this to make the glass sphere hollow (negative radius)
+
+        scene.setCamera({ { 3.f, 3.f, 2.f }, { 0.f, 0.f, -1.f }, { 0.f, 1.f, 0.f }, 20.f, 2.f, 0.f, 0.f, 0.f });
+    }
+
+    void generateSimpleCustomWorld(Scene& scene)
+    {
+        float R = cos(static_cast<int>(M_PI) / 4.f);
+        scene.addSphere(vec3(-R, 0.f, -1.f), R, scene.addMaterial(makeLambertianRecord(vec3(0.f, 0.f, 1.f))));
+        scene.addSphere(vec3(R, 0.f, -1.f), R, scene.addMaterial(makeLambertianRecord(vec3(1.f, 0.f, 0.f))));
+
+        scene.setCamera({ { 3.f, 3.f, 2.f }, { 0.f, 0.f, -1.f }, { 0.f, 1.f, 0.f }, 20.f, 2.f, 0.f, 0.f, 0.f });
+    }
+
+    void generateRandomWorld(Scene& scene, const DispersionRecord& glassDispersion, bool groundSphere)
+    {
+        std::uint32_t groundMaterial = scene.addMaterial(makeLambertianRecord(vec3(0.5f, 0.5f, 0.5f)));
+        if (groundSphere)
+        {
+            scene.addSphere(vec3(0.f, -1000.f, 0.f), 1000.f, groundMaterial);
+        }
+        else
+        {
+            scene.addPlane(vec3(0.f, 0.f, 0.f), vec3(0.f, 1.f, 0.f), groundMaterial);
+        }
+
+        Random random;
+        for (int a = -11; a < 11; ++a)
+        {
+            for (int b = -11; b < 11; ++b)
+            {
+                float chooseMat = random.get();
+                vec3 center(a + 0.9f * random.get(), 0.2f, b + 0.9f * random.get());
+
+                if ((center - vec3(4.f, 0.2f, 0.f)).length() > 0.9f)
+                {
+                    if (chooseMat < 0.8f) // diffuse
+                    {
+                        scene.addSphere(center, 0.2f,
+                            scene.addMaterial(makeLambertianRecord(vec3(random.get() * random.get(), random.get() * random.get(), random.get() * random.get()))));
+                    }
+                    else if (chooseMat < 0.95f) // metal
+                    {
+                        scene.addSphere(center, 0.2f,
+                            scene.addMaterial(makeMetalRecord(vec3(0.5f * (1.f + random.get()), 0.5f * (1.f + random.get()), 0.5f * (1.f + random.get())), 0.5f * random.get())));
+                    }
+                    else // glass
+                    {
+                        scene.addSphere(center, 0.2f, scene.addMaterial(makeDielectricRecord(vec3(1.f, 1.f, 1.f), 1.5f), Scene::NO_TEXTURE, glassDispersion));
+                    }
+                }
+            }
+        }
+
+        scene.addSphere(vec3(0.f, 1.f, 0.f), 1.f, scene.addMaterial(makeDielectricRecord(vec3(1.f, 1.f, 1.f), 1.5f), Scene::NO_TEXTURE, glassDispersion));
+        scene.addSphere(vec3(-4.f, 1.f, 0.f), 1.f, scene.addMaterial(makeLambertianRecord(vec3(0.4f, 0.2f, 0.1f))));
+        scene.addSphere(vec3(4.f, 1.f, 0.f), 1.f, scene.addMaterial(makeMetalRecord(vec3(0.7f, 0.6f, 0.5f), 0.f)));
+
+        scene.setCamera({ { 6.f, 1.5f, -2.f }, { 4.f, 1.1667f, -1.333f }, { 0.f, 1.f, 0.f }, CAMERA_FOV, 0.02f, 0.f, 0.f, 0.f });
+    }
+}
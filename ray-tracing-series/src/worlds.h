@@ -0,0 +1,28 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include "dielectric.h"
+
+namespace rts // for ray tracing series
+{
+    class Scene;
+
+    // The built-in worlds rendered when no scene file is given, the scene still has to be committed
+
+    // The final scene of the book, a ground with 3 bigger spheres and around 500 small ones of random materials
+    // the glass spheres get the given dispersion, the world is otherwise the same
+    // the ground is a plane, or the book's sphere of radius 1000 with groundSphere which is only meant for comparison
+    void generateRandomWorld(Scene& scene, const DispersionRecord& glassDispersion = makeNoDispersionRecord(), bool groundSphere = false);
+
+    // A few spheres of each material on a ground sphere
+    void generateCustomWorld(Scene& scene);
+    void generateSimpleCustomWorld(Scene& scene);
+}
@@ -0,0 +1,200 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "hitablebvh.h"
+#include "hitablelist.h"
+#include "lambertian.h"
+#include "plane.h"
+#include "random.h"
+#include "ray.h"
+#include "sphere.h"
+#include "sphereset.h"
+#include "test.h"
+#include "threadpool.h"
+
+using namespace rts;
+
+namespace
+{
+    const int TEST_SPHERE_COUNT = 2000;
+    const int TEST_RAY_COUNT = 5000;
+
+    std::vector<SphereRecord> generateSpheres(Random& random)
+    {
+        std::vector<SphereRecord> spheres(TEST_SPHERE_COUNT);
+        for (auto& sphere : spheres)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                sphere.center[axis] = 20.f * random.get() - 10.f;
+            }
+            sphere.radius = 0.05f + 0.3f * random.get();
+            sphere.materialIndex = 0;
+        }
+        return spheres;
+    }
+
+    // A ray from a random point of the volume of the spheres towards a random direction
+    Ray generateRay(Random& random)
+    {
+        vec3 origin(24.f * random.get() - 12.f, 24.f * random.get() - 12.f, 24.f * random.get() - 12.f);
+        vec3 direction(random.get() - 0.5f, random.get() - 0.5f, random.get() - 0.5f);
+        return Ray(origin, direction);
+    }
+
+    // The closest hit by testing every sphere, the reference of the hierarchies
+    bool intersectAll(const std::vector<SphereRecord>& spheres, const Ray& r, float& t)
+    {
+        bool hitAnything = false;
+        float closestSoFar = std::numeric_limits<float>::max();
+        for (const auto& sphere : spheres)
+        {
+            float sphereT;
+            if (Sphere::intersect(vec3(sphere.center[0], sphere.center[1], sphere.center[2]), sphere.radius * sphere.radius, r, 0.001f, closestSoFar, sphereT))
+            {
+                closestSoFar = sphereT;
+                hitAnything = true;
+            }
+        }
+        t = closestSoFar;
+        return hitAnything;
+    }
+
+    // The closest hits of the set must be the ones of the brute force, along with their normals
+    int countMismatches(const SphereSet& sphereSet, const std::vector<SphereRecord>& spheres, Random& random)
+    {
+        int mismatchCount = 0;
+        for (int i = 0; i < TEST_RAY_COUNT; ++i)
+        {
+            Ray r = generateRay(random);
+            float t;
+            bool expected = intersectAll(spheres, r, t);
+            HitRecord rec;
+            bool found = sphereSet.hit(r, 0.001f, std::numeric_limits<float>::max(), rec);
+            mismatchCount += (found != expected || (found && (rec.t != t || std::fabs(rec.normal.length() - 1.f) > 1e-4f))) ? 1 : 0;
+        }
+        return mismatchCount;
+    }
+
+    void checkSphereSet(BvhBuildMethod buildMethod)
+    {
+        Random random(1);
+        std::vector<SphereRecord> spheres = generateSpheres(random);
+        std::vector<std::unique_ptr<Material>> materials;
+        materials.push_back(std::make_unique<Lambertian>(vec3(0.5f, 0.5f, 0.5f)));
+        SphereSet sphereSet(spheres.data(), spheres.size(), materials, buildMethod, getThreadPool());
+        RTS_CHECK(countMismatches(sphereSet, spheres, random) == 0);
+    }
+}
+
+// The hierarchies must find the same closest hit as the brute force, the sphere test being the same
+RTS_TEST(bvh, binnedSahMatchesBruteForce)
+{
+    checkSphereSet(BvhBuildMethod::BinnedSah);
+}
+
+RTS_TEST(bvh, lbvhMatchesBruteForce)
+{
+    checkSphereSet(BvhBuildMethod::Lbvh);
+}
+
+// The terms of the radius kept by the set must follow the edits of its spheres: the added, the removed and the resized ones
+// a removed sphere is replaced by the last one as the set expects
+RTS_TEST(bvh, editedSphereSetMatchesBruteForce)
+{
+    Random random(3);
+    std::vector<SphereRecord> spheres = generateSpheres(random);
+    std::vector<std::unique_ptr<Material>> materials;
+    materials.push_back(std::make_unique<Lambertian>(vec3(0.5f, 0.5f, 0.5f)));
+    SphereSet sphereSet(spheres.data(), spheres.size(), materials, BvhBuildMethod::BinnedSah, getThreadPool());
+
+    for (int i = 0; i < 100; ++i)
+    {
+        auto index = static_cast<std::uint32_t>(random.get() * (spheres.size() - 1));
+        sphereSet.removeSphere(index);
+        spheres[index] = spheres.back();
+        spheres.pop_back();
+    }
+    Random newSpheresRandom(4);
+    std::vector<SphereRecord> newSpheres = generateSpheres(newSpheresRandom);
+    for (int i = 0; i < 100; ++i)
+    {
+        spheres.push_back(newSpheres[i]);
+        sphereSet.addSphere(newSpheres[i]);
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        spheres[i].radius *= 2.f;
+    }
+    sphereSet.update(spheres.data(), spheres.size(), getThreadPool());
+    RTS_CHECK(countMismatches(sphereSet, spheres, random) == 0);
+}
+
+// A ray parallel to an axis which lies in a face of a box computes 0 * inf for that face, it must still enter the box where it should
+RTS_TEST(bvh, axisParallelRaysInBoxFaces)
+{
+    const float boundsMin[3] = { 0.f, 0.f, 0.f };
+    const float boundsMax[3] = { 1.f, 1.f, 1.f };
+    int failureCount = 0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        for (float direction : { 1.f, -1.f })
+        {
+            // The ray starts 1 unit before the box along the axis and runs in each face parallel to it
+            int faceAxis = (axis + 1) % 3;
+            for (float faceValue : { 0.f, 1.f })
+            {
+                vec3 origin(0.5f, 0.5f, 0.5f);
+                origin[axis] = (direction > 0.f) ? -1.f : 2.f;
+                origin[faceAxis] = faceValue;
+                vec3 rayDirection(0.f, 0.f, 0.f);
+                rayDirection[axis] = direction;
+                float t = intersectBox(boundsMin, boundsMax, Ray(origin, rayDirection), 0.f, std::numeric_limits<float>::max());
+                failureCount += (std::fabs(t - 1.f) < 1e-5f) ? 0 : 1; // the normalized direction may be 1 ulp short
+            }
+        }
+    }
+    RTS_CHECK(failureCount == 0);
+}
+
+// The hitables without bounds are kept out of the hierarchy but must still be hit, in front of the bounded ones or behind them
+RTS_TEST(bvh, unboundedHitablesMatchList)
+{
+    Random random(2);
+    std::vector<SphereRecord> spheres = generateSpheres(random);
+    auto material = std::make_shared<Lambertian>(vec3(0.5f, 0.5f, 0.5f));
+    HitableBvh hitableBvh;
+    HitableList hitableList;
+    for (const auto& sphere : spheres)
+    {
+        vec3 center(sphere.center[0], sphere.center[1], sphere.center[2]);
+        hitableBvh.add(std::make_unique<Sphere>(center, sphere.radius, material));
+        hitableList.add(std::make_unique<Sphere>(center, sphere.radius, material));
+    }
+    hitableBvh.add(std::make_unique<Plane>(vec3(0.f, -2.f, 0.f), vec3(0.f, 1.f, 0.f), material.get()));
+    hitableList.add(std::make_unique<Plane>(vec3(0.f, -2.f, 0.f), vec3(0.f, 1.f, 0.f), material.get()));
+    hitableBvh.build(BvhBuildMethod::BinnedSah, getThreadPool());
+    RTS_CHECK(hitableBvh.getHitableCount() == spheres.size() + 1);
+
+    int mismatchCount = 0;
+    for (int i = 0; i < TEST_RAY_COUNT; ++i)
+    {
+        Ray r = generateRay(random);
+        HitRecord bvhRec, listRec;
+        bool bvhHit = hitableBvh.hit(r, 0.001f, std::numeric_limits<float>::max(), bvhRec);
+        bool listHit = hitableList.hit(r, 0.001f, std::numeric_limits<float>::max(), listRec);
+        mismatchCount += (bvhHit != listHit || (bvhHit && bvhRec.t != listRec.t)) ? 1 : 0;
+    }
+    RTS_CHECK(mismatchCount == 0);
+}
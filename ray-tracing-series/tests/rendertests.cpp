@@ -0,0 +1,291 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "camera.h"
+#include "hdrimage.h"
+#include "meshloader.h"
+#include "raytracer.h"
+#include "scene.h"
+#include "test.h"
+#include "threadpool.h"
+#include "transform.h"
+#include "worlds.h"
+
+using namespace rts;
+
+namespace
+{
+    const int TEST_IMAGE_WIDTH = 64;
+    const int TEST_IMAGE_HEIGHT = 48;
+    const int TEST_SAMPLE_COUNT = 4;
+
+    // A quad of two triangles in the plane z = depth
+    TriangleMeshData makeQuad(float depth)
+    {
+        TriangleMeshData mesh;
+        const float corners[4][2] = { { -1.f, 0.f }, { 1.f, 0.f }, { 1.f, 1.5f }, { -1.f, 1.5f } };
+        for (const auto& corner : corners)
+        {
+            mesh.vertices.push_back({ { corner[0], corner[1], depth }, { 0.f, 0.f, 1.f } });
+        }
+        mesh.indices = { 0, 1, 2, 0, 2, 3 };
+        return mesh;
+    }
+
+    // A scene with every kind of geometry which the binary format keeps in place: the spheres of the world, the moving spheres
+    // and the spheres and the meshes of a group, along with a mesh and a plane in the world
+    void buildTestScene(Scene& scene)
+    {
+        std::uint32_t ground = scene.addMaterial(makeLambertianRecord(vec3(0.5f, 0.5f, 0.5f)));
+        std::uint32_t red = scene.addMaterial(makeLambertianRecord(vec3(0.8f, 0.2f, 0.1f)));
+        std::uint32_t metal = scene.addMaterial(makeMetalRecord(vec3(0.8f, 0.8f, 0.7f), 0.1f));
+
+        scene.addPlane(vec3(0.f, 0.f, 0.f), vec3(0.f, 1.f, 0.f), ground);
+        for (int i = 0; i < 8; ++i)
+        {
+            scene.addSphere(vec3(-3.5f + i, 0.3f, 1.f), 0.3f, (i % 2 == 0) ? red : metal);
+        }
+        scene.addMovingSphere(vec3(0.f, 1.5f, 0.f), vec3(0.f, 1.7f, 0.f), 0.f, 1.f, 0.4f, metal);
+        scene.addMesh(makeQuad(-3.f), metal);
+
+        std::uint32_t group = scene.addGroup();
+        scene.addGroupSphere(group, vec3(0.f, 0.5f, 0.f), 0.5f, red);
+        scene.addGroupMesh(group, makeQuad(-0.6f), red);
+        scene.addInstance(group, Transform::translation(vec3(-2.f, 0.f, -1.f)));
+        scene.addInstance(group, Transform::translation(vec3(2.f, 0.f, -1.f)));
+
+        scene.setCamera({ { 0.f, 2.f, 8.f }, { 0.f, 0.5f, 0.f }, { 0.f, 1.f, 0.f }, 40.f, 0.f, 0.f, 0.f, 1.f });
+    }
+
+    // Move, add and remove a few spheres of the world, then refit
+    void editTestScene(Scene& scene)
+    {
+        scene.moveSphere(0, vec3(-3.5f, 1.f, 1.5f), 0.5f);
+        scene.addSphere(vec3(0.f, 0.25f, 3.f), 0.25f, 1);
+        scene.removeSphere(3);
+        scene.update();
+    }
+
+    void render(const Scene& scene, HdrImage& image)
+    {
+        image.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+        auto camera = scene.createCamera(static_cast<float>(TEST_IMAGE_WIDTH) / TEST_IMAGE_HEIGHT);
+        rayTracingMainTask(*camera, scene, TEST_SAMPLE_COUNT, &image);
+    }
+
+    // Render in bands of the given height on the calling thread, as without multithreading when the band is the whole image
+    void renderInBands(const Camera& camera, const Scene& scene, int bandHeight, HdrImage& image)
+    {
+        image.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+        for (int startLine = 0; startLine < image.height; startLine += bandHeight)
+        {
+            rayTracingSubTask(camera, scene, TEST_SAMPLE_COUNT, &image, nullptr, nullptr, startLine, std::min(startLine + bandHeight, image.height), 0);
+        }
+    }
+
+#ifdef DETERMINISTIC_RNG
+    // Render on a pool of its own with the given number of threads, the main task runs on the pool as it waits for its sub tasks
+    void renderOnPool(const Camera& camera, const Scene& scene, unsigned int threadCount, HdrImage& image)
+    {
+        image.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+        ThreadPool pool(threadCount);
+        std::vector<const Scene*> nodeScenes(pool.getNodeCount(), &scene);
+        std::promise<void> done;
+        std::future<void> doneFuture = done.get_future();
+        pool.submit([&]()
+        {
+            rayTracingMainTask(camera, nodeScenes, TEST_SAMPLE_COUNT, &image, nullptr, &pool);
+            done.set_value();
+        });
+        doneFuture.wait();
+    }
+
+    // Every split of the render must produce the same bits as the whole image traced on a single thread
+    void checkDeterministicRender(const Scene& scene)
+    {
+        auto camera = scene.createCamera(static_cast<float>(TEST_IMAGE_WIDTH) / TEST_IMAGE_HEIGHT);
+        HdrImage reference;
+        renderInBands(*camera, scene, TEST_IMAGE_HEIGHT, reference);
+
+        HdrImage black;
+        black.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+        RTS_CHECK(countDifferentPixels(reference, black) > 0);
+
+        HdrImage image;
+        for (int bandHeight : { 1, 7, 16 })
+        {
+            renderInBands(*camera, scene, bandHeight, image);
+            RTS_CHECK(countDifferentPixels(image, reference) == 0);
+        }
+        for (unsigned int threadCount : { 1u, 2u, 3u, 8u })
+        {
+            renderOnPool(*camera, scene, threadCount, image);
+            RTS_CHECK(countDifferentPixels(image, reference) == 0);
+        }
+        image.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+        rayTracingMainTask(*camera, scene, TEST_SAMPLE_COUNT, &image);
+        RTS_CHECK(countDifferentPixels(image, reference) == 0);
+    }
+#endif // DETERMINISTIC_RNG
+
+    // A sphere whose material turns every path which hits it into NaN, in front of a uniform background
+    // the background is exactly representable so that the average of any number of its samples is the background itself
+    void buildNanScene(Scene& scene)
+    {
+        float nan = std::numeric_limits<float>::quiet_NaN();
+        std::uint32_t material = scene.addMaterial(makeLambertianRecord(vec3(nan, nan, nan)));
+        scene.addSphere(vec3(0.f, 0.f, 0.f), 1.f, material);
+        scene.setBackground({ { 0.5f, 0.5f, 0.5f }, { 0.5f, 0.5f, 0.5f } });
+        scene.setCamera({ { 0.f, 0.f, 4.f }, { 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, 40.f, 0.f, 0.f, 0.f, 0.f });
+        scene.commit();
+    }
+
+    // The pixels must be the background where a sample is valid and black where none is, the NaN samples being left out of the count
+    // return the number of pixels which are neither
+    int countMisaveragedPixels(const HdrImage& image)
+    {
+        int count = 0;
+        for (const vec3& pixel : image.pixels)
+        {
+            bool isBackground = pixel.r() == 0.5f && pixel.g() == 0.5f && pixel.b() == 0.5f;
+            bool isBlack = pixel.r() == 0.f && pixel.g() == 0.f && pixel.b() == 0.f;
+            count += (isBackground || isBlack) ? 0 : 1;
+        }
+        return count;
+    }
+}
+
+#ifdef DETERMINISTIC_RNG
+// The random numbers of a sample only depend on the frame, the pixel and the sample index, not on the threads or the bands
+// without DETERMINISTIC_RNG each generator draws a key of its own, the images aren't meant to be reproduced
+RTS_TEST(render, deterministicAcrossThreads)
+{
+    Scene scene;
+    generateRandomWorld(scene);
+    scene.commit();
+    checkDeterministicRender(scene);
+}
+
+// The same in the spectral mode, whose wavelengths are drawn from the same streams
+RTS_TEST(render, deterministicAcrossThreadsSpectral)
+{
+    Scene scene;
+    generateRandomWorld(scene);
+    scene.commit();
+    setSpectralRendering(true);
+    checkDeterministicRender(scene);
+    setSpectralRendering(false);
+}
+#endif // DETERMINISTIC_RNG
+
+// The frames of an animation draw different numbers, their noise isn't the same
+RTS_TEST(render, framesDiffer)
+{
+    Scene scene;
+    generateRandomWorld(scene);
+    scene.commit();
+    auto camera = scene.createCamera(static_cast<float>(TEST_IMAGE_WIDTH) / TEST_IMAGE_HEIGHT);
+    HdrImage firstFrame, secondFrame;
+    renderInBands(*camera, scene, TEST_IMAGE_HEIGHT, firstFrame);
+    setFrameIndex(1);
+    renderInBands(*camera, scene, TEST_IMAGE_HEIGHT, secondFrame);
+    setFrameIndex(0);
+    RTS_CHECK(countDifferentPixels(firstFrame, secondFrame) > 0);
+}
+
+// The edits of a committed scene loaded from a binary file unmap the file, the hitables which read it in place must follow
+// the render must match the one of the same edits on a copy of the file made before the scene was committed, with DETERMINISTIC_RNG
+RTS_TEST(render, editMappedScene)
+{
+    std::string filePath = test::getOutputPath("edit_mapped_scene.rtsb");
+    {
+        Scene scene;
+        buildTestScene(scene);
+        RTS_REQUIRE(scene.saveBinaryFile(filePath));
+    }
+
+    Scene mappedScene;
+    RTS_REQUIRE(mappedScene.loadBinaryFile(filePath));
+    mappedScene.commit();
+    HdrImage image;
+    render(mappedScene, image);
+    editTestScene(mappedScene);
+    render(mappedScene, image);
+
+    Scene copiedScene;
+    RTS_REQUIRE(copiedScene.loadBinaryFile(filePath));
+    copiedScene.copyMappedData();
+    copiedScene.commit();
+    editTestScene(copiedScene);
+    HdrImage reference;
+    render(copiedScene, reference);
+
+    HdrImage black;
+    black.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    RTS_CHECK(countDifferentPixels(reference, black) > 0);
+#ifdef DETERMINISTIC_RNG
+    RTS_CHECK(countDifferentPixels(image, reference) == 0);
+#endif // DETERMINISTIC_RNG
+}
+
+// The final render leaves the NaN samples out of the average of their pixel, some of the pixels on the edge of the sphere have both kinds
+RTS_TEST(render, invalidSamplesLeftOut)
+{
+    Scene scene;
+    buildNanScene(scene);
+    auto camera = scene.createCamera(static_cast<float>(TEST_IMAGE_WIDTH) / TEST_IMAGE_HEIGHT);
+    HdrImage image;
+    image.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    SampleDiagnostics diagnostics;
+    diagnostics.invalidSamples.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    rayTracingMainTask(*camera, scene, TEST_SAMPLE_COUNT, &image, nullptr, &diagnostics);
+
+    int partialPixelCount = 0;
+    for (const vec3& fraction : diagnostics.invalidSamples.pixels)
+    {
+        partialPixelCount += (fraction.r() > 0.f && fraction.r() < 1.f) ? 1 : 0;
+    }
+    RTS_CHECK(diagnostics.getInvalidSampleCount() > 0);
+    RTS_CHECK(partialPixelCount > 0);
+    RTS_CHECK(countMisaveragedPixels(image) == 0);
+}
+
+// The progressive passes follow the same policy, with DETERMINISTIC_RNG they trace the same samples and give the same image
+RTS_TEST(render, progressiveInvalidSamplesLeftOut)
+{
+    Scene scene;
+    buildNanScene(scene);
+    auto camera = scene.createCamera(static_cast<float>(TEST_IMAGE_WIDTH) / TEST_IMAGE_HEIGHT);
+    AccumulationImage accumulation;
+    accumulation.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    for (int passIndex = 0; passIndex < TEST_SAMPLE_COUNT; ++passIndex)
+    {
+        RTS_REQUIRE(rayTracingProgressivePass(*camera, scene, passIndex, 1, &accumulation, nullptr));
+    }
+    HdrImage image;
+    image.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    accumulation.resolve(image);
+    RTS_CHECK(countMisaveragedPixels(image) == 0);
+
+#ifdef DETERMINISTIC_RNG
+    HdrImage reference;
+    reference.resize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    rayTracingMainTask(*camera, scene, TEST_SAMPLE_COUNT, &reference);
+    RTS_CHECK(countDifferentPixels(image, reference) == 0);
+#endif // DETERMINISTIC_RNG
+}
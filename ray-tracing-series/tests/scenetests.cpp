@@ -0,0 +1,217 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "hdrimage.h"
+#include "hitable.h"
+#include "ray.h"
+#include "scene.h"
+#include "test.h"
+#include "transform.h"
+#include "worlds.h"
+
+using namespace rts;
+
+namespace
+{
+    std::string readFile(const std::string& filePath)
+    {
+        std::ifstream file(filePath, std::ios::binary);
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    bool writeFile(const std::string& filePath, const std::string& content)
+    {
+        std::ofstream file(filePath);
+        file << content;
+        return file.good();
+    }
+
+    // Load a scene file referencing files by relative paths, then save it in other directories, it must load back from each of them
+    // the same directory, the working directory, a directory which is gone up from and one which can only be given absolute paths
+    // hasFile tells whether the file was found by the loaded scene
+    void checkSavedPaths(const std::string& sourcePath, bool (*hasFile)(const Scene&))
+    {
+        Scene scene;
+        RTS_REQUIRE(scene.loadTextFile(sourcePath));
+        RTS_REQUIRE(hasFile(scene));
+
+        const char* savedPaths[] = { "test-output/saved_paths.txt", "saved_paths.txt", "test-output/./saved_paths.txt",
+            "test-output/../test-output/saved_paths.txt" };
+        for (const char* savedPath : savedPaths)
+        {
+            RTS_REQUIRE(scene.saveTextFile(savedPath));
+            Scene savedScene;
+            RTS_CHECK(savedScene.loadTextFile(savedPath));
+            RTS_CHECK(hasFile(savedScene));
+        }
+    }
+
+    // A small image next to the scene files of the path tests
+    bool writeTestImage(const std::string& filePath)
+    {
+        HdrImage image;
+        image.resize(4, 2);
+        image.at(1, 1) = vec3(2.f, 1.f, 0.5f);
+        return saveHdrFile(image, filePath);
+    }
+}
+
+// A saved text file must load back into the same scene, which is checked by saving it again
+RTS_TEST(scene, textRoundTrip)
+{
+    Scene scene;
+    generateRandomWorld(scene);
+    std::string firstPath = test::getOutputPath("text_round_trip_1.txt");
+    std::string secondPath = test::getOutputPath("text_round_trip_2.txt");
+    RTS_REQUIRE(scene.saveTextFile(firstPath));
+
+    Scene loadedScene;
+    RTS_REQUIRE(loadedScene.loadTextFile(firstPath));
+    RTS_CHECK(loadedScene.getSphereCount() == scene.getSphereCount());
+    RTS_CHECK(loadedScene.getPlaneCount() == scene.getPlaneCount());
+    RTS_CHECK(loadedScene.getMaterialCount() == scene.getMaterialCount());
+    RTS_REQUIRE(loadedScene.saveTextFile(secondPath));
+    RTS_CHECK(readFile(firstPath) == readFile(secondPath));
+}
+
+// The values which don't fit in 6 digits must be written exactly, the scene loaded from the text file is saved in the binary format
+// to be compared with the original to the bit
+RTS_TEST(scene, textRoundTripIsExact)
+{
+    Scene scene;
+    std::uint32_t material = scene.addMaterial(makeMetalRecord(vec3(0.123456789f, 0.2f, 0.3f), 0.0123456789f));
+    scene.addSphere(vec3(1.23456789f, -2.3456789f, 1e-7f), 1.23456789f, material);
+    scene.addPlane(vec3(0.f, -0.333333333f, 0.f), vec3(0.f, 1.f, 0.f), material);
+    std::uint32_t group = scene.addGroup();
+    scene.addGroupSphere(group, vec3(0.1f, 0.2f, 0.3f), 0.7f, material);
+    scene.addInstance(group, Transform::translation(vec3(13.123456789f, 0.f, -7.7777777f)) * Transform::rotationY(33.3f));
+    scene.setCamera({ { 13.123456789f, 2.1f, 3.3f }, { 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, 20.123456f, 0.1f, 10.987654321f, 0.f, 0.f });
+
+    std::string textPath = test::getOutputPath("exact_round_trip.txt");
+    std::string firstPath = test::getOutputPath("exact_round_trip_1.rtsb");
+    std::string secondPath = test::getOutputPath("exact_round_trip_2.rtsb");
+    RTS_REQUIRE(scene.saveTextFile(textPath));
+    RTS_REQUIRE(scene.saveBinaryFile(firstPath));
+
+    Scene loadedScene;
+    RTS_REQUIRE(loadedScene.loadTextFile(textPath));
+    RTS_REQUIRE(loadedScene.saveBinaryFile(secondPath));
+    RTS_CHECK(readFile(firstPath) == readFile(secondPath));
+}
+
+// The same through the binary format, the loaded scene is saved as text to be compared
+RTS_TEST(scene, binaryRoundTrip)
+{
+    Scene scene;
+    generateRandomWorld(scene);
+    std::string binaryPath = test::getOutputPath("binary_round_trip.rtsb");
+    std::string firstPath = test::getOutputPath("binary_round_trip_1.txt");
+    std::string secondPath = test::getOutputPath("binary_round_trip_2.txt");
+    RTS_REQUIRE(scene.saveBinaryFile(binaryPath));
+    RTS_REQUIRE(scene.saveTextFile(firstPath));
+
+    Scene loadedScene;
+    RTS_REQUIRE(loadedScene.loadBinaryFile(binaryPath));
+    RTS_CHECK(loadedScene.getSphereCount() == scene.getSphereCount());
+    RTS_CHECK(loadedScene.getPlaneCount() == scene.getPlaneCount());
+    RTS_REQUIRE(loadedScene.saveTextFile(secondPath));
+    RTS_CHECK(readFile(firstPath) == readFile(secondPath));
+}
+
+// The image textures are saved with a path which still leads to them from the saved file
+RTS_TEST(scene, texturePathsFollowSavedFile)
+{
+    std::string sourcePath = test::getOutputPath("texture_paths.txt");
+    RTS_REQUIRE(writeTestImage(test::getOutputPath("path_image.pfm")));
+    RTS_REQUIRE(writeFile(sourcePath, "texture image image path_image.pfm\nmaterial textured lambertian 1 1 1 texture image\n"
+        "sphere 0 0 0 1 textured\n"));
+    checkSavedPaths(sourcePath, [](const Scene& scene) { return scene.getTextureCount() == 1; });
+}
+
+// The same for the image of the environment
+RTS_TEST(scene, environmentPathFollowsSavedFile)
+{
+    std::string sourcePath = test::getOutputPath("environment_path.txt");
+    RTS_REQUIRE(writeTestImage(test::getOutputPath("path_environment.pfm")));
+    RTS_REQUIRE(writeFile(sourcePath, "environment path_environment.pfm 2 90\n"));
+    checkSavedPaths(sourcePath, [](const Scene& scene) { return scene.getEnvironment() != nullptr; });
+}
+
+// A relative name may contain a colon, only a drive letter makes a path absolute
+RTS_TEST(scene, colonInRelativePath)
+{
+    std::string sourcePath = test::getOutputPath("colon_path.txt");
+    RTS_REQUIRE(writeTestImage(test::getOutputPath("path:image.pfm")));
+    RTS_REQUIRE(writeFile(sourcePath, "texture image image path:image.pfm\nmaterial textured lambertian 1 1 1 texture image\n"
+        "sphere 0 0 0 1 textured\n"));
+    checkSavedPaths(sourcePath, [](const Scene& scene) { return scene.getTextureCount() == 1; });
+}
+
+// The same for the brick files, the loader fails when one of them is missing, the spheres of the world are all in the bricks
+RTS_TEST(scene, brickPathsFollowSavedFile)
+{
+    std::string spheresPath = test::getOutputPath("brick_spheres.txt");
+    std::string sourcePath = test::getOutputPath("brick_paths.txt");
+    RTS_REQUIRE(writeFile(spheresPath, "material red lambertian 0.8 0.1 0.1\nsphere 0 0 0 1 red\nsphere 2 0 0 0.5 red\n"));
+    Scene scene;
+    RTS_REQUIRE(scene.loadTextFile(spheresPath));
+    RTS_REQUIRE(scene.saveTextFile(sourcePath, true));
+    checkSavedPaths(sourcePath, [](const Scene& scene) { return scene.getSphereCount() == 0; });
+}
+
+// The shutter of each frame of an animation is shifted by its time, the moving spheres must still be hit at the last frames
+// long after the shutter interval of the camera
+RTS_TEST(scene, movingSpheresHitAtLateFrames)
+{
+    Scene scene;
+    std::uint32_t material = scene.addMaterial(makeLambertianRecord(vec3(0.5f, 0.5f, 0.5f)));
+    scene.addMovingSphere(vec3(-4.f, 0.f, 0.f), vec3(-3.f, 0.f, 0.f), 0.f, 1.f, 0.5f, material);
+    scene.setCamera({ { 0.f, 0.f, 10.f }, { 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, 40.f, 0.f, 0.f, 0.f, 1.f });
+    scene.addCameraKeyframe({ 0.f, { 0.f, 0.f, 10.f }, { 0.f, 0.f, 0.f }, 0.f, 0.f });
+    scene.addCameraKeyframe({ 10.f, { 0.f, 0.f, 10.f }, { 0.f, 0.f, 0.f }, 0.f, 0.f });
+    scene.commit();
+
+    // The sphere moves by one unit per second, the rays are traced at the times of the shutter of the frames
+    int missCount = 0;
+    for (float frameTime : { 0.f, 2.5f, 8.f, 10.f })
+    {
+        CameraRecord camera = scene.getCameraAt(frameTime);
+        for (float time : { camera.shutterOpen, 0.5f * (camera.shutterOpen + camera.shutterClose), camera.shutterClose })
+        {
+            Ray r(vec3(time - 4.f, 0.f, 10.f), vec3(0.f, 0.f, -1.f), time);
+            HitRecord rec;
+            missCount += scene.getWorld().hit(r, 0.001f, std::numeric_limits<float>::max(), rec) ? 0 : 1;
+        }
+    }
+    RTS_CHECK(missCount == 0);
+}
+
+// The invalid statements are rejected with the whole file rather than loaded partially
+RTS_TEST(scene, invalidStatementsRejected)
+{
+    std::string filePath = test::getOutputPath("invalid_statement.txt");
+    Scene scene;
+
+    RTS_REQUIRE(writeFile(filePath, "material ground lambertian 0.5 0.5 0.5\nplane 0 0 0 0 0 0 ground\n"));
+    RTS_CHECK(!scene.loadTextFile(filePath));
+
+    RTS_REQUIRE(writeFile(filePath, "sphere 0 0 0 1 unknown_material\n"));
+    RTS_CHECK(!scene.loadTextFile(filePath));
+
+    RTS_REQUIRE(writeFile(filePath, "material ground lambertian 0.5 0.5 0.5\nplane 0 0 0 0 1 0 ground\n"));
+    RTS_CHECK(scene.loadTextFile(filePath));
+    RTS_CHECK(scene.getPlaneCount() == 1);
+}
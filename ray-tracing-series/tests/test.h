@@ -0,0 +1,56 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace rts // for ray tracing series
+{
+    namespace test
+    {
+        // A test case, its suite is the name of the file it's defined in without the "tests.cpp" suffix, CTest runs one suite per test
+        struct TestCase
+        {
+            const char* suite;
+            const char* name;
+            void (*function)();
+        };
+
+        // The test cases register themselves before main() runs (see RTS_TEST)
+        std::vector<TestCase>& getTestCases();
+
+        struct TestRegistration
+        {
+            TestRegistration(const char* suite, const char* name, void (*function)())
+            {
+                getTestCases().push_back({ suite, name, function });
+            }
+        };
+
+        // Report a failed check of the running test case, it carries on unless the check was required
+        void reportFailure(const char* file, int line, const std::string& message);
+
+        // The path of a file written by a test in the output directory of the working directory
+        std::string getOutputPath(const std::string& fileName);
+    }
+}
+
+#define RTS_TEST(suite, name) \
+    static void suite##_##name(); \
+    static const rts::test::TestRegistration suite##_##name##_registration(#suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define RTS_CHECK(condition) \
+    do { if (!(condition)) { rts::test::reportFailure(__FILE__, __LINE__, #condition); } } while (false)
+
+// The same for a check which the rest of the test case depends on, the test case returns when it fails
+#define RTS_REQUIRE(condition) \
+    do { if (!(condition)) { rts::test::reportFailure(__FILE__, __LINE__, #condition); return; } } while (false)
@@ -0,0 +1,81 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include <cstring>
+#include <iostream>
+
+#include "test.h"
+
+namespace rts
+{
+    namespace
+    {
+        const char* TEST_OUTPUT_DIRECTORY = "test-output";
+
+        int s_failureCount = 0;
+    }
+
+    namespace test
+    {
+        std::vector<TestCase>& getTestCases()
+        {
+            static std::vector<TestCase> testCases;
+            return testCases;
+        }
+
+        void reportFailure(const char* file, int line, const std::string& message)
+        {
+            std::cerr << file << ":" << line << ": check failed: " << message << std::endl;
+            ++s_failureCount;
+        }
+
+        std::string getOutputPath(const std::string& fileName)
+        {
+            return std::string(TEST_OUTPUT_DIRECTORY) + "/" + fileName;
+        }
+    }
+}
+
+// Run the test cases of the suites given as arguments, or all of them without arguments
+// the output directory is expected in the working directory, the build creates it along with the CTest tests
+// the exit code is 1 if a check failed or if no test case matched the arguments
+int main(int argc, char* argv[])
+{
+    using namespace rts;
+
+    int runCount = 0;
+    int failedCount = 0;
+    for (const auto& testCase : test::getTestCases())
+    {
+        bool selected = (argc < 2);
+        for (int i = 1; i < argc; ++i)
+        {
+            selected = selected || std::strcmp(argv[i], testCase.suite) == 0;
+        }
+        if (!selected)
+        {
+            continue;
+        }
+
+        int failureCount = s_failureCount;
+        testCase.function();
+        bool passed = (s_failureCount == failureCount);
+        std::cout << (passed ? "[  OK  ] " : "[FAILED] ") << testCase.suite << "." << testCase.name << std::endl;
+        ++runCount;
+        failedCount += passed ? 0 : 1;
+    }
+
+    if (runCount == 0)
+    {
+        std::cerr << "No test case matches the arguments" << std::endl;
+        return 1;
+    }
+    std::cout << runCount - failedCount << " of " << runCount << " test cases passed" << std::endl;
+    return (failedCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+/**
+ * MIT License
+ * Copyright (c) 2019 Guillaume Riby <guillaumeriby@gmail.com>
+ *
+ * GitHub repository - https://github.com/griby/ray-tracing-series
+ *
+ * A ray tracer implementation based on the Ray Tracing in One Weekend Book Series by Peter Shirley - https://raytracing.github.io/
+ */
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <thread>
+
+#include "test.h"
+#include "threadpool.h"
+
+using namespace rts;
+
+namespace
+{
+    const int TEST_TASK_COUNT = 64;
+    const int TEST_SUB_TASK_COUNT = 16;
+}
+
+// The tasks may spawn and wait for sub tasks of their own, every task must run once whatever the number of threads
+RTS_TEST(threadpool, nestedGroupsComplete)
+{
+    for (unsigned int threadCount : { 1u, 2u, 5u })
+    {
+        ThreadPool pool(threadCount);
+        std::atomic<int> runCount(0);
+        TaskGroup group(&pool);
+        for (int i = 0; i < TEST_TASK_COUNT; ++i)
+        {
+            group.run([&]()
+            {
+                TaskGroup subGroup(&pool);
+                for (int j = 0; j < TEST_SUB_TASK_COUNT; ++j)
+                {
+                    subGroup.run([&]() { ++runCount; });
+                }
+                subGroup.wait();
+                ++runCount;
+            });
+        }
+        group.wait();
+        RTS_CHECK(runCount.load() == TEST_TASK_COUNT * (TEST_SUB_TASK_COUNT + 1));
+    }
+}
+
+// A thread waiting for a group it can't help sleeps rather than spinning, the process barely uses the processor while the task sleeps
+RTS_TEST(threadpool, waitDoesNotSpin)
+{
+    ThreadPool pool(1);
+    TaskGroup group(&pool);
+    std::clock_t startTime = std::clock();
+    group.runOnNode(0, []() { std::this_thread::sleep_for(std::chrono::milliseconds(300)); }, true); // bound, only a worker runs it
+    group.wait();
+    double cpuTime = static_cast<double>(std::clock() - startTime) / CLOCKS_PER_SEC;
+    RTS_CHECK(cpuTime < 0.1);
+}